@@ -0,0 +1,127 @@
+// Accept throughput benchmark
+//
+// ループバック上で「接続 -> リクエスト送信 -> 応答受信 -> 切断」を繰り返し、
+// 1秒あたりに受け付けられた接続数を Accept 方式ごとに比較する。
+//
+//   single    : 接続ごとに IORING_OP_ACCEPT を再発行する (従来方式)
+//   multishot : IORING_ACCEPT_MULTISHOT
+//   direct    : IORING_ACCEPT_MULTISHOT + IORING_FILE_INDEX_ALLOC
+//
+// usage: accept_bench [seconds=3] [client_threads=4]
+
+#include "ouroboros/http.hpp"
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace ouroboros::http;
+
+    void hello(const request &, response &res) {
+        res.set_body("ok");
+    }
+
+    // サーバーを専用スレッドで起動する (イベントループは終了しないためデタッチする)
+    bool start_server(uint16_t port, const server_options &options) {
+        std::atomic<int> state{ 0 };
+        std::thread([&state, port, options] {
+            io_context ctx;
+            auto svr = server::create(ctx, port, options);
+            if (!svr) {
+                std::cerr << "server::create failed: " << svr.error().message() << std::endl;
+                state = -1;
+                return;
+            }
+            svr->load_routes({ { method::GET, "/", hello } });
+            if (!svr->start()) {
+                state = -1;
+                return;
+            }
+            state = 1;
+            ctx.run();
+        }).detach();
+
+        while (state == 0) std::this_thread::yield();
+        return state == 1;
+    }
+
+    // 1接続 = 1リクエストのクライアント。成功した接続数を返す
+    uint64_t client_loop(uint16_t port, std::chrono::steady_clock::time_point deadline) {
+        constexpr std::string_view request_text = "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        uint64_t accepted = 0;
+        char buf[512];
+        while (std::chrono::steady_clock::now() < deadline) {
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0) continue;
+            // TIME_WAIT でエフェメラルポートを使い果たさないよう RST で閉じる
+            linger lg{ 1, 0 };
+            setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+            if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0 &&
+                ::send(fd, request_text.data(), request_text.size(), MSG_NOSIGNAL) > 0) {
+                ssize_t n;
+                bool responded = false;
+                while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) responded = true;
+                if (responded) accepted++;
+            }
+            ::close(fd);
+        }
+        return accepted;
+    }
+
+    void run_case(std::string_view name, uint16_t port, const server_options &options, int seconds, int clients) {
+        if (!start_server(port, options)) {
+            std::clog << name << ": unavailable" << std::endl;
+            return;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        std::vector<std::thread> threads;
+        std::atomic<uint64_t> total{ 0 };
+        for (int i = 0; i < clients; ++i) {
+            threads.emplace_back([&] { total += client_loop(port, deadline); });
+        }
+        for (auto &t : threads) t.join();
+
+        std::clog << name << ": " << total / static_cast<uint64_t>(seconds) << " conn/s" << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 3;
+    int clients = argc > 2 ? std::atoi(argv[2]) : 4;
+    if (seconds <= 0 || clients <= 0) {
+        std::cerr << "usage: accept_bench [seconds] [client_threads]" << std::endl;
+        return 1;
+    }
+
+    // サーバーの接続ログを抑制する (計測結果は std::clog へ出力)
+    std::cout.rdbuf(nullptr);
+
+    server_options single;
+    single.multishot_accept = false;
+    single.direct_descriptors = false;
+    server_options multishot;
+    multishot.direct_descriptors = false;
+    server_options direct;
+
+    run_case("single   ", 18081, single, seconds, clients);
+    run_case("multishot", 18082, multishot, seconds, clients);
+    run_case("direct   ", 18083, direct, seconds, clients);
+
+    // サーバースレッドは終了しないため、そのままプロセスを終了する
+    std::quick_exit(0);
+}
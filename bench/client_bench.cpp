@@ -0,0 +1,122 @@
+// HTTP client benchmark
+//
+// ouroboros のサーバーを専用スレッドで起動し、同じプロセスの別の io_context 上で
+// http::client からループバックで GET を繰り返す。
+// concurrency 個のコルーチンがそれぞれ「co_await request -> 応答」を繰り返し、
+// クライアントは上流ごとの接続プール (max_connections 本) とパイプライン (max_pipeline 段) で送る。
+// 1秒あたりのリクエスト数、確立した接続数、クライアント側の io_uring_enter の回数 (1リクエストあたり) を表示する。
+//
+// 続けて実行すると、前回の接続の TIME_WAIT と送信元ポートが重なった新しい接続がリセットされることがある
+// (ループバックで tcp_tw_reuse が有効な場合。failed に数えられる。間隔を空けるか port を変える)
+//
+// usage: client_bench [seconds=3] [concurrency=64] [max_connections=16] [max_pipeline=4]
+
+#include "ouroboros/http.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace ouroboros::http;
+
+    constexpr uint16_t port = 18085;
+
+    void hello(const request &, response &res) {
+        res.set_body("ok");
+    }
+
+    // サーバーを専用スレッドで起動する (イベントループは終了しないためデタッチする)
+    bool start_server() {
+        std::atomic<int> state{ 0 }; // 1: 起動, -1: 失敗
+        std::thread([&state] {
+            io_context ctx;
+            auto svr = server::create(ctx, port);
+            if (!svr || !svr->start()) {
+                state = -1;
+                return;
+            }
+            svr->load_routes({ { method::GET, "/", hello } });
+            state = 1;
+            ctx.run();
+        }).detach();
+
+        while (state == 0) std::this_thread::yield();
+        return state == 1;
+    }
+
+    struct counters
+    {
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+    };
+
+    coro::task<void> worker(client &cl, std::chrono::steady_clock::time_point deadline, counters &stats) {
+        while (std::chrono::steady_clock::now() < deadline) {
+            auto res = co_await cl.request("127.0.0.1", port, { .target = "/" });
+            if (res && res->status == 200 && res->body == "ok") {
+                stats.completed++;
+            } else {
+                stats.failed++;
+                if (!res) std::clog << "request failed: " << res.error().message() << std::endl;
+            }
+        }
+    }
+
+    // 全てのワーカーが終わったらイベントループを止める
+    struct join_counter : task
+    {
+        io_context &ctx;
+        size_t remaining;
+
+        join_counter(io_context &c, size_t n) : ctx(c), remaining(n) {}
+        void complete(int, uint32_t) override {
+            if (--remaining == 0) ctx.stop();
+        }
+    };
+}
+
+int main(int argc, char **argv) {
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 3;
+    int concurrency = argc > 2 ? std::atoi(argv[2]) : 64;
+    int connections = argc > 3 ? std::atoi(argv[3]) : 16;
+    int pipeline = argc > 4 ? std::atoi(argv[4]) : 4;
+    if (seconds <= 0 || concurrency <= 0 || connections <= 0 || pipeline <= 0) {
+        std::cerr << "usage: client_bench [seconds] [concurrency] [max_connections] [max_pipeline]" << std::endl;
+        return 1;
+    }
+
+    // サーバーの接続ログを抑制する (計測結果は std::clog へ出力)
+    std::cout.rdbuf(nullptr);
+    if (!start_server()) {
+        std::cerr << "server start failed" << std::endl;
+        return 1;
+    }
+
+    io_context ctx;
+    client cl(ctx, { .max_connections = static_cast<size_t>(connections), .max_pipeline = static_cast<size_t>(pipeline) });
+
+    counters stats;
+    join_counter joined(ctx, static_cast<size_t>(concurrency));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    std::vector<coro::task<void>> workers;
+    for (int i = 0; i < concurrency; ++i) {
+        workers.push_back(worker(cl, deadline, stats));
+        workers.back().start(joined);
+    }
+    uint64_t syscalls_before = ctx.syscalls();
+    ctx.run();
+    uint64_t syscalls = ctx.syscalls() - syscalls_before;
+
+    std::clog << "requests/s         : " << stats.completed / static_cast<uint64_t>(seconds) << std::endl;
+    std::clog << "failed             : " << stats.failed << std::endl;
+    std::clog << "connections opened : " << cl.connections_opened() << std::endl;
+    std::clog << "enter per request  : "
+              << (stats.completed ? static_cast<double>(syscalls) / static_cast<double>(stats.completed) : 0.0) << std::endl;
+
+    // サーバースレッドは終了しないため、そのままプロセスを終了する
+    std::quick_exit(0);
+}
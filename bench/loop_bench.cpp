@@ -0,0 +1,136 @@
+// Event loop syscall benchmark
+//
+// ループバック上の Keep-Alive 接続で「リクエスト送信 -> 応答受信」を繰り返し、
+// 1秒あたりのリクエスト数と、サーバーが発行した io_uring_enter の回数 (1リクエストあたり) を表示する。
+// イベントループは完了処理で積まれた SQE の送信と次の完了の待機を一度の io_uring_enter で行うため、
+// 同時接続数が増えるほど 1リクエストあたりの回数は 1 を下回る。
+//
+// usage: loop_bench [seconds=3] [connections=32] [pipeline_depth=1]
+
+#include "ouroboros/http.hpp"
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace ouroboros::http;
+
+    void hello(const request &, response &res) {
+        res.set_body("ok");
+    }
+
+    // サーバーを専用スレッドで起動し、その io_context を返す (イベントループは終了しないためデタッチする)
+    io_context *start_server(uint16_t port) {
+        std::atomic<io_context *> started{ nullptr };
+        std::atomic<bool> failed{ false };
+        std::thread([&started, &failed, port] {
+            io_context ctx;
+            auto svr = server::create(ctx, port);
+            if (!svr || !svr->start()) {
+                failed = true;
+                return;
+            }
+            svr->load_routes({ { method::GET, "/", hello } });
+            started = &ctx;
+            ctx.run();
+        }).detach();
+
+        while (!started && !failed) std::this_thread::yield();
+        return started;
+    }
+
+    // 1接続で depth 個ずつリクエストを送り、応答を全て受け取るまで待つ。完了したリクエスト数を返す
+    uint64_t client_loop(uint16_t port, int depth, std::chrono::steady_clock::time_point deadline) {
+        constexpr std::string_view request_text = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        constexpr std::string_view response_end = "\r\n\r\nok";
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return 0;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            return 0;
+        }
+
+        std::string batch;
+        for (int i = 0; i < depth; ++i) batch += request_text;
+
+        uint64_t completed = 0;
+        char buf[16 * 1024];
+        std::string pending;
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (::send(fd, batch.data(), batch.size(), MSG_NOSIGNAL) <= 0) break;
+            int remaining = depth;
+            while (remaining > 0) {
+                ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0) {
+                    ::close(fd);
+                    return completed;
+                }
+                pending.append(buf, static_cast<size_t>(n));
+                size_t pos;
+                while (remaining > 0 && (pos = pending.find(response_end)) != std::string::npos) {
+                    pending.erase(0, pos + response_end.size());
+                    remaining--;
+                    completed++;
+                }
+            }
+        }
+        ::close(fd);
+        return completed;
+    }
+}
+
+int main(int argc, char **argv) {
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 3;
+    int connections = argc > 2 ? std::atoi(argv[2]) : 32;
+    int depth = argc > 3 ? std::atoi(argv[3]) : 1;
+    if (seconds <= 0 || connections <= 0 || depth <= 0) {
+        std::cerr << "usage: loop_bench [seconds] [connections] [pipeline_depth]" << std::endl;
+        return 1;
+    }
+
+    // サーバーの接続ログを抑制する (計測結果は std::clog へ出力)
+    std::cout.rdbuf(nullptr);
+
+    constexpr uint16_t port = 18084;
+    io_context *ctx = start_server(port);
+    if (!ctx) {
+        std::cerr << "server start failed" << std::endl;
+        return 1;
+    }
+
+    uint64_t syscalls_before = ctx->syscalls();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    std::vector<std::thread> threads;
+    std::atomic<uint64_t> total{ 0 };
+    for (int i = 0; i < connections; ++i) {
+        threads.emplace_back([&] { total += client_loop(port, depth, deadline); });
+    }
+    for (auto &t : threads) t.join();
+    uint64_t syscalls = ctx->syscalls() - syscalls_before;
+
+    std::clog << "requests/s         : " << total / static_cast<uint64_t>(seconds) << std::endl;
+    std::clog << "io_uring_enter     : " << syscalls << std::endl;
+    std::clog << "enter per request  : " << (total ? static_cast<double>(syscalls) / static_cast<double>(total) : 0.0)
+              << std::endl;
+
+    // サーバースレッドは終了しないため、そのままプロセスを終了する
+    std::quick_exit(0);
+}
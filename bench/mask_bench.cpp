@@ -0,0 +1,98 @@
+// WebSocket unmasking benchmark
+//
+// 典型的な大きさのペイロードを繰り返しマスク解除し、websocket_masker の実装ごと (scalar / sse2 / avx2) の
+// スループットと、websocket_parser::parse 全体 (ヘッダーの解析 + マスク解除) の1フレームあたりの所要時間を計測する。
+//
+//   64B / 256B : チャットや通知などの小さなメッセージ
+//   4KB / 64KB : 一つの受信バッファ・大きなバイナリメッセージ
+//
+// usage: mask_bench [iterations=200000]
+
+#include "ouroboros/http/websocket_protocol.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    using namespace ouroboros::http;
+
+    constexpr uint32_t mask_key = 0x37fa213d;
+
+    // 最適化でマスク解除が消えないよう結果を集約する
+    volatile size_t sink = 0;
+
+    template <typename F>
+    double measure_ns(int iterations, F &&body) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) body();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    }
+
+    // クライアントが送るマスク付きのバイナリフレーム
+    std::string masked_frame(size_t size) {
+        std::string frame;
+        frame.push_back(static_cast<char>(0x82));
+        if (size < 126) {
+            frame.push_back(static_cast<char>(0x80 | size));
+        } else if (size <= 0xffff) {
+            frame.push_back(static_cast<char>(0x80 | 126));
+            frame.push_back(static_cast<char>(size >> 8));
+            frame.push_back(static_cast<char>(size & 0xff));
+        } else {
+            frame.push_back(static_cast<char>(0x80 | 127));
+            for (int shift = 56; shift >= 0; shift -= 8) frame.push_back(static_cast<char>((size >> shift) & 0xff));
+        }
+        char key[4];
+        std::memcpy(key, &mask_key, 4);
+        frame.append(key, 4);
+        for (size_t i = 0; i < size; ++i) frame.push_back(static_cast<char>('a' + i % 26));
+        return frame;
+    }
+
+    void run_size(size_t size, int iterations) {
+        // 大きなペイロードは回数を減らして計測時間を揃える
+        int n = std::max(1, static_cast<int>(static_cast<size_t>(iterations) * 256 / std::max<size_t>(size, 256)));
+        std::cout << "[" << size << " bytes]" << std::endl;
+
+        std::vector<char> payload(size, 'x');
+        for (auto kind : { websocket_masker::isa::scalar, websocket_masker::isa::sse2, websocket_masker::isa::avx2 }) {
+            const websocket_masker *m = websocket_masker::get(kind);
+            if (!m) continue;
+            double ns = measure_ns(n, [&] {
+                m->apply(payload.data(), payload.size(), mask_key);
+                sink = sink + static_cast<unsigned char>(payload[size / 2]);
+            });
+            std::cout << "  unmask " << m->name << ": " << ns << " ns/frame, "
+                      << static_cast<double>(size) / ns << " GB/s" << std::endl;
+        }
+
+        // パーサーはその場でマスクを解除するため、毎回元のフレームを書き戻す (コピーの時間を含む)
+        const std::string frame = masked_frame(size);
+        std::string buffer = frame;
+        websocket_parser parser(size);
+        double ns = measure_ns(n, [&] {
+            std::memcpy(buffer.data(), frame.data(), frame.size());
+            size_t consumed = 0;
+            std::string_view piece;
+            if (parser.parse(buffer.data(), buffer.size(), consumed, piece) != websocket_parser::status::payload) std::abort();
+            sink = sink + piece.size();
+        });
+        std::cout << "  websocket_parser (" << websocket_masker::active().name << ", with copy): " << ns << " ns/frame"
+                  << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200000;
+    if (iterations <= 0) iterations = 1;
+
+    for (size_t size : { size_t{ 64 }, size_t{ 256 }, size_t{ 4 * 1024 }, size_t{ 64 * 1024 } }) run_size(size, iterations);
+    return 0;
+}
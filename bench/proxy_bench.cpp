@@ -0,0 +1,165 @@
+// Reverse proxy benchmark
+//
+// 上流サーバー2台 (18086, 18087) とリバースプロキシ (18088) をそれぞれ専用スレッドで起動し、
+// 同じプロセスの http::client からプロキシ経由で GET を繰り返す。
+// body_size のレスポンスボディは上流のソケット -> パイプ -> クライアントのソケットへ SPLICE で転送される。
+// 1秒あたりのリクエスト数、上流ごとの処理数 (負荷分散の確認)、プロキシ側の io_uring_enter の回数を表示する。
+//
+// usage: proxy_bench [seconds=3] [concurrency=64] [body_size=2] [policy=rr|least]
+
+#include "ouroboros/http.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace ouroboros::http;
+
+    constexpr uint16_t upstream_ports[] = { 18086, 18087 };
+    constexpr uint16_t proxy_port = 18088;
+
+    std::atomic<uint64_t> upstream_hits[2];
+    std::atomic<uint64_t> proxy_syscalls{ 0 };
+
+    // 計測スレッドから読めるよう、一定間隔で io_uring_enter の回数を公開する
+    struct syscall_publisher : task
+    {
+        io_context &ctx;
+        timer tick{ *this };
+
+        explicit syscall_publisher(io_context &c) : ctx(c) { ctx.timers().arm(tick, std::chrono::milliseconds(10)); }
+        void complete(int, uint32_t) override {
+            proxy_syscalls.store(ctx.syscalls(), std::memory_order_relaxed);
+            ctx.timers().arm(tick, std::chrono::milliseconds(10));
+        }
+    };
+
+    // 専用スレッドでサーバーを起動する (イベントループは終了しないためデタッチする)
+    template <typename Setup>
+    bool start_server(uint16_t port, Setup setup, bool count_syscalls = false) {
+        std::atomic<int> state{ 0 }; // 1: 起動, -1: 失敗
+        std::thread([&state, port, setup, count_syscalls] {
+            io_context ctx;
+            auto svr = server::create(ctx, port);
+            if (!svr || !svr->start()) {
+                state = -1;
+                return;
+            }
+            setup(*svr);
+            state = 1;
+            if (!count_syscalls) {
+                ctx.run();
+                return;
+            }
+            syscall_publisher publisher(ctx);
+            ctx.run();
+        }).detach();
+
+        while (state == 0) std::this_thread::yield();
+        return state == 1;
+    }
+
+    struct counters
+    {
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+    };
+
+    coro::task<void> worker(client &cl, std::chrono::steady_clock::time_point deadline, size_t body_size, counters &stats) {
+        while (std::chrono::steady_clock::now() < deadline) {
+            auto res = co_await cl.request("127.0.0.1", proxy_port, { .target = "/api/" });
+            if (res && res->status == 200 && res->body.size() == body_size) {
+                stats.completed++;
+            } else {
+                stats.failed++;
+                if (!res) std::clog << "request failed: " << res.error().message() << std::endl;
+            }
+        }
+    }
+
+    // 全てのワーカーが終わったらイベントループを止める
+    struct join_counter : task
+    {
+        io_context &ctx;
+        size_t remaining;
+
+        join_counter(io_context &c, size_t n) : ctx(c), remaining(n) {}
+        void complete(int, uint32_t) override {
+            if (--remaining == 0) ctx.stop();
+        }
+    };
+}
+
+int main(int argc, char **argv) {
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 3;
+    int concurrency = argc > 2 ? std::atoi(argv[2]) : 64;
+    long body_size = argc > 3 ? std::atol(argv[3]) : 2;
+    std::string policy = argc > 4 ? argv[4] : "rr";
+    if (seconds <= 0 || concurrency <= 0 || body_size < 0 || (policy != "rr" && policy != "least")) {
+        std::cerr << "usage: proxy_bench [seconds] [concurrency] [body_size] [rr|least]" << std::endl;
+        return 1;
+    }
+
+    // サーバーの接続ログを抑制する (計測結果は std::clog へ出力)
+    std::cout.rdbuf(nullptr);
+    std::string body(static_cast<size_t>(body_size), 'x');
+    for (size_t i = 0; i < 2; ++i) {
+        bool started = start_server(upstream_ports[i], [&body, i](server &svr) {
+            svr.load_routes({ { method::GET, "/", [body, i](const request &, response &res) {
+                                   upstream_hits[i].fetch_add(1, std::memory_order_relaxed);
+                                   res.set_body(body);
+                               } } });
+        });
+        if (!started) {
+            std::cerr << "upstream start failed" << std::endl;
+            return 1;
+        }
+    }
+
+    proxy_options options;
+    for (auto port : upstream_ports) options.backends.push_back({ "127.0.0.1", port });
+    options.balance = policy == "rr" ? balance_policy::round_robin : balance_policy::least_outstanding;
+    options.strip_prefix = "/api";
+    reverse_proxy api(std::move(options));
+    bool started = start_server(
+        proxy_port, [&api](server &svr) {
+            std::vector<route_entry> routes;
+            api.mount(routes, "/api/*rest");
+            svr.load_routes(routes);
+        },
+        true);
+    if (!started) {
+        std::cerr << "proxy start failed" << std::endl;
+        return 1;
+    }
+
+    io_context ctx;
+    client cl(ctx, { .max_connections = 16, .max_pipeline = 1 });
+
+    counters stats;
+    join_counter joined(ctx, static_cast<size_t>(concurrency));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    std::vector<coro::task<void>> workers;
+    for (int i = 0; i < concurrency; ++i) {
+        workers.push_back(worker(cl, deadline, static_cast<size_t>(body_size), stats));
+        workers.back().start(joined);
+    }
+    uint64_t syscalls_before = proxy_syscalls.load(std::memory_order_relaxed);
+    ctx.run();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t syscalls = proxy_syscalls.load(std::memory_order_relaxed) - syscalls_before;
+
+    std::clog << "requests/s         : " << stats.completed / static_cast<uint64_t>(seconds) << std::endl;
+    std::clog << "failed             : " << stats.failed << std::endl;
+    std::clog << "upstream hits      : " << upstream_hits[0].load() << " / " << upstream_hits[1].load() << std::endl;
+    std::clog << "proxy enter/request: "
+              << (stats.completed ? static_cast<double>(syscalls) / static_cast<double>(stats.completed) : 0.0) << std::endl;
+
+    // サーバースレッドは終了しないため、そのままプロセスを終了する
+    std::quick_exit(0);
+}
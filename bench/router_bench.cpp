@@ -0,0 +1,136 @@
+// Routing benchmark
+//
+// 約600ルートのテーブルで、以前の実装 (std::map による完全一致検索 + std::function のコピー) と
+// router (圧縮基数木、ハンドラは参照で返す) の1検索あたりの所要時間を比較する。
+// router 側はパラメータ付きのルート (/api/vN/resourceM/:id) の検索も計測する。
+// また、8ルートの小さなテーブルで router と static_router (コンパイル時生成の照合 + 直接呼び出し) の
+// 検索とハンドラ呼び出しを合わせた所要時間を比較する。
+//
+// usage: router_bench [iterations=2000000]
+
+#include "ouroboros/http/router.hpp"
+#include "ouroboros/http/static_router.hpp"
+#include "ouroboros/http/member_binder.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace ouroboros::http;
+
+    volatile size_t sink = 0;
+
+    void count(const request &, response &) {
+        sink = sink + 1;
+    }
+
+    struct api
+    {
+        void get_user(const request &req, response &) {
+            sink = sink + req.params["id"].size();
+        }
+    };
+
+    // paths を順に巡回しながら検索する
+    template <typename F>
+    double measure_ns(size_t iterations, const std::vector<std::string> &paths, F &&body) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0, j = 0; i < iterations; ++i) {
+            body(paths[j]);
+            if (++j == paths.size()) j = 0;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    if (iterations == 0) iterations = 1;
+
+    // 4バージョン x 50リソース x 3 = 600ルート
+    std::vector<std::string> static_paths;
+    std::vector<std::string> param_paths;
+    router table;
+    std::map<std::string, handler_function, std::less<>> legacy;
+    handler_function handler = [](const request &, response &) {};
+
+    for (int version = 1; version <= 4; ++version) {
+        for (int resource = 0; resource < 50; ++resource) {
+            std::string base = "/api/v" + std::to_string(version) + "/resource" + std::to_string(resource);
+            for (std::string path : { base, base + "/search" }) {
+                table.add(method::GET, path, handler);
+                legacy[path] = handler;
+                static_paths.push_back(path);
+            }
+            table.add(method::GET, base + "/:id", handler);
+            param_paths.push_back(base + "/" + std::to_string(10000 + resource));
+        }
+    }
+    std::cout << "routes: " << static_paths.size() + param_paths.size() << std::endl;
+
+    double legacy_ns = measure_ns(iterations, static_paths, [&](const std::string &path) {
+        std::optional<handler_function> found;
+        if (auto it = legacy.find(std::string_view(path)); it != legacy.end()) found = it->second;
+        sink = sink + (found ? 1 : 0);
+    });
+    std::cout << "  std::map + std::function copy (static): " << legacy_ns << " ns/lookup" << std::endl;
+
+    path_params params;
+    double radix_ns = measure_ns(iterations, static_paths, [&](const std::string &path) {
+        sink = sink + (table.find(method::GET, path, params) ? 1 : 0);
+    });
+    std::cout << "  router (static): " << radix_ns << " ns/lookup" << std::endl;
+
+    double param_ns = measure_ns(iterations, param_paths, [&](const std::string &path) {
+        sink = sink + (table.find(method::GET, path, params) ? params.size() : 0);
+    });
+    std::cout << "  router (:id): " << param_ns << " ns/lookup" << std::endl;
+
+    // --- 小さな固定テーブル: router + std::function vs static_router ---
+    api controller;
+    static_router<
+        route<"GET", "/", &count>,
+        route<"GET", "/health", &count>,
+        route<"GET", "/metrics", &count>,
+        route<"POST", "/login", &count>,
+        route<"GET", "/users", &count>,
+        route<"POST", "/users", &count>,
+        route<"GET", "/users/:id", &api::get_user>,
+        route<"GET", "/static/*path", &count>
+    > compiled{ controller };
+
+    router dynamic;
+    dynamic.add(method::GET, "/", count);
+    dynamic.add(method::GET, "/health", count);
+    dynamic.add(method::GET, "/metrics", count);
+    dynamic.add(method::POST, "/login", count);
+    dynamic.add(method::GET, "/users", count);
+    dynamic.add(method::POST, "/users", count);
+    dynamic.add(method::GET, "/users/:id", bind_member(&api::get_user, &controller));
+    dynamic.add(method::GET, "/static/*path", count);
+
+    const std::vector<std::string> small_paths = { "/", "/health", "/metrics", "/users", "/users/42", "/static/app.js" };
+    std::cout << "small table (8 routes, lookup + call):" << std::endl;
+
+    request req;
+    response res;
+    double dynamic_ns = measure_ns(iterations, small_paths, [&](const std::string &path) {
+        req.path = path;
+        if (auto *route = dynamic.find(method::GET, req.path, req.params)) route->handler(req, res);
+    });
+    std::cout << "  router: " << dynamic_ns << " ns/request" << std::endl;
+
+    double compiled_ns = measure_ns(iterations, small_paths, [&](const std::string &path) {
+        req.path = path;
+        compiled.dispatch(method::GET, req, res);
+    });
+    std::cout << "  static_router: " << compiled_ns << " ns/request" << std::endl;
+    return 0;
+}
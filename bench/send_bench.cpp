@@ -0,0 +1,147 @@
+// Send throughput benchmark (copy vs zero-copy)
+//
+// ループバックの TCP 接続へ同じペイロードを繰り返し送信し、ペイロードの大きさごとに
+// 送信方式のスループットを比較する。受信側は別スレッドで読み捨てる。
+//
+//   copy : IORING_OP_SEND (カーネルがソケットバッファへコピーする)
+//   zc   : IORING_OP_SEND_ZC + IORING_RECVSEND_FIXED_BUF (登録済みバッファから送信)
+//
+// サーバーと同じく、ゼロコピー送信ではバッファを通知 (IORING_CQE_F_NOTIF) まで再利用しない。
+// ループバックでは受信側がデータを読むまで通知が届かないため、実際の NIC より不利な条件になる。
+//
+// usage: send_bench [megabytes_per_run=1024]
+
+#include "ouroboros/http.hpp"
+#include "ouroboros/http/send_buffer_pool.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    using namespace ouroboros::http;
+
+    // 送信の完了と通知を数える
+    struct send_op : task
+    {
+        bool armed = false;
+        int result = 0;
+        int notifs = 0;
+
+        void complete(int res, uint32_t flags) override {
+            if (flags & IORING_CQE_F_NOTIF) {
+                notifs--;
+                return;
+            }
+            if (flags & IORING_CQE_F_MORE) notifs++;
+            armed = false;
+            result = res;
+        }
+    };
+
+    // ループバック上の接続済みソケットの組 (送信側, 受信側)
+    bool connect_pair(int &sender, int &receiver) {
+        int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(listener, 1) < 0 ||
+            getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len) < 0) {
+            ::close(listener);
+            return false;
+        }
+        sender = ::socket(AF_INET, SOCK_STREAM, 0);
+        bool ok = ::connect(sender, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+        receiver = ok ? ::accept(listener, nullptr, nullptr) : -1;
+        ::close(listener);
+        return ok && receiver >= 0;
+    }
+
+    // total バイトを payload 単位で送信し、スループット (GB/s) を返す (失敗時は負)
+    double run(io_context &ctx, send_buffer_pool &buffers, bool zero_copy, size_t payload, size_t total) {
+        int sender = -1;
+        int receiver = -1;
+        if (!connect_pair(sender, receiver)) return -1;
+
+        std::thread drain([receiver] {
+            static thread_local char sink[1 << 20];
+            while (::recv(receiver, sink, sizeof(sink), 0) > 0) {}
+        });
+
+        char *data = buffers.data(0);
+        send_op op;
+        size_t sent_total = 0;
+        bool failed = false;
+        auto start = std::chrono::steady_clock::now();
+        while (sent_total < total && !failed) {
+            // 一つのペイロードを送り切る (部分送信は残りを再発行する)
+            size_t offset = 0;
+            while (offset < payload) {
+                auto *sqe = ctx.get_sqe();
+                sqe->fd = sender;
+                sqe->addr = reinterpret_cast<uint64_t>(data + offset);
+                sqe->len = static_cast<uint32_t>(payload - offset);
+                if (zero_copy) {
+                    sqe->opcode = IORING_OP_SEND_ZC;
+                    sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+                    sqe->buf_index = 0;
+                } else {
+                    sqe->opcode = IORING_OP_SEND;
+                }
+                sqe->user_data = reinterpret_cast<uint64_t>(&op);
+                op.armed = true;
+                ctx.submit();
+                while (op.armed) ctx.process_completions();
+                if (op.result <= 0) {
+                    std::cerr << "send failed: " << -op.result << std::endl;
+                    failed = true;
+                    break;
+                }
+                offset += static_cast<size_t>(op.result);
+            }
+            // バッファを再利用する前に通知を待つ
+            while (op.notifs > 0) ctx.process_completions();
+            sent_total += payload;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        ::shutdown(sender, SHUT_WR);
+        drain.join();
+        ::close(sender);
+        ::close(receiver);
+        return failed ? -1 : static_cast<double>(sent_total) / seconds / 1e9;
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t total = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1024) * 1024 * 1024;
+    constexpr size_t payloads[] = { 4 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024 };
+    constexpr size_t max_payload = 4 * 1024 * 1024;
+
+    io_context ctx;
+    if (!ctx.supports(IORING_OP_SEND_ZC)) {
+        std::cerr << "IORING_OP_SEND_ZC is not supported by this kernel" << std::endl;
+        return 1;
+    }
+    auto buffers = send_buffer_pool::create(ctx, 1, max_payload);
+    if (!buffers) {
+        std::cerr << "send_buffer_pool::create failed: " << buffers.error().message() << " (RLIMIT_MEMLOCK?)" << std::endl;
+        return 1;
+    }
+    std::memset(buffers->data(0), 'x', max_payload);
+
+    std::cout << "payload      copy (GB/s)  zc (GB/s)" << std::endl;
+    for (size_t payload : payloads) {
+        double copy = run(ctx, *buffers, false, payload, total);
+        double zc = run(ctx, *buffers, true, payload, total);
+        std::cout << payload / 1024 << " KiB\t" << copy << "\t" << zc << std::endl;
+    }
+    return 0;
+}
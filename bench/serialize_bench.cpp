@@ -0,0 +1,77 @@
+// Response serialization benchmark
+//
+// 典型的なレスポンス (ステータス 200、ヘッダー2つ、短い JSON ボディ) を繰り返しシリアライズし、
+// 以前の実装 (std::stringstream + std::string へのコピー) と write_response の
+// 1レスポンスあたりの所要時間を比較する。
+//
+// usage: serialize_bench [iterations=2000000]
+
+#include "ouroboros/http/response_writer.hpp"
+#include "ouroboros/http/arena.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    using namespace ouroboros::http;
+
+    volatile size_t sink = 0;
+
+    template <typename F>
+    double measure_ns(size_t iterations, F &&body) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) body();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    if (iterations == 0) iterations = 1;
+
+    constexpr std::string_view body = "{\"status\": \"ok\", \"message\": \"Logged in successfully\"}";
+
+    // 以前の実装と同じ手順
+    std::map<std::string, std::string> legacy_headers = {
+        { "Content-Type", "application/json" },
+        { "Cache-Control", "no-store" },
+    };
+    double legacy_ns = measure_ns(iterations, [&] {
+        std::stringstream ss;
+        ss << "HTTP/1.1 " << 200 << " " << "OK" << "\r\n";
+        ss << "Content-Length: " << body.size() << "\r\n";
+        ss << "Connection: " << "keep-alive" << "\r\n";
+        for (const auto &[key, val] : legacy_headers) ss << key << ": " << val << "\r\n";
+        ss << "\r\n" << body;
+        static thread_local std::string response_buffer;
+        response_buffer = ss.str();
+        sink = sink + response_buffer.size();
+    });
+    std::cout << "std::stringstream: " << legacy_ns << " ns/response" << std::endl;
+
+    // セッションと同じく response をリクエストアリーナ上に構築し、出力バッファを再利用する
+    counting_resource upstream;
+    arena_block_pool blocks(8 * 1024);
+    request_arena arena(blocks, &upstream);
+    std::string out;
+    double writer_ns = measure_ns(iterations, [&] {
+        {
+            response res(arena.resource());
+            res.set_header("Content-Type", "application/json");
+            res.set_header("Cache-Control", "no-store");
+            res.set_body(body);
+            out.clear();
+            write_response(out, res, false, false);
+        }
+        arena.reset();
+        sink = sink + out.size();
+    });
+    std::cout << "write_response (incl. building the response): " << writer_ns << " ns/response" << std::endl;
+    std::cout << "arena overflow allocations: " << upstream.allocations() << std::endl;
+    return 0;
+}
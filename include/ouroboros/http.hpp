@@ -5,4 +5,12 @@
 
 #include "http/type_definitions.hpp"
 #include "http/member_binder.hpp"
+#include "http/router.hpp"
+#include "http/static_router.hpp"
+#include "http/static_files.hpp"
 #include "http/server.hpp"
+#include "http/runtime.hpp"
+#include "http/coro_io.hpp"
+#include "http/client.hpp"
+#include "http/reverse_proxy.hpp"
+#include "http/websocket.hpp"
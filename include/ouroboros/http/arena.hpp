@@ -0,0 +1,113 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace ouroboros::http
+{
+    // 上位リソースへの割り当てを数える memory_resource
+    // request_arena の上位リソースとして使い、アリーナから溢れた割り当て (= ヒープ割り当て) を計測する。
+    // スレッド間で共有しないこと (コアごとに一つ)
+    class counting_resource final : public std::pmr::memory_resource
+    {
+    public:
+        explicit counting_resource(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) noexcept
+            : upstream_(upstream) {}
+
+        // 累計の割り当て回数・バイト数
+        [[nodiscard]] size_t allocations() const noexcept { return allocations_; }
+        [[nodiscard]] size_t bytes_allocated() const noexcept { return bytes_allocated_; }
+        // 現在解放されていないバイト数
+        [[nodiscard]] size_t bytes_in_use() const noexcept { return bytes_in_use_; }
+
+    private:
+        void *do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+        std::pmr::memory_resource *upstream_;
+        size_t allocations_ = 0;
+        size_t bytes_allocated_ = 0;
+        size_t bytes_in_use_ = 0;
+    };
+
+    // request_arena が使う固定長ブロックの空きリスト (コアごとに一つ。スレッドセーフではない)
+    //
+    // ブロックは処理中のリクエストだけが借り、レスポンスを書き終えたら返す。返されたブロックは解放せずに
+    // 次のリクエストへ回すため、確保されるブロック数は同時に処理したリクエスト数の最大値で決まる
+    // (待機中の Keep-Alive 接続はブロックを持たない)
+    class arena_block_pool
+    {
+    public:
+        explicit arena_block_pool(size_t block_size) noexcept;
+        ~arena_block_pool();
+
+        arena_block_pool(const arena_block_pool &) = delete;
+        arena_block_pool &operator=(const arena_block_pool &) = delete;
+        arena_block_pool(arena_block_pool &&other) noexcept;
+        arena_block_pool &operator=(arena_block_pool &&) = delete;
+
+        // 空きリストから取り出す (空なら新しく確保する)
+        [[nodiscard]] std::byte *acquire();
+        // 空きリストへ戻す (O(1))
+        void release(std::byte *block) noexcept;
+
+        [[nodiscard]] size_t block_size() const noexcept { return block_size_; }
+        // 確保済みのブロック数と、そのうち空きリストにある数
+        [[nodiscard]] size_t blocks() const noexcept { return blocks_; }
+        [[nodiscard]] size_t available() const noexcept { return available_; }
+
+    private:
+        // 空きブロックの先頭に次のブロックへのリンクを置く (侵入型)
+        struct free_block
+        {
+            free_block *next;
+        };
+
+        size_t block_size_;
+        free_block *free_ = nullptr;
+        size_t blocks_ = 0;
+        size_t available_ = 0;
+    };
+
+    // リクエストごとのモノトニックアリーナ
+    //
+    // 最初の割り当ての時に arena_block_pool からブロックを借り、先頭詰めで割り当てる (個々の解放は行わない)。
+    // レスポンスの構築が終わったら reset() で丸ごと破棄し、ブロックを返す (ブロックに収まっていれば O(1))。
+    // ブロックに収まらない分だけ上位リソースから割り当てられ、reset() で返却される。
+    class request_arena final : private std::pmr::memory_resource
+    {
+    public:
+        request_arena(arena_block_pool &blocks, std::pmr::memory_resource *upstream) noexcept
+            : blocks_(blocks), upstream_(upstream) {}
+        ~request_arena() { reset(); }
+
+        request_arena(const request_arena &) = delete;
+        request_arena &operator=(const request_arena &) = delete;
+
+        // ハンドラに渡すリソース (std::pmr のコンテナに渡す)
+        [[nodiscard]] std::pmr::memory_resource *resource() noexcept { return this; }
+        // 全ての割り当てを破棄してブロックを返す (以降、それまでに割り当てた領域を参照してはならない)
+        void reset() noexcept;
+
+        [[nodiscard]] size_t block_size() const noexcept { return blocks_.block_size(); }
+        // ブロックを借りているか (このリクエストで割り当てがあったか)
+        [[nodiscard]] bool holds_block() const noexcept { return block_ != nullptr; }
+
+    private:
+        void *do_allocate(size_t bytes, size_t alignment) override;
+        // 個々の解放は行わない (reset() でまとめて破棄する)
+        void do_deallocate(void *, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+        arena_block_pool &blocks_;
+        std::pmr::memory_resource *upstream_;
+        std::byte *block_ = nullptr;
+        std::optional<std::pmr::monotonic_buffer_resource> resource_;
+    };
+}
+
+#endif // ARENA_HPP
@@ -0,0 +1,75 @@
+#ifndef BODY_DECODER_HPP
+#define BODY_DECODER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace ouroboros::http
+{
+    // リクエストボディを受信データの中で少しずつ取り出すデコーダー
+    //
+    // Content-Length のボディと Transfer-Encoding: chunked のボディを扱う。
+    // チャンクの区切り (長さの行・拡張・トレーラー) はどこで分割されていても続きから解析し、
+    // データは受信した分ずつ受信データ内の範囲として返す (コピーなし)。
+    // ボディの長さの上限は呼び出し元が返された piece の合計で判断する。
+    class body_decoder
+    {
+    public:
+        enum class status
+        {
+            incomplete, // データを使い切った (続きを待つ)
+            data,       // ボディの一部を返した
+            done,       // ボディが終わった (consumed はボディの終わりまで。以降は次のリクエスト)
+            error       // 不正なチャンク形式 (400)
+        };
+
+        // Content-Length のボディを読む
+        void reset(uint64_t length) noexcept;
+        // チャンク形式のボディを読む
+        void reset_chunked() noexcept;
+
+        // data を解析する。consumed には消費したバイト数を返す (data の場合、piece の終わりまで)
+        status decode(std::string_view data, size_t &consumed, std::string_view &piece) noexcept;
+
+        [[nodiscard]] bool chunked() const noexcept { return chunked_; }
+        // 現在のボディ・チャンクのデータの残り (区切りを解析中なら 0)
+        [[nodiscard]] uint64_t data_remaining() const noexcept { return state_ == state::data ? remaining_ : 0; }
+        // data_remaining() のうち n バイトを受信データを経由せずに読んだ (SPLICE で転送した場合)
+        void skip(uint64_t n) noexcept { remaining_ -= std::min(n, data_remaining()); }
+
+    private:
+        enum class state : uint8_t
+        {
+            data,          // ボディ (Content-Length) またはチャンクのデータ
+            size,          // チャンクの長さ (16進)
+            extension,     // チャンク拡張 (読み飛ばす)
+            size_lf,       // 長さの行の LF
+            data_end,      // チャンクのデータの後の CRLF
+            data_lf,
+            trailer_begin, // トレーラーの行頭 (空行ならボディの終わり)
+            trailer,       // トレーラーの行 (読み飛ばす)
+            trailer_lf,
+            last_lf,       // 最後の空行の LF
+            done,
+            failed
+        };
+
+        // チャンクの長さの行とトレーラーの長さの上限
+        static constexpr size_t max_line = 4096;
+        static constexpr size_t max_trailer = 16 * 1024;
+
+        status fail(size_t pos, size_t &consumed) noexcept;
+        void end_size_line() noexcept;
+
+        state state_ = state::done;
+        bool chunked_ = false;
+        uint64_t remaining_ = 0; // 現在のボディ・チャンクの残り
+        size_t digits_ = 0;      // 読んだ長さの桁数
+        size_t line_ = 0;        // 現在の行のバイト数
+        size_t trailer_ = 0;     // トレーラーのバイト数
+    };
+}
+
+#endif // BODY_DECODER_HPP
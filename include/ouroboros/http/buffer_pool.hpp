@@ -0,0 +1,100 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include <linux/io_uring.h>
+#include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/error.hpp"
+
+namespace ouroboros::http
+{
+    // カーネル管理の受信バッファプール (要件 3.2)
+    //
+    // 固定長バッファの集合を一つのバッファグループとしてリングに登録し、
+    // IOSQE_BUFFER_SELECT を指定した受信操作でカーネルに選ばせる。
+    // 使用メモリはオープン中のソケット数ではなく、処理中のリクエスト数に比例する。
+    //
+    // 登録方式:
+    //   1. IORING_REGISTER_PBUF_RING (Linux 5.19+): 共有メモリ上のリングで返却する (システムコール不要)
+    //   2. IORING_OP_PROVIDE_BUFFERS (フォールバック): 返却のたびに SQE を発行する
+    class buffer_pool
+    {
+    public:
+        static constexpr uint16_t default_group_id = 0;
+        static constexpr uint16_t default_buffer_count = 1024; // 2のべき乗であること (PBUF ring の要件)
+        static constexpr uint32_t default_buffer_size = 8192;
+
+        // Factory function for safe creation
+        [[nodiscard]] static std::expected<buffer_pool, std::error_code> create(io_context &ctx,
+            uint16_t group_id = default_group_id,
+            uint16_t buffer_count = default_buffer_count,
+            uint32_t buffer_size = default_buffer_size);
+        ~buffer_pool();
+
+        // Prohibit copying, allow moving
+        buffer_pool(const buffer_pool &) = delete;
+        buffer_pool &operator=(const buffer_pool &) = delete;
+        buffer_pool(buffer_pool &&other) noexcept;
+        buffer_pool &operator=(buffer_pool &&other) noexcept;
+
+        // CQE のフラグからカーネルが選択したバッファIDを取り出す
+        [[nodiscard]] static constexpr std::optional<uint16_t> buffer_id(uint32_t cqe_flags) noexcept {
+            if (!(cqe_flags & IORING_CQE_F_BUFFER)) return std::nullopt;
+            return static_cast<uint16_t>(cqe_flags >> IORING_CQE_BUFFER_SHIFT);
+        }
+
+        // 受信済みデータへのビュー
+        [[nodiscard]] std::string_view view(uint16_t bid, size_t length) const noexcept {
+            return { storage_ + static_cast<size_t>(bid) * buffer_size_, length };
+        }
+        // 受信済みデータの書き換え可能な先頭 (その場で変換する場合。WebSocket のマスク解除等)
+        [[nodiscard]] char *data(uint16_t bid) const noexcept { return storage_ + static_cast<size_t>(bid) * buffer_size_; }
+
+        // 使用済みバッファをカーネルへ返却する
+        void recycle(uint16_t bid) noexcept;
+
+        [[nodiscard]] uint16_t group_id() const noexcept { return group_id_; }
+        [[nodiscard]] uint16_t buffer_count() const noexcept { return buffer_count_; }
+        [[nodiscard]] uint32_t buffer_size() const noexcept { return buffer_size_; }
+        [[nodiscard]] bool uses_ring() const noexcept { return ring_ != nullptr; }
+
+    private:
+        buffer_pool(io_context &ctx, uint16_t group_id, uint16_t buffer_count, uint32_t buffer_size);
+
+        // 登録処理 (PBUF ring を試し、非対応カーネルでは PROVIDE_BUFFERS へフォールバック)
+        std::error_code register_ring();
+        std::error_code provide_all();
+        // PROVIDE_BUFFERS 用 SQE を準備する (SQ が一杯なら false)
+        bool provide(uint16_t bid, uint16_t count) noexcept;
+        void release() noexcept;
+        // リングのエントリ配列
+        // 注意: C++ では __DECLARE_FLEX_ARRAY の空構造体がサイズ1となり bufs のオフセットがずれるため、
+        // io_uring_buf_ring::bufs は使わずリング先頭から直接参照する
+        io_uring_buf *ring_buffers() const noexcept { return reinterpret_cast<io_uring_buf *>(ring_); }
+
+        io_context *ctx_;
+        uint16_t group_id_;
+        uint16_t buffer_count_;
+        uint32_t buffer_size_;
+
+        // バッファ本体 (buffer_count_ * buffer_size_ バイト、mmap で確保)
+        char *storage_ = nullptr;
+        size_t storage_sz_ = 0;
+
+        // PBUF ring (カーネルと共有するリング)
+        io_uring_buf_ring *ring_ = nullptr;
+        size_t ring_sz_ = 0;
+        uint16_t ring_tail_ = 0;
+
+        // フォールバック時、SQ が一杯で返却できなかったバッファID
+        std::vector<uint16_t> deferred_;
+    };
+}
+
+#endif // BUFFER_POOL_HPP
@@ -0,0 +1,49 @@
+#ifndef CHAR_SCANNER_HPP
+#define CHAR_SCANNER_HPP
+
+#include <cstddef>
+#include <string_view>
+
+namespace ouroboros::http
+{
+    // リクエストヘッダー走査用のベクトル化スキャナ
+    //
+    // 各関数は先頭から走査し、条件を満たさない最初の文字の位置を返す (全て満たせば n)。
+    // 区切り文字 (SP, ':', CR, LF) の検出と文字種の検証を一度の走査で行う。
+    // 実装は起動時に CPU を判定して選択する (AVX2: 32バイト / SSE4.2 pcmpestri: 16バイト / スカラー)。
+    struct char_scanner
+    {
+        enum class isa
+        {
+            scalar,
+            sse42,
+            avx2
+        };
+
+        isa kind;
+        const char *name;
+        // RFC 9110 tchar 以外の最初の位置 (メソッド・ヘッダー名。SP や ':' で止まる)
+        size_t (*token)(const char *p, size_t n) noexcept;
+        // SP・制御文字・DEL の最初の位置 (リクエストターゲット。SP で止まる)
+        size_t (*target)(const char *p, size_t n) noexcept;
+        // HT 以外の制御文字・DEL の最初の位置 (フィールド値。CR / LF で止まる)
+        size_t (*field_value)(const char *p, size_t n) noexcept;
+
+        // 実行中の CPU で使用可能な最速の実装
+        static const char_scanner &active() noexcept;
+        // 指定した実装 (CPU が非対応なら nullptr)。ベンチマーク用
+        static const char_scanner *get(isa kind) noexcept;
+    };
+
+    inline size_t scan_token(std::string_view s) noexcept {
+        return char_scanner::active().token(s.data(), s.size());
+    }
+    inline size_t scan_target(std::string_view s) noexcept {
+        return char_scanner::active().target(s.data(), s.size());
+    }
+    inline size_t scan_field_value(std::string_view s) noexcept {
+        return char_scanner::active().field_value(s.data(), s.size());
+    }
+}
+
+#endif // CHAR_SCANNER_HPP
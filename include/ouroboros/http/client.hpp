@@ -0,0 +1,134 @@
+#ifndef CLIENT_HPP
+#define CLIENT_HPP
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/request_parser.hpp"
+#include "ouroboros/http/type_definitions.hpp"
+
+namespace ouroboros::http
+{
+    // HTTP クライアントの設定
+    struct client_options
+    {
+        // 接続の確立を待つ時間
+        std::chrono::milliseconds connect_timeout{ 3000 };
+        // 応答待ちの間に受信が進まない時間の上限
+        std::chrono::milliseconds read_timeout{ 10000 };
+        // 使われていない接続を閉じるまでの時間 (上流の Keep-Alive タイムアウトより短くする)
+        std::chrono::milliseconds idle_timeout{ 4000 };
+        // 上流 (ホスト・ポート) ごとの最大接続数。超える分は空いた接続を待つ
+        size_t max_connections = 32;
+        // 1接続で応答待ちにできるリクエスト数 (1 でパイプライン無効)
+        // 空いている接続が無く、接続数も上限の場合にだけパイプラインに積む
+        size_t max_pipeline = 8;
+        // レスポンスの解析の上限値 (超過したレスポンスは invalid_response)
+        parser_limits limits = { .max_body_size = 16 * 1024 * 1024 };
+    };
+
+    // 送信するリクエスト (各ビューは co_await が完了するまで有効であること)
+    // Host と Content-Length はクライアントが付与する (headers に Host があればそれを使う)
+    struct client_request
+    {
+        http::method method = method::GET;
+        std::string_view target = "/";
+        std::span<const header_field> headers = {};
+        std::string_view body = {};
+    };
+
+    // 非同期 HTTP/1.1 クライアント (io_context ごと = コアごとに一つ。スレッドセーフではない)
+    //
+    // 上流 (ホスト・ポート) ごとに Keep-Alive 接続をプールし、リクエストは空いている接続へ割り当てる。
+    // 全て使用中で接続数が上限に達していれば、応答待ちの少ない接続へパイプラインで送る。
+    // 接続・送受信は io_uring の操作、タイムアウトは io_context のタイミングホイールで扱い、
+    // レスポンスはサーバーと同じ request_parser (parser_mode::response) で解析する。
+    //
+    //   auto res = co_await client::current().request("127.0.0.1", 8080, { .target = "/users" });
+    //   if (res) use(res->status, res->body);
+    //
+    // 再利用した接続が応答前に閉じられた場合、冪等なメソッドのリクエストは一度だけ新しい接続で送り直す。
+    // チャンク形式 (Transfer-Encoding) のレスポンスは受信バッファの中で復号し、ボディを連続した領域に詰める。
+    // イベントループが停止してから破棄すること (応答待ちのコルーチンは再開されない)。
+    class client
+    {
+        class upstream;
+        class connection;
+        struct exchange_queue;
+
+    public:
+        class exchange;
+
+        explicit client(io_context &ctx, const client_options &options = {});
+        ~client();
+
+        // 接続が自身を指すためコピー・ムーブ禁止
+        client(const client &) = delete;
+        client &operator=(const client &) = delete;
+
+        // このスレッドで実行中のイベントループ (io_context::current()) のクライアント
+        // 初回に既定の設定で作成する。イベントループのスレッド (ハンドラの中) から呼ぶこと
+        [[nodiscard]] static client &current();
+
+        // リクエストを送信し、レスポンスを待つ awaitable を返す
+        // co_await の結果は std::expected<client_response, std::error_code>
+        // host は IP アドレスまたはホスト名 (名前解決は上流ごとに初回だけ行い、その間はブロックする)
+        [[nodiscard]] exchange request(std::string_view host, uint16_t port, const client_request &req);
+
+        [[nodiscard]] io_context &context() noexcept { return ctx_; }
+        [[nodiscard]] const client_options &options() const noexcept { return options_; }
+        // これまでに確立を開始した接続の数 (プールの効果の確認用)
+        [[nodiscard]] uint64_t connections_opened() const noexcept { return connections_opened_; }
+
+    private:
+        upstream *find_upstream(std::string_view host, uint16_t port, std::error_code &error);
+
+        io_context &ctx_;
+        client_options options_;
+        std::vector<std::unique_ptr<upstream>> upstreams_;
+        uint64_t connections_opened_ = 0;
+    };
+
+    // 一つのリクエストとレスポンスの交換 (co_await するための awaitable)
+    // co_await の間はコルーチンフレームの中にあり、接続の応答待ちの列につながれる
+    class client::exchange
+    {
+    public:
+        exchange(const exchange &) = delete;
+        exchange &operator=(const exchange &) = delete;
+
+        // 上流の名前解決に失敗していれば中断しない
+        bool await_ready() const noexcept { return static_cast<bool>(error_); }
+        // 接続を開始できなかった場合は中断せずにエラーを返す
+        bool await_suspend(std::coroutine_handle<> caller);
+        std::expected<client_response, std::error_code> await_resume();
+
+    private:
+        friend class client;
+
+        exchange(upstream *target, const client_request &req, std::error_code error) noexcept
+            : upstream_(target), request_(req), error_(error) {}
+
+        // レスポンスまたはエラーを設定済みの交換を再開する (次の交換へのリンクを先に読むこと)
+        void resume() { caller_.resume(); }
+
+        upstream *upstream_;
+        client_request request_;
+        std::error_code error_;
+        client_response response_;
+        std::coroutine_handle<> caller_;
+        exchange *next_ = nullptr;
+        bool retried_ = false; // 送り直し済み
+    };
+}
+
+#endif // CLIENT_HPP
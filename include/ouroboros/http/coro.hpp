@@ -0,0 +1,167 @@
+#ifndef CORO_HPP
+#define CORO_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <utility>
+#include "ouroboros/http/task.hpp"
+
+namespace ouroboros::http::coro
+{
+    // コルーチンフレームのプール (スレッドごと = Thread-per-core ではコアごと)
+    //
+    // フレームの大きさを granularity 単位のクラスに分け、解放されたフレームを空きリストで再利用する。
+    // 定常状態ではコルーチンの生成・破棄にヒープ割り当てが発生しない。
+    // max_pooled_size を超えるフレームは毎回 ::operator new から割り当てる。
+    class frame_pool
+    {
+    public:
+        static constexpr size_t granularity = 64;
+        static constexpr size_t max_pooled_size = 4096;
+
+        [[nodiscard]] static void *allocate(size_t size);
+        static void deallocate(void *frame, size_t size) noexcept;
+        // このスレッドでヒープから割り当てた回数 (空きリストが空だった場合と max_pooled_size 超)
+        [[nodiscard]] static size_t heap_allocations() noexcept;
+    };
+
+    template <typename T = void>
+    class task;
+
+    namespace detail
+    {
+        struct promise_base
+        {
+            // co_await した呼び出し元 (対称転送で再開する)
+            std::coroutine_handle<> continuation;
+            // task::start() で開始した場合の完了通知先
+            http::task *done = nullptr;
+            std::exception_ptr exception;
+
+            static void *operator new(size_t size) { return frame_pool::allocate(size); }
+            static void operator delete(void *frame, size_t size) noexcept { frame_pool::deallocate(frame, size); }
+
+            struct final_awaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> self) noexcept {
+                    promise_base &promise = self.promise();
+                    if (promise.continuation) return promise.continuation;
+                    // 通知先はこのフレームを破棄してもよい (以降フレームには触れない)
+                    if (promise.done) promise.done->complete(0, 0);
+                    return std::noop_coroutine();
+                }
+                void await_resume() const noexcept {}
+            };
+
+            // 遅延開始: co_await または start() されるまで実行しない
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            final_awaiter final_suspend() const noexcept { return {}; }
+            void unhandled_exception() noexcept { exception = std::current_exception(); }
+        };
+
+        template <typename T>
+        struct promise : promise_base
+        {
+            std::optional<T> value;
+
+            task<T> get_return_object() noexcept;
+            template <typename U>
+            void return_value(U &&result) {
+                value.emplace(std::forward<U>(result));
+            }
+            T result() {
+                if (exception) std::rethrow_exception(exception);
+                return std::move(*value);
+            }
+        };
+
+        template <>
+        struct promise<void> : promise_base
+        {
+            task<void> get_return_object() noexcept;
+            void return_void() noexcept {}
+            void result() {
+                if (exception) std::rethrow_exception(exception);
+            }
+        };
+    }
+
+    // 遅延開始のコルーチン (値 T を返す。例外は co_await / get() で再送出される)
+    //
+    // コルーチンの中からは co_await で子コルーチンを待つ (完了時に呼び出し元を直接再開する)。
+    // イベントループ側からは start() で開始し、完了通知 (http::task) を受け取ってから get() で結果を取り出す。
+    template <typename T>
+    class [[nodiscard]] task
+    {
+    public:
+        using promise_type = detail::promise<T>;
+
+        task() noexcept = default;
+        explicit task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+        task(task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+        task &operator=(task &&other) noexcept {
+            if (this != &other) {
+                destroy();
+                handle_ = std::exchange(other.handle_, {});
+            }
+            return *this;
+        }
+        task(const task &) = delete;
+        task &operator=(const task &) = delete;
+        // 中断中のコルーチンを破棄する場合は、実行中の操作が完了していること
+        ~task() { destroy(); }
+
+        [[nodiscard]] bool valid() const noexcept { return static_cast<bool>(handle_); }
+        [[nodiscard]] bool done() const noexcept { return handle_ && handle_.done(); }
+
+        // 開始し、最初に中断するか完了するまで実行する
+        // 完了すると (開始中に完了した場合も) done の complete(0, 0) が呼ばれる
+        void start(http::task &done) {
+            handle_.promise().done = &done;
+            handle_.resume();
+        }
+        // 完了したコルーチンの結果を取り出す (例外はここで再送出する)
+        T get() { return handle_.promise().result(); }
+
+        auto operator co_await() && noexcept {
+            struct awaiter
+            {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+                    handle.promise().continuation = caller;
+                    return handle;
+                }
+                T await_resume() { return handle.promise().result(); }
+            };
+            return awaiter{ handle_ };
+        }
+
+    private:
+        void destroy() noexcept {
+            if (handle_) handle_.destroy();
+            handle_ = {};
+        }
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        task<T> promise<T>::get_return_object() noexcept {
+            return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+        }
+
+        inline task<void> promise<void>::get_return_object() noexcept {
+            return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+        }
+    }
+}
+
+#endif // CORO_HPP
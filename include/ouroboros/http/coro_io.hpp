@@ -0,0 +1,92 @@
+#ifndef CORO_IO_HPP
+#define CORO_IO_HPP
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <span>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include "ouroboros/http/coro.hpp"
+#include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/task.hpp"
+#include "ouroboros/http/timer_wheel.hpp"
+
+namespace ouroboros::http::coro
+{
+    // io_uring の操作を一つ発行し、CQE の res (成功時は0以上、失敗時は -errno) を co_await の結果として返す
+    //
+    // user_data はこのオブジェクト (co_await 中はコルーチンフレームの中にある) を指し、
+    // 完了時にコルーチンを直接再開する。完了するまでコルーチンを破棄しないこと。
+    // SQE が取得できない場合は中断せずに -EBUSY を返す。
+    class operation final : public http::task
+    {
+    public:
+        operation(io_context &ctx, uint8_t opcode, int fd, uint64_t addr, uint32_t len, uint64_t offset,
+            uint32_t op_flags = 0) noexcept;
+        // フレーム内のアドレスをカーネルに渡すためコピー・ムーブ禁止
+        operation(const operation &) = delete;
+        operation &operator=(const operation &) = delete;
+
+        // 発行前に SQE のフラグを調整する (IOSQE_FIXED_FILE 等)
+        [[nodiscard]] uint8_t &sqe_flags() noexcept { return sqe_flags_; }
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> caller) noexcept;
+        int await_resume() const noexcept { return result_; }
+        // 完了時の CQE のフラグ
+        [[nodiscard]] uint32_t cqe_flags() const noexcept { return flags_; }
+
+        void complete(int result, uint32_t flags) override;
+
+    private:
+        io_context &ctx_;
+        // 発行する SQE の内容 (io_uring_sqe は無名共用体を含むため、フィールドごとに保持して設定する)
+        uint8_t opcode_;
+        uint8_t sqe_flags_ = 0;
+        int fd_;
+        uint64_t addr_;
+        uint32_t len_;
+        uint64_t offset_;
+        uint32_t op_flags_;
+        std::coroutine_handle<> caller_;
+        int result_ = 0;
+        uint32_t flags_ = 0;
+    };
+
+    // 指定時間だけ中断する (io_context のタイミングホイールを使い、SQE を発行しない)
+    class delay final : public http::task
+    {
+    public:
+        delay(io_context &ctx, std::chrono::milliseconds duration) noexcept
+            : ctx_(ctx), duration_(duration) {}
+        delay(const delay &) = delete;
+        delay &operator=(const delay &) = delete;
+
+        bool await_ready() const noexcept { return duration_.count() <= 0; }
+        void await_suspend(std::coroutine_handle<> caller) noexcept;
+        void await_resume() const noexcept {}
+
+        void complete(int result, uint32_t flags) override;
+
+    private:
+        io_context &ctx_;
+        std::chrono::milliseconds duration_;
+        timer timer_{ *this };
+        std::coroutine_handle<> caller_;
+    };
+
+    // 各操作の awaitable (バッファ・パスは完了まで有効であること)
+    // fd は通常のファイルディスクリプタ (固定ファイルは sqe_flags() に IOSQE_FIXED_FILE を加える)
+    [[nodiscard]] operation recv(io_context &ctx, int fd, std::span<char> buffer, int flags = 0) noexcept;
+    [[nodiscard]] operation send(io_context &ctx, int fd, std::span<const char> data, int flags = MSG_NOSIGNAL) noexcept;
+    [[nodiscard]] operation read(io_context &ctx, int fd, std::span<char> buffer, uint64_t offset) noexcept;
+    // 結果は開いた fd (所有権は呼び出し元)
+    [[nodiscard]] operation openat(io_context &ctx, int dirfd, const char *path, int flags, mode_t mode = 0) noexcept;
+    [[nodiscard]] operation close(io_context &ctx, int fd) noexcept;
+    [[nodiscard]] inline delay sleep_for(io_context &ctx, std::chrono::milliseconds duration) noexcept {
+        return delay(ctx, duration);
+    }
+}
+
+#endif // CORO_IO_HPP
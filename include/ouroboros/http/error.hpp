@@ -13,6 +13,12 @@ namespace ouroboros::http
         socket_option_failed,
         bind_failed,
         listen_failed,
+        buffer_registration_failed,
+        file_registration_failed,
+        // HTTP クライアント
+        address_resolution_failed, // 上流のホスト名を解決できない
+        invalid_response,          // 上流のレスポンスが不正 (または未対応の形式)
+        connection_closed,         // レスポンスを受信する前に上流が接続を閉じた
     };
 
     // カスタムエラーカテゴリを取得するための関数宣言
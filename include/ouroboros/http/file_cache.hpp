@@ -0,0 +1,79 @@
+#ifndef FILE_CACHE_HPP
+#define FILE_CACHE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "ouroboros/http/unique_socket.hpp"
+
+namespace ouroboros::http
+{
+    // 開いたファイルとメタデータ (STATX の結果)
+    struct open_file
+    {
+        unique_socket fd;
+        uint64_t size = 0;
+        int64_t mtime_sec = 0;
+        uint32_t mtime_nsec = 0;
+        std::chrono::steady_clock::time_point opened_at;
+
+        // 強い ETag: "<mtime>-<size>" (16進数、引用符を含む)
+        char etag_text[48]{};
+        uint8_t etag_length = 0;
+
+        [[nodiscard]] std::string_view etag() const noexcept { return { etag_text, etag_length }; }
+        // size と mtime から etag_text を生成する
+        void make_etag() noexcept;
+    };
+
+    // 開いたファイルの LRU キャッシュ (コアごと。スレッド間で共有しないこと)
+    //
+    // 同じファイルへのリクエストで OPENAT / STATX を省く。ファイルの更新を反映するため、
+    // 開いてから revalidate_after を過ぎたエントリは使わずに開き直す。
+    // エントリは shared_ptr で保持するため、送信中に追い出されても fd は送信完了まで閉じられない。
+    class file_cache
+    {
+    public:
+        static constexpr size_t default_capacity = 1024;
+        static constexpr std::chrono::milliseconds default_revalidate_after{ 1000 };
+
+        explicit file_cache(size_t capacity = default_capacity,
+            std::chrono::milliseconds revalidate_after = default_revalidate_after);
+
+        // dirfd からの相対パス path のエントリ (無い、または古ければ nullptr)
+        [[nodiscard]] std::shared_ptr<const open_file> find(int dirfd, std::string_view path);
+        // エントリを追加する (容量を超えた場合は最も古く使われたものを追い出す)
+        void insert(int dirfd, std::string_view path, std::shared_ptr<const open_file> file);
+
+        [[nodiscard]] size_t size() const noexcept { return index_.size(); }
+        [[nodiscard]] size_t capacity() const noexcept { return capacity_; }
+        [[nodiscard]] uint64_t hits() const noexcept { return hits_; }
+        [[nodiscard]] uint64_t misses() const noexcept { return misses_; }
+
+    private:
+        struct entry
+        {
+            std::string key;
+            std::shared_ptr<const open_file> file;
+        };
+
+        // キー: dirfd (4バイト) + パス。検索時は key_buffer_ を再利用して組み立てる
+        std::string_view make_key(int dirfd, std::string_view path);
+        void erase(std::list<entry>::iterator it);
+
+        size_t capacity_;
+        std::chrono::milliseconds revalidate_after_;
+        std::list<entry> lru_; // 先頭が最も新しく使われたもの
+        std::unordered_map<std::string_view, std::list<entry>::iterator> index_; // キーは lru_ 内の文字列
+        std::string key_buffer_;
+        uint64_t hits_ = 0;
+        uint64_t misses_ = 0;
+    };
+}
+
+#endif // FILE_CACHE_HPP
@@ -0,0 +1,58 @@
+#ifndef FIXED_SOCKET_HPP
+#define FIXED_SOCKET_HPP
+
+#include <cstdint>
+#include <utility>
+#include "ouroboros/http/io_context.hpp"
+
+namespace ouroboros::http
+{
+    // 固定ファイルテーブル (IORING_REGISTER_FILES) のスロットを所有する RAII ラッパー
+    //
+    // ダイレクトディスクリプタはプロセスのFDテーブルに存在しないため ::close() では閉じられない。
+    // unique_socket と同じ所有権セマンティクスを持ち、破棄時に IORING_OP_CLOSE でスロットを解放する。
+    // SQE には fd としてスロット番号を設定し、IOSQE_FIXED_FILE を付与すること。
+    class fixed_socket
+    {
+    public:
+        // デフォルトコンストラクタ：無効なスロット（-1）で初期化
+        constexpr fixed_socket() noexcept = default;
+        // スロット番号による明示的な初期化
+        constexpr fixed_socket(io_context &ctx, int slot) noexcept : ctx_(&ctx), slot_(slot) {}
+        ~fixed_socket() {
+            reset();
+        }
+        // コピー禁止（所有権の唯一性を保証）
+        fixed_socket(const fixed_socket &) = delete;
+        fixed_socket &operator=(const fixed_socket &) = delete;
+        // ムーブコンストラクタ
+        constexpr fixed_socket(fixed_socket &&other) noexcept
+            : ctx_(other.ctx_), slot_(std::exchange(other.slot_, -1)) {}
+        // ムーブ代入演算子
+        fixed_socket &operator=(fixed_socket &&other) noexcept {
+            if (this != &other) {
+                reset();
+                ctx_ = other.ctx_;
+                slot_ = std::exchange(other.slot_, -1);
+            }
+            return *this;
+        }
+        // 固定ファイルテーブル上のスロット番号 (SQE の fd に設定する)
+        [[nodiscard]] constexpr int native_handle() const noexcept {
+            return slot_;
+        }
+        // 有効性チェック
+        explicit constexpr operator bool() const noexcept {
+            return slot_ >= 0;
+        }
+
+    private:
+        // IORING_OP_CLOSE を発行してスロットを解放する
+        void reset() noexcept;
+
+        io_context *ctx_ = nullptr;
+        int slot_ = -1;
+    };
+} // namespace ouroboros::http
+
+#endif // FIXED_SOCKET_HPP
@@ -1,59 +1,402 @@
 #ifndef HTTP_SESSION_HPP
 #define HTTP_SESSION_HPP
 
+#include <string>
 #include <vector>
 #include <memory>
 #include <string_view>
 #include <chrono>
+#include <sys/stat.h>
+#include <linux/openat2.h>
 #include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/fixed_socket.hpp"
 #include "ouroboros/http/task.hpp"
 #include "ouroboros/http/member_binder.hpp"
+#include "ouroboros/http/request_parser.hpp"
+#include "ouroboros/http/body_decoder.hpp"
+#include "ouroboros/http/arena.hpp"
+#include "ouroboros/http/file_cache.hpp"
 
 namespace ouroboros::http
 {
     class server; // Forward-declaration
+    class session_pool;
+    class proxy_transfer;
+    class websocket_session;
+    struct route_handler;
 
-    class http_session : public task
+    // セッションは session_pool が所有し、接続ごとに再利用する (キャッシュライン境界に配置)
+    class alignas(64) http_session
     {
     public:
         // Constructor now accepts a reference to the server to access the routing table
-        http_session(server &svr, io_context &ctx, unique_socket socket);
+        http_session(server &svr, io_context &ctx);
         ~http_session();
 
-        // 処理開始 (最初の Read を発行)
-        void start();
+        http_session(const http_session &) = delete;
+        http_session &operator=(const http_session &) = delete;
 
-    private:
-        // task インターフェースの実装 (IO完了時に呼ばれる)
-        void complete(int result, uint32_t flags) override;
+        // 接続の処理を開始する (最初の Read を発行)
+        void start(unique_socket socket);
+        // ダイレクトディスクリプタ (固定ファイルテーブルのスロット) で受け付けた接続用
+        void start(fixed_socket socket);
 
-        // Main logic for request processing
+    private:
+        // 受信データに含まれる完了済みのリクエストを全て処理し、消費したバイト数を返す
+        // (末尾の不完全なリクエストは消費しない)
+        size_t process(std::string_view data);
+        // Main logic for request processing (レスポンスは out_ に追加される)
         void handle_request();
+        // m と request_.path に一致するハンドラを呼び出す (static_router -> router の順。無ければ false)
+        bool dispatch(method m, response &res);
+        // ハンドラが作ったレスポンスをキャッシュへ保持し、out_ へ書く (ファイルの場合は送信を始める)
+        void finish_response();
+        // コルーチンハンドラを開始する (中断した場合は完了後に handle_handler() が続きを行う)
+        void start_handler(const route_handler &route, response &res);
+        // コルーチンハンドラの完了 (handler_op_ から呼ばれる)
+        void handle_handler(int result, uint32_t flags);
+        // 完了したコルーチンハンドラの結果を受け取り、レスポンスを書く。送信中は呼ばないこと
+        void finish_handler();
+        // request_ のビューが指す受信データをアリーナへ複製し、ビューを付け替える
+        void stash_request();
+        // request_ に一致するルートのボディの設定 (無ければ nullptr: 既定の扱い)
+        const body_options *route_body_options() noexcept;
+        // ボディを受信しながら読む: ヘッダーを複製し、ルートの body_options に従って受け取り先を用意する
+        void begin_body(const body_options *options);
+        // data からボディを読み、消費したバイト数を返す (書き出しが追いつかなければ途中で止まる)
+        size_t read_body(std::string_view data);
+        // 取り出したボディの一部を受け取り先 (body_sink・メモリ・一時ファイル) へ渡す (打ち切った場合は false)
+        bool store_body(std::string_view piece);
+        // ボディの終わりを読んだ (一時ファイルへの書き出しが残っていれば、その完了を待つ)
+        void end_body();
+        // request_ にボディを設定してハンドラを呼ぶ。送信中は呼ばないこと
+        void complete_body();
+        // ボディの受信を打ち切り、エラーを返して閉じる
+        void abort_body(int status);
+        // 一時ファイルを作り (OPENAT + O_TMPFILE)、集めたボディを書き出し始める
+        void start_spill();
+        // 溜まったボディを一時ファイルへ書き出す (書き出し中・ボディの途中で少量の場合は何もしない)
+        void submit_spill_write();
+        // 一時ファイルの操作 (OPENAT / WRITE) の完了 (spill_op_ から呼ばれる)
+        void handle_spill(int result, uint32_t flags);
+        // 前のリクエストのボディ (メモリ・一時ファイル) を解放する (書き出し中であれば完了後に行う)
+        void release_body() noexcept;
+        bool spilling() const noexcept { return spill_started_; }
+        // 一時ファイルへの書き出しが追いつかず、ボディの読み取りを止めているか
+        bool body_blocked() const noexcept { return spill_busy_ && spill_buf_.size() >= spill_write_size; }
+        // ハンドラが send_file() したレスポンスの処理を始める (キャッシュに無ければ OPENAT2 を発行)
+        void start_file();
+        // ファイルのレスポンスヘッダー (または 304 / 416 / エラー) を out_ に書く。送信中は呼ばないこと
+        void write_file_response();
+        // ファイルの操作 (OPENAT2 / STATX / SPLICE) の完了 (file_op_ から呼ばれる)
+        void handle_file(int result, uint32_t flags);
+        bool submit_file_open();
+        bool submit_file_stat();
+        // ファイル -> パイプ -> ソケットの順に SPLICE で送る (ユーザー空間へのコピーなし)
+        void submit_splice_in();
+        void submit_splice_out();
+        // ファイルのオープン結果を受け取り、送信中でなければレスポンスを書く
+        void file_opened(int status);
+        // ファイルの送信を終える (abort: 途中で失敗したため接続を閉じる)
+        void finish_file(bool abort);
+        bool file_busy() const noexcept { return file_stage_ != file_stage::none; }
+        // ハンドラが proxy_pass() したリクエストの転送を始める (上流の選択・接続・送信は proxy_transfer が行う)
+        void start_proxy();
+        // 上流のレスポンスヘッダー (または 502 / 504) を out_ に書く。送信中は呼ばないこと
+        void write_proxy_response();
+        // 転送の完了と、ボディの SPLICE の完了 (proxy_op_ から呼ばれる)
+        void handle_proxy(int result, uint32_t flags);
+        // ヘッダー・チャンクの区切りを送り終えた後、またはパイプが空いた後にボディの続きを転送する
+        void continue_proxy_body();
+        // 上流のソケット -> パイプ -> クライアントのソケットの順に SPLICE で送る (ユーザー空間へのコピーなし)
+        void submit_proxy_splice_in();
+        void submit_proxy_splice_out();
+        // チャンク形式のボディの区切り (長さの行など) を受信する
+        void submit_proxy_receive();
+        // 転送を終える (abort: 途中で失敗したため接続を閉じる。上流の接続は再利用しない)
+        void finish_proxy(bool abort);
+        bool proxy_busy() const noexcept { return proxy_stage_ != proxy_stage::none; }
+        // 上流のボディを転送中 (上流のソケットに対する操作を実行中)
+        bool proxy_relaying() const noexcept {
+            return proxy_stage_ == proxy_stage::splice_in || proxy_stage_ == proxy_stage::splice_out ||
+                   proxy_stage_ == proxy_stage::receive;
+        }
+        // ハンドラが stream() したレスポンスのヘッダーを out_ に書き、ボディの生成を始める
+        void start_stream();
+        // 生成済みのボディを送信へ回し (送信中でなければ)、上限まで次を生成する
+        void advance_stream();
+        // 生成器を一回呼ぶ (非同期の生成器が中断した・失敗した場合は false)
+        bool produce_stream();
+        // 完了した非同期の生成器の結果を受け取る (失敗した場合は false)
+        bool finish_produce();
+        // 非同期の生成器の完了 (stream_op_ から呼ばれる)
+        void handle_stream(int result, uint32_t flags);
+        // stream_buf_ をチャンクとして out_ へ移す (最後ならボディの終わりも書く)
+        void write_stream_chunk();
+        // ボディの送信を終える (abort: 途中で失敗したため接続を閉じる)
+        void finish_stream(bool abort);
+        bool stream_busy() const noexcept { return stream_stage_ != stream_stage::none; }
+        // ハンドラが accept_websocket() したリクエストに 101 を返し、websocket_session を用意する
+        // (101 を送り終えて受信も止まったら hand_off_websocket() がソケットを引き継がせる)
+        void start_websocket();
+        void hand_off_websocket();
+        // SPLICE 用のパイプを用意する (ファイルと転送で共用。失敗したら false)
+        bool open_pipe();
+        // 処理中のリクエストのレスポンスが未完成か (ファイル・ストリームの送信中・転送中・コルーチンハンドラの実行中、
+        // ボディの書き出し待ち、または WebSocket への引き継ぎ待ち)。その間、後続のリクエストは処理しない
+        bool response_pending() const noexcept {
+            return file_busy() || proxy_busy() || stream_busy() || handler_stage_ != handler_stage::none || websocket_ ||
+                   body_blocked() || body_stage_ == body_stage::flushing || body_stage_ == body_stage::ready;
+        }
+        // 止めていたリクエストの処理を再開する (送信中・ファイル処理中は何もしない)
+        void resume_requests();
+        // 解析エラー時のレスポンスを out_ に追加し、送信後に接続を閉じる
+        void send_error(int status);
+        // 大きなレスポンスを登録済み送信バッファへ直接書き込む (書き込めなければ false)
+        bool write_to_send_buffer(const response &res, bool omit_body);
 
         // Low-level IO operations
         void submit_recv();
-        void submit_send(std::string_view data);
+        // 止まっている受信を再開する (backlog_ が上限に達している間・ボディの書き出し待ちの間、
+        // ENOBUFS で受信を見合わせている間は再開しない)
+        void arm_recv();
+        // ENOBUFS で見合わせていた受信を再開する (recv_retry_ から呼ばれる)
+        void handle_recv_retry(int result, uint32_t flags);
+        void submit_send();
+        void submit_cancel(task *target);
+        // 受信/送信の完了 (recv_op_ / send_op_ から呼ばれる)
         void handle_read(int result, uint32_t flags);
-        void handle_write(int result);
+        void handle_write(int result, uint32_t flags);
 
-        // 内部状態
-        enum class state
-        {
-            reading,
-            writing,
-            closed
-        };
+        // 受信したバッファを一つ処理する (送信中であれば backlog_ に積む)
+        void accept_chunk(uint16_t bid, size_t length);
+        // バッファ内のリクエストを処理してプールへ返却する (不完全な末尾は staging_ へ退避)
+        void consume_chunk(uint16_t bid, size_t length);
+        // 溜まったレスポンスを送信し、次の受信または切断を決める
+        void flush();
+        // 未送信のレスポンスがあるか (送信バッファまたは out_)
+        bool has_unsent() const noexcept {
+            return (send_buffer_ != no_send_buffer && send_buffer_sent_ < send_buffer_used_) || out_sent_ < out_.size();
+        }
+        // 送信中のバッファを送り終え、カーネルの参照 (ゼロコピー) も無くなった時の処理
+        void complete_write();
+        // 現在の状態 (ヘッダー受信中・ボディ受信中・Keep-Alive 待機中・送信中) に応じたタイムアウトを設定する
+        // ヘッダーの期限は受信開始時に一度だけ設定し、それ以外は進捗があるたびに延長する
+        void update_timeout() noexcept;
+        // タイムアウト (timer_ から呼ばれる)
+        void handle_timeout(int result, uint32_t flags);
+        // 実行中の操作がなく、ソケットが閉じていれば自身をプールへ返却する
+        void finish_if_done();
+        // 次の接続のために状態を初期化する (確保済みの領域は保持する)
+        void reset() noexcept;
+        // response_ をアリーナごと破棄し、次のリクエスト用に作り直す (O(1))
+        void recycle_response() noexcept;
+
+        // ソケット操作用の SQE に fd (またはスロット番号) とフラグを設定する
+        void prepare_socket_io(io_uring_sqe *sqe) const noexcept;
+        void close_socket();
+        bool is_open() const noexcept { return socket_ || fixed_socket_; }
 
         server &server_; // Reference to the server instance
         io_context &ctx_;
         unique_socket socket_;
-        state current_state_ = state::closed;
-        std::vector<char> buffer_;
+        fixed_socket fixed_socket_; // ダイレクトディスクリプタの場合はこちらを使用
+
+        // 受信と送信は同時に実行中になり得るため、操作ごとに user_data を分ける
+        member_task<http_session> recv_op_{ *this, &http_session::handle_read };
+        member_task<http_session> send_op_{ *this, &http_session::handle_write };
+        member_task<http_session> file_op_{ *this, &http_session::handle_file };
+        member_task<http_session> timeout_op_{ *this, &http_session::handle_timeout };
+        member_task<http_session> handler_op_{ *this, &http_session::handle_handler };
+        member_task<http_session> proxy_op_{ *this, &http_session::handle_proxy };
+        member_task<http_session> stream_op_{ *this, &http_session::handle_stream };
+        member_task<http_session> spill_op_{ *this, &http_session::handle_spill };
+        member_task<http_session> recv_retry_op_{ *this, &http_session::handle_recv_retry };
+
+        // 内部状態
+        bool multishot_ = false;   // IORING_RECV_MULTISHOT で受信を継続しているか
+        bool recv_armed_ = false;  // 受信操作が実行中か
+        bool writing_ = false;     // 送信操作が実行中か (ゼロコピーの場合は通知を受け取るまで)
+        bool send_armed_ = false;  // 送信の完了 (結果の CQE) を待っているか
+        bool peer_closed_ = false; // 相手が送信を終えた (EOF) か
+        bool closing_ = false;     // 送信済みのレスポンスを送り終えたら閉じる (Connection: close / エラー)
+        bool paused_ = false;      // ファイルの送信を待つため process() を途中で止めたか (残りは staging_)
+
+        // リクエストの解析 (request_ のビューは受信バッファまたは staging_ を指す)
+        request_parser parser_;
+        request request_;
+        // レスポンスとハンドラの作業領域はリクエストごとのアリーナから割り当て、
+        // out_ へ書き出した時点でアリーナごと破棄する (response_ より先に宣言すること)
+        request_arena arena_;
+        response response_;
+        // ハンドラを呼んだルートのキャッシュ設定 (レスポンスを response_cache へ保持する場合)
+        const response_cache_policy *route_cache_ = nullptr;
+        uint64_t route_cache_generation_ = 0;
+        // 処理中のリクエスト全体 (request_ のビューはこの範囲を指す。stash_request() 用)
+        std::string_view request_raw_;
+        // 中断中のコルーチンハンドラ
+        //   running (実行中) -> ready (完了したが送信中のためレスポンス未作成) -> none
+        enum class handler_stage : uint8_t
+        {
+            none,
+            running,
+            ready
+        };
+        handler_stage handler_stage_ = handler_stage::none;
+        coro::task<void> handler_;
+        // 複数の受信に分割されたリクエストの退避領域 (分割時のみ使用。受信中のボディは含まない)
+        std::vector<char> staging_;
+
+        // 受信しながら読むリクエストボディ (揃っていない Content-Length・チャンク形式・body_options の指定)
+        //   receiving -> flushing (一時ファイルへの書き出しの完了待ち) -> ready (送信中のためハンドラ未実行) -> none
+        // ヘッダーは stash_request() でアリーナへ複製し、ボディは受け取り先へ渡す
+        enum class body_stage : uint8_t
+        {
+            none,
+            receiving,
+            flushing,
+            ready
+        };
+        body_stage body_stage_ = body_stage::none;
+        body_decoder body_decoder_;
+        uint64_t body_limit_ = 0;     // 413 を返す長さ
+        uint64_t body_received_ = 0;
+        body_sink body_sink_;         // body_options::on_body が返した受け取り先
+        std::string body_buf_;        // メモリに集めたボディ (request_.body が指す。次のリクエストまで保持する)
+        // 一時ファイルへの書き出し (body_options::spill_threshold)。書き出し中に届いた分は spill_buf_ に溜め、
+        // それが spill_write_size に達したら、書き出しが終わるまでボディの読み取りを止める (受信の背圧)
+        static constexpr size_t spill_write_size = 64 * 1024;
+        size_t spill_threshold_ = 0;
+        const char *spill_directory_ = nullptr;
+        bool spill_started_ = false;
+        bool spill_busy_ = false;     // OPENAT / WRITE の実行中 (完了まで spill_out_ は変更しない)
+        unique_socket spill_file_;
+        std::string spill_buf_;
+        std::string spill_out_;
+        size_t spill_out_sent_ = 0;   // 部分書き込み時の書き込み済みバイト数
+        uint64_t spill_offset_ = 0;   // ファイルへ書き込んだバイト数
+
+        // パイプライン化されたリクエストのレスポンスをまとめて一度に送信する
+        // (送信完了後も容量を保持して再利用する。大きなレスポンスの後は解放する)
+        static constexpr size_t initial_out_capacity = 2048;
+        static constexpr size_t max_retained_out_capacity = 64 * 1024;
+        std::string out_;
+        size_t out_sent_ = 0; // 部分送信時の送信済みバイト数
+
+        // 登録済み送信バッファ (大きなレスポンス用)。内容は out_ より先に送信する
+        static constexpr uint16_t no_send_buffer = 0xffff;
+        uint16_t send_buffer_ = no_send_buffer;
+        size_t send_buffer_used_ = 0;
+        size_t send_buffer_sent_ = 0;
+        bool sending_send_buffer_ = false; // 実行中の送信が send_buffer_ からか
+        int zero_copy_notifs_ = 0;         // 未着の IORING_CQE_F_NOTIF の数 (届くまでバッファを変更しない)
+
+        // ファイルの送信 (response::send_file)。送信が終わるまで後続のリクエストは処理しない
+        //   opening/stat -> ready (レスポンス未作成) -> headers (ヘッダー送信中) -> splice_in <-> splice_out
+        // response_ と条件付きリクエストのヘッダーの複製は、ヘッダーを書くまでアリーナに保持する
+        enum class file_stage : uint8_t
+        {
+            none,
+            opening,
+            stat,
+            ready,
+            headers,
+            splice_in,
+            splice_out
+        };
+        file_stage file_stage_ = file_stage::none;
+        bool file_omit_body_ = false;    // HEAD
+        int file_status_ = 200;          // オープンに失敗した場合のステータス
+        std::string_view file_if_none_match_;
+        std::string_view file_range_;
+        std::string_view file_if_range_;
+        open_how open_how_{};
+        struct statx statx_{};
+        unique_socket opening_fd_;       // OPENAT2 の結果 (STATX の完了まで)
+        std::shared_ptr<const open_file> file_;
+        uint64_t file_offset_ = 0;
+        uint64_t file_remaining_ = 0;
+        // SPLICE 用のパイプ (最初のファイル送信時に作成し、接続の間は再利用する)
+        unique_socket pipe_read_;
+        unique_socket pipe_write_;
+        size_t pipe_capacity_ = 0;
+        size_t pipe_fill_ = 0;           // パイプ内の未送信バイト数
+
+        // 上流への転送 (response::proxy_pass)。送信が終わるまで後続のリクエストは処理しない
+        //   exchanging (proxy_transfer が実行中) -> ready (レスポンス未作成) -> headers (ヘッダー送信中)
+        //   -> splice_in <-> splice_out
+        // チャンク形式のボディは区切りを receive で受信して headers (送信中) へ戻り、チャンクのデータを SPLICE する
+        enum class proxy_stage : uint8_t
+        {
+            none,
+            exchanging,
+            ready,
+            headers,
+            splice_in,
+            splice_out,
+            receive
+        };
+        proxy_stage proxy_stage_ = proxy_stage::none;
+        int proxy_status_ = 0;           // 0: 上流のレスポンスを返す。それ以外: 返すエラーステータス
+        uint64_t proxy_remaining_ = 0;   // 上流のソケットに残っているボディのバイト数
+        bool proxy_until_close_ = false; // ボディが上流の接続の終わりまで続く
+        bool proxy_dechunk_ = false;     // チャンク形式のボディをデータだけにして送る (HTTP/1.0 のクライアント)
+        // 最初の転送時に作成し、接続の間は再利用する
+        std::unique_ptr<proxy_transfer> proxy_;
+
+        // ストリーミングのボディ (response::stream)。送信が終わるまで後続のリクエストは処理しない
+        //   idle (次を生成できる) <-> producing (非同期の生成器の実行中) -> finished (最後の部分を生成した) -> none
+        // 生成したデータは stream_buf_ に溜め、送信中でなければ out_ へ移して送る (送信中に次を生成する)
+        enum class stream_stage : uint8_t
+        {
+            none,
+            idle,
+            producing,
+            finished
+        };
+        stream_stage stream_stage_ = stream_stage::none;
+        bool stream_chunked_ = false;      // Transfer-Encoding: chunked で送る
+        bool stream_sized_ = false;        // set_content_length() で長さが指定された
+        uint64_t stream_remaining_ = 0;    // 長さが指定された場合の残り
+        body_producer stream_producer_;
+        async_body_producer stream_async_producer_;
+        coro::task<bool> stream_task_;
+        std::string stream_buf_;
+
+        // アップグレードした接続の引き継ぎ先 (101 の送信中。後続のデータはフレームとして引き継ぐ)
+        websocket_session *websocket_ = nullptr;
+
+        // 送信中に届いた受信バッファ (送信完了後にまとめて処理する)
+        // 上限に達したら受信を止め、一つの接続が受信バッファのプールを使い切らないようにする
+        static constexpr size_t max_backlog_chunks = 4;
+        struct received_chunk
+        {
+            uint16_t bid;
+            uint32_t length;
+        };
+        std::vector<received_chunk> backlog_;
+
+        // タイムアウト管理用 (io_context のタイミングホイールに登録する。SQE は発行しない)
+        enum class timeout_phase : uint8_t
+        {
+            none,
+            header,
+            body,
+            idle,
+            write
+        };
+        timer timer_{ timeout_op_ };
+        timeout_phase timeout_phase_ = timeout_phase::none;
+        // 受信バッファのプールが枯渇した (ENOBUFS) 時は、すぐに発行し直さずこの時間だけ受信を見合わせる
+        // (その間に他のセッションがバッファをプールへ返す)
+        static constexpr std::chrono::milliseconds recv_retry_delay{ 5 };
+        timer recv_retry_{ recv_retry_op_ };
+        bool served_ = false; // この接続でレスポンスを返したか (以降の待機は keep_alive_timeout)
+        int pending_ops_ = 0; // 実行中の非同期操作数 (0になったらプールへ返却)
 
-        // タイムアウト管理用
-        __kernel_timespec ts_;
-        int pending_ops_ = 0; // 実行中の非同期操作数 (0になったらセッションを削除)
-        bool keep_alive_ = false;
+        // session_pool の空きリスト (侵入型)
+        friend class session_pool;
+        http_session *next_free_ = nullptr;
     };
 
 }
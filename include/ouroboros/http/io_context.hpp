@@ -2,12 +2,15 @@
 #define IO_CONTEXT_HPP
 
 #include <atomic>
+#include <bitset>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <linux/io_uring.h> // カーネルヘッダー
 #include <linux/time_types.h>
 #include "ouroboros/http/unique_socket.hpp"
 #include "ouroboros/http/task.hpp"
+#include "ouroboros/http/timer_wheel.hpp"
 
 namespace ouroboros::http
 {
@@ -21,23 +24,89 @@ namespace ouroboros::http
         uint32_t *flags;
         uint32_t *array; // SQのみ使用 (index array)
     };
+    // io_uring_setup の設定
+    // 実行中のカーネルが対応していないフラグは新しいものから順に外して作り直す (setup_flags() で確認できる)
+    struct io_context_options
+    {
+        // SQ のエントリ数
+        unsigned entries = 4096;
+        // CQ のエントリ数 (IORING_SETUP_CQSIZE。0 ならカーネル既定の entries * 2)
+        unsigned cq_entries = 0;
+        // IORING_SETUP_SQPOLL: カーネルスレッドが SQ を監視し、submit() のシステムコールを省く
+        // (CPU を一つ占有する。sq_thread_idle の間 SQE が無ければスリープし、submit() が起こす)
+        // 権限が足りない場合 (Linux 5.11 未満では CAP_SYS_ADMIN が必要) は無効になる
+        bool sqpoll = false;
+        std::chrono::milliseconds sq_thread_idle{ 1000 };
+        // SQPOLL スレッドを固定する CPU (IORING_SETUP_SQ_AFF。負なら固定しない)
+        int sq_thread_cpu = -1;
+        // IORING_SETUP_SINGLE_ISSUER: リングを作ったスレッドだけが SQE を発行する (Linux 6.0+)
+        bool single_issuer = false;
+        // IORING_SETUP_DEFER_TASKRUN: 完了処理を io_uring_enter(IORING_ENTER_GETEVENTS) の時まで遅らせ、
+        // 割り込みなしにまとめて行う (Linux 6.1+。single_issuer が必要で、sqpoll とは併用できない)
+        bool defer_taskrun = false;
+        // IORING_SETUP_COOP_TASKRUN: 完了処理のために実行中のスレッドへ割り込まない (Linux 5.19+)
+        bool coop_taskrun = true;
+        // IORING_SETUP_SUBMIT_ALL: 途中の SQE がエラーになっても残りを送信する (Linux 5.18+)
+        bool submit_all = true;
+    };
+
     class io_context
     {
     public:
         // コンストラクタ: io_uring_setup システムコールを発行し、リングをmmapする
         explicit io_context(unsigned entries = 4096);
+        explicit io_context(const io_context_options &options);
         ~io_context();
         // コピー禁止 (リソースへのポインタを持つため)
         io_context(const io_context &) = delete;
         io_context &operator=(const io_context &) = delete;
-        // イベントループの開始 (ブロッキング)
+        // イベントループの開始 (ブロッキング、stop() が呼ばれると戻る)
         void run();
+        // イベントループの停止を要求する (他スレッドから呼び出し可能)
+        void stop() noexcept;
+        // このスレッドで run() を実行中の io_context (無ければ nullptr)
+        // ハンドラ (コルーチンハンドラを含む) はイベントループのスレッドで呼ばれるため、I/O の発行先として使える
+        [[nodiscard]] static io_context *current() noexcept;
         void process_completions();
         // SQE (Submission Queue Entry) を取得する
         // 取得できない場合 (Full) は nullptr を返す
         [[nodiscard]] io_uring_sqe *get_sqe() noexcept;
         // get_sqe() で取得したリクエストをカーネルに送信する
+        // イベントループ (run()) の中ではシステムコールを発行せず、ループが次の待機と同時にまとめて送信する
+        // (完了ハンドラは SQE を積むだけでよい)。ループの外では即座に io_uring_enter を発行する
         int submit();
+        // このリング (コア) のタイミングホイール
+        // イベントループは次の期限まで io_uring_enter で待機し、期限の来たタイマーを完了処理の後に発火させる
+        // (タイマーごとに SQE を発行しない。コールバックはイベントループのスレッドで呼ばれる)
+        timer_wheel &timers() noexcept { return timers_; }
+        // io_uring_enter の呼び出し回数 (送信と待機の合計。他スレッドからも読める)
+        [[nodiscard]] uint64_t syscalls() const noexcept { return syscalls_.load(std::memory_order_relaxed); }
+        // io_uring_register システムコールのラッパー (バッファリング登録等)
+        // 戻り値: 成功時は0以上、失敗時は -errno
+        int register_resource(unsigned opcode, void *arg, unsigned nr_args) noexcept;
+
+        // 固定ファイルテーブル (全スロット空) を登録する
+        // ダイレクトディスクリプタ (IORING_FILE_INDEX_ALLOC) の割り当て先となる
+        // 先頭の reserved_file_slots 個は install_fixed_file() 用に残し、カーネルには割り当てさせない
+        // (IORING_REGISTER_FILE_ALLOC_RANGE。非対応カーネルでは最初の Accept より前に install すること)
+        int register_sparse_files(unsigned slots) noexcept;
+        // 既存の fd を予約スロットへ登録し、スロット番号を返す (失敗時は -errno)
+        // fd の所有権は移らない (テーブルは独立した参照を持つため、fd は閉じてもよい)
+        // 予約スロットは再利用しない (リスナー等、接続より長く生きるもの用)
+        int install_fixed_file(int fd) noexcept;
+        // 固定ファイルテーブルのスロットを更新する (fd = -1 で解除)
+        int update_fixed_file(unsigned slot, int fd) noexcept;
+        static constexpr unsigned reserved_file_slots = 16;
+        // 登録済みの固定ファイルテーブルのサイズ (未登録なら0)
+        [[nodiscard]] unsigned fixed_file_slots() const noexcept { return fixed_file_slots_; }
+
+        // 実際に使われた IORING_SETUP_* フラグ (非対応のものは外されている)
+        [[nodiscard]] uint32_t setup_flags() const noexcept { return setup_flags_; }
+        // カーネルが報告した機能 (IORING_FEAT_*) を持つか
+        [[nodiscard]] bool has_feature(uint32_t feature) const noexcept { return (params_.features & feature) == feature; }
+
+        // 実行中のカーネルが opcode (IORING_OP_*) に対応しているか (起動時に IORING_REGISTER_PROBE で取得)
+        [[nodiscard]] bool supports(uint8_t opcode) const noexcept { return supported_ops_.test(opcode); }
 
         // タイムアウトを設定する (SQEの準備)
         // 注意: ts は submit_request() が完了するまで(正確にはカーネルが読み込むまで)有効である必要があります。
@@ -68,8 +137,45 @@ namespace ouroboros::http
 
         // SQのtailをユーザー空間でキャッシュし、バッチ送信を可能にする
         uint32_t sq_tail_cached_;
+        uint32_t setup_flags_ = 0;
+        // run() の実行中か (submit() を遅延させる)
+        bool in_loop_ = false;
+        std::atomic<uint64_t> syscalls_{ 0 };
+        // 固定ファイルテーブルのサイズ
+        unsigned fixed_file_slots_ = 0;
+        // install_fixed_file() が次に使う予約スロット
+        unsigned next_reserved_slot_ = 0;
+        // 対応している opcode の集合
+        std::bitset<256> supported_ops_;
         // 内部ヘルパー: mmap のセットアップ
         void setup_memory_mapping();
+        void probe_opcodes() noexcept;
+        // 積まれた SQE をカーネルから見えるようにし (tail の更新)、カーネルが未消費の SQE 数を返す
+        unsigned publish() noexcept;
+        // io_uring_enter を発行する (SQPOLL では必要な場合だけ)
+        // wait を指定すると、完了が無くてもその時間で戻る (IORING_ENTER_EXT_ARG。-ETIME は errno に入る)
+        int enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+            const __kernel_timespec *wait = nullptr) noexcept;
+
+        // タイミングホイールの次の期限まで待機できるようにする
+        // IORING_FEAT_EXT_ARG (Linux 5.11+) では待機のタイムアウトを wait_ts_ に設定して true を返す。
+        // 非対応カーネルではリングのタイムアウトを一つだけ発行しておく (期限の遅れを抑えるため最下位の一周分まで)
+        bool prepare_wait(std::chrono::milliseconds timeout);
+        void handle_timeout(int result, uint32_t flags);
+        timer_wheel timers_;
+        __kernel_timespec wait_ts_{};
+        __kernel_timespec timeout_ts_{};
+        member_task<io_context> timeout_op_{ *this, &io_context::handle_timeout };
+        bool timeout_armed_ = false;
+
+        // stop() による起床用: eventfd への読み込みを常に1つ発行しておく
+        void arm_wakeup();
+        void handle_wakeup(int result, uint32_t flags);
+        unique_socket wakeup_fd_;
+        uint64_t wakeup_value_ = 0;
+        member_task<io_context> wakeup_op_{ *this, &io_context::handle_wakeup };
+        bool wakeup_armed_ = false;
+        std::atomic<bool> stop_requested_{ false };
     };
 } // namespace ouroboros::http
 #endif // IO_CONTEXT_HPP
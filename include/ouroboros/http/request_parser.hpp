@@ -0,0 +1,149 @@
+#ifndef REQUEST_PARSER_HPP
+#define REQUEST_PARSER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include "ouroboros/http/type_definitions.hpp"
+
+namespace ouroboros::http
+{
+    // パーサーの上限値 (超過時は対応するエラーステータスで失敗する)
+    struct parser_limits
+    {
+        size_t max_request_line = 8192;      // 414 URI Too Long
+        size_t max_header_bytes = 16384;     // 431 Request Header Fields Too Large (リクエストライン含む)
+        size_t max_headers = header_list::capacity; // 431
+        size_t max_body_size = 1024 * 1024;  // 413 Content Too Large (リクエストでは body_options::max_size の既定値)
+    };
+
+    enum class parse_status
+    {
+        incomplete, // データ不足。追加のデータと共に再度 parse() を呼ぶ
+        complete,   // リクエストが揃った
+        error       // 不正なリクエスト (error_status() を返して接続を閉じる)
+    };
+
+    // 解析する開始行の種類
+    enum class parser_mode : uint8_t
+    {
+        request, // サーバー: リクエストライン
+        response // クライアント: ステータスライン
+    };
+
+    // メソッド名を enum に変換する (未対応なら nullopt)
+    std::optional<method> parse_method(std::string_view name) noexcept;
+
+    // 再開可能な HTTP/1.1 リクエストパーサー (ステートマシン)
+    //
+    // ヒープ割り当てを一切行わない。解析位置は受信データ先頭からのオフセットで保持するため、
+    // 呼び出し間でデータが別のバッファへ移動 (連結) されても解析を継続できる。
+    // 完了時に request の各フィールドを、その時点のデータへの string_view として設定する。
+    // parser_mode::response ではステータスラインから始まるレスポンスを解析する (HTTP クライアント用)。
+    // ヘッダーの解析と上限値は共通で、ボディの長さだけレスポンスの規則 (RFC 9112 6.3) に従う。
+    class request_parser
+    {
+    public:
+        explicit request_parser(const parser_limits &limits = {}) noexcept : limits_(limits) {}
+        request_parser(parser_mode mode, const parser_limits &limits) noexcept : limits_(limits), mode_(mode) {}
+
+        // 次のリクエストの解析に備えて状態を初期化する
+        void reset() noexcept;
+
+        // data: このリクエストの先頭から現在までに受信したデータ全体
+        //       (前回の呼び出し時のデータを同じオフセットで含んでいること)
+        [[nodiscard]] parse_status parse(std::string_view data, request &req) noexcept;
+        // レスポンスを解析する (parser_mode::response)
+        // eof: 接続が閉じられ、data が最後まで揃った (Content-Length の無いボディは接続の終わりまで)
+        // チャンク形式のボディはヘッダーまでで complete を返す (body_pending()。呼び出し元が body_decoder で読む)
+        [[nodiscard]] parse_status parse(std::string_view data, client_response &res, bool eof = false) noexcept;
+        // parser_mode::response: 対応するリクエストのメソッド (HEAD への応答はボディを持たない)
+        // reset() の後、parse() の前に設定する
+        void set_request_method(http::method m) noexcept { method_ = m; }
+        // parser_mode::response: ステータスラインとヘッダーだけを解析する (リバースプロキシ用)
+        // complete 時に headers を設定する (ビューは data を指す)。ボディは呼び出し元が転送する
+        [[nodiscard]] parse_status parse_head(std::string_view data, header_list &headers) noexcept;
+
+        // parse_head() が complete の時のレスポンスの情報
+        [[nodiscard]] int status() const noexcept { return status_; }
+        [[nodiscard]] std::string_view reason(std::string_view data) const noexcept { return target_.in(data); }
+        // ステータスラインとヘッダーのバイト数 (ボディはこの位置から始まる)
+        [[nodiscard]] size_t head_size() const noexcept { return head_end_; }
+        // ボディの長さ (body_until_close() の場合は不定)
+        [[nodiscard]] size_t body_length() const noexcept { return content_length_; }
+        [[nodiscard]] bool body_until_close() const noexcept { return until_close_; }
+        // 上流が接続の再利用を許しているか (ボディを読み終えた後)
+        [[nodiscard]] bool keep_alive() const noexcept {
+            return !until_close_ && (version_minor_ >= 1 ? !connection_close_ : (connection_keep_alive_ && !connection_close_));
+        }
+
+        // complete 時: このリクエストが占めるバイト数 (ヘッダー + ボディ)。以降は次のリクエスト
+        // body_pending() の場合はヘッダーまで (ボディは呼び出し元がこの位置から読む)
+        [[nodiscard]] size_t consumed() const noexcept { return head_end_ + (body_pending_ ? 0 : content_length_); }
+        // complete 時: ボディがまだ揃っていない、またはチャンク形式 (req.body は空)
+        [[nodiscard]] bool body_pending() const noexcept { return body_pending_; }
+        // Transfer-Encoding: chunked のメッセージ (body_length() は 0)
+        [[nodiscard]] bool chunked() const noexcept { return chunked_; }
+        // incomplete 時: ヘッダーを受信し終え、ボディの続きを待っているか
+        [[nodiscard]] bool in_body() const noexcept { return state_ == state::body; }
+        // error 時: 返すべき HTTP ステータスコード
+        [[nodiscard]] int error_status() const noexcept { return error_status_; }
+        [[nodiscard]] const parser_limits &limits() const noexcept { return limits_; }
+
+    private:
+        enum class state : uint8_t
+        {
+            request_line, // 開始行 (レスポンスではステータスライン)
+            headers,
+            body,
+            done,
+            failed
+        };
+
+        // データ先頭からの位置と長さ
+        struct range
+        {
+            uint32_t offset;
+            uint32_t length;
+
+            std::string_view in(std::string_view data) const noexcept { return data.substr(offset, length); }
+        };
+
+        parse_status fail(int status) noexcept;
+        // 開始行とヘッダーを解析する (ヘッダー終端まで揃えば complete)
+        parse_status parse_head(std::string_view data) noexcept;
+        size_t reject(int status) noexcept; // 行の解析関数用: fail() して 0 を返す
+        // begin から始まる一行を解析し、次の行の先頭を返す (データ不足またはエラーなら 0)
+        size_t parse_request_line(std::string_view data, size_t begin) noexcept;
+        size_t parse_status_line(std::string_view data, size_t begin) noexcept;
+        size_t parse_header_line(std::string_view data, size_t begin) noexcept;
+        void materialize(std::string_view data, request &req) const noexcept;
+        void materialize(std::string_view data, client_response &res) const;
+
+        parser_limits limits_;
+        parser_mode mode_ = parser_mode::request;
+        state state_ = state::request_line;
+        size_t line_begin_ = 0; // 解析中の行の先頭 (データ不足時はここから再開する)
+        size_t head_end_ = 0;   // ヘッダー終端 (空行の直後)
+        size_t content_length_ = 0;
+        int error_status_ = 0;
+
+        // 解析結果 (オフセット表現)
+        http::method method_ = method::GET; // レスポンスでは対応するリクエストのメソッド
+        range target_{};                    // レスポンスでは reason-phrase
+        int status_ = 0;
+        bool until_close_ = false;          // レスポンスのボディが接続の終わりまで続く
+        int version_minor_ = 1;
+        std::array<std::pair<range, range>, header_list::capacity> headers_;
+        size_t header_count_ = 0;
+        bool has_content_length_ = false;
+        bool chunked_ = false;
+        bool body_pending_ = false;
+        bool connection_close_ = false;
+        bool connection_keep_alive_ = false;
+    };
+}
+
+#endif // REQUEST_PARSER_HPP
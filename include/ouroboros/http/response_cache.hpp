@@ -0,0 +1,69 @@
+#ifndef RESPONSE_CACHE_HPP
+#define RESPONSE_CACHE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "ouroboros/http/type_definitions.hpp"
+
+namespace ouroboros::http
+{
+    // シリアライズ済みレスポンスの LRU キャッシュ (コアごと。スレッド間で共有しないこと)
+    //
+    // response_cache_policy を指定したルートのレスポンスをワイヤ上のバイト列のままリクエストターゲットごとに保持し、
+    // 一致すればハンドラの呼び出しもシリアライズも行わずに送信バッファへコピーする。
+    // Date と Connection だけはコピー時に現在の値へ差し替える。
+    // 期限 (ttl) とタグの世代番号は参照時に調べ、古いエントリはその場で捨てる。
+    class response_cache
+    {
+    public:
+        static constexpr size_t default_capacity = 1024;
+        static constexpr size_t default_max_entry_size = 64 * 1024;
+
+        explicit response_cache(size_t capacity = default_capacity, size_t max_entry_size = default_max_entry_size);
+
+        // target のエントリがあれば out の末尾にレスポンスを追加して true を返す
+        //   omit_body: HEAD へのレスポンス / close: Connection: close を付ける
+        bool write(std::string_view target, std::string &out, bool omit_body, bool close);
+        // res を target のエントリとして保持する (200 以外、ファイル、max_entry_size を超えるものは保持しない)
+        // generation はハンドラを呼ぶ前に読んだタグの世代番号 (ハンドラの実行中に無効化された場合に古い内容を残さない)
+        void store(std::string_view target, const response &res, const response_cache_policy &policy, uint64_t generation);
+        void clear() noexcept;
+
+        [[nodiscard]] bool empty() const noexcept { return index_.empty(); }
+        [[nodiscard]] size_t size() const noexcept { return index_.size(); }
+        [[nodiscard]] size_t capacity() const noexcept { return capacity_; }
+        [[nodiscard]] uint64_t hits() const noexcept { return hits_; }
+        [[nodiscard]] uint64_t misses() const noexcept { return misses_; }
+
+    private:
+        struct entry
+        {
+            std::string key;
+            std::string wire;      // keep-alive として書いたレスポンス全体
+            size_t date_offset;    // "Date: ...\r\n" の先頭
+            size_t date_end;
+            size_t connection_end; // "Connection: keep-alive\r\n" の直後
+            size_t body_offset;
+            std::chrono::steady_clock::time_point expires; // ttl が無ければ max()
+            std::optional<cache_tag> tag;
+            uint64_t generation;   // 保持した時点のタグの世代番号
+        };
+
+        void erase(std::list<entry>::iterator it);
+
+        size_t capacity_;
+        size_t max_entry_size_;
+        std::list<entry> lru_; // 先頭が最も新しく使われたもの
+        std::unordered_map<std::string_view, std::list<entry>::iterator> index_; // キーは lru_ 内の文字列
+        uint64_t hits_ = 0;
+        uint64_t misses_ = 0;
+    };
+}
+
+#endif // RESPONSE_CACHE_HPP
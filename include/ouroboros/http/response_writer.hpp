@@ -0,0 +1,35 @@
+#ifndef RESPONSE_WRITER_HPP
+#define RESPONSE_WRITER_HPP
+
+#include <string>
+#include <string_view>
+#include "ouroboros/http/type_definitions.hpp"
+
+namespace ouroboros::http
+{
+    // ステータスライン "HTTP/1.1 NNN Reason\r\n" (事前に生成した表から返す。標準外のコードは空)
+    [[nodiscard]] std::string_view status_line(int status) noexcept;
+
+    // "Date: <IMF-fixdate>\r\n"
+    // スレッド (= コア) ごとにキャッシュし、秒が変わった時だけ再生成する
+    [[nodiscard]] std::string_view date_header() noexcept;
+
+    // out の末尾にレスポンス (ステータスライン・ヘッダー・ボディ) を追加する
+    //
+    // 必要な長さを先に計算して一度だけ伸長し、直接書き込む。out は呼び出し側が再利用するため、
+    // 容量が足りていればヒープ割り当ては発生しない。
+    // Content-Length / Date / Connection はここで付与し、ハンドラが設定した同名のヘッダーは無視する。
+    // 長さの分からないストリーミングのボディ (response::stream) は Content-Length の代わりに
+    // Transfer-Encoding: chunked を付ける (close の場合は付けず、接続の終わりをボディの終わりとする)。
+    //   omit_body: HEAD へのレスポンス (Content-Length はボディの長さのまま、ボディは送らない)
+    //              (ファイルを送信する場合、Content-Length は set_content_length() の値でボディは空)
+    //   close    : Connection: close を付ける (false なら keep-alive)
+    void write_response(std::string &out, const response &res, bool omit_body, bool close);
+
+    // write_response() が書き込むバイト数
+    [[nodiscard]] size_t response_size(const response &res, bool omit_body, bool close) noexcept;
+    // dst (response_size() バイト以上) へ直接書き込み、書き込んだ末尾を返す (登録済み送信バッファ用)
+    char *write_response(char *dst, const response &res, bool omit_body, bool close) noexcept;
+}
+
+#endif // RESPONSE_WRITER_HPP
@@ -0,0 +1,294 @@
+#ifndef REVERSE_PROXY_HPP
+#define REVERSE_PROXY_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "ouroboros/http/body_decoder.hpp"
+#include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/request_parser.hpp"
+#include "ouroboros/http/socket_address.hpp"
+#include "ouroboros/http/task.hpp"
+#include "ouroboros/http/timer_wheel.hpp"
+#include "ouroboros/http/type_definitions.hpp"
+#include "ouroboros/http/unique_socket.hpp"
+
+namespace ouroboros::http
+{
+    // 転送先の上流サーバー
+    struct proxy_backend
+    {
+        std::string host; // IP アドレスまたはホスト名 (reverse_proxy の構築時に一度だけ解決する)
+        uint16_t port = 80;
+    };
+
+    // 上流サーバーの選び方 (状態はコアごと)
+    enum class balance_policy : uint8_t
+    {
+        round_robin,      // 順番に割り当てる
+        least_outstanding // 処理中のリクエストが最も少ないサーバー (同数なら順番)
+    };
+
+    // リバースプロキシの設定
+    struct proxy_options
+    {
+        std::vector<proxy_backend> backends;
+        balance_policy balance = balance_policy::round_robin;
+        // 転送前にリクエストターゲットの先頭から取り除く接頭辞 (例: "/api" なら "/api/users?id=1" -> "/users?id=1")
+        std::string strip_prefix;
+        // Host をクライアントの値のまま送る (false なら上流の host:port を送り、元の値は X-Forwarded-Host に入れる)
+        bool preserve_host = false;
+        // ヘッダーの書き換え (名前は大文字・小文字を区別しない。set は同名のヘッダーを置き換える)
+        // ホップバイホップヘッダー (Connection とそこに列挙されたもの、Keep-Alive、Upgrade 等) は常に転送しない
+        std::vector<std::pair<std::string, std::string>> set_request_headers;
+        std::vector<std::string> remove_request_headers;
+        std::vector<std::pair<std::string, std::string>> set_response_headers;
+        std::vector<std::string> remove_response_headers;
+        // 接続の確立を待つ時間 (超えたら次のサーバーを試す)
+        std::chrono::milliseconds connect_timeout{ 3000 };
+        // リクエストの送信開始からレスポンスヘッダーを受信し終えるまで (超えたら 504)
+        // ボディの転送が進まない時間は server_options::write_timeout で制限される
+        std::chrono::milliseconds read_timeout{ 30000 };
+        // 待機中の接続を再利用する期間 (上流の Keep-Alive タイムアウトより短くする)
+        std::chrono::milliseconds idle_timeout{ 4000 };
+        // コア・上流サーバーごとに保持する待機中の接続数 (0 で再利用しない)
+        size_t max_idle_connections = 32;
+        // 受動的ヘルスチェック: 連続して max_fails 回失敗 (接続できない・タイムアウト・不正なレスポンス) した
+        // サーバーには fail_timeout の間割り当てない (0 で無効。全て停止中なら最も早く復帰するものを試す)
+        unsigned max_fails = 3;
+        std::chrono::milliseconds fail_timeout{ 10000 };
+        // レスポンスのステータスラインとヘッダーの上限 (ボディはユーザー空間を経由しないため上限なし)
+        size_t max_response_header = 16384;
+    };
+
+    // 解決済みの設定 (全コアで共有し、変更しない)
+    struct proxy_route
+    {
+        struct backend
+        {
+            socket_address address;
+            std::string host_header;
+            std::string name; // ログ用 "host:port"
+        };
+
+        proxy_options options;
+        std::vector<backend> backends;
+    };
+
+    // ルートに一致したリクエストを上流サーバーへ転送するハンドラ
+    //
+    //   reverse_proxy api({ .backends = { { "10.0.0.1", 8080 }, { "10.0.0.2", 8080 } }, .strip_prefix = "/api" });
+    //   api.mount(routes, "/api/*rest");
+    //
+    // ハンドラは転送先を response::proxy_pass() で指定するだけで、転送はセッションが非同期に行う。
+    // 上流への接続はコアごと・サーバーごとにプールして再利用し (server::proxy_pool())、
+    // レスポンスボディは上流のソケット -> パイプ -> クライアントのソケットへ SPLICE で送る (ユーザー空間へのコピーなし)。
+    // チャンク形式のボディはそのまま転送し、終わりは body_decoder で見つける (長さの行だけを受信して解析し、
+    // チャンクのデータは SPLICE する)。リクエストボディは受信バッファで解析済みのため、ヘッダーと共に送信する。
+    // Upgrade は未対応 (502)。
+    class reverse_proxy
+    {
+    public:
+        // 上流のアドレスを解決する (サーバーが無い・解決できなければ std::system_error / std::invalid_argument)
+        explicit reverse_proxy(proxy_options options);
+
+        void operator()(const request &req, response &res) const;
+
+        // path (例: "/api/*rest") に全てのメソッドのルートとして追加する
+        void mount(std::vector<route_entry> &routes, std::string_view path) const;
+
+        [[nodiscard]] const proxy_route &route() const noexcept { return *route_; }
+
+    private:
+        // handler_function (std::function) はコピー可能である必要があるため共有する
+        std::shared_ptr<const proxy_route> route_;
+    };
+
+    // 一つのルートの上流サーバーの状態 (コアごと。server が所有する。スレッドセーフではない)
+    // 待機中の接続・処理中のリクエスト数・失敗回数を上流サーバーごとに持つ
+    class upstream_pool
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        explicit upstream_pool(const proxy_route &route);
+
+        upstream_pool(const upstream_pool &) = delete;
+        upstream_pool &operator=(const upstream_pool &) = delete;
+
+        [[nodiscard]] const proxy_route &route() const noexcept { return route_; }
+        [[nodiscard]] size_t size() const noexcept { return backends_.size(); }
+
+        // 割り当てるサーバーを選び、処理中の数を増やす (exclude は直前に失敗したサーバー)
+        [[nodiscard]] size_t select(clock::time_point now, size_t exclude = npos);
+        // 処理を終えた (select() と対にする)
+        void done(size_t index) noexcept { backends_[index].outstanding--; }
+        // 結果を記録する (失敗が続いたサーバーは一定時間割り当てない)
+        void report(size_t index, bool success, clock::time_point now);
+
+        // 待機中の接続を取り出す (idle_timeout を過ぎたものは閉じる。無ければ無効なソケット)
+        [[nodiscard]] unique_socket acquire(size_t index, clock::time_point now);
+        // 再利用できる接続を返す (上限を超える分は閉じる)
+        void release(size_t index, unique_socket socket, clock::time_point now);
+
+        [[nodiscard]] size_t outstanding(size_t index) const noexcept { return backends_[index].outstanding; }
+        [[nodiscard]] size_t idle_connections(size_t index) const noexcept { return backends_[index].idle.size(); }
+        // これまでに開いた接続の数 (プールの効果の確認用)
+        [[nodiscard]] uint64_t connections_opened() const noexcept { return connections_opened_; }
+        void connection_opened() noexcept { connections_opened_++; }
+
+    private:
+        struct idle_connection
+        {
+            unique_socket socket;
+            clock::time_point since;
+        };
+        struct backend_state
+        {
+            std::vector<idle_connection> idle; // 末尾が最も新しい
+            size_t outstanding = 0;
+            unsigned fails = 0;
+            clock::time_point down_until{};
+        };
+
+        const proxy_route &route_;
+        std::vector<backend_state> backends_;
+        size_t next_ = 0;
+        uint64_t connections_opened_ = 0;
+    };
+
+    // 一つのリクエストを上流へ送り、レスポンスヘッダーを受信するまでの処理 (http_session が所有し、再利用する)
+    //
+    // 上流の選択・接続 (またはプールからの取り出し)・送信・ヘッダーの受信を行い、
+    // 終わったら done.complete(status, 0) を呼ぶ (0: 成功、それ以外: 返すべきステータス 502 / 504)。
+    // 成功後、ボディはセッションが socket() から SPLICE し、finish() で接続をプールへ返す。
+    // チャンク形式のボディは relay_chunked() が区切りを解析しながら送信データへ書き、チャンクのデータの残りを SPLICE させる。
+    class proxy_transfer
+    {
+    public:
+        // relay_chunked() の後にセッションが行うこと
+        enum class chunk_step : uint8_t
+        {
+            receive, // 長さの行などの続きを receive_buffer() へ受信する
+            splice,  // チャンクのデータの残り (body_remaining()) を socket() から SPLICE する
+            done,    // ボディが終わった
+            error    // 不正なチャンク形式 (クライアントの接続も閉じる)
+        };
+
+        explicit proxy_transfer(io_context &ctx) noexcept : ctx_(ctx) {}
+
+        // 完了ハンドラが自身を指すためコピー・ムーブ禁止
+        proxy_transfer(const proxy_transfer &) = delete;
+        proxy_transfer &operator=(const proxy_transfer &) = delete;
+
+        // 転送を開始する (req と target はこの呼び出しの間だけ参照する)
+        // 開始できなければ done を呼ばずにステータス (502) を返す
+        [[nodiscard]] int start(upstream_pool &pool, const request &req, std::string_view target, task &done);
+        // 実行中の操作を取り消す (done は後で呼ばれる)
+        void cancel() noexcept;
+
+        // --- 成功後 ---
+        // ステータスライン・転送するヘッダー・Connection を out に書く (close: Connection: close)
+        // chunked: Transfer-Encoding: chunked を付ける (チャンク形式のボディをそのまま転送する場合)
+        void write_head(std::string &out, bool close, bool chunked) const;
+        // ヘッダーと共に受信したボディの先頭 (チャンク形式では空。relay_chunked() が書く)
+        [[nodiscard]] std::string_view body_prefix() const noexcept { return body_prefix_; }
+        // ソケットに残っているボディのバイト数 (until_close() の場合は接続の終わりまで)
+        // チャンク形式では現在のチャンクのデータの残り
+        [[nodiscard]] uint64_t body_remaining() const noexcept {
+            return parser_.chunked() ? decoder_.data_remaining() : body_remaining_;
+        }
+        [[nodiscard]] bool until_close() const noexcept { return parser_.body_until_close(); }
+        [[nodiscard]] bool chunked() const noexcept { return parser_.chunked(); }
+        // 受信済みのチャンク形式のボディを区切りながら out へ書き、次に必要な操作を返す
+        // decode: データだけを書く (Transfer-Encoding を使えない HTTP/1.0 のクライアント向け)
+        [[nodiscard]] chunk_step relay_chunked(std::string &out, bool decode);
+        // チャンクの区切りを受信する領域 (受信したら received() を呼ぶ)
+        [[nodiscard]] std::span<char> receive_buffer() noexcept { return { in_.data(), in_.size() }; }
+        void received(size_t n) noexcept { in_used_ = n; }
+        // チャンクのデータを n バイト SPLICE した
+        void spliced(uint64_t n) noexcept { decoder_.skip(n); }
+        [[nodiscard]] int socket() const noexcept { return socket_.native_handle(); }
+        // ボディを転送し終えた (reusable: 最後まで転送できた。上流が許せば接続をプールへ返す)
+        void finish(bool reusable);
+
+    private:
+        enum class stage : uint8_t
+        {
+            idle,
+            connecting,
+            sending,
+            receiving,
+            done
+        };
+
+        void handle_io(int result, uint32_t flags);
+        void handle_timeout(int result, uint32_t flags);
+
+        // backend_ への接続をプールから取り出すか新しく開く (fresh: プールを使わない)
+        bool open(bool fresh);
+        bool submit_connect();
+        bool submit_send();
+        bool submit_recv();
+        void submit_cancel() noexcept;
+        // 受信済みのデータからヘッダーを解析する
+        void parse();
+        // 接続できなかった: 次のサーバーを試す (試すものが無ければ失敗)
+        void connect_failed(int status);
+        // 再利用した接続が応答前に閉じられた: 冪等なメソッドは一度だけ新しい接続で送り直す
+        bool retry_stale();
+        // 上流の異常: サーバーの失敗として記録して終える
+        void fail(int status);
+        // 送信データを作る (Host の行は set_host() が書く)
+        void serialize(const request &req, std::string_view target);
+        // 選んだサーバーの Host を送信データへ設定する
+        void set_host();
+        void complete(int status);
+
+        io_context &ctx_;
+        upstream_pool *pool_ = nullptr;
+        task *done_ = nullptr;
+        stage stage_ = stage::idle;
+        method method_ = method::GET;
+        size_t backend_ = upstream_pool::npos;
+        size_t attempts_ = 0;
+        bool reused_ = false;    // プールから取り出した接続か
+        bool retried_ = false;   // 送り直し済み
+        bool armed_ = false;     // io_op_ が実行中か
+        bool timed_out_ = false;
+        bool cancelled_ = false;
+        unique_socket socket_;
+
+        // 送信するリクエスト (Host の行は [host_begin_, host_end_))
+        std::string out_;
+        size_t out_sent_ = 0;
+        size_t host_begin_ = 0;
+        size_t host_end_ = 0;
+        bool host_fixed_ = false; // preserve_host: クライアントの Host を送る
+
+        // レスポンスヘッダーの受信
+        request_parser parser_{ parser_mode::response, {} };
+        std::vector<char> in_;
+        size_t in_used_ = 0;
+        header_list headers_;
+        std::string_view body_prefix_;
+        uint64_t body_remaining_ = 0;
+        // チャンク形式のボディ (in_ の body_read_ から未解析)
+        body_decoder decoder_;
+        size_t body_read_ = 0;
+        bool excess_ = false; // ボディより後ろのデータを受信した (接続は再利用しない)
+
+        member_task<proxy_transfer> io_op_{ *this, &proxy_transfer::handle_io };
+        member_task<proxy_transfer> timeout_op_{ *this, &proxy_transfer::handle_timeout };
+        timer timer_{ timeout_op_ };
+    };
+}
+
+#endif // REVERSE_PROXY_HPP
@@ -0,0 +1,62 @@
+#ifndef ROUTER_HPP
+#define ROUTER_HPP
+
+#include <array>
+#include <memory>
+#include <string_view>
+#include "ouroboros/http/type_definitions.hpp"
+
+namespace ouroboros::http
+{
+    // 圧縮基数木 (radix tree) によるルーティングテーブル
+    //
+    // メソッドごとに一つの木を持ち、共通の接頭辞を一つのノードにまとめる。
+    // 検索はパスを先頭から一度走査するだけで、文字列の構築やハンドラのコピーは行わない。
+    //
+    // パターンの構文 (':' と '*' はセグメントの先頭でのみ特別な意味を持つ):
+    //   /users/:id       次の '/' までの一つのセグメント (空は不可) に一致するパラメータ
+    //   /static/*path    残り全体 (空を含む) に一致するワイルドカード。名前を省略すると "*"
+    // 一致の優先順位は 静的 > パラメータ > ワイルドカード。一致しなければ後戻りして次を試す。
+    // ルートに登録されたハンドラと設定
+    struct route_handler
+    {
+        handler_function handler;
+        // コルーチンハンドラ (設定されていれば handler の代わりに呼ぶ)
+        async_handler_function async_handler;
+        response_cache_policy cache;
+        body_options body;
+    };
+
+    class router
+    {
+    public:
+        router();
+        ~router();
+
+        // Prohibit copying, allow moving
+        router(const router &) = delete;
+        router &operator=(const router &) = delete;
+        router(router &&) noexcept;
+        router &operator=(router &&) noexcept;
+
+        // ルートを追加する (同じパターンは上書き)
+        // 不正なパターン (同じ位置で名前の異なるパラメータ等) は std::invalid_argument を送出する
+        void add(method m, std::string_view pattern, any_handler handler, response_cache_policy cache = {},
+            body_options body = {});
+
+        // 一致したハンドラ (無ければ nullptr)
+        // params にはパラメータの名前 (テーブル内) と値 (path へのビュー) が設定される
+        [[nodiscard]] const route_handler *find(method m, std::string_view path, path_params &params) const noexcept;
+
+        // path に一致するルートを持つメソッドの集合 (method_bit のビットマスク。405 の Allow ヘッダー用)
+        [[nodiscard]] unsigned allowed_methods(std::string_view path) const noexcept;
+
+        // 木のノード (定義は router.cpp)
+        struct node;
+
+    private:
+        std::array<std::unique_ptr<node>, method_count> roots_;
+    };
+}
+
+#endif // ROUTER_HPP
@@ -0,0 +1,90 @@
+#ifndef RUNTIME_HPP
+#define RUNTIME_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/server.hpp"
+#include "ouroboros/http/type_definitions.hpp"
+
+namespace ouroboros::http
+{
+    // Thread-per-core ランタイムの設定
+    struct runtime_options
+    {
+        // ワーカースレッド数 (0 = std::thread::hardware_concurrency())
+        unsigned threads = 0;
+        // 各ワーカーを割り当てるCPU (空なら 0, 1, 2, ...)
+        std::vector<unsigned> cpus;
+        // ワーカースレッドを CPU に固定するか
+        bool pin_threads = true;
+        // SO_ATTACH_REUSEPORT_CBPF で、接続を受信処理したCPUのワーカーへ振り分けるか
+        bool reuseport_cbpf = false;
+        // 各 io_context の設定
+        // ワーカーは自分のリングにだけ発行するため、SINGLE_ISSUER / DEFER_TASKRUN を既定で有効にする
+        // (非対応カーネルでは io_context が外す)
+        io_context_options io = { .single_issuer = true, .defer_taskrun = true };
+        // 各ワーカーの server に渡す設定
+        server_options server;
+    };
+
+    // Thread-per-core (Shared-nothing) ランタイム
+    //
+    // ワーカーごとに io_context・リスナー (SO_REUSEPORT)・ルーティングテーブルのコピーを持ち、
+    // ワーカー間で状態を共有しない。カーネルが SO_REUSEPORT グループ内で接続を分散する。
+    class runtime
+    {
+    public:
+        explicit runtime(runtime_options options = {});
+        // 実行中であれば停止し、全ワーカーの終了を待つ
+        ~runtime();
+
+        // スレッドを保持するためコピー・ムーブ禁止
+        runtime(const runtime &) = delete;
+        runtime &operator=(const runtime &) = delete;
+
+        // 全ワーカーを起動する
+        // 全リスナーが listen を完了し、イベントループに入る直前まで待ってから戻る
+        // いずれかのワーカーが失敗した場合は全ワーカーを停止してエラーを返す
+        [[nodiscard]] std::expected<void, std::error_code> start(uint16_t port, const std::vector<route_entry> &routes);
+
+        // 全ワーカーのイベントループに停止を要求する (他スレッド・シグナル待ちスレッドから呼び出し可能)
+        void stop() noexcept;
+        // 全ワーカーの終了を待つ
+        void wait();
+
+        [[nodiscard]] size_t size() const noexcept { return workers_.size(); }
+
+    private:
+        struct worker
+        {
+            unsigned cpu = 0;
+            std::thread thread;
+            // ワーカースレッドが所有する io_context (停止要求の送信先)
+            // stop() と io_context の破棄が競合しないよう mutex で保護する
+            std::mutex mutex;
+            io_context *ctx = nullptr;
+            std::error_code error;
+        };
+
+        void worker_main(size_t index, uint16_t port, const std::vector<route_entry> &routes);
+
+        runtime_options options_;
+        std::vector<std::unique_ptr<worker>> workers_;
+
+        // 起動の同期
+        // listen 順序 = SO_REUSEPORT グループ内のインデックス (CBPF の戻り値と対応させるため逐次化する)
+        std::atomic<size_t> listen_turn_{ 0 };
+        std::atomic<size_t> listening_{ 0 };
+        std::atomic<size_t> ready_{ 0 };
+        std::atomic<bool> stopping_{ false };
+    };
+}
+
+#endif // RUNTIME_HPP
@@ -0,0 +1,69 @@
+#ifndef SEND_BUFFER_POOL_HPP
+#define SEND_BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <system_error>
+#include <vector>
+#include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/error.hpp"
+
+namespace ouroboros::http
+{
+    // 登録済みの送信バッファプール (IORING_REGISTER_BUFFERS)
+    //
+    // 大きなレスポンスを直接ここへ書き込み、IORING_OP_SEND_ZC + IORING_RECVSEND_FIXED_BUF で送信する。
+    // ページは登録時に一度だけピン留めされるため、送信ごとのピン留め・コピーが発生しない。
+    // バッファのインデックスはそのまま登録バッファのインデックス (sqe->buf_index) になる
+    // (io_context に登録するバッファはこのプールのみであること)。
+    class send_buffer_pool
+    {
+    public:
+        static constexpr uint16_t default_buffer_count = 8;
+        static constexpr uint32_t default_buffer_size = 1024 * 1024;
+
+        // Factory function for safe creation
+        [[nodiscard]] static std::expected<send_buffer_pool, std::error_code> create(io_context &ctx,
+            uint16_t buffer_count = default_buffer_count,
+            uint32_t buffer_size = default_buffer_size);
+        // 空のプール (acquire() は常に失敗する)
+        send_buffer_pool() noexcept = default;
+        ~send_buffer_pool();
+
+        // Prohibit copying, allow moving
+        send_buffer_pool(const send_buffer_pool &) = delete;
+        send_buffer_pool &operator=(const send_buffer_pool &) = delete;
+        send_buffer_pool(send_buffer_pool &&other) noexcept;
+        send_buffer_pool &operator=(send_buffer_pool &&other) noexcept;
+
+        // 空いているバッファを取得する (無ければ nullopt)
+        [[nodiscard]] std::optional<uint16_t> acquire() noexcept;
+        // 送信 (ゼロコピーの場合は F_NOTIF の受信) を終えたバッファを返却する
+        void release(uint16_t index) noexcept;
+
+        [[nodiscard]] char *data(uint16_t index) const noexcept {
+            return storage_ + static_cast<size_t>(index) * buffer_size_;
+        }
+        [[nodiscard]] uint16_t buffer_count() const noexcept { return buffer_count_; }
+        [[nodiscard]] uint32_t buffer_size() const noexcept { return buffer_size_; }
+        [[nodiscard]] size_t available() const noexcept { return free_.size(); }
+
+    private:
+        send_buffer_pool(uint16_t buffer_count, uint32_t buffer_size);
+        void release_storage() noexcept;
+
+        io_context *ctx_ = nullptr;
+        uint16_t buffer_count_ = 0;
+        uint32_t buffer_size_ = 0;
+
+        // バッファ本体 (buffer_count_ * buffer_size_ バイト、mmap で確保)
+        char *storage_ = nullptr;
+        size_t storage_sz_ = 0;
+        // 空いているバッファのインデックス (スタック)
+        std::vector<uint16_t> free_;
+    };
+}
+
+#endif // SEND_BUFFER_POOL_HPP
@@ -1,60 +1,208 @@
 #pragma once
 
 #include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/buffer_pool.hpp"
+#include "ouroboros/http/send_buffer_pool.hpp"
+#include "ouroboros/http/fixed_socket.hpp"
 #include "ouroboros/http/error.hpp"
 #include "ouroboros/http/task.hpp"
 #include "ouroboros/http/member_binder.hpp"
 #include "ouroboros/http/type_definitions.hpp"
+#include "ouroboros/http/request_parser.hpp"
+#include "ouroboros/http/router.hpp"
+#include "ouroboros/http/static_router.hpp"
+#include "ouroboros/http/session_pool.hpp"
+#include "ouroboros/http/arena.hpp"
+#include "ouroboros/http/file_cache.hpp"
+#include "ouroboros/http/response_cache.hpp"
+#include "ouroboros/http/reverse_proxy.hpp"
+#include "ouroboros/http/websocket_session.hpp"
 #include <netinet/in.h>
 #include <expected>
-#include <map>
+#include <memory>
 #include <vector>
 #include <string>
-#include <optional>
+#include <span>
 
 namespace ouroboros::http
 {
+    // サーバーの動作設定
+    struct server_options
+    {
+        // IORING_ACCEPT_MULTISHOT: 一つの SQE で複数の接続を受け付ける
+        // (CQE に IORING_CQE_F_MORE が無くなった時だけ再発行する)
+        bool multishot_accept = true;
+        // IORING_FILE_INDEX_ALLOC: 接続を固定ファイルテーブルへ直接受け付け、プロセスのFDテーブルを使わない
+        // (全てのソケット操作に IOSQE_FIXED_FILE を付け、操作ごとの fget/fput を省く。リスナーも固定ファイルにする)
+        // テーブルの登録に失敗した場合や非対応カーネル (Linux 5.19 未満) では通常の fd に戻す
+        bool direct_descriptors = true;
+        // direct_descriptors 有効時に登録する固定ファイルテーブルのスロット数 (= 最大同時接続数)
+        unsigned fixed_file_slots = 65536;
+        // IORING_RECV_MULTISHOT: 接続ごとに受信操作を一度だけ発行し、Keep-Alive 中も受信を継続する
+        // (CQE に IORING_CQE_F_MORE が無くなった時、または ENOBUFS の時だけ再発行する)
+        bool multishot_recv = true;
+        // 同時に処理するセッション数の上限 (超えた接続は受け付け直後に閉じる)
+        // セッションは session_pool::slab_size 個ずつ必要になった時に確保される
+        size_t max_sessions = 65536;
+        // 同時に開いている WebSocket の接続数の上限 (超えたアップグレードには 503 を返す)
+        // アップグレードした接続は http_session を返却し、websocket_pool::slab_size 個ずつ確保する websocket_session へ移る
+        size_t max_websockets = 65536;
+        // リクエストアリーナのブロックの大きさ (レスポンスとハンドラの作業領域)
+        // ブロックはリクエストの処理中だけ arena_blocks() から借りる。超えた分は arena_upstream() からの割り当てになる
+        size_t arena_size = 8 * 1024;
+        // IORING_OP_SEND_ZC: この大きさ以上の送信をゼロコピーで行う (0 で無効。非対応カーネルでは常に無効)
+        // 通知 (IORING_CQE_F_NOTIF) を受け取るまで送信バッファは再利用されない
+        size_t zero_copy_threshold = 64 * 1024;
+        // ゼロコピー送信用の登録済みバッファ (IORING_REGISTER_BUFFERS)
+        // zero_copy_threshold 以上のレスポンスで、一つのバッファに収まるものはここへ直接書き込む
+        // (0 で無効。登録に失敗した場合は警告を出して無効にする)
+        uint16_t send_buffer_count = send_buffer_pool::default_buffer_count;
+        uint32_t send_buffer_size = send_buffer_pool::default_buffer_size;
+        // 開いたファイルのキャッシュ (static_files / response::send_file 用。0 で無効)
+        // file_revalidate_after を過ぎたエントリは開き直し、ファイルの更新を反映する
+        size_t file_cache_size = file_cache::default_capacity;
+        std::chrono::milliseconds file_revalidate_after = file_cache::default_revalidate_after;
+        // ファイル送信用パイプの大きさ (F_SETPIPE_SZ。一度の SPLICE で送る最大量)
+        size_t file_pipe_size = 256 * 1024;
+        // response::stream() のボディを送る単位 (chunked の1チャンク)。生成済みで未送信のデータは
+        // 送信中の分と合わせて接続ごとにおよそこの2倍までに抑え、それ以上は送信の完了まで生成器を呼ばない
+        size_t stream_chunk_size = 16 * 1024;
+        // シリアライズ済みレスポンスのキャッシュ (route_entry::cache を指定したルート用。0 で無効)
+        // max_entry_size を超えるレスポンスは保持しない
+        size_t response_cache_size = response_cache::default_capacity;
+        size_t response_cache_max_entry_size = response_cache::default_max_entry_size;
+        // 接続のタイムアウト (io_context::timers() のタイミングホイールで管理する。0 で無効)
+        // header_timeout: リクエストの受信開始 (新しい接続では接続) からヘッダーを受信し終えるまで。超えたら 408 を返して閉じる
+        std::chrono::milliseconds header_timeout{ 10000 };
+        // body_timeout: ボディの受信が進まない時間。超えたら 408 を返して閉じる
+        std::chrono::milliseconds body_timeout{ 30000 };
+        // keep_alive_timeout: レスポンスを送り終えてから次のリクエストが届き始めるまで。超えたら閉じる
+        std::chrono::milliseconds keep_alive_timeout{ 5000 };
+        // write_timeout: 送信 (ファイルを含む) が進まない時間。超えたら実行中の操作を取り消して閉じる
+        std::chrono::milliseconds write_timeout{ 30000 };
+        // 接続ごとのログ (接続・切断・タイムアウト等) を標準出力へ書く (デバッグ用)
+        // 一行ごとにフラッシュするため、接続の多い環境では有効にしないこと
+        bool log_connections = false;
+        // リクエストパーサーの上限値
+        parser_limits limits;
+        // コンパイル時ルーティングテーブル (static_router::table())。load_routes のテーブルより先に照合する
+        static_route_table static_routes;
+    };
+
     class server : public task
     {
     public:
         // Factory function for safe creation
-        [[nodiscard]] static std::expected<server, std::error_code> create(io_context &ctx, uint16_t port);
-        ~server() = default;
+        [[nodiscard]] static std::expected<server, std::error_code> create(io_context &ctx, uint16_t port,
+            const server_options &options = {});
+        ~server();
 
         // Prohibit copying, allow moving
         server(const server &) = delete;
         server &operator=(const server &) = delete;
-        server(server &&) = default;
+        server(server &&) noexcept;
         server &operator=(server &&) = default;
 
         // サーバー起動 (Bind -> Listen -> 最初のAccept発行)
         [[nodiscard]] std::expected<void, std::error_code> start();
 
+        // SO_ATTACH_REUSEPORT_CBPF: 接続を受信処理したCPUに対応するリスナーへ振り分ける
+        // cpus[i] は SO_REUSEPORT グループ内で i 番目に listen したソケットを処理するCPU
+        [[nodiscard]] std::expected<void, std::error_code> attach_reuseport_cbpf(std::span<const unsigned> cpus);
+
         // Load routes into the routing table
         void load_routes(const std::vector<route_entry> &routes);
 
-        // Find a handler for a given method and path
-        std::optional<handler_function> find_handler(method method, const std::string &path) const;
+        // Find a handler for a given method and path (nullptr if none)
+        // パスパラメータは params に設定される (値は path へのビュー)
+        const route_handler *find_handler(method method, std::string_view path, path_params &params) const noexcept {
+            return router_.find(method, path, params);
+        }
+        // 他のメソッドでは一致する場合の Allow ヘッダー値 (405 用。無ければ空)
+        std::string allowed_methods(std::string_view path) const;
+
+        // セッションが受信に使用するカーネル管理バッファ
+        buffer_pool &buffers() noexcept { return buffers_; }
+        // ゼロコピー送信用の登録済みバッファ (無効な場合は空)
+        send_buffer_pool &send_buffers() noexcept { return send_buffers_; }
+        // 接続をダイレクトディスクリプタで受け付けているか (設定とカーネルの対応状況による)
+        bool direct_descriptors() const noexcept { return direct_; }
+        // IORING_OP_SEND_ZC を使用するか (設定とカーネルの対応状況による)
+        bool zero_copy() const noexcept { return zero_copy_; }
+        // セッションのプール (in_use() が現在の接続数)
+        session_pool &sessions() noexcept { return sessions_; }
+        const session_pool &sessions() const noexcept { return sessions_; }
+        // WebSocket の接続のプール (in_use() が現在の接続数)
+        websocket_pool &websockets() noexcept { return websockets_; }
+        const websocket_pool &websockets() const noexcept { return websockets_; }
+        const server_options &options() const noexcept { return options_; }
+        // 待ち受けているポート (create() に 0 を渡した場合はカーネルが選んだポート)
+        uint16_t port() const noexcept { return port_; }
+        // リクエストアリーナの上位リソース (allocations() が処理中のヒープ割り当て回数)
+        counting_resource &arena_upstream() noexcept { return arena_upstream_; }
+        const counting_resource &arena_upstream() const noexcept { return arena_upstream_; }
+        // リクエストアリーナのブロック (全セッションで共有)
+        arena_block_pool &arena_blocks() noexcept { return arena_blocks_; }
+        const arena_block_pool &arena_blocks() const noexcept { return arena_blocks_; }
+        // 開いたファイルのキャッシュ (全セッションで共有)
+        file_cache &files() noexcept { return files_; }
+        // シリアライズ済みレスポンスのキャッシュ (全セッションで共有)
+        response_cache &responses() noexcept { return responses_; }
+        // reverse_proxy のルートごとの上流サーバーの状態と待機中の接続 (全セッションで共有。初回に作成する)
+        upstream_pool &proxy_pool(const proxy_route &route);
 
     private:
         // Private constructor, called by create()
-        server(io_context &ctx, uint16_t port, unique_socket socket);
+        server(io_context &ctx, uint16_t port, unique_socket socket, buffer_pool buffers,
+            send_buffer_pool send_buffers, const server_options &options);
 
         // task インターフェースの実装: Accept完了時に呼ばれる
         void complete(int result, uint32_t flags) override;
 
         // 次のAcceptリクエストを発行するヘルパー
         void submit_accept();
+        // 資源不足 (EMFILE / ENFILE 等) で失敗した Accept を、間を置いてから発行し直す
+        void retry_accept_later();
 
         io_context &ctx_;
         unique_socket server_socket_;
+        // 固定ファイルテーブルに登録したリスナー (Accept に使う。登録できなければ空)
+        fixed_socket listen_slot_;
+        bool direct_ = false;
+        // Accept の再発行用タイマー (タイミングホイールを使う)。サーバーはムーブされ得るため、start() で確保する
+        struct accept_retry;
+        std::unique_ptr<accept_retry> accept_retry_;
         uint16_t port_;
+        server_options options_;
 
         // Accept用のバッファ (接続元アドレス情報)
         struct sockaddr_in client_addr_;
         socklen_t client_len_;
 
+        // 受信バッファプール (全セッションで共有)
+        buffer_pool buffers_;
+        // 送信バッファプール (全セッションで共有)
+        send_buffer_pool send_buffers_;
+        bool zero_copy_ = false;
+
+        // アリーナから溢れた割り当ての計測 (セッションのアリーナが参照する)
+        counting_resource arena_upstream_;
+        // リクエストアリーナのブロックの空きリスト (処理中のリクエストだけがブロックを借りる)
+        arena_block_pool arena_blocks_;
+
+        // 開いたファイルのキャッシュ
+        file_cache files_;
+        // シリアライズ済みレスポンスのキャッシュ
+        response_cache responses_;
+        // 上流サーバーの状態 (ルートは少ないため線形探索)
+        std::vector<std::unique_ptr<upstream_pool>> proxy_pools_;
+        // WebSocket の接続のプール (http_session が引き継ぐため、sessions_ より後に破棄されるよう前に置く)
+        websocket_pool websockets_;
+
+        // セッションのプール (セッションはバッファプールと arena_upstream_、arena_blocks_、files_、proxy_pools_ を参照するため、先に破棄されるよう後ろに置く)
+        session_pool sessions_;
+
         // Routing table
-        std::map<method, std::map<std::string, handler_function>> routes_;
+        router router_;
     };
 }
\ No newline at end of file
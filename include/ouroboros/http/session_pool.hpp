@@ -0,0 +1,57 @@
+#ifndef SESSION_POOL_HPP
+#define SESSION_POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "ouroboros/http/http_session.hpp"
+
+namespace ouroboros::http
+{
+    // http_session のスラブプール (io_context ごと = サーバーごと)
+    //
+    // セッションは slab_size 個ずつまとめて確保し、接続が終わっても破棄せずに空きリストへ戻す。
+    // 再利用時はセッション内部の領域 (退避領域・送信バッファ等) もそのまま使うため、
+    // 短い接続が続いてもヒープ割り当ては発生しない。
+    // 空きリストはセッション自身のポインタでつなぐ (侵入型) ため、追加の領域も不要。
+    // 各セッションはキャッシュライン境界に揃えて配置される (alignas(64))。
+    class session_pool
+    {
+    public:
+        static constexpr size_t slab_size = 64;
+
+        // capacity: 同時に使用できるセッションの上限 (= 最大同時接続数)
+        explicit session_pool(size_t capacity) noexcept : capacity_(capacity) {}
+        ~session_pool() = default;
+
+        // Prohibit copying, allow moving
+        session_pool(const session_pool &) = delete;
+        session_pool &operator=(const session_pool &) = delete;
+        session_pool(session_pool &&) noexcept = default;
+        session_pool &operator=(session_pool &&) noexcept = default;
+
+        // 空いているセッションを取り出す (上限に達していれば nullptr)
+        // 空きが無ければスラブを一つ追加で確保する
+        [[nodiscard]] http_session *acquire(server &svr, io_context &ctx);
+        // 使い終わったセッションを空きリストへ戻す (reset() 済みであること)
+        void release(http_session *session) noexcept;
+
+        // 使用状況 (接続数の制限やメトリクスに使用)
+        [[nodiscard]] size_t in_use() const noexcept { return in_use_; }
+        [[nodiscard]] size_t allocated() const noexcept { return slabs_.size() * slab_size; }
+        [[nodiscard]] size_t capacity() const noexcept { return capacity_; }
+
+    private:
+        struct slab_deleter
+        {
+            void operator()(http_session *slab) const noexcept;
+        };
+
+        size_t capacity_;
+        size_t in_use_ = 0;
+        http_session *free_list_ = nullptr;
+        std::vector<std::unique_ptr<http_session, slab_deleter>> slabs_;
+    };
+}
+
+#endif // SESSION_POOL_HPP
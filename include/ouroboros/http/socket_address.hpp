@@ -0,0 +1,27 @@
+#ifndef SOCKET_ADDRESS_HPP
+#define SOCKET_ADDRESS_HPP
+
+#include <cstdint>
+#include <string>
+#include <sys/socket.h>
+
+namespace ouroboros::http
+{
+    // 接続先のアドレス (IPv4 / IPv6)。IORING_OP_CONNECT の完了まで有効であること
+    struct socket_address
+    {
+        sockaddr_storage storage{};
+        socklen_t length = 0;
+
+        [[nodiscard]] const sockaddr *get() const noexcept { return reinterpret_cast<const sockaddr *>(&storage); }
+        [[nodiscard]] int family() const noexcept { return storage.ss_family; }
+    };
+
+    // ホスト名・IP アドレスとポートからアドレスを求める (IP アドレスでなければ getaddrinfo でブロックする)
+    [[nodiscard]] bool resolve_address(const std::string &host, uint16_t port, socket_address &address);
+
+    // Host ヘッダーの値 (IPv6 リテラルは角括弧で囲み、80 以外はポートを付ける)
+    [[nodiscard]] std::string host_header_value(const std::string &host, uint16_t port);
+}
+
+#endif // SOCKET_ADDRESS_HPP
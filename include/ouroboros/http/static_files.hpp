@@ -0,0 +1,53 @@
+#ifndef STATIC_FILES_HPP
+#define STATIC_FILES_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "ouroboros/http/type_definitions.hpp"
+#include "ouroboros/http/unique_socket.hpp"
+
+namespace ouroboros::http
+{
+    // ディレクトリ以下のファイルを配信するハンドラ。ワイルドカードのルートに登録する
+    //
+    //   { method::GET, "/assets/*path", static_files("/var/www/assets") }
+    //
+    // 最後のパスパラメータ (ワイルドカード) をパーセントデコードしてルートからの相対パスとし、
+    // response::send_file() に渡す。ファイルを開く・送る処理はセッションが非同期に行う
+    // (OPENAT2 + RESOLVE_BENEATH で開くため、".." やシンボリックリンクでルートの外へは出られない)。
+    // '/' で終わるパスには index.html を補う。HEAD は GET のルートで処理される。
+    class static_files
+    {
+    public:
+        // root を開く (開けなければ std::system_error)
+        explicit static_files(const std::string &root);
+
+        void operator()(const request &req, response &res) const;
+
+        [[nodiscard]] int root_fd() const noexcept { return root_->native_handle(); }
+
+    private:
+        // handler_function (std::function) はコピー可能である必要があるため共有する
+        std::shared_ptr<const unique_socket> root_;
+    };
+
+    // 拡張子から Content-Type を決める (不明なら application/octet-stream)
+    [[nodiscard]] std::string_view mime_type(std::string_view path) noexcept;
+
+    // If-None-Match の値 (カンマ区切りのリストまたは "*") が etag に一致するか (弱い比較)
+    [[nodiscard]] bool etag_matches(std::string_view if_none_match, std::string_view etag) noexcept;
+
+    enum class range_status
+    {
+        none,          // Range を使わず全体を返す (無い・解釈できない・複数範囲)
+        satisfiable,   // 206 Partial Content
+        unsatisfiable  // 416 Range Not Satisfiable
+    };
+
+    // Range: bytes=a-b / bytes=a- / bytes=-n を解釈する (単一範囲のみ。複数範囲は none)
+    [[nodiscard]] range_status parse_range(std::string_view value, uint64_t size, uint64_t &begin, uint64_t &length) noexcept;
+}
+
+#endif // STATIC_FILES_HPP
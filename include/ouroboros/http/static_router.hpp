@@ -0,0 +1,236 @@
+#ifndef STATIC_ROUTER_HPP
+#define STATIC_ROUTER_HPP
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "ouroboros/http/type_definitions.hpp"
+
+namespace ouroboros::http
+{
+    // テンプレート引数として文字列リテラルを受け取るための型
+    template <size_t N>
+    struct fixed_string
+    {
+        char data[N]{};
+
+        consteval fixed_string(const char (&s)[N]) noexcept {
+            for (size_t i = 0; i < N; ++i) data[i] = s[i];
+        }
+
+        constexpr std::string_view view() const noexcept { return { data, N - 1 }; }
+    };
+
+    namespace detail
+    {
+        // 未知のメソッド名なら method_count
+        consteval size_t method_index(std::string_view name) {
+            for (size_t i = 0; i < method_count; ++i) {
+                if (to_string(static_cast<method>(i)) == name) return i;
+            }
+            return method_count;
+        }
+
+        // ':' と '*' はセグメントの先頭でのみ特別な意味を持つ (router と同じ構文)
+        constexpr bool is_marker(std::string_view pattern, size_t i) noexcept {
+            return i > 0 && pattern[i - 1] == '/' && (pattern[i] == ':' || pattern[i] == '*');
+        }
+
+        consteval bool has_markers(std::string_view pattern) {
+            for (size_t i = 0; i < pattern.size(); ++i) {
+                if (is_marker(pattern, i)) return true;
+            }
+            return false;
+        }
+
+        consteval bool valid_pattern(std::string_view pattern) {
+            if (pattern.empty() || pattern.front() != '/') return false;
+            for (size_t i = 0; i < pattern.size(); ++i) {
+                if (!is_marker(pattern, i)) continue;
+                size_t end = pattern.find('/', i);
+                if (pattern[i] == ':' && (end == i + 1)) return false;                // 名前のないパラメータ
+                if (pattern[i] == '*' && end != std::string_view::npos) return false; // ワイルドカードは末尾のみ
+            }
+            return true;
+        }
+
+        // パラメータを含むパターンとの照合 (pattern はコンパイル時定数。インライン展開される)
+        constexpr bool match_pattern(std::string_view pattern, std::string_view path, path_params &params) noexcept {
+            size_t i = 0;
+            size_t j = 0;
+            while (i < pattern.size()) {
+                if (!is_marker(pattern, i)) {
+                    // 次のマーカーまでの静的部分を一度に比較する
+                    size_t end = i + 1;
+                    while (end < pattern.size() && !is_marker(pattern, end)) end++;
+                    if (path.substr(j, end - i) != pattern.substr(i, end - i)) return false;
+                    j += end - i;
+                    i = end;
+                } else if (pattern[i] == ':') {
+                    size_t name_end = pattern.find('/', i);
+                    if (name_end == std::string_view::npos) name_end = pattern.size();
+                    size_t value_end = path.find('/', j);
+                    if (value_end == std::string_view::npos) value_end = path.size();
+                    if (value_end == j) return false;
+                    if (!params.push_back(pattern.substr(i + 1, name_end - i - 1), path.substr(j, value_end - j))) {
+                        return false;
+                    }
+                    i = name_end;
+                    j = value_end;
+                } else {
+                    std::string_view name = pattern.substr(i + 1);
+                    return params.push_back(name.empty() ? std::string_view("*") : name, path.substr(j));
+                }
+            }
+            return j == path.size();
+        }
+
+        // ハンドラの種類: 自由関数 (class_type = void) またはメンバ関数
+        template <typename F>
+        struct handler_traits;
+
+        template <>
+        struct handler_traits<void (*)(const request &, response &)>
+        {
+            using class_type = void;
+        };
+
+        template <typename C>
+        struct handler_traits<void (C::*)(const request &, response &)>
+        {
+            using class_type = C;
+        };
+
+        template <typename C>
+        struct handler_traits<void (C::*)(const request &, response &) const>
+        {
+            using class_type = const C;
+        };
+
+        // コンストラクタに渡されたコントローラの中から C 型のものを探す
+        template <typename C, typename... Controllers>
+        constexpr void *find_controller(Controllers &...controllers) noexcept {
+            if constexpr (std::is_void_v<C>) {
+                return nullptr;
+            } else {
+                static_assert((std::is_same_v<std::remove_const_t<C>, Controllers> || ...),
+                    "static_router: no controller instance was passed for a member function route");
+                void *found = nullptr;
+                ((found = (!found && std::is_same_v<std::remove_const_t<C>, Controllers>) ? static_cast<void *>(&controllers) : found), ...);
+                return found;
+            }
+        }
+    }
+
+    // コンパイル時ルーティングテーブルの一つのルート
+    //   route<"GET", "/users/:id", &api::get_user>
+    // ハンドラは void(const request&, response&) の自由関数、またはメンバ関数へのポインタ
+    template <fixed_string Method, fixed_string Pattern, auto Handler>
+    struct route
+    {
+        static_assert(detail::method_index(Method.view()) < method_count, "static_router: unknown HTTP method");
+        static_assert(detail::valid_pattern(Pattern.view()), "static_router: invalid route pattern");
+
+        static constexpr http::method verb = static_cast<http::method>(detail::method_index(Method.view()));
+        static constexpr std::string_view pattern = Pattern.view();
+        static constexpr bool has_params = detail::has_markers(Pattern.view());
+        using class_type = typename detail::handler_traits<decltype(Handler)>::class_type;
+
+        static bool match(std::string_view path, path_params &params) noexcept {
+            if constexpr (!has_params) {
+                // 長さの比較の後、固定文字列と比較する
+                if (path != pattern) return false;
+                params.clear();
+                return true;
+            } else {
+                params.clear();
+                return detail::match_pattern(pattern, path, params);
+            }
+        }
+
+        // 間接呼び出しを介さず直接呼び出す (インライン展開可能)
+        static void invoke([[maybe_unused]] void *object, const request &req, response &res) {
+            if constexpr (std::is_void_v<class_type>) {
+                Handler(req, res);
+            } else {
+                (static_cast<class_type *>(object)->*Handler)(req, res);
+            }
+        }
+    };
+
+    // server_options に設定する、型消去された static_router への参照
+    // (dispatch の呼び出しは一度の間接呼び出しのみで、その内側のハンドラ呼び出しは直接呼び出し)
+    struct static_route_table
+    {
+        const void *router = nullptr;
+        bool (*dispatch)(const void *router, method m, request &req, response &res) = nullptr;
+        unsigned (*allowed_methods)(const void *router, std::string_view path) noexcept = nullptr;
+
+        explicit operator bool() const noexcept { return dispatch != nullptr; }
+    };
+
+    // コンパイル時ルーティングテーブル
+    //
+    //   static_router<
+    //       route<"GET",  "/health",    &health>,
+    //       route<"GET",  "/users/:id", &api::get_user>,
+    //       route<"POST", "/users",     &api::create_user>
+    //   > routes{ api_instance };
+    //
+    // ルートの照合コードはテンプレート展開で生成され、ハンドラは直接呼び出される。
+    // 宣言順で最初に一致したルートが使われる。メンバ関数のルートには、その型のインスタンスを
+    // コンストラクタで渡す (参照を保持するため、ルーターより長く生存させること)。
+    // 実行時に変更するルートは従来どおり server::load_routes を使う。
+    template <typename... Routes>
+    class static_router
+    {
+    public:
+        template <typename... Controllers>
+        explicit static_router(Controllers &...controllers) noexcept
+            : objects_{ detail::find_controller<typename Routes::class_type>(controllers...)... } {}
+
+        // m と req.path に一致するルートのハンドラを呼び出す (一致しなければ false)
+        bool dispatch(method m, request &req, response &res) const {
+            return dispatch_impl(m, req, res, std::index_sequence_for<Routes...>{});
+        }
+
+        // path に一致するルートを持つメソッドの集合 (method_bit のビットマスク)
+        [[nodiscard]] unsigned allowed_methods(std::string_view path) const noexcept {
+            path_params scratch;
+            unsigned methods = 0;
+            ((methods |= Routes::match(path, scratch) ? method_bit(Routes::verb) : 0u), ...);
+            return methods;
+        }
+
+        // server_options::static_routes に設定する値
+        [[nodiscard]] static_route_table table() const noexcept {
+            return { this, &dispatch_thunk, &allowed_methods_thunk };
+        }
+
+    private:
+        template <size_t... I>
+        bool dispatch_impl(method m, request &req, response &res, std::index_sequence<I...>) const {
+            return (try_route<Routes, I>(m, req, res) || ...);
+        }
+
+        template <typename Route, size_t I>
+        bool try_route(method m, request &req, response &res) const {
+            if (m != Route::verb || !Route::match(req.path, req.params)) return false;
+            Route::invoke(objects_[I], req, res);
+            return true;
+        }
+
+        static bool dispatch_thunk(const void *self, method m, request &req, response &res) {
+            return static_cast<const static_router *>(self)->dispatch(m, req, res);
+        }
+        static unsigned allowed_methods_thunk(const void *self, std::string_view path) noexcept {
+            return static_cast<const static_router *>(self)->allowed_methods(path);
+        }
+
+        std::array<void *, sizeof...(Routes)> objects_;
+    };
+}
+
+#endif // STATIC_ROUTER_HPP
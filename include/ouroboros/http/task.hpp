@@ -1,6 +1,8 @@
 #ifndef TASK_HPP
 #define TASK_HPP
 
+#include <cstdint>
+
 namespace ouroboros::http
 {
     // IO完了時に呼び出される汎用インターフェース
@@ -12,6 +14,26 @@ namespace ouroboros::http
         // flags: 完了キューエントリ(CQE)のフラグ
         virtual void complete(int result, uint32_t flags) = 0;
     };
+
+    // 完了通知を所有者のメンバ関数へ転送するタスク
+    // 一つのオブジェクトが複数の非同期操作 (受信と送信など) を同時に実行する場合に、
+    // 操作ごとに別の user_data を割り当てるために使用する
+    template <typename T>
+    class member_task : public task
+    {
+    public:
+        using handler_type = void (T::*)(int result, uint32_t flags);
+
+        member_task(T &owner, handler_type handler) noexcept : owner_(&owner), handler_(handler) {}
+
+        void complete(int result, uint32_t flags) override {
+            (owner_->*handler_)(result, flags);
+        }
+
+    private:
+        T *owner_;
+        handler_type handler_;
+    };
 }
 
 #endif // TASK_HPP
@@ -0,0 +1,116 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "ouroboros/http/task.hpp"
+
+namespace ouroboros::http
+{
+    class timer_wheel;
+
+    // timer_wheel に登録するタイマー (所有者のメンバとして保持する侵入型ノード)
+    // 期限が来ると target の complete(-ETIME, 0) が呼ばれる (リングの IORING_OP_TIMEOUT と同じ結果)
+    class timer
+    {
+    public:
+        explicit timer(task &target) noexcept : target_(&target) {}
+        // 登録中であればホイールから外す
+        ~timer();
+
+        // ホイール内のリストにつながっているためコピー・ムーブ禁止
+        timer(const timer &) = delete;
+        timer &operator=(const timer &) = delete;
+
+        [[nodiscard]] bool armed() const noexcept { return wheel_ != nullptr; }
+        // 登録を解除する (O(1)。未登録なら何もしない)
+        void cancel() noexcept;
+
+    private:
+        friend class timer_wheel;
+        // スロットの番兵とタイマーで共通のリンク (循環双方向リスト)
+        struct link
+        {
+            link *prev = this;
+            link *next = this;
+
+            link() noexcept = default;
+            // 番兵・ノードは自身を指すため、コピーではなく reset() で初期化する
+            link(const link &) = delete;
+            link &operator=(const link &) = delete;
+            void reset() noexcept { prev = next = this; }
+        };
+        link link_;
+        task *target_;
+        timer_wheel *wheel_ = nullptr;
+        uint64_t expires_ = 0; // 期限 (ティック)
+        uint8_t level_ = 0;
+        uint8_t slot_ = 0;
+    };
+
+    // 階層型タイミングホイール (io_context ごとに一つ。スレッドセーフではない)
+    //
+    // 64 スロット x 4 階層、1 ティック = 1ms (約 4.6 時間先まで。それ以上は最上位に丸める)。
+    // 登録・解除はリストの付け替えだけで O(1)。上位の階層のスロットは、その時刻が来た時に
+    // 下位の階層へ振り分け直す。各階層の空でないスロットをビットマップで持ち、次に処理が必要な時刻を
+    // O(階層数) で求める (イベントループはその時刻まで io_uring_enter で待機する)。
+    class timer_wheel
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+        static constexpr std::chrono::milliseconds tick{ 1 };
+        static constexpr unsigned slot_bits = 6;
+        static constexpr unsigned slots = 1u << slot_bits;
+        static constexpr unsigned levels = 4;
+
+        // origin: ティック 0 の時刻 (テストでは固定した時刻を渡して時間を進める)
+        explicit timer_wheel(clock::time_point origin = clock::now()) noexcept : origin_(origin) {}
+        // 登録中のタイマーを全て外す
+        ~timer_wheel();
+
+        // スロットの番兵を指すためコピー・ムーブ禁止
+        timer_wheel(const timer_wheel &) = delete;
+        timer_wheel &operator=(const timer_wheel &) = delete;
+
+        // after 後に期限が来るよう登録する (登録済みなら付け替える。1 ティック未満は切り上げ)
+        void arm(timer &t, std::chrono::milliseconds after, clock::time_point now = clock::now()) noexcept;
+        // 登録を解除する (O(1)。未登録なら何もしない)
+        void cancel(timer &t) noexcept;
+
+        // 現在時刻までに期限が来たタイマーを全て発火させ、その数を返す
+        size_t advance() { return advance(clock::now()); }
+        size_t advance(clock::time_point now);
+
+        // 次に advance() が必要になるまでの時間 (登録が無ければ負の値)
+        // 上位の階層の振り分けも含むため、タイマーの期限より早いことがある
+        [[nodiscard]] std::chrono::milliseconds next_timeout(clock::time_point now = clock::now()) const noexcept;
+
+        // 登録中のタイマー数
+        [[nodiscard]] size_t size() const noexcept { return size_; }
+        [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    private:
+        using link = timer::link;
+
+        static timer &owner(link *l) noexcept;
+        uint64_t ticks(clock::time_point now) const noexcept;
+        // expires に対応するスロットへつなぐ (now_ より前の期限は now_ のスロットへ)
+        void insert(timer &t) noexcept;
+        void unlink(timer &t) noexcept;
+        // now_ から、次に空でないスロットを処理する時刻までのティック数
+        uint64_t ticks_until_next() const noexcept;
+        // now_ のティックを処理する (上位の階層の振り分け -> 最下位のスロットの発火)
+        size_t process_tick();
+        void cascade(unsigned level, unsigned slot) noexcept;
+
+        clock::time_point origin_;
+        uint64_t now_ = 0; // 処理済みのティック
+        size_t size_ = 0;
+        std::array<uint64_t, levels> occupied_{}; // 空でないスロットのビットマップ
+        std::array<std::array<link, slots>, levels> wheel_;
+    };
+}
+
+#endif // TIMER_WHEEL_HPP
@@ -1,12 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <vector>
-#include <map>
+#include <span>
+#include <type_traits>
+#include "ouroboros/http/coro.hpp"
 
 namespace ouroboros::http
 {
+    struct proxy_route; // reverse_proxy.hpp
+    struct websocket_route; // websocket.hpp
 
     // 型安全なHTTPメソッド処理を保証するためのenumクラス
     enum class method
@@ -19,66 +33,497 @@ namespace ouroboros::http
         HEAD,
         OPTIONS
     };
+    inline constexpr size_t method_count = 7;
 
-    // リクエストクラス（プレースホルダ）
-    // 実際のHTTPリクエストデータに基づき、セッションによって構築される
+    // メソッド名 (Allow ヘッダー等に使用)
+    constexpr std::string_view to_string(method m) noexcept {
+        switch (m) {
+        case method::GET: return "GET";
+        case method::POST: return "POST";
+        case method::PUT: return "PUT";
+        case method::DELETE: return "DELETE";
+        case method::PATCH: return "PATCH";
+        case method::HEAD: return "HEAD";
+        case method::OPTIONS: return "OPTIONS";
+        }
+        return {};
+    }
+
+    // メソッドの集合 (ビットマスク) 用
+    constexpr unsigned method_bit(method m) noexcept {
+        return 1u << static_cast<unsigned>(m);
+    }
+
+    // Allow ヘッダーの値 (例: "GET, HEAD, POST")
+    inline std::string format_allow(unsigned methods) {
+        std::string result;
+        for (size_t i = 0; i < method_count; ++i) {
+            auto m = static_cast<method>(i);
+            if (!(methods & method_bit(m))) continue;
+            if (!result.empty()) result += ", ";
+            result += to_string(m);
+        }
+        return result;
+    }
+
+    // ASCII の大文字・小文字を区別しない比較 (ヘッダー名、トークン値用)
+    constexpr bool iequals(std::string_view a, std::string_view b) noexcept {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            char x = a[i], y = b[i];
+            if (x >= 'A' && x <= 'Z') x = static_cast<char>(x + ('a' - 'A'));
+            if (y >= 'A' && y <= 'Z') y = static_cast<char>(y + ('a' - 'A'));
+            if (x != y) return false;
+        }
+        return true;
+    }
+
+    // ヘッダーフィールド (名前と値は受信バッファへのビュー)
+    struct header_field
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    // 固定容量のヘッダーリスト (ヒープ割り当てなし)
+    class header_list
+    {
+    public:
+        static constexpr size_t capacity = 64;
+
+        // 容量を超える場合は false
+        bool push_back(std::string_view name, std::string_view value) noexcept {
+            if (size_ == capacity) return false;
+            fields_[size_++] = { name, value };
+            return true;
+        }
+        void clear() noexcept { size_ = 0; }
+
+        // 大文字・小文字を区別せずに検索する (見つからなければ空のビュー)
+        [[nodiscard]] std::string_view find(std::string_view name) const noexcept {
+            for (size_t i = 0; i < size_; ++i) {
+                if (iequals(fields_[i].name, name)) return fields_[i].value;
+            }
+            return {};
+        }
+        [[nodiscard]] bool contains(std::string_view name) const noexcept {
+            for (size_t i = 0; i < size_; ++i) {
+                if (iequals(fields_[i].name, name)) return true;
+            }
+            return false;
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return size_; }
+        [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+        [[nodiscard]] const header_field *begin() const noexcept { return fields_.data(); }
+        [[nodiscard]] const header_field *end() const noexcept { return fields_.data() + size_; }
+
+    private:
+        std::array<header_field, capacity> fields_{};
+        size_t size_ = 0;
+    };
+
+    // パスパラメータ (例: "/users/:id" の id)
+    // 名前はルーティングテーブル、値は受信バッファへのビュー (ヒープ割り当てなし)
+    struct path_param
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    class path_params
+    {
+    public:
+        static constexpr size_t capacity = 16;
+
+        // 容量を超える場合は false
+        bool push_back(std::string_view name, std::string_view value) noexcept {
+            if (size_ == capacity) return false;
+            params_[size_++] = { name, value };
+            return true;
+        }
+        void clear() noexcept { size_ = 0; }
+        // ルーターの後戻り用: 指定した個数まで戻す
+        void truncate(size_t size) noexcept { if (size < size_) size_ = size; }
+
+        // 名前で検索する (見つからなければ空のビュー)
+        [[nodiscard]] std::string_view operator[](std::string_view name) const noexcept {
+            for (size_t i = 0; i < size_; ++i) {
+                if (params_[i].name == name) return params_[i].value;
+            }
+            return {};
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return size_; }
+        [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+        [[nodiscard]] const path_param *begin() const noexcept { return params_.data(); }
+        [[nodiscard]] const path_param *end() const noexcept { return params_.data() + size_; }
+
+    private:
+        std::array<path_param, capacity> params_{};
+        size_t size_ = 0;
+    };
+
+    // リクエストクラス
+    // request_parser によって構築され、すべての文字列は受信バッファへのビュー (コピーなし)
+    // ビューはハンドラの呼び出し中のみ有効
     class request
     {
     public:
         // 現在はセッションがオブジェクトを容易に構築できるよう、メンバはpublic
         // より堅牢な実装では、ビルダーパターンやフレンドクラスの使用が考えられる
         http::method method;
-        std::string path;
-        std::map<std::string, std::string> headers;
-        std::string body;
+        std::string_view target;  // リクエストターゲット全体 (例: "/users?id=1")
+        std::string_view path;    // '?' より前
+        std::string_view query;   // '?' より後 (無ければ空)
+        int version_minor = 1;    // HTTP/1.x の x
+        header_list headers;
+        path_params params;       // ルーティング時に設定される (例: params["id"])
+        std::string_view body;
+        // ボディを一時ファイルへ書き出した場合 (body_options::spill_threshold) の読み書き可能なディスクリプタ
+        // (無ければ -1。body は空)。ファイルは名前を持たず、レスポンスの送信後に閉じられる。
+        // 残す場合はハンドラ内で linkat で名前を付けること
+        int body_file = -1;
+        uint64_t body_file_size = 0;
+        bool keep_alive = true;
+
+        // ヘッダー値の取得 (大文字・小文字を区別しない。無ければ空のビュー)
+        [[nodiscard]] std::string_view header(std::string_view name) const noexcept {
+            return headers.find(name);
+        }
     };
 
-    // レスポンスクラス（プレースホルダ）
+    // ストリーミングのボディの生成器 (response::stream)
+    // 呼ばれるたびに続きを out の末尾へ追加し、続きがあれば true、最後の部分なら false を返す
+    using body_producer = std::function<bool(std::string &out)>;
+    // データを待つ生成器 (co_await できる。中断中もそのコアの他の接続は処理される)
+    using async_body_producer = std::function<coro::task<bool>(std::string &out)>;
+
+    // レスポンスクラス
     // ハンドラはこのクラスを用いてレスポンスを構築する
-    // その後、セッションがこのクラスの内容を基に最終的なHTTPレスポンスを生成する
+    // その後、セッションがこのクラスの内容を基に最終的なHTTPレスポンスを生成する (write_response)
+    // ボディとヘッダーはリクエストごとのアリーナ (arena()) から割り当てられ、
+    // レスポンスの生成後にアリーナごと破棄される (ヒープ割り当てなし)
     class response
     {
     public:
-        response() : status_code_(200) {}
+        // 名前と値も response と同じアリーナから割り当てる (allocator-aware)
+        struct header
+        {
+            using allocator_type = std::pmr::polymorphic_allocator<>;
 
-        void set_body(const std::string &body) {
-            body_ = body;
+            header(std::string_view n, std::string_view v, allocator_type alloc = {})
+                : name(n, alloc), value(v, alloc) {}
+            header(const header &other, allocator_type alloc = {})
+                : name(other.name, alloc), value(other.value, alloc) {}
+            header(header &&other, allocator_type alloc) noexcept
+                : name(std::move(other.name), alloc), value(std::move(other.value), alloc) {}
+            header &operator=(const header &) = default;
+
+            std::pmr::string name;
+            std::pmr::string value;
+        };
+
+        explicit response(std::pmr::memory_resource *arena = std::pmr::get_default_resource()) noexcept
+            : body_(arena), headers_(arena), file_path_(arena), proxy_target_(arena) {}
+
+        void set_body(std::string_view body) {
+            body_.assign(body);
+        }
+        void set_body(const char *body) {
+            body_.assign(body);
+        }
+        // arena() 上で構築した文字列はコピーせずに受け取る
+        void set_body(std::pmr::string &&body) {
+            body_ = std::move(body);
         }
 
-        void set_header(const std::string &name, const std::string &value) {
-            headers_[name] = value;
+        // 同名 (大文字・小文字を区別しない) のヘッダーがあれば値を置き換える
+        // Content-Length / Transfer-Encoding / Date / Connection はセッションが付与するため無視される
+        void set_header(std::string_view name, std::string_view value) {
+            for (auto &h : headers_) {
+                if (iequals(h.name, name)) {
+                    h.value.assign(value);
+                    return;
+                }
+            }
+            headers_.emplace_back(name, value);
         }
 
         void set_status_code(int code) {
             status_code_ = code;
         }
 
+        // ボディとしてファイルを送信する (通常は static_files を使う)
+        // セッションがハンドラの戻り後に非同期で開き、ETag / Range を処理して splice で送信する。
+        // path は dirfd からの相対パスで、dirfd の外へは解決されない (RESOLVE_BENEATH)
+        void send_file(int dirfd, std::string_view path) {
+            file_dirfd_ = dirfd;
+            file_path_.assign(path);
+            has_file_ = true;
+        }
+
+        // リクエストを上流へ転送し、そのレスポンスを返す (通常は reverse_proxy を使う)
+        // セッションがハンドラの戻り後に非同期で転送する。このレスポンスに設定した内容は使われない
+        void proxy_pass(const proxy_route &route, std::string_view target) {
+            proxy_ = &route;
+            proxy_target_.assign(target);
+        }
+
+        // 接続を WebSocket へアップグレードする (通常は websocket_endpoint を使う)
+        // セッションが 101 Switching Protocols とここで設定したヘッダーを送り、ソケットを websocket_session へ引き継ぐ
+        void accept_websocket(const websocket_route &route) noexcept {
+            websocket_ = &route;
+        }
+
+        // ボディを生成器から少しずつ送る (CSV の出力や NDJSON のフィード等、全体をメモリに置かない大きなボディ用)
+        // セッションが送信の完了に合わせて producer を呼び、接続ごとの未送信のデータを
+        // server_options::stream_chunk_size の2倍程度までに抑える (受信の遅いクライアントには生成も止まる)。
+        // 長さが分からなければ Transfer-Encoding: chunked で送る (set_content_length() で指定すればそのまま送る)。
+        // producer はハンドラの戻り後に呼ばれるため、request のビューはキャプチャせずにコピーすること。
+        // coro::task<bool> を返す producer は非同期の生成器として扱う
+        template <typename F>
+            requires std::is_invocable_v<F &, std::string &>
+        void stream(F producer) {
+            if constexpr (std::is_same_v<std::invoke_result_t<F &, std::string &>, coro::task<bool>>) {
+                async_producer_ = std::move(producer);
+                producer_ = nullptr;
+            } else {
+                producer_ = std::move(producer);
+                async_producer_ = nullptr;
+            }
+        }
+
+        // ボディを別に送信する場合の Content-Length (ファイルはセッションが設定する。stream() では長さが分かれば指定する)
+        void set_content_length(size_t length) noexcept {
+            content_length_ = length;
+        }
+
+        // 作り直すために初期化する (使用済みのアリーナ領域はアリーナの破棄まで解放されない)
+        void clear() noexcept {
+            status_code_ = 200;
+            body_.clear();
+            headers_.clear();
+            has_file_ = false;
+            content_length_ = no_content_length;
+            proxy_ = nullptr;
+            websocket_ = nullptr;
+            producer_ = nullptr;
+            async_producer_ = nullptr;
+        }
+
+        // ハンドラの作業領域用のアリーナ。レスポンスの送信準備ができた時点で破棄される
+        //   std::pmr::string body(res.arena());
+        //   std::pmr::vector<int> ids(res.arena());
+        [[nodiscard]] std::pmr::memory_resource *arena() const noexcept {
+            return headers_.get_allocator().resource();
+        }
+
         // セッションが最終的なHTTPレスポンス文字列を構築するための内部アクセサ
         int status_code() const {
             return status_code_;
         }
-        const std::string &body() const {
+        std::string_view body() const {
             return body_;
         }
-        const std::map<std::string, std::string> &headers() const {
+        std::span<const header> headers() const {
             return headers_;
         }
+        size_t content_length() const noexcept {
+            return content_length_ == no_content_length ? body_.size() : content_length_;
+        }
+        bool has_content_length() const noexcept {
+            return content_length_ != no_content_length;
+        }
+        bool has_file() const noexcept {
+            return has_file_;
+        }
+        int file_dirfd() const noexcept {
+            return file_dirfd_;
+        }
+        const char *file_path() const noexcept {
+            return file_path_.c_str();
+        }
+        bool has_proxy() const noexcept {
+            return proxy_ != nullptr;
+        }
+        const proxy_route *proxy() const noexcept {
+            return proxy_;
+        }
+        std::string_view proxy_target() const noexcept {
+            return proxy_target_;
+        }
+        bool has_websocket() const noexcept {
+            return websocket_ != nullptr;
+        }
+        const websocket_route *websocket() const noexcept {
+            return websocket_;
+        }
+        bool has_stream() const noexcept {
+            return producer_ || async_producer_;
+        }
+        // セッションが取り出す (ムーブする)
+        body_producer &producer() noexcept {
+            return producer_;
+        }
+        async_body_producer &async_producer() noexcept {
+            return async_producer_;
+        }
 
     private:
-        int status_code_;
-        std::string body_;
-        std::map<std::string, std::string> headers_;
+        static constexpr size_t no_content_length = static_cast<size_t>(-1);
+
+        int status_code_ = 200;
+        std::pmr::string body_;
+        // 小さなフラットな配列
+        std::pmr::vector<header> headers_;
+        size_t content_length_ = no_content_length;
+        // send_file() の送信対象
+        bool has_file_ = false;
+        int file_dirfd_ = -1;
+        std::pmr::string file_path_;
+        // proxy_pass() の転送先 (リクエストターゲットは書き換え後のもの)
+        const proxy_route *proxy_ = nullptr;
+        std::pmr::string proxy_target_;
+        // accept_websocket() のエンドポイント
+        const websocket_route *websocket_ = nullptr;
+        // stream() の生成器 (どちらか一方)
+        body_producer producer_;
+        async_body_producer async_producer_;
+    };
+
+    // HTTP クライアント (client.hpp) が受信したレスポンス
+    // 各ビューはこのオブジェクトが保持する受信データの複製を指す (ムーブしても有効)
+    class client_response
+    {
+    public:
+        int status = 0;
+        std::string_view reason;
+        int version_minor = 1;
+        std::vector<header_field> headers;
+        std::string_view body;
+        bool keep_alive = true; // 接続を再利用できるか
+
+        client_response() = default;
+        client_response(client_response &&) noexcept = default;
+        client_response &operator=(client_response &&) noexcept = default;
+        client_response(const client_response &) = delete;
+        client_response &operator=(const client_response &) = delete;
+
+        // ヘッダー値の取得 (大文字・小文字を区別しない。無ければ空のビュー)
+        [[nodiscard]] std::string_view header(std::string_view name) const noexcept {
+            for (const auto &field : headers) {
+                if (iequals(field.name, name)) return field.value;
+            }
+            return {};
+        }
+
+        // 受信バッファ内の raw を指すビューを、raw の複製へ付け替える (クライアントが受信バッファを再利用する前に呼ぶ)
+        void take_ownership(std::string_view raw) {
+            storage_ = std::make_unique_for_overwrite<char[]>(raw.size());
+            std::copy(raw.begin(), raw.end(), storage_.get());
+            auto rebase = [&](std::string_view view) {
+                return view.empty() ? view : std::string_view(storage_.get() + (view.data() - raw.data()), view.size());
+            };
+            reason = rebase(reason);
+            for (auto &field : headers) field = { rebase(field.name), rebase(field.value) };
+            body = rebase(body);
+        }
+
+    private:
+        std::unique_ptr<char[]> storage_;
     };
 
     // 全てのHTTPハンドラのシグネチャを定義
     using handler_function = std::function<void(const request &, response &)>;
+    // コルーチンハンドラ: co_await で I/O (coro_io.hpp) を待ってからレスポンスを完成させる
+    // 中断中も request の内容は有効 (セッションがアリーナへ複製する)。後続のリクエストは完了まで処理されない
+    using async_handler_function = std::function<coro::task<void>(const request &, response &)>;
+
+    // route_entry に登録するハンドラ (coro::task<void> を返すものはコルーチンハンドラとして登録される)
+    struct any_handler
+    {
+        handler_function sync;
+        async_handler_function async;
+
+        any_handler() = default;
+        template <typename F>
+            requires std::is_invocable_v<F &, const request &, response &>
+        any_handler(F function) {
+            if constexpr (std::is_same_v<std::invoke_result_t<F &, const request &, response &>, coro::task<void>>) {
+                async = std::move(function);
+            } else {
+                sync = std::move(function);
+            }
+        }
+
+        explicit operator bool() const noexcept { return sync || async; }
+    };
+
+    // レスポンスキャッシュを明示的に無効化するためのタグ (コピーは同じタグを指す)
+    // invalidate() はどのスレッドからでも呼べる。各コアは次の参照時に世代番号の違いで気付き、
+    // そのエントリを捨てる (コア間のロックは無い)
+    class cache_tag
+    {
+    public:
+        cache_tag() : generation_(std::make_shared<std::atomic<uint64_t>>(0)) {}
+
+        void invalidate() noexcept { generation_->fetch_add(1, std::memory_order_release); }
+        [[nodiscard]] uint64_t generation() const noexcept { return generation_->load(std::memory_order_acquire); }
+
+    private:
+        std::shared_ptr<std::atomic<uint64_t>> generation_;
+    };
+
+    // ルートごとのレスポンスキャッシュの設定 (GET のみ。HEAD は同じエントリからボディを省いて返す)
+    // キャッシュのキーはリクエストターゲット (パスとクエリ) だけなので、
+    // ヘッダー (Cookie 等) によって内容が変わるルートには使わないこと
+    struct response_cache_policy
+    {
+        bool enabled = false;
+        std::chrono::milliseconds ttl{ 0 }; // 0 なら期限なし (tag で無効化する)
+        std::optional<cache_tag> tag;
+
+        explicit operator bool() const noexcept { return enabled; }
+    };
+
+    // { method::GET, "/status", handler, cache_for(std::chrono::seconds(5)) }
+    inline response_cache_policy cache_for(std::chrono::milliseconds ttl) {
+        return { true, ttl, std::nullopt };
+    }
+    // tag.invalidate() されるまで (ttl を指定すればその期限まで) キャッシュする
+    inline response_cache_policy cache_until(const cache_tag &tag, std::chrono::milliseconds ttl = {}) {
+        return { true, ttl, tag };
+    }
+
+    // リクエストボディを受信した分ずつ受け取る関数 (ボディはバッファしない)
+    // false を返すと受信を打ち切って 413 を返す
+    using body_sink = std::function<bool(std::string_view piece)>;
+
+    // ルートごとのリクエストボディの扱い
+    // 既定ではボディ全体をメモリに集めて request::body としてハンドラへ渡す
+    struct body_options
+    {
+        // ボディの上限 (0 なら parser_limits::max_body_size)。超えたら 413
+        size_t max_size = 0;
+        // これを超えるボディは spill_directory の一時ファイルへ書き出し、request::body_file として渡す (0 なら無効)
+        size_t spill_threshold = 0;
+        std::string spill_directory = "/tmp";
+        // ヘッダーを受信した時点でこのリクエストのボディの受け取り先を返す (設定すればバッファしない)
+        // ハンドラはボディを受け取り終えた後に空の request::body で呼ばれる
+        std::function<body_sink(const request &)> on_body{};
+    };
 
     // ルーティングテーブル内の一つのルート（経路）を表現する構造体
     struct route_entry
     {
         http::method method;
         std::string path;
-        handler_function handler;
+        any_handler handler;
+        // 完成したレスポンスをコアごとにキャッシュし、ハンドラを呼ばずに返す (既定は無効)
+        response_cache_policy cache = {};
+        // リクエストボディの上限と受け取り方 (既定は parser_limits::max_body_size までメモリに集める)
+        body_options body = {};
     };
 
 } // namespace ouroboros::http
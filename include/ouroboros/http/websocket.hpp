@@ -0,0 +1,116 @@
+#ifndef WEBSOCKET_HPP
+#define WEBSOCKET_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ouroboros/http/type_definitions.hpp"
+#include "ouroboros/http/websocket_protocol.hpp"
+#include "ouroboros/http/websocket_session.hpp"
+
+namespace ouroboros::http
+{
+    // WebSocket エンドポイントの設定
+    struct websocket_options
+    {
+        // ハンドシェイクを受け付けた (101 の送信前。req はこの呼び出しの間だけ有効)
+        // ここで送ったメッセージは 101 の後に送られる
+        std::function<void(websocket_session &, const request &)> on_open{};
+        // テキスト・バイナリのメッセージ (断片化されたものは組み立て済み。message はこの呼び出しの間だけ有効)
+        std::function<void(websocket_session &, std::string_view message, websocket_opcode opcode)> on_message{};
+        // 接続が開いている状態を終えた (クローズフレームの送受信・切断のいずれでも一度だけ呼ばれる)
+        // code は相手から受け取った (またはこちらが送った) ステータス。切断の場合は 1006
+        std::function<void(websocket_session &, uint16_t code)> on_close{};
+
+        // Sec-WebSocket-Protocol で合意するサブプロトコル (クライアントの提示順で最初に一致したもの)
+        std::vector<std::string> protocols{};
+        // 許可する Origin (空なら確認しない。一致しなければ 403)
+        std::vector<std::string> allowed_origins{};
+        // 組み立て後のメッセージの上限 (超えたら 1009 で閉じる)
+        size_t max_message_size = 1024 * 1024;
+        // 送信キューの上限 (受信の遅いクライアントは超えた時点で切断する)
+        size_t max_send_queue = 4 * 1024 * 1024;
+        // テキストメッセージの UTF-8 を検証する (不正なら 1007 で閉じる)
+        bool validate_utf8 = true;
+        // 受信が途絶えてからこの時間で Ping を送り、さらにこの時間応答が無ければ閉じる (0 で無効)
+        std::chrono::milliseconds ping_interval{ 30000 };
+        // クローズフレームを送ってから相手のクローズを待つ時間
+        std::chrono::milliseconds close_timeout{ 5000 };
+    };
+
+    // 設定 (全コアで共有し、変更しない)
+    struct websocket_route
+    {
+        websocket_options options;
+    };
+
+    // ハンドシェイク (RFC 6455 4.2) を検証してアップグレードするハンドラ
+    //
+    //   websocket_endpoint feed({ .on_open = [](websocket_session &ws, const request &) { ... } });
+    //   routes.push_back({ method::GET, "/feed", feed });
+    //
+    // 検証に失敗したリクエストには 400 / 403 / 426 を返す。成功すると response::accept_websocket() で
+    // 指定し、セッションが 101 を送った後にソケットを websocket_session へ引き継ぐ。
+    // 拡張 (permessage-deflate 等) は合意しない。
+    class websocket_endpoint
+    {
+    public:
+        explicit websocket_endpoint(websocket_options options);
+
+        void operator()(const request &req, response &res) const;
+
+        [[nodiscard]] const websocket_route &route() const noexcept { return *route_; }
+
+    private:
+        // handler_function (std::function) はコピー可能である必要があるため共有する
+        std::shared_ptr<const websocket_route> route_;
+    };
+
+    // 購読者へ同じメッセージを送るハブ (コアごと。スレッドセーフではない)
+    //
+    // publish() はフレームを一度だけシリアライズし、各購読者の送信キューから参照させる
+    // (購読者ごとのコピーは無く、送信は接続ごとに一つの SEND / SENDMSG)。
+    // 閉じた接続は自動的に外れる。Thread-per-core では各コアのハブへそれぞれ publish する。
+    class websocket_hub
+    {
+    public:
+        websocket_hub() = default;
+        ~websocket_hub();
+
+        // 購読者の位置を保持するためコピー・ムーブ禁止
+        websocket_hub(const websocket_hub &) = delete;
+        websocket_hub &operator=(const websocket_hub &) = delete;
+
+        // このスレッドの名前付きハブ (ルートのハンドラはコアごとに呼ばれるため、コアごとのハブになる)
+        [[nodiscard]] static websocket_hub &current(std::string_view name);
+
+        // 開いている接続を加える (既に購読中なら何もしない)
+        void subscribe(websocket_session &session);
+        void unsubscribe(websocket_session &session);
+
+        // 全ての購読者へ送り、送った接続の数を返す
+        size_t publish(websocket_opcode opcode, std::string_view payload);
+        size_t publish(const websocket_frame &frame);
+
+        [[nodiscard]] size_t size() const noexcept { return members_.size() - holes_; }
+
+    private:
+        friend class websocket_session;
+        // members_[index] を外す (publish 中は穴を空け、終わってから詰める)
+        void remove_at(size_t index) noexcept;
+        void compact() noexcept;
+        // 移動した購読者が持つこのハブの位置を更新する
+        void relink(websocket_session &session, size_t index) noexcept;
+
+        std::vector<websocket_session *> members_;
+        bool publishing_ = false;
+        size_t holes_ = 0;
+    };
+}
+
+#endif // WEBSOCKET_HPP
@@ -0,0 +1,133 @@
+#ifndef WEBSOCKET_PROTOCOL_HPP
+#define WEBSOCKET_PROTOCOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace ouroboros::http
+{
+    // WebSocket (RFC 6455) のフレーム種別
+    enum class websocket_opcode : uint8_t
+    {
+        continuation = 0x0,
+        text = 0x1,
+        binary = 0x2,
+        close = 0x8,
+        ping = 0x9,
+        pong = 0xa
+    };
+
+    constexpr bool is_control(websocket_opcode op) noexcept {
+        return (static_cast<uint8_t>(op) & 0x8) != 0;
+    }
+
+    // クローズフレームのステータスコード (RFC 6455 7.4.1)
+    namespace websocket_close
+    {
+        inline constexpr uint16_t normal = 1000;
+        inline constexpr uint16_t going_away = 1001;
+        inline constexpr uint16_t protocol_error = 1002;
+        inline constexpr uint16_t unsupported_data = 1003;
+        inline constexpr uint16_t no_status = 1005;  // 受信したクローズフレームにコードが無かった (送信しない)
+        inline constexpr uint16_t abnormal = 1006;   // クローズフレームなしに切断された (送信しない)
+        inline constexpr uint16_t invalid_payload = 1007;
+        inline constexpr uint16_t policy_violation = 1008;
+        inline constexpr uint16_t message_too_big = 1009;
+        inline constexpr uint16_t internal_error = 1011;
+    }
+
+    // クライアントのフレームのマスク解除 (ペイロードとマスクキーの XOR) のベクトル化実装
+    //
+    // apply(p, n, key) は p[i] ^= key[i % 4] を行う (key はフレーム中のバイト順のまま 32bit に読み込んだ値)。
+    // 実装は起動時に CPU を判定して選択する (AVX2: 32バイト / SSE2: 16バイト / スカラー: 8バイト単位)。
+    struct websocket_masker
+    {
+        enum class isa
+        {
+            scalar,
+            sse2,
+            avx2
+        };
+
+        isa kind;
+        const char *name;
+        void (*apply)(char *p, size_t n, uint32_t key) noexcept;
+
+        // 実行中の CPU で使用可能な最速の実装
+        static const websocket_masker &active() noexcept;
+        // 指定した実装 (CPU が非対応なら nullptr)。ベンチマーク用
+        static const websocket_masker *get(isa kind) noexcept;
+    };
+
+    // ペイロードの途中 (offset バイト目) から続けてマスクを解除する (フレームが複数の受信に分かれた場合)
+    void websocket_unmask(char *p, size_t n, uint32_t key, uint64_t offset) noexcept;
+
+    // クライアントのフレームを受信データの中で少しずつ解析するパーサー
+    //
+    // ヘッダーがどこで分割されていても続きから解析する (ヘッダーの断片だけを内部に保持する)。
+    // ペイロードは受信データの中でそのままマスクを解除し、受信した分ずつ返す (コピーなし)。
+    // メッセージの組み立て (断片化・制御フレームの割り込み) は呼び出し元が行う。
+    class websocket_parser
+    {
+    public:
+        enum class status
+        {
+            incomplete, // データを使い切った (続きを待つ)
+            payload,    // フレームのペイロードの一部 (または全部) を返した
+            error       // プロトコル違反 (error_code() を送って閉じる)
+        };
+
+        struct frame_header
+        {
+            websocket_opcode opcode = websocket_opcode::continuation;
+            bool fin = false;
+            uint64_t length = 0; // ペイロード長
+        };
+
+        // max_frame_size: これを超えるペイロード長のフレームは 1009 (message_too_big)
+        explicit websocket_parser(uint64_t max_frame_size) noexcept : max_frame_size_(max_frame_size) {}
+
+        // data[0..n) を解析する。consumed には消費したバイト数を返す (payload の場合、piece の終わりまで)
+        // payload を返した時、piece はマスク解除済みの data 内の範囲。frame() が対象のフレーム
+        status parse(char *data, size_t n, size_t &consumed, std::string_view &piece) noexcept;
+
+        // 直前に返したフレームのヘッダー
+        [[nodiscard]] const frame_header &frame() const noexcept { return frame_; }
+        // 直前に返した piece でフレームのペイロードが終わったか
+        [[nodiscard]] bool frame_complete() const noexcept { return in_payload_ && remaining_ == 0; }
+        [[nodiscard]] uint16_t error_code() const noexcept { return error_; }
+
+        void set_max_frame_size(uint64_t size) noexcept { max_frame_size_ = size; }
+        void reset() noexcept;
+
+    private:
+        // p[0..n) からヘッダーを読む (足りなければ 0、違反なら error_ を設定して 0)
+        size_t decode_header(const unsigned char *p, size_t n) noexcept;
+
+        uint64_t max_frame_size_;
+        frame_header frame_;
+        uint32_t mask_ = 0;
+        uint64_t remaining_ = 0;
+        bool in_payload_ = false;
+        uint16_t error_ = 0;
+        // 受信の境界で分割されたヘッダー (最大 14 バイト)
+        std::array<unsigned char, 14> header_{};
+        size_t header_size_ = 0;
+    };
+
+    // サーバーが送るフレーム (マスクなし) のヘッダーを out に書き、その長さを返す (最大 max_frame_header バイト)
+    inline constexpr size_t max_frame_header = 10;
+    size_t write_frame_header(char *out, websocket_opcode opcode, bool fin, uint64_t length) noexcept;
+
+    // Sec-WebSocket-Key に対する Sec-WebSocket-Accept の値 (base64(SHA-1(key + GUID))。28文字)
+    [[nodiscard]] std::array<char, 28> websocket_accept_key(std::string_view key) noexcept;
+    // Sec-WebSocket-Key として正しい形式か (16バイトの base64 = 24文字)
+    [[nodiscard]] bool valid_websocket_key(std::string_view key) noexcept;
+
+    // テキストメッセージ・クローズの理由が正しい UTF-8 か (ASCII は8バイト単位で読み飛ばす)
+    [[nodiscard]] bool valid_utf8(std::string_view s) noexcept;
+}
+
+#endif // WEBSOCKET_PROTOCOL_HPP
@@ -0,0 +1,264 @@
+#ifndef WEBSOCKET_SESSION_HPP
+#define WEBSOCKET_SESSION_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "ouroboros/http/fixed_socket.hpp"
+#include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/task.hpp"
+#include "ouroboros/http/timer_wheel.hpp"
+#include "ouroboros/http/type_definitions.hpp"
+#include "ouroboros/http/unique_socket.hpp"
+#include "ouroboros/http/websocket_protocol.hpp"
+
+namespace ouroboros::http
+{
+    class server;
+    class websocket_hub;
+    struct websocket_route;
+
+    // シリアライズ済みのフレーム (ヘッダー + ペイロード)
+    // 一度だけ作り、複数の接続の送信キューから参照する (ブロードキャスト用)。
+    // 参照カウントはアトミックではないため、作ったコア (スレッド) の中でだけ共有すること
+    class websocket_frame
+    {
+    public:
+        websocket_frame() noexcept = default;
+        // ヘッダーとペイロードを一つの領域へ書く (割り当ては一回)
+        [[nodiscard]] static websocket_frame make(websocket_opcode opcode, std::string_view payload);
+
+        websocket_frame(const websocket_frame &other) noexcept : block_(other.block_) {
+            if (block_) block_->refs++;
+        }
+        websocket_frame(websocket_frame &&other) noexcept : block_(other.block_) { other.block_ = nullptr; }
+        websocket_frame &operator=(websocket_frame other) noexcept {
+            std::swap(block_, other.block_);
+            return *this;
+        }
+        ~websocket_frame() { reset(); }
+
+        void reset() noexcept;
+        // 送信するバイト列 (フレームヘッダーを含む)
+        [[nodiscard]] std::string_view bytes() const noexcept {
+            return block_ ? std::string_view(reinterpret_cast<const char *>(block_ + 1), block_->size) : std::string_view{};
+        }
+        explicit operator bool() const noexcept { return block_ != nullptr; }
+
+    private:
+        // バイト列は block の直後に置く
+        struct block
+        {
+            size_t refs;
+            size_t size;
+        };
+        block *block_ = nullptr;
+    };
+
+    // アップグレードした接続 (websocket_pool が所有し、接続ごとに再利用する)
+    //
+    // http_session が 101 を送り終えるとソケットを引き継ぐ。受信は http_session と同じカーネル管理の
+    // バッファプールへ受け取り、フレームのマスクはその場で解除する。一つの受信に収まった断片化されていない
+    // メッセージはコピーせずに on_message へ渡し、それ以外は message_ で組み立てる。
+    // 送信はキューに積んだフレームをまとめて一回の SENDMSG で送る (共有フレームはコピーしない)。
+    // アプリケーションから呼ぶ関数はこの接続のイベントループのスレッドで呼ぶこと。
+    class alignas(64) websocket_session
+    {
+    public:
+        websocket_session(server &svr, io_context &ctx);
+        ~websocket_session();
+
+        websocket_session(const websocket_session &) = delete;
+        websocket_session &operator=(const websocket_session &) = delete;
+
+        // --- アプリケーション用 ---
+
+        // メッセージを送る (開いていなければ何もしない。送信キューの上限を超えたら接続を閉じる)
+        void send_text(std::string_view message) { send(websocket_opcode::text, message); }
+        void send_binary(std::string_view message) { send(websocket_opcode::binary, message); }
+        void send(websocket_opcode opcode, std::string_view message);
+        // シリアライズ済みのフレームを送る (コピーせずに参照する。送れなければ false)
+        bool send(const websocket_frame &frame);
+        // クローズフレームを送り、相手のクローズフレームを待ってから閉じる
+        void close(uint16_t code = websocket_close::normal, std::string_view reason = {});
+
+        // メッセージを送れる状態か (on_close の後は false)
+        [[nodiscard]] bool is_open() const noexcept { return state_ == state::handshake || state_ == state::open; }
+        // 送信キューに残っているバイト数
+        [[nodiscard]] size_t queued_bytes() const noexcept { return queued_bytes_; }
+        // 接続ごとのアプリケーションのデータ (on_close の後に解放すること。再利用時に nullptr へ戻る)
+        [[nodiscard]] void *user_data() const noexcept { return user_data_; }
+        void set_user_data(void *data) noexcept { user_data_ = data; }
+
+        // --- http_session 用 ---
+
+        // ハンドシェイクを受け付けた (on_open を呼ぶ。以降の送信は start() までキューに積む)
+        void open(const websocket_route &route, const request &req);
+        // 101 を送り終えたソケットを引き継ぐ (received: 101 の送信中に受信していたデータ)
+        void start(unique_socket socket, std::string_view received);
+        void start(fixed_socket socket, std::string_view received);
+        // 101 を送れずに接続が閉じられた (on_close を呼んでプールへ返却する)
+        void abandon();
+
+    private:
+        enum class state : uint8_t
+        {
+            idle,      // プール内
+            handshake, // open() 済み、ソケットの引き継ぎ前
+            open,
+            closing,   // クローズフレームを送った・受け取った (メッセージは渡さない)
+            closed     // ソケットを閉じた (実行中の操作の完了待ち)
+        };
+        enum class timeout_phase : uint8_t
+        {
+            none,
+            ping,   // 受信が途絶えたら Ping を送る
+            pong,   // Ping を送った。応答が無ければ閉じる
+            closing // クローズハンドシェイクの完了待ち
+        };
+        // 送信キューの要素 (frame が空なら local_ / local_sending_ の [offset, offset + length))
+        struct queued_frame
+        {
+            websocket_frame frame;
+            size_t offset;
+            size_t length;
+        };
+        // 一回の SENDMSG で送る最大のフレーム数
+        static constexpr size_t max_iovecs = 64;
+
+        void start_io(std::string_view received);
+        // 受信したデータのフレームを処理する (data はその場でマスクを解除する)
+        void receive(char *data, size_t length);
+        // フレームのペイロードの一部 (parser_.frame() のもの)
+        void handle_piece(std::string_view piece);
+        void handle_control(websocket_opcode opcode, std::string_view payload);
+        void deliver(websocket_opcode opcode, std::string_view message);
+        // プロトコル違反: code を送って閉じる
+        void fail(uint16_t code);
+        // 開いている状態を終え、ハブから外して on_close を呼ぶ (一度だけ)
+        void notify_close(uint16_t code);
+        void leave_hubs() noexcept;
+
+        // 制御フレーム・メッセージを local_ へ書いてキューに積む
+        void enqueue(websocket_opcode opcode, std::string_view payload);
+        void enqueue_close(uint16_t code, std::string_view reason);
+        // 送信キューの上限を確認する (超えたら閉じて false)
+        bool check_queue_limit();
+        // キューに積まれたフレームの送信を始める (送信中なら完了後に送る)
+        void flush();
+
+        void submit_recv();
+        void submit_send();
+        void submit_cancel(task *target);
+        void handle_read(int result, uint32_t flags);
+        void handle_write(int result, uint32_t flags);
+        void handle_timeout(int result, uint32_t flags);
+        // ENOBUFS で見合わせていた受信を再開する (recv_retry_ から呼ばれる)
+        void handle_recv_retry(int result, uint32_t flags);
+        void arm_timeout(timeout_phase phase);
+
+        void prepare_socket_io(io_uring_sqe *sqe) const noexcept;
+        void close_socket();
+        bool has_socket() const noexcept { return socket_ || fixed_socket_; }
+        // 実行中の操作が無く、ソケットが閉じていれば自身をプールへ返却する
+        void finish_if_done();
+        void reset() noexcept;
+
+        server &server_;
+        io_context &ctx_;
+        unique_socket socket_;
+        fixed_socket fixed_socket_;
+        const websocket_route *route_ = nullptr;
+        state state_ = state::idle;
+        void *user_data_ = nullptr;
+
+        member_task<websocket_session> recv_op_{ *this, &websocket_session::handle_read };
+        member_task<websocket_session> send_op_{ *this, &websocket_session::handle_write };
+        member_task<websocket_session> timeout_op_{ *this, &websocket_session::handle_timeout };
+        timer timer_{ timeout_op_ };
+        timeout_phase timeout_phase_ = timeout_phase::none;
+        // 受信バッファのプールが枯渇した (ENOBUFS) 時は、少し待ってから受信をやり直す
+        static constexpr std::chrono::milliseconds recv_retry_delay{ 5 };
+        member_task<websocket_session> recv_retry_op_{ *this, &websocket_session::handle_recv_retry };
+        timer recv_retry_{ recv_retry_op_ };
+
+        bool multishot_ = false;
+        bool recv_armed_ = false;
+        bool send_armed_ = false;
+        bool close_after_send_ = false; // 送信キューを送り終えたらソケットを閉じる
+        int pending_ops_ = 0;
+
+        // 受信
+        websocket_parser parser_{ 0 };
+        bool frame_open_ = false;       // データフレームのペイロードの途中
+        bool in_message_ = false;       // 断片化されたメッセージの途中
+        websocket_opcode message_opcode_ = websocket_opcode::text;
+        std::string message_;           // 組み立て中のメッセージ
+        char control_[125];             // 受信中の制御フレームのペイロード
+        size_t control_size_ = 0;
+
+        // 送信
+        std::vector<queued_frame> queue_;   // 次に送るフレーム (local_ を参照)
+        std::vector<queued_frame> sending_; // 送信中のフレーム (local_sending_ を参照)
+        size_t sending_index_ = 0;          // sending_ の送り終えていない最初の要素
+        std::string local_;
+        std::string local_sending_;
+        size_t queued_bytes_ = 0;
+        // 複数のフレームを送る時だけ使う (購読者の大半は一つずつ送るため必要になった時に確保する)
+        std::vector<iovec> iov_;
+        msghdr msg_{};
+
+        // 購読中のハブと、ハブ内での位置
+        friend class websocket_hub;
+        struct hub_link
+        {
+            websocket_hub *hub;
+            size_t index;
+        };
+        std::vector<hub_link> hubs_;
+
+        // websocket_pool の空きリスト (侵入型)
+        friend class websocket_pool;
+        websocket_session *next_free_ = nullptr;
+    };
+
+    // websocket_session のスラブプール (io_context ごと = サーバーごと)。session_pool と同じ構造
+    class websocket_pool
+    {
+    public:
+        static constexpr size_t slab_size = 64;
+
+        explicit websocket_pool(size_t capacity) noexcept : capacity_(capacity) {}
+
+        websocket_pool(const websocket_pool &) = delete;
+        websocket_pool &operator=(const websocket_pool &) = delete;
+        websocket_pool(websocket_pool &&) noexcept = default;
+        websocket_pool &operator=(websocket_pool &&) noexcept = default;
+
+        // 空いているセッションを取り出す (上限に達していれば nullptr)
+        [[nodiscard]] websocket_session *acquire(server &svr, io_context &ctx);
+        void release(websocket_session *session) noexcept;
+
+        [[nodiscard]] size_t in_use() const noexcept { return in_use_; }
+        [[nodiscard]] size_t capacity() const noexcept { return capacity_; }
+
+    private:
+        struct slab_deleter
+        {
+            void operator()(websocket_session *slab) const noexcept;
+        };
+
+        size_t capacity_;
+        size_t in_use_ = 0;
+        websocket_session *free_list_ = nullptr;
+        std::vector<std::unique_ptr<websocket_session, slab_deleter>> slabs_;
+    };
+}
+
+#endif // WEBSOCKET_SESSION_HPP
@@ -0,0 +1,67 @@
+#include "ouroboros/http/arena.hpp"
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace ouroboros::http
+{
+    void *counting_resource::do_allocate(size_t bytes, size_t alignment) {
+        void *p = upstream_->allocate(bytes, alignment);
+        allocations_++;
+        bytes_allocated_ += bytes;
+        bytes_in_use_ += bytes;
+        return p;
+    }
+
+    void counting_resource::do_deallocate(void *p, size_t bytes, size_t alignment) {
+        upstream_->deallocate(p, bytes, alignment);
+        bytes_in_use_ -= bytes;
+    }
+
+    bool counting_resource::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+        return this == &other;
+    }
+
+    arena_block_pool::arena_block_pool(size_t block_size) noexcept
+        : block_size_(std::max(block_size, sizeof(free_block))) {}
+
+    arena_block_pool::~arena_block_pool() {
+        while (free_) {
+            ::operator delete(std::exchange(free_, free_->next));
+        }
+    }
+
+    arena_block_pool::arena_block_pool(arena_block_pool &&other) noexcept
+        : block_size_(other.block_size_), free_(std::exchange(other.free_, nullptr)),
+        blocks_(std::exchange(other.blocks_, 0)), available_(std::exchange(other.available_, 0)) {}
+
+    std::byte *arena_block_pool::acquire() {
+        if (free_) {
+            available_--;
+            return reinterpret_cast<std::byte *>(std::exchange(free_, free_->next));
+        }
+        auto *block = static_cast<std::byte *>(::operator new(block_size_));
+        blocks_++;
+        return block;
+    }
+
+    void arena_block_pool::release(std::byte *block) noexcept {
+        free_ = ::new (block) free_block{ free_ };
+        available_++;
+    }
+
+    void request_arena::reset() noexcept {
+        if (!block_) return;
+        // 上位リソースから割り当てた分を返却してから、ブロックを空きリストへ戻す
+        resource_.reset();
+        blocks_.release(std::exchange(block_, nullptr));
+    }
+
+    void *request_arena::do_allocate(size_t bytes, size_t alignment) {
+        if (!block_) {
+            block_ = blocks_.acquire();
+            resource_.emplace(block_, blocks_.block_size(), upstream_);
+        }
+        return resource_->allocate(bytes, alignment);
+    }
+}
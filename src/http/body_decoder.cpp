@@ -0,0 +1,149 @@
+#include "ouroboros/http/body_decoder.hpp"
+#include <algorithm>
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        // 16進の値 (数字でなければ -1)
+        constexpr int hex_value(char c) noexcept {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        // 拡張・トレーラーの行に許さない制御文字 (HTAB は可)
+        constexpr bool is_control(char c) noexcept {
+            auto u = static_cast<unsigned char>(c);
+            return (u < 0x20 && c != '\t') || u == 0x7f;
+        }
+    }
+
+    void body_decoder::reset(uint64_t length) noexcept {
+        chunked_ = false;
+        remaining_ = length;
+        state_ = length == 0 ? state::done : state::data;
+    }
+
+    void body_decoder::reset_chunked() noexcept {
+        chunked_ = true;
+        remaining_ = 0;
+        digits_ = 0;
+        line_ = 0;
+        trailer_ = 0;
+        state_ = state::size;
+    }
+
+    body_decoder::status body_decoder::fail(size_t pos, size_t &consumed) noexcept {
+        state_ = state::failed;
+        consumed = pos;
+        return status::error;
+    }
+
+    void body_decoder::end_size_line() noexcept {
+        // 長さ 0 のチャンクが最後 (トレーラーが続く)
+        state_ = remaining_ == 0 ? state::trailer_begin : state::data;
+    }
+
+    body_decoder::status body_decoder::decode(std::string_view data, size_t &consumed, std::string_view &piece) noexcept {
+        size_t pos = 0;
+        piece = {};
+
+        while (true) {
+            if (state_ == state::data) {
+                if (remaining_ == 0) {
+                    state_ = chunked_ ? state::data_end : state::done;
+                    continue;
+                }
+                if (pos == data.size()) break;
+                size_t n = static_cast<size_t>(std::min<uint64_t>(remaining_, data.size() - pos));
+                piece = data.substr(pos, n);
+                remaining_ -= n;
+                consumed = pos + n;
+                return status::data;
+            }
+            if (state_ == state::done) {
+                consumed = pos;
+                return status::done;
+            }
+            if (state_ == state::failed) return fail(pos, consumed);
+            if (pos == data.size()) break;
+
+            // チャンクの区切りは短いため1バイトずつ解析する (単独の LF も行末として受け付ける)
+            char c = data[pos++];
+            switch (state_) {
+            case state::size:
+                if (int v = hex_value(c); v >= 0) {
+                    // 16桁を超える長さは uint64_t に収まらない
+                    if (++digits_ > 16) return fail(pos, consumed);
+                    remaining_ = remaining_ * 16 + static_cast<uint64_t>(v);
+                } else if (digits_ == 0) {
+                    return fail(pos, consumed);
+                } else if (c == ';' || c == ' ' || c == '\t') {
+                    line_ = 0;
+                    state_ = state::extension;
+                } else if (c == '\r') {
+                    state_ = state::size_lf;
+                } else if (c == '\n') {
+                    end_size_line();
+                } else {
+                    return fail(pos, consumed);
+                }
+                break;
+            case state::extension:
+                if (c == '\r') state_ = state::size_lf;
+                else if (c == '\n') end_size_line();
+                else if (is_control(c) || ++line_ > max_line) return fail(pos, consumed);
+                break;
+            case state::size_lf:
+                if (c != '\n') return fail(pos, consumed);
+                end_size_line();
+                break;
+            case state::data_end:
+                if (c == '\r') {
+                    state_ = state::data_lf;
+                } else if (c == '\n') {
+                    digits_ = 0;
+                    state_ = state::size;
+                } else {
+                    return fail(pos, consumed);
+                }
+                break;
+            case state::data_lf:
+                if (c != '\n') return fail(pos, consumed);
+                digits_ = 0;
+                state_ = state::size;
+                break;
+            case state::trailer_begin:
+                if (c == '\r') {
+                    state_ = state::last_lf;
+                } else if (c == '\n') {
+                    state_ = state::done;
+                } else {
+                    if (is_control(c) || ++trailer_ > max_trailer) return fail(pos, consumed);
+                    state_ = state::trailer;
+                }
+                break;
+            case state::trailer:
+                // トレーラーのフィールドは使用しない
+                if (c == '\r') state_ = state::trailer_lf;
+                else if (c == '\n') state_ = state::trailer_begin;
+                else if (is_control(c) || ++trailer_ > max_trailer) return fail(pos, consumed);
+                break;
+            case state::trailer_lf:
+                if (c != '\n') return fail(pos, consumed);
+                state_ = state::trailer_begin;
+                break;
+            case state::last_lf:
+                if (c != '\n') return fail(pos, consumed);
+                state_ = state::done;
+                break;
+            default:
+                break;
+            }
+        }
+        consumed = pos;
+        return status::incomplete;
+    }
+}
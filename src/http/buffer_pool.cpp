@@ -0,0 +1,157 @@
+#include "ouroboros/http/buffer_pool.hpp"
+#include <sys/mman.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace ouroboros::http
+{
+    std::expected<buffer_pool, std::error_code> buffer_pool::create(io_context &ctx, uint16_t group_id,
+        uint16_t buffer_count, uint32_t buffer_size) {
+        // PBUF ring はエントリ数が2のべき乗である必要がある
+        if (buffer_count == 0 || (buffer_count & (buffer_count - 1)) != 0 || buffer_size == 0) {
+            return std::unexpected(error_code::buffer_registration_failed);
+        }
+
+        buffer_pool pool(ctx, group_id, buffer_count, buffer_size);
+
+        pool.storage_sz_ = static_cast<size_t>(buffer_count) * buffer_size;
+        void *storage = mmap(nullptr, pool.storage_sz_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (storage == MAP_FAILED) {
+            return std::unexpected(error_code::buffer_registration_failed);
+        }
+        pool.storage_ = static_cast<char *>(storage);
+
+        if (auto ec = pool.register_ring(); ec) {
+            return std::unexpected(ec);
+        }
+        return pool;
+    }
+
+    buffer_pool::buffer_pool(io_context &ctx, uint16_t group_id, uint16_t buffer_count, uint32_t buffer_size)
+        : ctx_(&ctx), group_id_(group_id), buffer_count_(buffer_count), buffer_size_(buffer_size) {}
+
+    buffer_pool::buffer_pool(buffer_pool &&other) noexcept
+        : ctx_(other.ctx_), group_id_(other.group_id_), buffer_count_(other.buffer_count_),
+        buffer_size_(other.buffer_size_),
+        storage_(std::exchange(other.storage_, nullptr)), storage_sz_(std::exchange(other.storage_sz_, 0)),
+        ring_(std::exchange(other.ring_, nullptr)), ring_sz_(std::exchange(other.ring_sz_, 0)),
+        ring_tail_(other.ring_tail_), deferred_(std::move(other.deferred_)) {}
+
+    buffer_pool &buffer_pool::operator=(buffer_pool &&other) noexcept {
+        if (this != &other) {
+            release();
+            ctx_ = other.ctx_;
+            group_id_ = other.group_id_;
+            buffer_count_ = other.buffer_count_;
+            buffer_size_ = other.buffer_size_;
+            storage_ = std::exchange(other.storage_, nullptr);
+            storage_sz_ = std::exchange(other.storage_sz_, 0);
+            ring_ = std::exchange(other.ring_, nullptr);
+            ring_sz_ = std::exchange(other.ring_sz_, 0);
+            ring_tail_ = other.ring_tail_;
+            deferred_ = std::move(other.deferred_);
+        }
+        return *this;
+    }
+
+    buffer_pool::~buffer_pool() {
+        release();
+    }
+
+    void buffer_pool::release() noexcept {
+        if (ring_) {
+            io_uring_buf_reg reg{};
+            reg.bgid = group_id_;
+            ctx_->register_resource(IORING_UNREGISTER_PBUF_RING, &reg, 1);
+            munmap(ring_, ring_sz_);
+            ring_ = nullptr;
+        }
+        if (storage_) {
+            munmap(storage_, storage_sz_);
+            storage_ = nullptr;
+        }
+    }
+
+    std::error_code buffer_pool::register_ring() {
+        // 1. PBUF ring を試す (リング本体はページ境界に揃っている必要があるため mmap で確保)
+        ring_sz_ = static_cast<size_t>(buffer_count_) * sizeof(io_uring_buf);
+        void *ring = mmap(nullptr, ring_sz_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED) {
+            ring_sz_ = 0;
+            return error_code::buffer_registration_failed;
+        }
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uintptr_t>(ring);
+        reg.ring_entries = buffer_count_;
+        reg.bgid = group_id_;
+
+        int ret = ctx_->register_resource(IORING_REGISTER_PBUF_RING, &reg, 1);
+        if (ret < 0) {
+            munmap(ring, ring_sz_);
+            ring_sz_ = 0;
+            // 非対応カーネル (EINVAL) の場合のみフォールバックする
+            if (ret != -EINVAL) return error_code::buffer_registration_failed;
+            return provide_all();
+        }
+
+        ring_ = static_cast<io_uring_buf_ring *>(ring);
+        ring_tail_ = 0;
+        for (uint16_t bid = 0; bid < buffer_count_; ++bid) {
+            io_uring_buf &buf = ring_buffers()[ring_tail_ & (buffer_count_ - 1)];
+            buf.addr = reinterpret_cast<uintptr_t>(storage_ + static_cast<size_t>(bid) * buffer_size_);
+            buf.len = buffer_size_;
+            buf.bid = bid;
+            ring_tail_++;
+        }
+        std::atomic_store_explicit(reinterpret_cast<std::atomic<uint16_t> *>(&ring_->tail), ring_tail_,
+            std::memory_order_release);
+        return {};
+    }
+
+    std::error_code buffer_pool::provide_all() {
+        // 2. フォールバック: 全バッファを一つの PROVIDE_BUFFERS で登録する
+        deferred_.reserve(buffer_count_);
+        if (!provide(0, buffer_count_)) return error_code::buffer_registration_failed;
+        if (ctx_->submit() < 0) return error_code::buffer_registration_failed;
+        return {};
+    }
+
+    bool buffer_pool::provide(uint16_t bid, uint16_t count) noexcept {
+        auto *sqe = ctx_->get_sqe();
+        if (!sqe) return false;
+
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = count; // 登録するバッファ数
+        sqe->addr = reinterpret_cast<uintptr_t>(storage_ + static_cast<size_t>(bid) * buffer_size_);
+        sqe->len = buffer_size_;
+        sqe->off = bid; // 先頭のバッファID
+        sqe->buf_group = group_id_;
+        sqe->user_data = 0; // 完了通知は不要
+        return true;
+    }
+
+    void buffer_pool::recycle(uint16_t bid) noexcept {
+        if (ring_) {
+            // リングの末尾に追加し、tail を公開するだけでカーネルから再利用可能になる
+            io_uring_buf &buf = ring_buffers()[ring_tail_ & (buffer_count_ - 1)];
+            buf.addr = reinterpret_cast<uintptr_t>(storage_ + static_cast<size_t>(bid) * buffer_size_);
+            buf.len = buffer_size_;
+            buf.bid = bid;
+            ring_tail_++;
+            std::atomic_store_explicit(reinterpret_cast<std::atomic<uint16_t> *>(&ring_->tail), ring_tail_,
+                std::memory_order_release);
+            return;
+        }
+
+        // フォールバック: 以前返却できなかった分も含めて SQE を発行する
+        deferred_.push_back(bid);
+        while (!deferred_.empty()) {
+            if (!provide(deferred_.back(), 1)) return; // SQ が一杯。次回の返却時に再試行
+            deferred_.pop_back();
+        }
+        ctx_->submit();
+    }
+}
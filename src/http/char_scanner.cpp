@@ -0,0 +1,251 @@
+#include "ouroboros/http/char_scanner.hpp"
+#include <array>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define OUROBOROS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        // --- 文字種テーブル (スカラー実装と SIMD の端数処理で使用) ---
+
+        constexpr bool tchar(unsigned char c) noexcept {
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) return true;
+            switch (c) {
+            case '!': case '#': case '$': case '%': case '&': case '\'': case '*': case '+':
+            case '-': case '.': case '^': case '_': case '`': case '|': case '~':
+                return true;
+            default:
+                return false;
+            }
+        }
+        constexpr bool target_char(unsigned char c) noexcept {
+            return c > 0x20 && c != 0x7f;
+        }
+        constexpr bool field_value_char(unsigned char c) noexcept {
+            return (c >= 0x20 || c == '\t') && c != 0x7f;
+        }
+
+        template <bool (*Pred)(unsigned char)>
+        constexpr std::array<bool, 256> make_table() noexcept {
+            std::array<bool, 256> table{};
+            for (unsigned c = 0; c < 256; ++c) table[c] = Pred(static_cast<unsigned char>(c));
+            return table;
+        }
+
+        constexpr auto token_table = make_table<tchar>();
+        constexpr auto target_table = make_table<target_char>();
+        constexpr auto field_value_table = make_table<field_value_char>();
+
+        inline size_t scan_scalar(const std::array<bool, 256> &table, const char *p, size_t i, size_t n) noexcept {
+            while (i < n && table[static_cast<unsigned char>(p[i])]) ++i;
+            return i;
+        }
+
+        // --- スカラー実装 ---
+
+        size_t token_scalar(const char *p, size_t n) noexcept {
+            return scan_scalar(token_table, p, 0, n);
+        }
+        size_t target_scalar(const char *p, size_t n) noexcept {
+            return scan_scalar(target_table, p, 0, n);
+        }
+        size_t field_value_scalar(const char *p, size_t n) noexcept {
+            return scan_scalar(field_value_table, p, 0, n);
+        }
+
+#ifdef OUROBOROS_X86
+        // --- SSE4.2 (pcmpestri, 16バイト単位) ---
+        //
+        // _SIDD_CMP_RANGES: needle は [下限, 上限] の組 (最大8組)。
+        // 16バイトに満たない末尾はページ境界を越えて読まないよう、スカラーで処理する。
+
+        constexpr int sse_ranges = _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT;
+
+        // tchar の範囲 (9組必要なため '~' を除いた8組。'~' で止まった場合はスカラーで確認して続行)
+        alignas(16) constexpr char token_ranges[16] = {
+            '!', '!', '#', '\'', '*', '+', '-', '.', '0', '9', 'A', 'Z', '^', 'z', '|', '|'
+        };
+        // 停止文字の範囲
+        alignas(16) constexpr char target_stop_ranges[16] = { 0x00, 0x20, 0x7f, 0x7f };
+        alignas(16) constexpr char field_value_stop_ranges[16] = { 0x00, 0x08, 0x0a, 0x1f, 0x7f, 0x7f };
+
+        __attribute__((target("sse4.2")))
+        size_t token_sse42(const char *p, size_t n) noexcept {
+            const __m128i ranges = _mm_load_si128(reinterpret_cast<const __m128i *>(token_ranges));
+            size_t i = 0;
+            while (i + 16 <= n) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                // 範囲外 (= 非 tchar 候補) の最初の位置
+                int idx = _mm_cmpestri(ranges, 16, block, 16, sse_ranges | _SIDD_MASKED_NEGATIVE_POLARITY);
+                if (idx == 16) {
+                    i += 16;
+                    continue;
+                }
+                i += static_cast<size_t>(idx);
+                if (!token_table[static_cast<unsigned char>(p[i])]) return i;
+                ++i; // '~'
+            }
+            return scan_scalar(token_table, p, i, n);
+        }
+
+        __attribute__((target("sse4.2")))
+        size_t target_sse42(const char *p, size_t n) noexcept {
+            const __m128i ranges = _mm_load_si128(reinterpret_cast<const __m128i *>(target_stop_ranges));
+            size_t i = 0;
+            while (i + 16 <= n) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                int idx = _mm_cmpestri(ranges, 4, block, 16, sse_ranges);
+                if (idx != 16) return i + static_cast<size_t>(idx);
+                i += 16;
+            }
+            return scan_scalar(target_table, p, i, n);
+        }
+
+        __attribute__((target("sse4.2")))
+        size_t field_value_sse42(const char *p, size_t n) noexcept {
+            const __m128i ranges = _mm_load_si128(reinterpret_cast<const __m128i *>(field_value_stop_ranges));
+            size_t i = 0;
+            while (i + 16 <= n) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                int idx = _mm_cmpestri(ranges, 6, block, 16, sse_ranges);
+                if (idx != 16) return i + static_cast<size_t>(idx);
+                i += 16;
+            }
+            return scan_scalar(field_value_table, p, i, n);
+        }
+
+        // --- AVX2 (32バイト単位) ---
+        //
+        // ヘッダー行の多くは32バイトに満たないため、残りは16バイト単位で判定し、
+        // 最後の端数はデータ末尾に揃えた (既に判定済みの部分と重なる) 16バイトで判定する。
+
+        // tchar 判定用のニブル表: lo[下位4bit] の bit h が立っていれば (h << 4 | 下位4bit) は tchar
+        constexpr std::array<uint8_t, 16> make_token_nibbles() noexcept {
+            std::array<uint8_t, 16> lo{};
+            for (unsigned c = 0; c < 128; ++c) {
+                if (tchar(static_cast<unsigned char>(c))) lo[c & 0x0f] = static_cast<uint8_t>(lo[c & 0x0f] | (1u << (c >> 4)));
+            }
+            return lo;
+        }
+        alignas(16) constexpr std::array<uint8_t, 16> token_nibbles = make_token_nibbles();
+        // 上位4bit -> ビット (0x80 以上は非 ASCII なので 0 = tchar ではない)
+        alignas(16) constexpr uint8_t high_nibble_bits[16] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+
+        // 各関数は停止すべきバイトのビットマスクを返す
+
+        __attribute__((target("avx2")))
+        inline uint32_t token_stop_mask(__m256i block) noexcept {
+            const __m256i lo_table = _mm256_broadcastsi128_si256(
+                _mm_load_si128(reinterpret_cast<const __m128i *>(token_nibbles.data())));
+            const __m256i hi_table = _mm256_broadcastsi128_si256(
+                _mm_load_si128(reinterpret_cast<const __m128i *>(high_nibble_bits)));
+            const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+            __m256i lo = _mm256_and_si256(block, nibble_mask);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble_mask);
+            __m256i hit = _mm256_and_si256(_mm256_shuffle_epi8(lo_table, lo), _mm256_shuffle_epi8(hi_table, hi));
+            // hit == 0 のバイトが tchar 以外
+            return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hit, _mm256_setzero_si256())));
+        }
+
+        // c <= 0x20 (符号なし) または c == 0x7f
+        __attribute__((target("avx2")))
+        inline uint32_t target_stop_mask(__m256i block) noexcept {
+            __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(block, _mm256_set1_epi8(0x20)), block),
+                _mm256_cmpeq_epi8(block, _mm256_set1_epi8(0x7f)));
+            return static_cast<uint32_t>(_mm256_movemask_epi8(stop));
+        }
+
+        // (c < 0x20 かつ c != HT) または c == 0x7f
+        __attribute__((target("avx2")))
+        inline uint32_t field_value_stop_mask(__m256i block) noexcept {
+            __m256i ctl = _mm256_andnot_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t')),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(block, _mm256_set1_epi8(0x1f)), block));
+            __m256i stop = _mm256_or_si256(ctl, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(0x7f)));
+            return static_cast<uint32_t>(_mm256_movemask_epi8(stop));
+        }
+
+        template <uint32_t (*StopMask)(__m256i) noexcept>
+        __attribute__((target("avx2")))
+        inline size_t scan_avx2(const std::array<bool, 256> &table, const char *p, size_t n) noexcept {
+            if (n < 16) return scan_scalar(table, p, 0, n);
+
+            size_t i = 0;
+            while (i + 32 <= n) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                if (uint32_t mask = StopMask(block)) return i + static_cast<size_t>(__builtin_ctz(mask));
+                i += 32;
+            }
+            while (i < n) {
+                size_t at = i + 16 <= n ? i : n - 16;
+                __m256i block = _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + at)));
+                // 上位レーンは不定、重なった部分は判定済みなので除外する
+                uint32_t mask = StopMask(block) & (0xffffu << (i - at)) & 0xffffu;
+                if (mask) return at + static_cast<size_t>(__builtin_ctz(mask));
+                i = at + 16;
+            }
+            return n;
+        }
+
+        __attribute__((target("avx2")))
+        size_t token_avx2(const char *p, size_t n) noexcept {
+            return scan_avx2<token_stop_mask>(token_table, p, n);
+        }
+        __attribute__((target("avx2")))
+        size_t target_avx2(const char *p, size_t n) noexcept {
+            return scan_avx2<target_stop_mask>(target_table, p, n);
+        }
+        __attribute__((target("avx2")))
+        size_t field_value_avx2(const char *p, size_t n) noexcept {
+            return scan_avx2<field_value_stop_mask>(field_value_table, p, n);
+        }
+#endif // OUROBOROS_X86
+
+        constexpr char_scanner scalar_scanner{
+            char_scanner::isa::scalar, "scalar", token_scalar, target_scalar, field_value_scalar
+        };
+#ifdef OUROBOROS_X86
+        constexpr char_scanner sse42_scanner{
+            char_scanner::isa::sse42, "sse4.2", token_sse42, target_sse42, field_value_sse42
+        };
+        constexpr char_scanner avx2_scanner{
+            char_scanner::isa::avx2, "avx2", token_avx2, target_avx2, field_value_avx2
+        };
+#endif
+
+        const char_scanner *detect() noexcept {
+#ifdef OUROBOROS_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return &avx2_scanner;
+            if (__builtin_cpu_supports("sse4.2")) return &sse42_scanner;
+#endif
+            return &scalar_scanner;
+        }
+
+        // 起動時に一度だけ判定する
+        const char_scanner *const active_scanner = detect();
+    }
+
+    const char_scanner &char_scanner::active() noexcept {
+        return *active_scanner;
+    }
+
+    const char_scanner *char_scanner::get(isa kind) noexcept {
+        switch (kind) {
+        case isa::scalar:
+            return &scalar_scanner;
+#ifdef OUROBOROS_X86
+        case isa::sse42:
+            return __builtin_cpu_supports("sse4.2") ? &sse42_scanner : nullptr;
+        case isa::avx2:
+            return __builtin_cpu_supports("avx2") ? &avx2_scanner : nullptr;
+#endif
+        default:
+            return nullptr;
+        }
+    }
+}
@@ -0,0 +1,621 @@
+#include "ouroboros/http/client.hpp"
+#include "ouroboros/http/body_decoder.hpp"
+#include "ouroboros/http/error.hpp"
+#include "ouroboros/http/socket_address.hpp"
+#include "ouroboros/http/timer_wheel.hpp"
+#include "ouroboros/http/unique_socket.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/socket.h>
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        constexpr size_t initial_buffer_size = 16 * 1024;
+
+        // 応答前に接続が閉じられた場合に送り直してよいメソッド (RFC 9110 9.2.2)
+        constexpr bool idempotent(method m) noexcept {
+            return m != method::POST && m != method::PATCH;
+        }
+
+        std::error_code system_error(int result) noexcept {
+            return { -result, std::system_category() };
+        }
+    }
+
+    // 交換の単方向リスト (FIFO)
+    struct client::exchange_queue
+    {
+        exchange *head = nullptr;
+        exchange *tail = nullptr;
+        size_t size = 0;
+
+        [[nodiscard]] bool empty() const noexcept { return head == nullptr; }
+        [[nodiscard]] exchange *front() const noexcept { return head; }
+
+        void push_back(exchange &ex) noexcept {
+            ex.next_ = nullptr;
+            if (tail) tail->next_ = &ex;
+            else head = &ex;
+            tail = &ex;
+            size++;
+        }
+        void push_front(exchange &ex) noexcept {
+            ex.next_ = head;
+            head = &ex;
+            if (!tail) tail = &ex;
+            size++;
+        }
+        exchange *pop_front() noexcept {
+            exchange *ex = head;
+            if (!ex) return nullptr;
+            head = ex->next_;
+            if (!head) tail = nullptr;
+            ex->next_ = nullptr;
+            size--;
+            return ex;
+        }
+
+        // 結果を設定済みの交換を全て再開する (再開したコルーチンは交換を破棄してよい)
+        void resume_all() {
+            while (exchange *ex = pop_front()) ex->resume();
+        }
+    };
+
+    // 上流 (ホスト・ポート) ごとの接続プール
+    class client::upstream
+    {
+    public:
+        upstream(client &owner, std::string host, uint16_t port, const socket_address &address)
+            : owner_(owner), host_(std::move(host)), port_(port), host_header_(host_header_value(host_, port)),
+              address_(address) {}
+
+        [[nodiscard]] bool matches(std::string_view host, uint16_t port) const noexcept {
+            return port_ == port && host_ == host;
+        }
+
+        // 交換を接続へ割り当てる (空きが無ければ待ち行列へ。front なら先頭へ戻す)
+        // 接続を開始できなければ error_ を設定して false を返す
+        bool dispatch(exchange &ex, bool front = false);
+        // 待ち行列の交換を割り当て直す (失敗したものは done へ)
+        void pump(exchange_queue &done);
+        // 送り直す交換を待ち行列の先頭へ戻す (次の pump() で割り当てる)
+        void requeue(exchange &ex) noexcept { waiting_.push_front(ex); }
+        // 閉じ終えた接続を破棄する
+        void release(connection &conn) noexcept;
+
+        [[nodiscard]] client &owner() noexcept { return owner_; }
+        [[nodiscard]] const std::string &host_header() const noexcept { return host_header_; }
+        [[nodiscard]] const socket_address &address() const noexcept { return address_; }
+
+    private:
+        client &owner_;
+        std::string host_;
+        uint16_t port_;
+        std::string host_header_;
+        socket_address address_;
+        std::vector<std::unique_ptr<connection>> connections_;
+        exchange_queue waiting_;
+    };
+
+    // 上流への一つの接続
+    //
+    // 送信順に応答待ちの列 (in_flight_) へつなぎ、受信したレスポンスを先頭から順に対応させる。
+    // 接続中は受信を常に一つ発行しておき、使われていない間に上流が閉じたことにも気付けるようにする。
+    // 閉じた後は発行中の操作を取り消し、全て完了してから upstream が破棄する。
+    // 完了ハンドラは最後に (接続を破棄した後に) 完了した交換のコルーチンを再開する。
+    class client::connection
+    {
+    public:
+        explicit connection(upstream &owner)
+            : owner_(owner), ctx_(owner.owner().context()), options_(owner.owner().options()),
+              parser_(parser_mode::response, options_.limits) {}
+
+        // 接続を開始する (ソケットの作成と IORING_OP_CONNECT の発行)。失敗時は -errno
+        int open();
+        // 交換を送信順の最後に加える
+        void enqueue(exchange &ex);
+
+        // 新しいリクエストを受け付けるか
+        [[nodiscard]] bool usable() const noexcept { return state_ != state::closed; }
+        [[nodiscard]] bool idle() const noexcept { return state_ == state::ready && in_flight_.empty(); }
+        [[nodiscard]] size_t in_flight() const noexcept { return in_flight_.size; }
+
+    private:
+        enum class state : uint8_t
+        {
+            connecting,
+            ready,
+            closed
+        };
+
+        void handle_connect(int result, uint32_t flags);
+        void handle_send(int result, uint32_t flags);
+        void handle_recv(int result, uint32_t flags);
+        void handle_timeout(int result, uint32_t flags);
+
+        void start_send();
+        void arm_recv();
+        // 状態に応じたタイムアウトを設定する (接続・応答待ち・アイドル)
+        void update_timer() noexcept;
+        void prepare_parser() noexcept;
+        // 受信済みのレスポンスを応答待ちの交換へ対応させる
+        void parse_responses(bool eof, exchange_queue &done);
+        // チャンク形式のボディを受信バッファの中で復号する (データをヘッダーの直後へ詰めていく)
+        // data はレスポンスの先頭から。complete 時のボディは data の [head_size, body_end_)
+        parse_status decode_chunked(char *data, size_t size, bool eof) noexcept;
+        // 応答待ちの交換を全て終わらせる (retry なら送り直せるものは upstream へ戻す)
+        void abort(std::error_code error, bool retry, exchange_queue &done);
+        // 発行中の操作を取り消し、以降のリクエストを受け付けない
+        void close() noexcept;
+        void submit_cancel(task *target) noexcept;
+        // 完了ハンドラの最後に呼ぶ (この接続は破棄されていることがある)
+        void finish(exchange_queue &done);
+
+        void serialize(const client_request &req, std::string &out) const;
+
+        upstream &owner_;
+        io_context &ctx_;
+        const client_options &options_;
+        unique_socket socket_;
+        state state_ = state::connecting;
+
+        exchange_queue in_flight_;
+        uint64_t responses_ = 0; // この接続で受信したレスポンス数 (再利用の判定)
+        request_parser parser_;
+        body_decoder decoder_;
+        bool decoding_ = false; // チャンク形式のボディを復号中
+        size_t body_read_ = 0;  // レスポンスの先頭から、復号し終えた受信データの終わり
+        size_t body_end_ = 0;   // レスポンスの先頭から、詰めたボディの終わり
+        std::vector<char> in_;
+        size_t in_used_ = 0;
+        std::string out_;    // 送信中
+        size_t out_sent_ = 0;
+        std::string queued_; // 送信中に追加されたリクエスト
+
+        member_task<connection> connect_op_{ *this, &connection::handle_connect };
+        member_task<connection> send_op_{ *this, &connection::handle_send };
+        member_task<connection> recv_op_{ *this, &connection::handle_recv };
+        member_task<connection> timeout_op_{ *this, &connection::handle_timeout };
+        timer timer_{ timeout_op_ };
+        bool connect_armed_ = false;
+        bool send_armed_ = false;
+        bool recv_armed_ = false;
+    };
+
+    // --- client ---
+
+    client::client(io_context &ctx, const client_options &options) : ctx_(ctx), options_(options) {
+        if (options_.max_connections == 0) options_.max_connections = 1;
+        if (options_.max_pipeline == 0) options_.max_pipeline = 1;
+    }
+
+    client::~client() = default;
+
+    client &client::current() {
+        thread_local std::unique_ptr<client> instance;
+        io_context *ctx = io_context::current();
+        if (!ctx) throw std::logic_error("client::current() must be called on an event loop thread");
+        if (!instance || &instance->ctx_ != ctx) instance = std::make_unique<client>(*ctx);
+        return *instance;
+    }
+
+    client::exchange client::request(std::string_view host, uint16_t port, const client_request &req) {
+        std::error_code error;
+        upstream *target = find_upstream(host, port, error);
+        return exchange(target, req, error);
+    }
+
+    client::upstream *client::find_upstream(std::string_view host, uint16_t port, std::error_code &error) {
+        // コアごとの上流の数は少ないため線形探索
+        for (auto &up : upstreams_) {
+            if (up->matches(host, port)) return up.get();
+        }
+        std::string name(host);
+        socket_address address;
+        if (!resolve_address(name, port, address)) {
+            error = error_code::address_resolution_failed;
+            return nullptr;
+        }
+        upstreams_.push_back(std::make_unique<upstream>(*this, std::move(name), port, address));
+        return upstreams_.back().get();
+    }
+
+    // --- exchange ---
+
+    bool client::exchange::await_suspend(std::coroutine_handle<> caller) {
+        caller_ = caller;
+        return upstream_->dispatch(*this);
+    }
+
+    std::expected<client_response, std::error_code> client::exchange::await_resume() {
+        if (error_) return std::unexpected(error_);
+        return std::move(response_);
+    }
+
+    // --- upstream ---
+
+    bool client::upstream::dispatch(exchange &ex, bool front) {
+        // 1. 空いている接続  2. 上限までは新しい接続  3. 応答待ちの少ない接続へパイプライン
+        connection *least = nullptr;
+        size_t open = 0;
+        for (auto &conn : connections_) {
+            if (!conn->usable()) continue;
+            open++;
+            if (conn->idle()) {
+                conn->enqueue(ex);
+                return true;
+            }
+            if (conn->in_flight() < owner_.options().max_pipeline && (!least || conn->in_flight() < least->in_flight())) {
+                least = conn.get();
+            }
+        }
+
+        if (open < owner_.options().max_connections) {
+            auto conn = std::make_unique<connection>(*this);
+            if (int result = conn->open(); result < 0) {
+                ex.error_ = system_error(result);
+                return false;
+            }
+            owner_.connections_opened_++;
+            conn->enqueue(ex);
+            connections_.push_back(std::move(conn));
+            return true;
+        }
+
+        if (least) least->enqueue(ex);
+        else if (front) waiting_.push_front(ex);
+        else waiting_.push_back(ex);
+        return true;
+    }
+
+    void client::upstream::pump(exchange_queue &done) {
+        while (!waiting_.empty()) {
+            // 割り当て先が無ければ先頭に戻るため、列の長さが変わらなければ終える
+            size_t before = waiting_.size;
+            exchange &ex = *waiting_.pop_front();
+            if (!dispatch(ex, true)) done.push_back(ex);
+            else if (waiting_.size == before) break;
+        }
+    }
+
+    void client::upstream::release(connection &conn) noexcept {
+        auto it = std::find_if(connections_.begin(), connections_.end(), [&](const auto &c) { return c.get() == &conn; });
+        if (it == connections_.end()) return;
+        std::swap(*it, connections_.back());
+        connections_.pop_back();
+    }
+
+    // --- connection ---
+
+    int client::connection::open() {
+        const socket_address &address = owner_.address();
+        int fd = ::socket(address.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -errno;
+        socket_ = unique_socket(fd);
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return -EBUSY;
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uintptr_t>(address.get());
+        sqe->off = address.length;
+        sqe->user_data = reinterpret_cast<uintptr_t>(&connect_op_);
+        connect_armed_ = true;
+        ctx_.submit();
+
+        in_.resize(initial_buffer_size);
+        update_timer();
+        return 0;
+    }
+
+    void client::connection::enqueue(exchange &ex) {
+        bool was_idle = in_flight_.empty();
+        in_flight_.push_back(ex);
+        serialize(ex.request_, send_armed_ ? queued_ : out_);
+        if (was_idle) prepare_parser();
+        if (state_ != state::ready) return;
+        if (was_idle) update_timer();
+        if (!send_armed_) start_send();
+    }
+
+    void client::connection::serialize(const client_request &req, std::string &out) const {
+        bool has_host = false;
+        size_t size = req.target.size() + req.body.size() + 64;
+        for (const auto &h : req.headers) size += h.name.size() + h.value.size() + 4;
+        out.reserve(out.size() + size);
+
+        out += to_string(req.method);
+        out += ' ';
+        out += req.target;
+        out += " HTTP/1.1\r\n";
+        for (const auto &h : req.headers) {
+            // フレーミングはクライアントが決める
+            if (iequals(h.name, "content-length") || iequals(h.name, "transfer-encoding")) continue;
+            if (iequals(h.name, "host")) has_host = true;
+            out += h.name;
+            out += ": ";
+            out += h.value;
+            out += "\r\n";
+        }
+        if (!has_host) {
+            out += "Host: ";
+            out += owner_.host_header();
+            out += "\r\n";
+        }
+        if (!req.body.empty() || req.method == method::POST || req.method == method::PUT || req.method == method::PATCH) {
+            out += "Content-Length: ";
+            out += std::to_string(req.body.size());
+            out += "\r\n";
+        }
+        out += "\r\n";
+        out += req.body;
+    }
+
+    void client::connection::start_send() {
+        if (out_sent_ == out_.size()) {
+            out_.clear();
+            out_sent_ = 0;
+            if (queued_.empty()) return;
+            out_.swap(queued_);
+        }
+        // SQE が取得できない場合は応答待ちのタイムアウトで失敗させる
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = socket_.native_handle();
+        sqe->addr = reinterpret_cast<uintptr_t>(out_.data() + out_sent_);
+        sqe->len = static_cast<uint32_t>(out_.size() - out_sent_);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = reinterpret_cast<uintptr_t>(&send_op_);
+        send_armed_ = true;
+        ctx_.submit();
+    }
+
+    void client::connection::arm_recv() {
+        if (in_used_ == in_.size()) {
+            // ヘッダーとボディの上限までは拡張する (それ以上はパーサーが失敗させる)
+            size_t limit = options_.limits.max_header_bytes + options_.limits.max_body_size;
+            in_.resize(std::min(in_.size() * 2, limit + initial_buffer_size));
+        }
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = socket_.native_handle();
+        sqe->addr = reinterpret_cast<uintptr_t>(in_.data() + in_used_);
+        sqe->len = static_cast<uint32_t>(in_.size() - in_used_);
+        sqe->user_data = reinterpret_cast<uintptr_t>(&recv_op_);
+        recv_armed_ = true;
+        ctx_.submit();
+    }
+
+    void client::connection::update_timer() noexcept {
+        std::chrono::milliseconds timeout;
+        switch (state_) {
+        case state::connecting: timeout = options_.connect_timeout; break;
+        case state::ready: timeout = in_flight_.empty() ? options_.idle_timeout : options_.read_timeout; break;
+        case state::closed: timer_.cancel(); return;
+        }
+        ctx_.timers().arm(timer_, timeout);
+    }
+
+    void client::connection::prepare_parser() noexcept {
+        parser_.reset();
+        decoding_ = false;
+        if (exchange *head = in_flight_.front()) parser_.set_request_method(head->request_.method);
+    }
+
+    void client::connection::handle_connect(int result, uint32_t) {
+        connect_armed_ = false;
+        exchange_queue done;
+        if (state_ == state::closed) {
+            finish(done);
+            return;
+        }
+        if (result < 0) {
+            abort(system_error(result), false, done);
+            close();
+            finish(done);
+            return;
+        }
+
+        state_ = state::ready;
+        start_send();
+        arm_recv();
+        update_timer();
+        finish(done);
+    }
+
+    void client::connection::handle_send(int result, uint32_t) {
+        send_armed_ = false;
+        exchange_queue done;
+        if (state_ == state::closed) {
+            finish(done);
+            return;
+        }
+        if (result <= 0) {
+            // 上流が閉じた (再利用した接続で、まだ何も受信していなければ送り直せる)
+            abort(result < 0 ? system_error(result) : make_error_code(error_code::connection_closed),
+                responses_ > 0 && in_used_ == 0, done);
+            close();
+            finish(done);
+            return;
+        }
+
+        out_sent_ += static_cast<size_t>(result);
+        start_send();
+        finish(done);
+    }
+
+    void client::connection::handle_recv(int result, uint32_t) {
+        recv_armed_ = false;
+        exchange_queue done;
+        if (state_ == state::closed) {
+            finish(done);
+            return;
+        }
+
+        bool eof = result <= 0;
+        if (result > 0) in_used_ += static_cast<size_t>(result);
+        parse_responses(eof, done);
+
+        if (state_ != state::closed) {
+            if (eof) {
+                abort(result < 0 ? system_error(result) : make_error_code(error_code::connection_closed),
+                    responses_ > 0 && in_used_ == 0, done);
+                close();
+            } else if (in_flight_.empty() && in_used_ > 0) {
+                // 要求していないデータ
+                close();
+            } else {
+                arm_recv();
+                update_timer();
+            }
+        }
+        finish(done);
+    }
+
+    void client::connection::parse_responses(bool eof, exchange_queue &done) {
+        size_t start = 0;
+        while (!in_flight_.empty()) {
+            exchange &ex = *in_flight_.front();
+            std::string_view data(in_.data() + start, in_used_ - start);
+            // 何も受信せずに閉じられた場合は呼び出し元が connection_closed として扱う
+            if (data.empty()) break;
+            // ヘッダーは受信バッファの移動・拡張に備えて毎回解析し直す (オフセットで保持しているため再開できる)
+            parse_status status = parser_.parse(data, ex.response_, eof);
+            if (status == parse_status::complete && parser_.body_pending()) {
+                if (!decoding_) {
+                    decoder_.reset_chunked();
+                    decoding_ = true;
+                    body_read_ = body_end_ = parser_.head_size();
+                }
+                status = decode_chunked(in_.data() + start, data.size(), eof);
+                if (status == parse_status::incomplete && body_read_ > body_end_) {
+                    // 復号済みの受信データの跡を詰め、続きを受信する領域を空ける
+                    std::memmove(in_.data() + start + body_end_, in_.data() + start + body_read_, data.size() - body_read_);
+                    in_used_ -= body_read_ - body_end_;
+                    body_read_ = body_end_;
+                }
+            }
+            if (status == parse_status::incomplete) break;
+            if (status == parse_status::error) {
+                abort(error_code::invalid_response, false, done);
+                close();
+                break;
+            }
+
+            size_t used = parser_.consumed();
+            size_t owned = used;
+            if (decoding_) {
+                // 受信データは復号し終えた位置まで使い、詰めたボディまでを複製する
+                ex.response_.body = data.substr(parser_.head_size(), body_end_ - parser_.head_size());
+                used = body_read_;
+                owned = body_end_;
+            }
+            int code = ex.response_.status;
+            bool keep_alive = ex.response_.keep_alive && code != 101;
+            if (code >= 200 || code == 101) {
+                ex.response_.take_ownership(data.substr(0, owned));
+                in_flight_.pop_front();
+                done.push_back(ex);
+                responses_++;
+            }
+            // 1xx の中間レスポンスは読み飛ばし、同じ交換の最終レスポンスを待つ
+            start += used;
+            prepare_parser();
+
+            if (!keep_alive) {
+                // 上流は以降のリクエストを処理しない
+                abort(error_code::connection_closed, true, done);
+                close();
+                break;
+            }
+        }
+
+        if (start > 0) {
+            std::memmove(in_.data(), in_.data() + start, in_used_ - start);
+            in_used_ -= start;
+        }
+    }
+
+    parse_status client::connection::decode_chunked(char *data, size_t size, bool eof) noexcept {
+        size_t head = parser_.head_size();
+        while (true) {
+            size_t consumed = 0;
+            std::string_view piece;
+            auto status = decoder_.decode(std::string_view(data + body_read_, size - body_read_), consumed, piece);
+            body_read_ += consumed;
+            switch (status) {
+            case body_decoder::status::incomplete:
+                // ボディの途中で閉じられた
+                return eof ? parse_status::error : parse_status::incomplete;
+            case body_decoder::status::error:
+                return parse_status::error;
+            case body_decoder::status::data:
+                if (body_end_ - head + piece.size() > options_.limits.max_body_size) return parse_status::error;
+                // 書き込み位置は常に読み込み位置より前にある
+                std::memmove(data + body_end_, piece.data(), piece.size());
+                body_end_ += piece.size();
+                break;
+            case body_decoder::status::done:
+                return parse_status::complete;
+            }
+        }
+    }
+
+    void client::connection::handle_timeout(int, uint32_t) {
+        exchange_queue done;
+        if (state_ == state::closed) return;
+        // 接続・応答待ちのタイムアウト (アイドルなら応答待ちの交換は無い)
+        abort(make_error_code(std::errc::timed_out), false, done);
+        close();
+        finish(done);
+    }
+
+    void client::connection::abort(std::error_code error, bool retry, exchange_queue &done) {
+        while (exchange *ex = in_flight_.pop_front()) {
+            if (retry && !ex->retried_ && idempotent(ex->request_.method)) {
+                ex->retried_ = true;
+                owner_.requeue(*ex);
+            } else {
+                ex->error_ = error;
+                done.push_back(*ex);
+            }
+        }
+    }
+
+    void client::connection::close() noexcept {
+        state_ = state::closed;
+        timer_.cancel();
+        if (connect_armed_) submit_cancel(&connect_op_);
+        if (send_armed_) submit_cancel(&send_op_);
+        if (recv_armed_) submit_cancel(&recv_op_);
+    }
+
+    void client::connection::submit_cancel(task *target) noexcept {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return;
+        // 対象操作は -ECANCELED で完了する。キャンセル自体の完了通知は不要
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uintptr_t>(target);
+        sqe->user_data = 0;
+        ctx_.submit();
+    }
+
+    void client::connection::finish(exchange_queue &done) {
+        upstream &owner = owner_;
+        if (state_ == state::closed && !connect_armed_ && !send_armed_ && !recv_armed_) owner.release(*this);
+        // 空いた接続へ待ち行列の交換を割り当ててから、完了した交換を再開する
+        owner.pump(done);
+        done.resume_all();
+    }
+}
@@ -0,0 +1,66 @@
+#include "ouroboros/http/coro.hpp"
+#include <array>
+#include <new>
+
+namespace ouroboros::http::coro
+{
+    namespace
+    {
+        struct free_frame
+        {
+            free_frame *next;
+        };
+
+        // スレッドごとの空きリスト (大きさのクラスごと)
+        struct frame_lists
+        {
+            std::array<free_frame *, frame_pool::max_pooled_size / frame_pool::granularity> heads{};
+            size_t heap_allocations = 0;
+
+            ~frame_lists() {
+                for (auto *head : heads) {
+                    while (head) {
+                        free_frame *next = head->next;
+                        ::operator delete(head);
+                        head = next;
+                    }
+                }
+            }
+        };
+
+        thread_local frame_lists lists;
+
+        constexpr size_t size_class(size_t size) noexcept {
+            return (size + frame_pool::granularity - 1) / frame_pool::granularity - 1;
+        }
+    }
+
+    void *frame_pool::allocate(size_t size) {
+        if (size > max_pooled_size) {
+            lists.heap_allocations++;
+            return ::operator new(size);
+        }
+        size_t index = size_class(size);
+        if (free_frame *frame = lists.heads[index]) {
+            lists.heads[index] = frame->next;
+            return frame;
+        }
+        lists.heap_allocations++;
+        return ::operator new((index + 1) * granularity);
+    }
+
+    void frame_pool::deallocate(void *frame, size_t size) noexcept {
+        if (size > max_pooled_size) {
+            ::operator delete(frame);
+            return;
+        }
+        size_t index = size_class(size);
+        auto *node = static_cast<free_frame *>(frame);
+        node->next = lists.heads[index];
+        lists.heads[index] = node;
+    }
+
+    size_t frame_pool::heap_allocations() noexcept {
+        return lists.heap_allocations;
+    }
+}
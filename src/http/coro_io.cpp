@@ -0,0 +1,69 @@
+#include "ouroboros/http/coro_io.hpp"
+#include <cerrno>
+
+namespace ouroboros::http::coro
+{
+    operation::operation(io_context &ctx, uint8_t opcode, int fd, uint64_t addr, uint32_t len, uint64_t offset,
+        uint32_t op_flags) noexcept
+        : ctx_(ctx), opcode_(opcode), fd_(fd), addr_(addr), len_(len), offset_(offset), op_flags_(op_flags) {}
+
+    bool operation::await_suspend(std::coroutine_handle<> caller) noexcept {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) {
+            // リングが一杯: 中断せずに失敗を返す
+            result_ = -EBUSY;
+            return false;
+        }
+        sqe->opcode = opcode_;
+        sqe->flags = sqe_flags_;
+        sqe->fd = fd_;
+        sqe->addr = addr_;
+        sqe->len = len_;
+        sqe->off = offset_;
+        // 操作ごとのフラグ (msg_flags / open_flags 等) は共用体の同じ位置にある。型はカーネルのヘッダーにより異なる
+        sqe->rw_flags = static_cast<decltype(sqe->rw_flags)>(op_flags_);
+        sqe->user_data = reinterpret_cast<uintptr_t>(static_cast<http::task *>(this));
+        caller_ = caller;
+        ctx_.submit();
+        return true;
+    }
+
+    void operation::complete(int result, uint32_t flags) {
+        result_ = result;
+        flags_ = flags;
+        caller_.resume();
+    }
+
+    operation recv(io_context &ctx, int fd, std::span<char> buffer, int flags) noexcept {
+        return operation(ctx, IORING_OP_RECV, fd, reinterpret_cast<uintptr_t>(buffer.data()),
+            static_cast<uint32_t>(buffer.size()), 0, static_cast<uint32_t>(flags));
+    }
+
+    operation send(io_context &ctx, int fd, std::span<const char> data, int flags) noexcept {
+        return operation(ctx, IORING_OP_SEND, fd, reinterpret_cast<uintptr_t>(data.data()),
+            static_cast<uint32_t>(data.size()), 0, static_cast<uint32_t>(flags));
+    }
+
+    operation read(io_context &ctx, int fd, std::span<char> buffer, uint64_t offset) noexcept {
+        return operation(ctx, IORING_OP_READ, fd, reinterpret_cast<uintptr_t>(buffer.data()),
+            static_cast<uint32_t>(buffer.size()), offset);
+    }
+
+    operation openat(io_context &ctx, int dirfd, const char *path, int flags, mode_t mode) noexcept {
+        return operation(ctx, IORING_OP_OPENAT, dirfd, reinterpret_cast<uintptr_t>(path), mode, 0,
+            static_cast<uint32_t>(flags));
+    }
+
+    operation close(io_context &ctx, int fd) noexcept {
+        return operation(ctx, IORING_OP_CLOSE, fd, 0, 0, 0);
+    }
+
+    void delay::await_suspend(std::coroutine_handle<> caller) noexcept {
+        caller_ = caller;
+        ctx_.timers().arm(timer_, duration_);
+    }
+
+    void delay::complete(int, uint32_t) {
+        caller_.resume();
+    }
+}
@@ -17,6 +17,11 @@ namespace ouroboros::http
             case error_code::socket_option_failed:   return "Setting socket option failed";
             case error_code::bind_failed:            return "Socket bind failed";
             case error_code::listen_failed:          return "Socket listen failed";
+            case error_code::buffer_registration_failed: return "Buffer ring registration failed";
+            case error_code::file_registration_failed:   return "Fixed file table registration failed";
+            case error_code::address_resolution_failed:  return "Upstream address resolution failed";
+            case error_code::invalid_response:           return "Invalid upstream response";
+            case error_code::connection_closed:          return "Upstream closed the connection";
             default:                           return "Unknown Ouroboros error";
             }
         }
@@ -0,0 +1,63 @@
+#include "ouroboros/http/file_cache.hpp"
+#include <charconv>
+#include <cstring>
+
+namespace ouroboros::http
+{
+    void open_file::make_etag() noexcept {
+        char *p = etag_text;
+        char *end = etag_text + sizeof(etag_text);
+        *p++ = '"';
+        p = std::to_chars(p, end, static_cast<uint64_t>(mtime_sec), 16).ptr;
+        *p++ = '.';
+        p = std::to_chars(p, end, mtime_nsec, 16).ptr;
+        *p++ = '-';
+        p = std::to_chars(p, end, size, 16).ptr;
+        *p++ = '"';
+        etag_length = static_cast<uint8_t>(p - etag_text);
+    }
+
+    file_cache::file_cache(size_t capacity, std::chrono::milliseconds revalidate_after)
+        : capacity_(capacity), revalidate_after_(revalidate_after) {
+        index_.reserve(capacity);
+    }
+
+    std::string_view file_cache::make_key(int dirfd, std::string_view path) {
+        key_buffer_.resize(sizeof(dirfd) + path.size());
+        std::memcpy(key_buffer_.data(), &dirfd, sizeof(dirfd));
+        std::memcpy(key_buffer_.data() + sizeof(dirfd), path.data(), path.size());
+        return key_buffer_;
+    }
+
+    std::shared_ptr<const open_file> file_cache::find(int dirfd, std::string_view path) {
+        auto found = index_.find(make_key(dirfd, path));
+        if (found == index_.end()) {
+            misses_++;
+            return nullptr;
+        }
+        auto it = found->second;
+        if (std::chrono::steady_clock::now() - it->file->opened_at > revalidate_after_) {
+            // 古いエントリは開き直す (送信中のセッションが持つ参照は有効なまま)
+            erase(it);
+            misses_++;
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it);
+        hits_++;
+        return it->file;
+    }
+
+    void file_cache::insert(int dirfd, std::string_view path, std::shared_ptr<const open_file> file) {
+        if (capacity_ == 0) return;
+        if (auto found = index_.find(make_key(dirfd, path)); found != index_.end()) erase(found->second);
+        while (lru_.size() >= capacity_) erase(std::prev(lru_.end()));
+
+        lru_.push_front({ std::string(key_buffer_), std::move(file) });
+        index_.emplace(lru_.front().key, lru_.begin());
+    }
+
+    void file_cache::erase(std::list<entry>::iterator it) {
+        index_.erase(it->key);
+        lru_.erase(it);
+    }
+}
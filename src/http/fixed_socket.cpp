@@ -0,0 +1,22 @@
+#include "ouroboros/http/fixed_socket.hpp"
+
+namespace ouroboros::http
+{
+    void fixed_socket::reset() noexcept {
+        if (slot_ < 0) return;
+
+        auto *sqe = ctx_->get_sqe();
+        if (sqe) {
+            // IORING_OP_CLOSE: file_index にスロット番号+1 を指定するとダイレクトディスクリプタを閉じる
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = 0;
+            sqe->file_index = static_cast<uint32_t>(slot_) + 1;
+            sqe->user_data = 0; // 完了通知は不要
+            ctx_->submit();
+        } else {
+            // SQ が一杯の場合は同期的にテーブルから外す
+            ctx_->update_fixed_file(static_cast<unsigned>(slot_), -1);
+        }
+        slot_ = -1;
+    }
+}
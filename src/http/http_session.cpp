@@ -1,205 +1,1825 @@
 #include "ouroboros/http/http_session.hpp"
 #include "ouroboros/http/server.hpp"
+#include "ouroboros/http/response_writer.hpp"
+#include "ouroboros/http/static_files.hpp"
+#include "ouroboros/http/reverse_proxy.hpp"
+#include "ouroboros/http/websocket.hpp"
 #include <iostream>
+#include <algorithm>
+#include <charconv>
 #include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 #include <linux/io_uring.h>
 #include <cerrno>
-#include <algorithm>
-#include <cctype>
-#include <sstream>
 #include <string_view>
+#include <memory>
+#include <utility>
 
 namespace ouroboros::http
 {
-    constexpr size_t BUFFER_SIZE = 8192;
-
-    http_session::http_session(server& svr, io_context &ctx, unique_socket socket)
-        : server_(svr), ctx_(ctx), socket_(std::move(socket)), buffer_(BUFFER_SIZE) {}
+    http_session::http_session(server& svr, io_context &ctx)
+        : server_(svr), ctx_(ctx), multishot_(svr.options().multishot_recv), parser_(svr.options().limits),
+        arena_(svr.arena_blocks(), &svr.arena_upstream()), response_(arena_.resource()) {}
 
     http_session::~http_session() {
-        if (socket_.native_handle() != -1) {
-             std::cout << "Session closing. FD: " << socket_.native_handle() << std::endl;
+        for (const auto &chunk : backlog_) server_.buffers().recycle(chunk.bid);
+    }
+
+    void http_session::start(unique_socket socket) {
+        socket_ = std::move(socket);
+        submit_recv();
+        update_timeout();
+    }
+
+    void http_session::start(fixed_socket socket) {
+        fixed_socket_ = std::move(socket);
+        submit_recv();
+        update_timeout();
+    }
+
+    void http_session::reset() noexcept {
+        multishot_ = server_.options().multishot_recv;
+        recv_armed_ = false;
+        writing_ = false;
+        send_armed_ = false;
+        peer_closed_ = false;
+        closing_ = false;
+        timer_.cancel();
+        recv_retry_.cancel();
+        timeout_phase_ = timeout_phase::none;
+        served_ = false;
+        parser_.reset();
+        staging_.clear();
+        out_.clear();
+        out_sent_ = 0;
+        if (out_.capacity() > max_retained_out_capacity) out_.shrink_to_fit();
+        if (send_buffer_ != no_send_buffer) server_.send_buffers().release(send_buffer_);
+        send_buffer_ = no_send_buffer;
+        send_buffer_used_ = 0;
+        send_buffer_sent_ = 0;
+        sending_send_buffer_ = false;
+        zero_copy_notifs_ = 0;
+        paused_ = false;
+        handler_stage_ = handler_stage::none;
+        handler_ = {};
+        file_stage_ = file_stage::none;
+        file_.reset();
+        opening_fd_ = unique_socket();
+        if (pipe_fill_ > 0) {
+            // 送り切れなかったデータは捨てられないため、パイプごと作り直す
+            pipe_read_ = unique_socket();
+            pipe_write_ = unique_socket();
+            pipe_fill_ = 0;
+        }
+        proxy_stage_ = proxy_stage::none;
+        proxy_status_ = 0;
+        proxy_remaining_ = 0;
+        proxy_until_close_ = false;
+        proxy_dechunk_ = false;
+        stream_stage_ = stream_stage::none;
+        stream_producer_ = nullptr;
+        stream_async_producer_ = nullptr;
+        stream_task_ = {};
+        stream_buf_.clear();
+        if (stream_buf_.capacity() > max_retained_out_capacity) stream_buf_.shrink_to_fit();
+        body_stage_ = body_stage::none;
+        body_sink_ = nullptr;
+        body_received_ = 0;
+        spill_busy_ = false;
+        spill_directory_ = nullptr;
+        spill_threshold_ = 0;
+        websocket_ = nullptr;
+        recycle_response();
+    }
+
+    void http_session::recycle_response() noexcept {
+        // リクエストボディ (一時ファイル) はレスポンスを書き終えた時点で不要
+        if (body_stage_ == body_stage::none) release_body();
+        // アリーナ上の領域を参照するオブジェクトを先に破棄し、ブロックを次のリクエストへ返す
+        // (待機中の接続はブロックを持たない)
+        std::destroy_at(&response_);
+        arena_.reset();
+        std::construct_at(&response_, arena_.resource());
+    }
+
+    void http_session::prepare_socket_io(io_uring_sqe *sqe) const noexcept {
+        if (fixed_socket_) {
+            // ダイレクトディスクリプタ: fd は固定ファイルテーブルのスロット番号
+            sqe->fd = fixed_socket_.native_handle();
+            sqe->flags |= IOSQE_FIXED_FILE;
         } else {
-             std::cout << "Session closed." << std::endl;
+            sqe->fd = socket_.native_handle();
         }
     }
 
-    void http_session::start() {
-        submit_recv();
+    size_t http_session::process(std::string_view data) {
+        size_t offset = 0;
+        while (!closing_) {
+            if (response_pending()) {
+                // ファイルの送信・コルーチンハンドラが終わるまで後続のリクエストは処理しない
+                // (残りは呼び出し元が staging_ へ退避する)
+                paused_ = true;
+                return offset;
+            }
+            if (body_stage_ == body_stage::receiving) {
+                // ボディの続き (受け取り先へ渡すため、staging_ には退避しない)
+                offset += read_body(data.substr(offset));
+                if (offset == data.size()) return offset;
+                continue;
+            }
+            switch (parser_.parse(data.substr(offset), request_)) {
+            case parse_status::incomplete:
+                // 末尾のリクエストは続きを待つ (パーサーの状態は保持する)
+                return offset;
+            case parse_status::error:
+                send_error(parser_.error_status());
+                return data.size();
+            case parse_status::complete:
+                if (parser_.body_pending() || !request_.body.empty()) {
+                    // 揃っているボディも、上限を超える・受け取り先やファイルへ渡す場合はボディとして読み直す
+                    const body_options *options = route_body_options();
+                    size_t size = request_.body.size();
+                    size_t limit = options && options->max_size ? options->max_size : parser_.limits().max_body_size;
+                    if (parser_.body_pending() || size > limit ||
+                        (options && (options->on_body || (options->spill_threshold && size > options->spill_threshold)))) {
+                        size_t head = parser_.consumed() - size;
+                        request_raw_ = data.substr(offset, head);
+                        begin_body(options);
+                        offset += head;
+                        parser_.reset();
+                        break;
+                    }
+                }
+                request_raw_ = data.substr(offset, parser_.consumed());
+                handle_request();
+                offset += parser_.consumed();
+                parser_.reset();
+                break;
+            }
+        }
+        // 接続を閉じる場合、以降のリクエストは処理しない
+        return data.size();
+    }
+
+    void http_session::send_error(int status) {
+        closing_ = true;
+        response_.set_status_code(status);
+        write_response(out_, response_, false, true);
+        recycle_response();
     }
 
     void http_session::handle_request() {
-        std::string_view received_data(buffer_.data(), buffer_.size());
+        const request &req = request_;
+        if (!req.keep_alive) closing_ = true;
+        served_ = true;
+
+        // キャッシュ済みのレスポンスはハンドラを呼ばずにそのまま返す
+        bool omit_body = req.method == method::HEAD;
+        if ((req.method == method::GET || omit_body) && !server_.responses().empty()) {
+            if (out_.capacity() < initial_out_capacity) out_.reserve(initial_out_capacity);
+            if (server_.responses().write(req.target, out_, omit_body, closing_)) return;
+        }
+
+        response &res = response_;
+        route_cache_ = nullptr;
+        try {
+            // HEAD は GET と同じハンドラで処理し、ボディだけを省く
+            bool handled = dispatch(req.method, res) || (req.method == method::HEAD && dispatch(method::GET, res));
+            if (!handled) {
+                if (std::string allow = server_.allowed_methods(req.path); !allow.empty()) {
+                    // パスは存在するがメソッドが異なる
+                    res.set_status_code(405);
+                    res.set_header("Allow", allow);
+                    res.set_body("Method Not Allowed");
+                } else {
+                    res.set_status_code(404);
+                    res.set_body("Not Found");
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Handler exception: " << e.what() << std::endl;
+            res.clear();
+            res.set_status_code(500);
+            res.set_body("Internal Server Error");
+            route_cache_ = nullptr;
+        }
+
+        // コルーチンハンドラが中断した: 完了後に handle_handler() がレスポンスを書く
+        if (handler_stage_ == handler_stage::running) return;
+        finish_response();
+    }
 
-        // Basic HTTP/1.x request line parsing: "METHOD /path HTTP/1.x\r\n"
-        size_t method_end = received_data.find(' ');
-        if (method_end == std::string_view::npos) {
-            submit_send("HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n");
-            keep_alive_ = false;
+    void http_session::finish_response() {
+        const request &req = request_;
+        response &res = response_;
+        bool omit_body = req.method == method::HEAD;
+
+        if (res.has_websocket()) {
+            // 101 を送った後、ソケットごと websocket_session へ引き継ぐ
+            start_websocket();
+            return;
+        }
+
+        if (res.has_stream()) {
+            // ボディは送信の完了に合わせて生成する (全体を持たないため、キャッシュには保持しない)
+            start_stream();
             return;
         }
-        size_t path_end = received_data.find(' ', method_end + 1);
-        if (path_end == std::string_view::npos) {
-            submit_send("HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n");
-            keep_alive_ = false;
+
+        if (res.has_proxy()) {
+            // 上流へ転送する (レスポンスは上流から受け取るため、キャッシュには保持しない)
+            start_proxy();
             return;
         }
 
-        std::string method_str(received_data.substr(0, method_end));
-        std::string path_str(received_data.substr(method_end + 1, path_end - (method_end + 1)));
+        if (route_cache_ && *route_cache_) {
+            server_.responses().store(req.target, res, *route_cache_, route_cache_generation_);
+        }
 
-        method method_enum;
-        if (method_str == "GET") method_enum = method::GET;
-        else if (method_str == "POST") method_enum = method::POST;
-        else {
-            submit_send("HTTP/1.1 501 Not Implemented\r\nConnection: close\r\n\r\n");
-            keep_alive_ = false;
+        if (res.has_file() && res.status_code() == 200) {
+            // ファイルは非同期に開いて送る (レスポンスはヘッダーを書くまで保持する)
+            start_file();
             return;
         }
 
-        request req;
-        req.method = method_enum;
-        req.path = path_str;
-        // A full parser would extract headers and body here.
+        // 送信はバッファ内の全リクエストを処理した後にまとめて行う
+        // HEAD にはボディを付けない (Content-Length は GET と同じ値)
+        if (!write_to_send_buffer(res, omit_body)) {
+            if (out_.capacity() < initial_out_capacity) out_.reserve(initial_out_capacity);
+            write_response(out_, res, omit_body, closing_);
+        }
+        // レスポンスは out_ へコピー済みなので、アリーナ上のものは全て不要
+        recycle_response();
+    }
 
-        auto handler_opt = server_.find_handler(req.method, req.path);
+    void http_session::start_stream() {
+        const request &req = request_;
+        response &res = response_;
+        stream_sized_ = res.has_content_length();
+        stream_remaining_ = stream_sized_ ? res.content_length() : 0;
+        // HTTP/1.0 は chunked を解釈できないため、接続を閉じてボディの終わりを伝える
+        if (!stream_sized_ && req.version_minor == 0) closing_ = true;
+        stream_chunked_ = !stream_sized_ && !closing_;
 
-        response res;
-        if (handler_opt) {
+        // ヘッダーだけを書く (ボディの長さの扱いは write_response() が has_stream() から決める)
+        if (out_.capacity() < initial_out_capacity) out_.reserve(initial_out_capacity);
+        write_response(out_, res, true, closing_);
+
+        int status = res.status_code();
+        bool bodiless = req.method == method::HEAD || status < 200 || status == 204 || status == 304;
+        if (!bodiless) {
+            stream_producer_ = std::move(res.producer());
+            stream_async_producer_ = std::move(res.async_producer());
+        }
+        recycle_response();
+        if (bodiless) return;
+
+        // 最初の部分はヘッダーと同じ送信にまとめる
+        stream_stage_ = stream_stage::idle;
+        advance_stream();
+    }
+
+    void http_session::advance_stream() {
+        const size_t chunk_size = server_.options().stream_chunk_size;
+        const bool async = static_cast<bool>(stream_async_producer_);
+
+        while (stream_busy() && is_open()) {
+            // 同期の生成器の小さな部分はチャンクの大きさまでまとめて送る。
+            // 非同期の生成器 (フィード等) は生成した分をすぐに送る
+            bool ready = stream_stage_ == stream_stage::finished ||
+                         (stream_stage_ == stream_stage::idle && !stream_buf_.empty() &&
+                          (async || stream_buf_.size() >= chunk_size));
+            if (ready && !writing_) {
+                write_stream_chunk();
+                if (!is_open()) return;
+                if (has_unsent()) submit_send();
+                continue;
+            }
+            // 送信中の分に加えて1チャンク分を生成したら、送信の完了を待つ (受信の遅いクライアントへの背圧)
+            if (stream_stage_ != stream_stage::idle || stream_buf_.size() >= chunk_size) return;
+            if (!produce_stream()) return;
+        }
+    }
+
+    bool http_session::produce_stream() {
+        size_t before = stream_buf_.size();
+        if (stream_producer_) {
+            bool more;
             try {
-                (*handler_opt)(req, res);
-            } catch (const std::exception& e) {
-                std::cerr << "Handler exception: " << e.what() << std::endl;
-                res = response();
-                res.set_status_code(500);
-                res.set_body("Internal Server Error");
-            }
-        } else {
-            res.set_status_code(404);
-            res.set_body("Not Found");
-        }
-        
-        const std::string_view conn_hdr("connection:");
-        auto it = std::search(received_data.begin(), received_data.end(), conn_hdr.begin(), conn_hdr.end(),
-            [](char a, char b){ return std::tolower(static_cast<unsigned char>(a)) == static_cast<unsigned char>(b); });
-        
-        keep_alive_ = true; // Default for HTTP/1.1
-        if (it != received_data.end()) {
-            std::string_view conn_val(it + conn_hdr.length());
-            conn_val = conn_val.substr(conn_val.find_first_not_of(" \t"));
-            conn_val = conn_val.substr(0, conn_val.find("\r\n"));
-            if (conn_val.length() >= 5 && std::equal(conn_val.begin(), conn_val.begin() + 5, "close", 
-                [](char a, char b){ return std::tolower(static_cast<unsigned char>(a)) == static_cast<unsigned char>(b); })) {
-                keep_alive_ = false;
-            }
-        }
-
-        std::stringstream ss;
-        ss << "HTTP/1.1 " << res.status_code() << " ";
-        switch(res.status_code()) {
-            case 200: ss << "OK"; break;
-            case 400: ss << "Bad Request"; break;
-            case 404: ss << "Not Found"; break;
-            case 500: ss << "Internal Server Error"; break;
-            case 501: ss << "Not Implemented"; break;
-            default: ss << "OK"; break;
-        }
-        ss << "\r\n";
-        ss << "Content-Length: " << res.body().length() << "\r\n";
-        ss << "Connection: " << (keep_alive_ ? "keep-alive" : "close") << "\r\n";
-        for(const auto& [key, val] : res.headers()) {
-            ss << key << ": " << val << "\r\n";
-        }
-        ss << "\r\n";
-        ss << res.body();
-        
-        static thread_local std::string response_buffer;
-        response_buffer = ss.str();
-        submit_send(response_buffer);
+                more = stream_producer_(stream_buf_);
+            } catch (const std::exception &e) {
+                std::cerr << "Stream producer exception: " << e.what() << std::endl;
+                finish_stream(true);
+                return false;
+            }
+            if (!more) {
+                stream_stage_ = stream_stage::finished;
+            } else if (stream_buf_.size() == before) {
+                // 何も返さずに続きがあると答え続けると、この接続のループから戻れなくなる
+                std::cerr << "Stream producer returned no data." << std::endl;
+                finish_stream(true);
+                return false;
+            }
+            return true;
+        }
+
+        try {
+            stream_task_ = stream_async_producer_(stream_buf_);
+        } catch (const std::exception &e) {
+            std::cerr << "Stream producer exception: " << e.what() << std::endl;
+            finish_stream(true);
+            return false;
+        }
+        stream_task_.start(stream_op_);
+        if (!stream_task_.done()) {
+            // 中断した: 完了後に handle_stream() が続きを行う (stream_buf_ はそれまで変更しない)
+            stream_stage_ = stream_stage::producing;
+            pending_ops_++;
+            return false;
+        }
+        // 中断せずに完了した
+        if (!finish_produce()) return false;
+        if (stream_stage_ == stream_stage::idle && stream_buf_.size() == before) {
+            std::cerr << "Stream producer returned no data." << std::endl;
+            finish_stream(true);
+            return false;
+        }
+        return true;
     }
 
-    void http_session::submit_recv() {
+    bool http_session::finish_produce() {
+        stream_stage_ = stream_stage::idle;
+        coro::task<bool> done = std::move(stream_task_);
+        try {
+            if (!done.get()) stream_stage_ = stream_stage::finished;
+        } catch (const std::exception &e) {
+            std::cerr << "Stream producer exception: " << e.what() << std::endl;
+            finish_stream(true);
+            return false;
+        }
+        return true;
+    }
+
+    void http_session::handle_stream(int, uint32_t) {
+        // 開始中に完了した場合は produce_stream() が結果を受け取る
+        if (stream_stage_ != stream_stage::producing) return;
+        pending_ops_--;
+
+        if (!is_open()) {
+            // 接続は閉じられている: 生成したデータは捨てる
+            stream_task_ = {};
+            finish_stream(false);
+            finish_if_done();
+            return;
+        }
+        // 送信中であれば、生成した分は送信完了後に complete_write() が送る
+        if (finish_produce()) advance_stream();
+        resume_requests();
+        flush();
+        finish_if_done();
+    }
+
+    void http_session::write_stream_chunk() {
+        bool last = stream_stage_ == stream_stage::finished;
+        size_t size = stream_buf_.size();
+
+        if (stream_sized_) {
+            // 指定された Content-Length と合わなければ、送信済みの部分と矛盾するため閉じる
+            if (size > stream_remaining_ || (last && size != stream_remaining_)) {
+                std::cerr << "Stream body does not match Content-Length." << std::endl;
+                finish_stream(true);
+                return;
+            }
+            stream_remaining_ -= size;
+            out_.append(stream_buf_);
+        } else if (stream_chunked_) {
+            // "<16進の長さ>\r\n<データ>\r\n" ... "0\r\n\r\n"
+            if (size > 0) {
+                char digits[16];
+                auto end = std::to_chars(digits, digits + sizeof(digits), size, 16).ptr;
+                out_.append(digits, static_cast<size_t>(end - digits));
+                out_.append("\r\n");
+                out_.append(stream_buf_);
+                out_.append("\r\n");
+            }
+            if (last) out_.append("0\r\n\r\n");
+        } else {
+            // 接続の終わりまでのボディ (closing_ のため送信後に閉じる)
+            out_.append(stream_buf_);
+        }
+        stream_buf_.clear();
+
+        if (last) finish_stream(false);
+    }
+
+    void http_session::finish_stream(bool abort) {
+        stream_stage_ = stream_stage::none;
+        stream_producer_ = nullptr;
+        stream_async_producer_ = nullptr;
+        stream_buf_.clear();
+        if (stream_buf_.capacity() > max_retained_out_capacity) stream_buf_.shrink_to_fit();
+
+        if (abort && is_open()) close_socket();
+    }
+
+    void http_session::start_websocket() {
+        response &res = response_;
+        // Connection: close のリクエストはアップグレードできない
+        websocket_session *ws = closing_ ? nullptr : server_.websockets().acquire(server_, ctx_);
+        if (!ws) {
+            int status = closing_ ? 400 : 503;
+            res.clear();
+            res.set_status_code(status);
+            res.set_body(status == 400 ? "Bad Request" : "Service Unavailable");
+            write_response(out_, res, false, closing_);
+            recycle_response();
+            return;
+        }
+
+        // on_open で送ったメッセージは 101 の後に送られる (それまで ws のキューに積まれる)
+        ws->open(*res.websocket(), request_);
+        out_ += "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n";
+        for (const auto &h : res.headers()) {
+            out_ += h.name;
+            out_ += ": ";
+            out_ += h.value;
+            out_ += "\r\n";
+        }
+        out_ += "\r\n";
+        recycle_response();
+        websocket_ = ws;
+
+        // マルチショット受信を止める (取り消しまでに届いたデータは backlog_ に積まれ、フレームとして引き継ぐ)
+        if (recv_armed_) submit_cancel(&recv_op_);
+    }
+
+    void http_session::hand_off_websocket() {
+        // 101 の後に届いていたデータ (staging_ の残りと backlog_) を順に渡す
+        for (const auto &chunk : backlog_) {
+            std::string_view data = server_.buffers().view(chunk.bid, chunk.length);
+            staging_.insert(staging_.end(), data.begin(), data.end());
+            server_.buffers().recycle(chunk.bid);
+        }
+        backlog_.clear();
+
+        websocket_session *ws = std::exchange(websocket_, nullptr);
+        timer_.cancel();
+        timeout_phase_ = timeout_phase::none;
+        if (server_.options().log_connections) std::cout << "Upgraded to WebSocket." << std::endl;
+
+        // ソケットを渡すとこのセッションは閉じた状態になり、呼び出し元の finish_if_done() でプールへ戻る
+        std::string_view received(staging_.data(), staging_.size());
+        if (fixed_socket_) {
+            ws->start(std::move(fixed_socket_), received);
+        } else {
+            ws->start(std::move(socket_), received);
+        }
+        staging_.clear();
+        paused_ = false;
+    }
+
+    bool http_session::write_to_send_buffer(const response &res, bool omit_body) {
+        if (!server_.zero_copy()) return false;
+        send_buffer_pool &pool = server_.send_buffers();
+        size_t size = response_size(res, omit_body, closing_);
+
+        if (send_buffer_ == no_send_buffer) {
+            // 小さなレスポンスはコピーの方が速い
+            if (size < server_.options().zero_copy_threshold) return false;
+            // 先に積まれたレスポンスも移して送信順を保つ (送信中はここに来ないため out_ は未送信分のみ)
+            if (out_.size() + size > pool.buffer_size()) return false;
+            auto index = pool.acquire();
+            if (!index) return false;
+            send_buffer_ = *index;
+            std::memcpy(pool.data(send_buffer_), out_.data(), out_.size());
+            send_buffer_used_ = out_.size();
+            out_.clear();
+        } else if (!out_.empty() || send_buffer_used_ + size > pool.buffer_size()) {
+            // 収まらなければ以降は out_ に積む (送信バッファの後に送信される)
+            return false;
+        }
+
+        char *end = write_response(pool.data(send_buffer_) + send_buffer_used_, res, omit_body, closing_);
+        send_buffer_used_ = static_cast<size_t>(end - pool.data(send_buffer_));
+        return true;
+    }
+
+    namespace
+    {
+        // OPENAT2 の失敗をステータスコードにする
+        int open_error_status(int error) noexcept {
+            switch (error) {
+            case ENOENT:
+            case ENOTDIR:
+            case ENAMETOOLONG:
+            case ELOOP:  // シンボリックリンクの解決に失敗
+            case EXDEV:  // RESOLVE_BENEATH: ルートの外を指している
+                return 404;
+            case EACCES:
+            case EPERM:
+                return 403;
+            default:
+                return 500;
+            }
+        }
+
+        std::string_view status_body(int status) noexcept {
+            switch (status) {
+            case 403: return "Forbidden";
+            case 404: return "Not Found";
+            case 502: return "Bad Gateway";
+            case 503: return "Service Unavailable";
+            case 504: return "Gateway Timeout";
+            default: return "Internal Server Error";
+            }
+        }
+    }
+
+    void http_session::start_file() {
+        const request &req = request_;
+
+        // 条件付きリクエストのヘッダーは受信バッファへのビューのため、アリーナへ複製しておく
+        auto stash = [this](std::string_view value) -> std::string_view {
+            if (value.empty()) return {};
+            auto *p = static_cast<char *>(arena_.resource()->allocate(value.size(), 1));
+            std::memcpy(p, value.data(), value.size());
+            return { p, value.size() };
+        };
+        file_omit_body_ = req.method == method::HEAD;
+        file_if_none_match_ = stash(req.header("If-None-Match"));
+        file_range_ = req.method == method::GET ? stash(req.header("Range")) : std::string_view{};
+        file_if_range_ = stash(req.header("If-Range"));
+        file_status_ = 200;
+
+        // process() の中から呼ばれるため送信中ではなく、その場でヘッダーを書ける
+        file_ = server_.files().find(response_.file_dirfd(), response_.file_path());
+        if (!file_) {
+            file_stage_ = file_stage::opening;
+            if (submit_file_open()) return;
+            file_status_ = 503;
+        }
+        file_stage_ = file_stage::ready;
+        write_file_response();
+    }
+
+    bool http_session::submit_file_open() {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return false;
+        pending_ops_++;
+
+        // ルートの外 (".." や絶対パス、外を指すシンボリックリンク) へは解決させない
+        open_how_ = {};
+        open_how_.flags = O_RDONLY | O_CLOEXEC;
+        open_how_.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+
+        sqe->opcode = IORING_OP_OPENAT2;
+        sqe->fd = response_.file_dirfd();
+        sqe->addr = (uint64_t)response_.file_path();
+        sqe->len = sizeof(open_how_);
+        sqe->off = (uint64_t)&open_how_;
+        sqe->user_data = (uint64_t)&file_op_;
+
+        ctx_.submit();
+        return true;
+    }
+
+    bool http_session::submit_file_stat() {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return false;
+        pending_ops_++;
+
+        // 開いた fd 自体を調べる (パスを再度解決しない)
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = opening_fd_.native_handle();
+        sqe->addr = (uint64_t)"";
+        sqe->statx_flags = AT_EMPTY_PATH;
+        sqe->len = STATX_TYPE | STATX_SIZE | STATX_MTIME;
+        sqe->off = (uint64_t)&statx_;
+        sqe->user_data = (uint64_t)&file_op_;
+
+        ctx_.submit();
+        return true;
+    }
+
+    void http_session::handle_file(int result, uint32_t) {
+        pending_ops_--;
+
+        if (!is_open()) {
+            // 接続が閉じられた (close_socket() がキャンセルした)
+            if (file_stage_ == file_stage::opening && result >= 0) ::close(result);
+            finish_file(true);
+            finish_if_done();
+            return;
+        }
+
+        switch (file_stage_) {
+        case file_stage::opening:
+            if (result < 0) {
+                file_opened(open_error_status(-result));
+                break;
+            }
+            opening_fd_ = unique_socket(result);
+            file_stage_ = file_stage::stat;
+            if (!submit_file_stat()) {
+                opening_fd_ = unique_socket();
+                file_opened(503);
+            }
+            break;
+
+        case file_stage::stat: {
+            if (result < 0 || !S_ISREG(statx_.stx_mode)) {
+                // ディレクトリ等は配信しない
+                opening_fd_ = unique_socket();
+                file_opened(result < 0 ? 500 : 404);
+                break;
+            }
+            auto file = std::make_shared<open_file>();
+            file->fd = std::move(opening_fd_);
+            file->size = statx_.stx_size;
+            file->mtime_sec = statx_.stx_mtime.tv_sec;
+            file->mtime_nsec = statx_.stx_mtime.tv_nsec;
+            file->opened_at = std::chrono::steady_clock::now();
+            file->make_etag();
+            server_.files().insert(response_.file_dirfd(), response_.file_path(), file);
+            file_ = std::move(file);
+            file_opened(200);
+            break;
+        }
+
+        case file_stage::splice_in:
+            if (result <= 0) {
+                // 読み込みエラー、またはファイルが縮んだ: 送信済みの Content-Length と合わないため閉じる
+                finish_file(true);
+                break;
+            }
+            pipe_fill_ += static_cast<size_t>(result);
+            file_offset_ += static_cast<uint64_t>(result);
+            file_remaining_ -= static_cast<uint64_t>(result);
+            submit_splice_out();
+            break;
+
+        case file_stage::splice_out:
+            if (result <= 0) {
+                finish_file(true);
+                break;
+            }
+            pipe_fill_ -= static_cast<size_t>(result);
+            update_timeout(); // 送信が進んだ
+            if (pipe_fill_ > 0) {
+                submit_splice_out();
+            } else if (file_remaining_ > 0) {
+                submit_splice_in();
+            } else {
+                finish_file(false);
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        finish_if_done();
+    }
+
+    void http_session::file_opened(int status) {
+        file_status_ = status;
+        file_stage_ = file_stage::ready;
+        // 前のレスポンスを送信中であれば、送信完了後に complete_write() が書く (out_ を変更できないため)
+        if (writing_) return;
+        write_file_response();
+        resume_requests();
+        flush();
+    }
+
+    void http_session::write_file_response() {
+        response &res = response_;
+        uint64_t begin = 0;
+        uint64_t length = 0;
+
+        if (!file_) {
+            res.clear();
+            res.set_status_code(file_status_);
+            res.set_body(status_body(file_status_));
+        } else {
+            res.set_header("ETag", file_->etag());
+            res.set_header("Accept-Ranges", "bytes");
+            length = file_->size;
+
+            char range[64];
+            if (!file_if_none_match_.empty() && etag_matches(file_if_none_match_, file_->etag())) {
+                res.set_status_code(304);
+                length = 0;
+            } else if (!file_range_.empty() && (file_if_range_.empty() || file_if_range_ == file_->etag())) {
+                // If-Range が現在の ETag と異なれば Range を無視して全体を返す
+                switch (parse_range(file_range_, file_->size, begin, length)) {
+                case range_status::satisfiable: {
+                    // "bytes <first>-<last>/<size>"
+                    char *p = std::copy_n("bytes ", 6, range);
+                    p = std::to_chars(p, range + sizeof(range), begin).ptr;
+                    *p++ = '-';
+                    p = std::to_chars(p, range + sizeof(range), begin + length - 1).ptr;
+                    *p++ = '/';
+                    p = std::to_chars(p, range + sizeof(range), file_->size).ptr;
+                    res.set_status_code(206);
+                    res.set_header("Content-Range", std::string_view(range, static_cast<size_t>(p - range)));
+                    break;
+                }
+                case range_status::unsatisfiable: {
+                    char *p = std::copy_n("bytes */", 8, range);
+                    p = std::to_chars(p, range + sizeof(range), file_->size).ptr;
+                    res.set_status_code(416);
+                    res.set_header("Content-Range", std::string_view(range, static_cast<size_t>(p - range)));
+                    length = 0;
+                    break;
+                }
+                case range_status::none:
+                    break;
+                }
+            }
+            res.set_content_length(length);
+        }
+
+        if (out_.capacity() < initial_out_capacity) out_.reserve(initial_out_capacity);
+        write_response(out_, res, file_omit_body_, closing_);
+        recycle_response();
+
+        file_offset_ = begin;
+        file_remaining_ = file_omit_body_ ? 0 : length;
+        if (file_remaining_ > 0) {
+            // ボディはヘッダーを送り終えてから送る (complete_write())
+            file_stage_ = file_stage::headers;
+        } else {
+            file_.reset();
+            file_stage_ = file_stage::none;
+        }
+    }
+
+    bool http_session::open_pipe() {
+        if (pipe_write_) return true;
+        int fds[2];
+        if (::pipe2(fds, O_CLOEXEC) < 0) return false;
+        pipe_read_ = unique_socket(fds[0]);
+        pipe_write_ = unique_socket(fds[1]);
+        // 大きくできなければ既定の大きさ (通常 64KiB) のまま使う
+        int size = ::fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(server_.options().file_pipe_size));
+        if (size < 0) size = ::fcntl(fds[1], F_GETPIPE_SZ);
+        pipe_capacity_ = size > 0 ? static_cast<size_t>(size) : 64 * 1024;
+        return true;
+    }
+
+    void http_session::submit_splice_in() {
+        if (!open_pipe()) {
+            finish_file(true);
+            return;
+        }
+
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) {
+            finish_file(true);
+            return;
+        }
         pending_ops_++;
-        current_state_ = state::reading;
+        file_stage_ = file_stage::splice_in;
+
+        // ファイル -> パイプ (ページキャッシュのページを参照するだけでコピーしない)
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->splice_fd_in = file_->fd.native_handle();
+        sqe->splice_off_in = file_offset_;
+        sqe->fd = pipe_write_.native_handle();
+        sqe->off = (uint64_t)-1; // パイプにオフセットは無い
+        sqe->len = static_cast<uint32_t>(std::min<uint64_t>(file_remaining_, pipe_capacity_));
+        sqe->user_data = (uint64_t)&file_op_;
+
+        ctx_.submit();
+    }
 
+    void http_session::submit_splice_out() {
         auto *sqe = ctx_.get_sqe();
         if (!sqe) {
-            pending_ops_--;
-            socket_ = unique_socket();
-            if (pending_ops_ == 0) delete this;
+            finish_file(true);
             return;
         }
+        pending_ops_++;
+        file_stage_ = file_stage::splice_out;
+
+        // パイプ -> ソケット (IOSQE_FIXED_FILE は出力側の fd に適用される)
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->splice_fd_in = pipe_read_.native_handle();
+        sqe->splice_off_in = (uint64_t)-1;
+        sqe->off = (uint64_t)-1;
+        sqe->len = static_cast<uint32_t>(pipe_fill_);
+        sqe->splice_flags = file_remaining_ > 0 ? SPLICE_F_MORE : 0;
+        prepare_socket_io(sqe);
+        sqe->user_data = (uint64_t)&file_op_;
+
+        ctx_.submit();
+    }
+
+    void http_session::finish_file(bool abort) {
+        file_.reset();
+        opening_fd_ = unique_socket();
+        file_stage_ = file_stage::none;
 
+        if (abort) {
+            if (is_open()) close_socket();
+            return;
+        }
+        resume_requests();
+        flush();
+    }
+
+    void http_session::start_proxy() {
+        if (!proxy_) proxy_ = std::make_unique<proxy_transfer>(ctx_);
+        upstream_pool &pool = server_.proxy_pool(*response_.proxy());
+        // リクエストは proxy_transfer の送信データへ複製されるため、受信バッファが再利用されても良い
+        int status = proxy_->start(pool, request_, response_.proxy_target(), proxy_op_);
+        recycle_response();
+        if (status != 0) {
+            // process() の中から呼ばれるため送信中ではなく、その場でエラーを書ける
+            proxy_status_ = status;
+            proxy_stage_ = proxy_stage::ready;
+            write_proxy_response();
+            return;
+        }
+        proxy_stage_ = proxy_stage::exchanging;
+        pending_ops_++;
+    }
+
+    void http_session::write_proxy_response() {
+        if (out_.capacity() < initial_out_capacity) out_.reserve(initial_out_capacity);
+
+        if (proxy_status_ != 0) {
+            response &res = response_;
+            res.set_status_code(proxy_status_);
+            res.set_body(status_body(proxy_status_));
+            write_response(out_, res, request_.method == method::HEAD, closing_);
+            recycle_response();
+            proxy_stage_ = proxy_stage::none;
+            return;
+        }
+
+        // 上流の接続の終わりまで続くボディは、クライアントの接続も閉じて終わりを伝える
+        // (Transfer-Encoding を使えない HTTP/1.0 のクライアントへのチャンク形式のボディも同じ)
+        proxy_until_close_ = proxy_->until_close();
+        proxy_dechunk_ = proxy_->chunked() && request_.version_minor == 0;
+        if (proxy_until_close_ || proxy_dechunk_) closing_ = true;
+        proxy_->write_head(out_, closing_, proxy_->chunked() && !proxy_dechunk_);
+        if (proxy_->chunked()) {
+            // ヘッダーと共に受信したチャンクも区切りを調べながらヘッダーの後ろに続けて送る
+            proxy_stage_ = proxy_stage::headers;
+            continue_proxy_body();
+            return;
+        }
+        // ヘッダーと共に受信したボディの先頭はヘッダーの後ろに続けて送る
+        out_.append(proxy_->body_prefix());
+
+        proxy_remaining_ = proxy_->body_remaining();
+        if (proxy_remaining_ > 0 || proxy_until_close_) {
+            // 残りはヘッダーを送り終えてから送る (complete_write())
+            proxy_stage_ = proxy_stage::headers;
+        } else {
+            proxy_->finish(true);
+            proxy_stage_ = proxy_stage::none;
+        }
+    }
+
+    void http_session::handle_proxy(int result, uint32_t) {
+        pending_ops_--;
+
+        if (!is_open()) {
+            // 接続が閉じられた (close_socket() がキャンセルした)
+            finish_proxy(true);
+            finish_if_done();
+            return;
+        }
+
+        switch (proxy_stage_) {
+        case proxy_stage::exchanging:
+            proxy_status_ = result;
+            proxy_stage_ = proxy_stage::ready;
+            // 前のレスポンスを送信中であれば、送信完了後に complete_write() が書く (out_ を変更できないため)
+            if (writing_) break;
+            write_proxy_response();
+            resume_requests();
+            flush();
+            break;
+
+        case proxy_stage::splice_in:
+            if (result < 0 || (result == 0 && !proxy_until_close_)) {
+                // 上流のエラー、またはボディの途中で閉じられた: 送信済みの Content-Length と合わないため閉じる
+                finish_proxy(true);
+                break;
+            }
+            if (result == 0) {
+                // 接続の終わりまでのボディを送り終えた (closing_ のため送信後に閉じる)
+                finish_proxy(false);
+                break;
+            }
+            pipe_fill_ += static_cast<size_t>(result);
+            if (!proxy_until_close_) proxy_remaining_ -= static_cast<uint64_t>(result);
+            if (proxy_->chunked()) proxy_->spliced(static_cast<uint64_t>(result));
+            submit_proxy_splice_out();
+            break;
+
+        case proxy_stage::splice_out:
+            if (result <= 0) {
+                finish_proxy(true);
+                break;
+            }
+            pipe_fill_ -= static_cast<size_t>(result);
+            update_timeout(); // 送信が進んだ
+            if (pipe_fill_ > 0) {
+                submit_proxy_splice_out();
+            } else {
+                continue_proxy_body();
+            }
+            break;
+
+        case proxy_stage::receive:
+            if (result <= 0) {
+                // 上流のエラー、またはチャンク形式のボディの途中で閉じられた
+                finish_proxy(true);
+                break;
+            }
+            proxy_->received(static_cast<size_t>(result));
+            continue_proxy_body();
+            break;
+
+        default:
+            break;
+        }
+
+        finish_if_done();
+    }
+
+    void http_session::continue_proxy_body() {
+        if (!proxy_->chunked()) {
+            if (proxy_remaining_ > 0 || proxy_until_close_) submit_proxy_splice_in();
+            else finish_proxy(false);
+            return;
+        }
+
+        // チャンク形式: 受信済みの区切り (とデータ) を out_ へ書き、チャンクのデータの残りは SPLICE する
+        switch (proxy_->relay_chunked(out_, proxy_dechunk_)) {
+        case proxy_transfer::chunk_step::error:
+            // 送信済みのボディを正しく終えられないため閉じる
+            finish_proxy(true);
+            return;
+        case proxy_transfer::chunk_step::done:
+            // 最後のチャンクは後続のレスポンスと共に送る
+            finish_proxy(false);
+            return;
+        case proxy_transfer::chunk_step::receive:
+        case proxy_transfer::chunk_step::splice:
+            break;
+        }
+        if (!out_.empty()) {
+            // 書いた分を送り終えてから続ける (complete_write())
+            proxy_stage_ = proxy_stage::headers;
+            flush();
+            return;
+        }
+        proxy_remaining_ = proxy_->body_remaining();
+        if (proxy_remaining_ > 0) submit_proxy_splice_in();
+        else submit_proxy_receive();
+    }
+
+    void http_session::submit_proxy_receive() {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) {
+            finish_proxy(true);
+            return;
+        }
+        pending_ops_++;
+        proxy_stage_ = proxy_stage::receive;
+
+        std::span<char> buffer = proxy_->receive_buffer();
         sqe->opcode = IORING_OP_RECV;
-        sqe->fd = socket_.native_handle();
-        sqe->addr = (uint64_t)buffer_.data();
-        sqe->len = buffer_.capacity();
-        sqe->flags = 0;
-        sqe->user_data = (uint64_t)this;
+        sqe->fd = proxy_->socket();
+        sqe->addr = (uint64_t)buffer.data();
+        sqe->len = static_cast<uint32_t>(buffer.size());
+        sqe->user_data = (uint64_t)&proxy_op_;
+
+        ctx_.submit();
+    }
+
+    void http_session::submit_proxy_splice_in() {
+        if (!open_pipe()) {
+            finish_proxy(true);
+            return;
+        }
+
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) {
+            finish_proxy(true);
+            return;
+        }
+        pending_ops_++;
+        proxy_stage_ = proxy_stage::splice_in;
+
+        // 上流のソケット -> パイプ (ソケットバッファのページをパイプへ移す。届いている分だけで完了する)
+        uint64_t length = proxy_until_close_ ? pipe_capacity_ : std::min<uint64_t>(proxy_remaining_, pipe_capacity_);
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->splice_fd_in = proxy_->socket();
+        sqe->splice_off_in = (uint64_t)-1; // ソケットにもパイプにもオフセットは無い
+        sqe->fd = pipe_write_.native_handle();
+        sqe->off = (uint64_t)-1;
+        sqe->len = static_cast<uint32_t>(length);
+        sqe->user_data = (uint64_t)&proxy_op_;
 
         ctx_.submit();
     }
 
-    void http_session::submit_send(std::string_view data) {
+    void http_session::submit_proxy_splice_out() {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) {
+            finish_proxy(true);
+            return;
+        }
         pending_ops_++;
-        current_state_ = state::writing;
+        proxy_stage_ = proxy_stage::splice_out;
+
+        // パイプ -> クライアントのソケット (IOSQE_FIXED_FILE は出力側の fd に適用される)
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->splice_fd_in = pipe_read_.native_handle();
+        sqe->splice_off_in = (uint64_t)-1;
+        sqe->off = (uint64_t)-1;
+        sqe->len = static_cast<uint32_t>(pipe_fill_);
+        sqe->splice_flags = proxy_remaining_ > 0 || proxy_until_close_ || proxy_->chunked() ? SPLICE_F_MORE : 0;
+        prepare_socket_io(sqe);
+        sqe->user_data = (uint64_t)&proxy_op_;
+
+        ctx_.submit();
+    }
+
+    void http_session::finish_proxy(bool abort) {
+        proxy_->finish(!abort);
+        proxy_stage_ = proxy_stage::none;
+
+        if (abort) {
+            if (is_open()) close_socket();
+            return;
+        }
+        resume_requests();
+        flush();
+    }
+
+    void http_session::resume_requests() {
+        if (writing_ || response_pending() || !is_open()) return;
+
+        if (paused_) {
+            paused_ = false;
+            size_t used = process(std::string_view(staging_.data(), staging_.size()));
+            staging_.erase(staging_.begin(), staging_.begin() + static_cast<ptrdiff_t>(used));
+        }
+        // 送信中・ファイル送信中に届いたリクエストを処理し、そのレスポンスを次の一回の送信にまとめる
+        // (途中で再びファイルの送信等が始まれば、残りの受信バッファは次の再開まで backlog_ に残す)
+        size_t consumed = 0;
+        while (consumed < backlog_.size() && !response_pending()) {
+            consume_chunk(backlog_[consumed].bid, backlog_[consumed].length);
+            consumed++;
+        }
+        backlog_.erase(backlog_.begin(), backlog_.begin() + static_cast<ptrdiff_t>(consumed));
+    }
+
+    bool http_session::dispatch(method m, response &res) {
+        if (const auto &table = server_.options().static_routes; table && table.dispatch(table.router, m, request_, res)) {
+            return true;
+        }
+        if (const route_handler *route = server_.find_handler(m, request_.path, request_.params)) {
+            if (route->cache && m == method::GET) {
+                // ハンドラの実行中に無効化された場合は、古い世代番号で保持されて次の参照で捨てられる
+                route_cache_ = &route->cache;
+                route_cache_generation_ = route->cache.tag ? route->cache.tag->generation() : 0;
+            }
+            if (route->async_handler) {
+                start_handler(*route, res);
+            } else {
+                route->handler(request_, res);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void http_session::start_handler(const route_handler &route, response &res) {
+        // 中断中に受信バッファが再利用されても request_ を参照できるよう、先に複製しておく
+        stash_request();
+        handler_ = route.async_handler(request_, res);
+        handler_.start(handler_op_);
+        if (!handler_.done()) {
+            handler_stage_ = handler_stage::running;
+            pending_ops_++;
+            return;
+        }
+        // 中断せずに完了した (例外は handle_request() が受け取る)
+        coro::task<void> finished = std::move(handler_);
+        finished.get();
+    }
+
+    void http_session::handle_handler(int, uint32_t) {
+        // 開始中に完了した場合は start_handler() が結果を受け取る
+        if (handler_stage_ != handler_stage::running) return;
+        pending_ops_--;
+        handler_stage_ = handler_stage::ready;
+
+        if (!is_open()) {
+            // 接続は閉じられている: 結果は捨てる
+            handler_stage_ = handler_stage::none;
+            handler_ = {};
+            recycle_response();
+            finish_if_done();
+            return;
+        }
+        // 前のレスポンスを送信中であれば、送信完了後に complete_write() が書く (out_ を変更できないため)
+        if (writing_) return;
+        finish_handler();
+        resume_requests();
+        flush();
+    }
+
+    void http_session::finish_handler() {
+        handler_stage_ = handler_stage::none;
+        coro::task<void> finished = std::move(handler_);
+        try {
+            finished.get();
+        } catch (const std::exception &e) {
+            std::cerr << "Handler exception: " << e.what() << std::endl;
+            response_.clear();
+            response_.set_status_code(500);
+            response_.set_body("Internal Server Error");
+            route_cache_ = nullptr;
+        }
+        finish_response();
+    }
+
+    void http_session::stash_request() {
+        std::string_view raw = request_raw_;
+        auto *copy = static_cast<char *>(arena_.resource()->allocate(raw.size(), 1));
+        std::memcpy(copy, raw.data(), raw.size());
+
+        // 受信データの中を指すビューだけを付け替える (パラメータ名等はルーティングテーブルを指す)
+        auto begin = reinterpret_cast<uintptr_t>(raw.data());
+        auto rebase = [&](std::string_view view) -> std::string_view {
+            auto p = reinterpret_cast<uintptr_t>(view.data());
+            if (view.empty() || p < begin || p + view.size() > begin + raw.size()) return view;
+            return { copy + (p - begin), view.size() };
+        };
+
+        request &req = request_;
+        req.target = rebase(req.target);
+        req.path = rebase(req.path);
+        req.query = rebase(req.query);
+        req.body = rebase(req.body);
+        header_list headers;
+        for (const auto &h : req.headers) headers.push_back(rebase(h.name), rebase(h.value));
+        req.headers = headers;
+        path_params params;
+        for (const auto &p : req.params) params.push_back(p.name, rebase(p.value));
+        req.params = params;
+        request_raw_ = { copy, raw.size() };
+    }
+
+    const body_options *http_session::route_body_options() noexcept {
+        // コンパイル時ルーティングテーブルのルートは既定の扱い (パラメータは dispatch() で設定し直される)
+        const route_handler *route = server_.find_handler(request_.method, request_.path, request_.params);
+        return route ? &route->body : nullptr;
+    }
+
+    void http_session::begin_body(const body_options *options) {
+        // ボディの受信中に受信バッファが再利用されても request_ を参照できるよう、ヘッダーを複製しておく
+        // (揃っているボディも受信データから読み直す)
+        request_.body = {};
+        stash_request();
+        release_body();
+
+        body_limit_ = options && options->max_size ? options->max_size : parser_.limits().max_body_size;
+        body_received_ = 0;
+        if (!parser_.chunked() && parser_.body_length() > body_limit_) {
+            // 受信する前に断る (残りのボディは読まずに閉じる)
+            send_error(413);
+            return;
+        }
+        if (parser_.chunked()) {
+            body_decoder_.reset_chunked();
+        } else {
+            body_decoder_.reset(parser_.body_length());
+        }
+
+        if (options && options->on_body) {
+            try {
+                body_sink_ = options->on_body(request_);
+            } catch (const std::exception &e) {
+                std::cerr << "Body sink exception: " << e.what() << std::endl;
+                send_error(500);
+                return;
+            }
+        }
+        spill_threshold_ = options && !body_sink_ ? options->spill_threshold : 0;
+        spill_directory_ = options ? options->spill_directory.c_str() : nullptr;
+        body_stage_ = body_stage::receiving;
+
+        // 続きを送る前に確認を待つクライアント (RFC 9110 10.1.1)
+        if (request_.version_minor >= 1 && iequals(request_.header("Expect"), "100-continue")) {
+            out_.append("HTTP/1.1 100 Continue\r\n\r\n");
+        }
+        // 長さが分かっていて閾値を超えるボディは最初からファイルへ書き出す
+        if (spill_threshold_ > 0 && !parser_.chunked() && parser_.body_length() > spill_threshold_) start_spill();
+    }
+
+    size_t http_session::read_body(std::string_view data) {
+        size_t offset = 0;
+        while (body_stage_ == body_stage::receiving) {
+            // 書き出しを待つ間、残りは呼び出し元が退避する (ボディの終わりは残りが無くても判定する)
+            if (body_blocked() && offset < data.size()) return offset;
+            size_t used = 0;
+            std::string_view piece;
+            auto status = body_decoder_.decode(data.substr(offset), used, piece);
+            offset += used;
+            switch (status) {
+            case body_decoder::status::incomplete:
+                return offset;
+            case body_decoder::status::error:
+                abort_body(400);
+                return data.size();
+            case body_decoder::status::data:
+                if (!store_body(piece)) return data.size();
+                break;
+            case body_decoder::status::done:
+                end_body();
+                return offset;
+            }
+        }
+        return offset;
+    }
+
+    bool http_session::store_body(std::string_view piece) {
+        body_received_ += piece.size();
+        if (body_received_ > body_limit_) {
+            abort_body(413);
+            return false;
+        }
+
+        if (body_sink_) {
+            bool accepted;
+            try {
+                accepted = body_sink_(piece);
+            } catch (const std::exception &e) {
+                std::cerr << "Body sink exception: " << e.what() << std::endl;
+                abort_body(500);
+                return false;
+            }
+            if (!accepted) abort_body(413);
+            return accepted;
+        }
+        if (spilling()) {
+            spill_buf_.append(piece);
+            submit_spill_write();
+            return is_open();
+        }
+        body_buf_.append(piece);
+        if (spill_threshold_ > 0 && body_buf_.size() > spill_threshold_) start_spill();
+        return is_open();
+    }
+
+    void http_session::end_body() {
+        if (spilling()) {
+            // 残りを書き出し終えてからハンドラを呼ぶ (handle_spill() が続きを行う)
+            body_stage_ = body_stage::flushing;
+            submit_spill_write();
+            if (spill_busy_ || !is_open()) return;
+        }
+        complete_body();
+    }
+
+    void http_session::complete_body() {
+        request &req = request_;
+        body_stage_ = body_stage::none;
+        body_sink_ = nullptr;
+        if (spill_file_) {
+            req.body = {};
+            req.body_file = spill_file_.native_handle();
+            req.body_file_size = spill_offset_;
+        } else {
+            req.body = body_buf_;
+        }
+        handle_request();
+    }
+
+    void http_session::abort_body(int status) {
+        body_stage_ = body_stage::none;
+        body_sink_ = nullptr;
+        release_body();
+        send_error(status);
+    }
+
+    void http_session::start_spill() {
+        spill_started_ = true;
+        spill_buf_ = std::move(body_buf_);
+        body_buf_.clear();
 
         auto *sqe = ctx_.get_sqe();
         if (!sqe) {
-            pending_ops_--;
-            socket_ = unique_socket();
-            if (pending_ops_ == 0) delete this;
+            close_socket();
+            return;
+        }
+        pending_ops_++;
+        spill_busy_ = true;
+
+        // 名前の無いファイル: 閉じれば消え、ハンドラは linkat で残すこともできる
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uint64_t)spill_directory_;
+        sqe->open_flags = O_TMPFILE | O_RDWR | O_CLOEXEC;
+        sqe->len = 0600;
+        sqe->user_data = (uint64_t)&spill_op_;
+
+        ctx_.submit();
+    }
+
+    void http_session::submit_spill_write() {
+        if (spill_busy_ || !spill_file_) return;
+        if (spill_out_.empty()) {
+            // 小さな部分はまとめて書く (ボディの終わりでは残りを全て書く)
+            if (spill_buf_.empty()) return;
+            if (spill_buf_.size() < spill_write_size && body_stage_ != body_stage::flushing) return;
+            std::swap(spill_out_, spill_buf_);
+            spill_buf_.clear();
+            spill_out_sent_ = 0;
+        }
+
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) {
+            close_socket();
+            return;
+        }
+        pending_ops_++;
+        spill_busy_ = true;
+
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = spill_file_.native_handle();
+        sqe->addr = (uint64_t)(spill_out_.data() + spill_out_sent_);
+        sqe->len = static_cast<uint32_t>(spill_out_.size() - spill_out_sent_);
+        sqe->off = spill_offset_;
+        sqe->user_data = (uint64_t)&spill_op_;
+
+        ctx_.submit();
+    }
+
+    void http_session::handle_spill(int result, uint32_t) {
+        pending_ops_--;
+        spill_busy_ = false;
+
+        if (result >= 0) {
+            if (!spill_file_) {
+                spill_file_ = unique_socket(result);
+            } else {
+                spill_out_sent_ += static_cast<size_t>(result);
+                spill_offset_ += static_cast<uint64_t>(result);
+                if (spill_out_sent_ == spill_out_.size()) {
+                    spill_out_.clear();
+                    spill_out_sent_ = 0;
+                }
+            }
+        }
+
+        if (!is_open() || body_stage_ == body_stage::none) {
+            // 接続が閉じられた・ボディを打ち切った: 書き出し中のため残していたファイルとバッファを解放する
+            release_body();
+            finish_if_done();
+            return;
+        }
+        if (result < 0 || (result == 0 && !spill_out_.empty())) {
+            std::cerr << "Failed to write the request body to a temporary file: " << -result << std::endl;
+            body_stage_ = body_stage::none;
+            release_body();
+            // 送信中は out_ を変更できないため、エラーを返さずに閉じる
+            if (writing_) {
+                close_socket();
+            } else {
+                send_error(500);
+                flush();
+            }
+            finish_if_done();
+            return;
+        }
+
+        // 部分書き込みの残り、または書き出し中に溜まった分を書く
+        submit_spill_write();
+        if (body_stage_ == body_stage::flushing && !spill_busy_) {
+            // 全て書き出した。前のレスポンスを送信中であれば、送信完了後に complete_write() がハンドラを呼ぶ
+            if (writing_) {
+                body_stage_ = body_stage::ready;
+            } else {
+                complete_body();
+                resume_requests();
+                flush();
+            }
+        } else if (!body_blocked()) {
+            // 止めていたボディの読み取りを再開する
+            resume_requests();
+            flush();
+        }
+        finish_if_done();
+    }
+
+    void http_session::release_body() noexcept {
+        body_buf_.clear();
+        if (body_buf_.capacity() > max_retained_out_capacity) body_buf_.shrink_to_fit();
+        // 書き出し中のバッファとファイルは完了まで残す (handle_spill() が改めて呼ぶ)
+        if (spill_busy_) return;
+        spill_file_ = unique_socket();
+        spill_started_ = false;
+        spill_buf_.clear();
+        spill_out_.clear();
+        if (spill_buf_.capacity() > max_retained_out_capacity) spill_buf_.shrink_to_fit();
+        if (spill_out_.capacity() > max_retained_out_capacity) spill_out_.shrink_to_fit();
+        spill_out_sent_ = 0;
+        spill_offset_ = 0;
+    }
+
+    void http_session::submit_recv() {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) {
+            close_socket();
             return;
         }
+        pending_ops_++;
+        recv_armed_ = true;
+
+        // バッファはカーネルがプールから選択する (IOSQE_BUFFER_SELECT)
+        sqe->opcode = IORING_OP_RECV;
+        sqe->addr = 0;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = server_.buffers().group_id();
+        if (multishot_) {
+            // 一度の発行で接続が続く限り受信し続ける (len は0でバッファ長を使用)
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->len = 0;
+        } else {
+            sqe->len = server_.buffers().buffer_size();
+        }
+        prepare_socket_io(sqe);
+        sqe->user_data = (uint64_t)&recv_op_;
 
-        sqe->opcode = IORING_OP_SEND;
-        sqe->fd = socket_.native_handle();
-        sqe->addr = (uint64_t)data.data();
-        sqe->len = static_cast<uint32_t>(data.size());
+        ctx_.submit();
+    }
+
+    void http_session::arm_recv() {
+        if (recv_armed_ || closing_ || peer_closed_ || recv_retry_.armed()) return;
+        // 受信の背圧: 送信・ファイル送信・ハンドラ・ストリーミングが追いつかない間は backlog_ を上限で止め、
+        // ボディの書き出しが追いつかない間は受信しない (どちらも処理が進んで flush() が呼ばれた時に再開する)
+        if (backlog_.size() >= max_backlog_chunks || body_blocked()) return;
+        submit_recv();
+    }
+
+    void http_session::handle_recv_retry(int, uint32_t) {
+        if (!is_open() || websocket_) return;
+        arm_recv();
+    }
+
+    void http_session::submit_send() {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) {
+            close_socket();
+            return;
+        }
+        pending_ops_++;
+        writing_ = true;
+        send_armed_ = true;
+
+        // 未送信部分をまとめて送る (送信バッファ -> out_ の順。送信完了まで変更しない)
+        sending_send_buffer_ = send_buffer_ != no_send_buffer && send_buffer_sent_ < send_buffer_used_;
+        const char *data = sending_send_buffer_ ? server_.send_buffers().data(send_buffer_) + send_buffer_sent_
+                                                : out_.data() + out_sent_;
+        size_t length = sending_send_buffer_ ? send_buffer_used_ - send_buffer_sent_ : out_.size() - out_sent_;
+
+        if (server_.zero_copy() && length >= server_.options().zero_copy_threshold) {
+            // ページを送信キューから直接参照させる。完了の CQE の後に F_NOTIF の CQE が届く
+            sqe->opcode = IORING_OP_SEND_ZC;
+            if (sending_send_buffer_) {
+                // 登録済みバッファ: 送信ごとのピン留めが不要
+                sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+                sqe->buf_index = send_buffer_;
+            }
+        } else {
+            sqe->opcode = IORING_OP_SEND;
+        }
+        sqe->addr = (uint64_t)data;
+        sqe->len = static_cast<uint32_t>(length);
         sqe->flags = 0;
-        sqe->user_data = (uint64_t)this;
+        prepare_socket_io(sqe);
+        sqe->user_data = (uint64_t)&send_op_;
+
+        ctx_.submit();
+    }
+
+    void http_session::submit_cancel(task *target) {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return;
+
+        // 対象操作は -ECANCELED で完了する。キャンセル自体の完了通知は不要
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = (uint64_t)target;
+        sqe->user_data = 0;
 
         ctx_.submit();
     }
 
     void http_session::handle_read(int result, uint32_t flags) {
-        if (result <= 0) {
-            socket_ = unique_socket();
-            return;
+        // マルチショット受信は F_MORE が付いている間は継続中
+        bool more = multishot_ && (flags & IORING_CQE_F_MORE);
+        if (!more) {
+            pending_ops_--;
+            recv_armed_ = false;
         }
-        
-        std::cout << "Received " << result << " bytes." << std::endl;
-        buffer_.resize(result);
 
-        handle_request();
+        // 結果に関わらず、選択されたバッファは自分の所有になる
+        auto bid = buffer_pool::buffer_id(flags);
+
+        if (result > 0 && bid && is_open()) {
+            accept_chunk(*bid, static_cast<size_t>(result));
+        } else {
+            if (bid) server_.buffers().recycle(*bid);
+
+            if (result == -ENOBUFS) {
+                // プールが枯渇している。すぐに発行し直しても同じ結果になるため、少し待ってから受信をやり直す
+                if (is_open()) ctx_.timers().arm(recv_retry_, recv_retry_delay);
+            } else if (result == -EINVAL && multishot_) {
+                // IORING_RECV_MULTISHOT 非対応カーネル: 単発受信へ切り替える
+                multishot_ = false;
+                if (is_open() && !writing_ && !websocket_) submit_recv();
+            } else if (result == -ECANCELED) {
+                // WebSocket へ引き継ぐため、または backlog_ が上限に達したために止めた
+                // (引き継ぎは下で、受信の再開は backlog_ を処理した後の flush() で行う)
+            } else if (result <= 0 && is_open()) {
+                // EOF またはエラー: 応答中のリクエストがあれば送信完了後に閉じる
+                peer_closed_ = true;
+                if (result < 0) {
+                    close_socket();
+                } else if (!writing_) {
+                    flush();
+                }
+            }
+        }
+
+        // 受信が終了してしまった場合の再発行
+        // マルチショット: F_MORE が無くなったら再発行する (backlog_ が上限なら処理後に、ENOBUFS なら recv_retry_ に任せる)
+        // 単発受信: flush() で発行する
+        // WebSocket: 101 を送り終えていれば受信が止まった時点で引き継ぐ
+        if (!recv_armed_ && is_open() && !peer_closed_ && !closing_) {
+            if (websocket_) {
+                if (!writing_) flush();
+            } else if (multishot_) {
+                arm_recv();
+            }
+        }
+
+        finish_if_done();
     }
 
-    void http_session::handle_write(int result) {
-        if (result < 0) {
-            std::cerr << "Send failed with error: " << -result << std::endl;
-            socket_ = unique_socket();
+    void http_session::accept_chunk(uint16_t bid, size_t length) {
+        if (writing_ || response_pending()) {
+            // 前のレスポンスを送信中。完了後にまとめて処理する
+            backlog_.push_back({ bid, static_cast<uint32_t>(length) });
+            // 上限に達したらマルチショット受信を止める (取り消しまでに届いた分は上限を超えて積む)
+            if (backlog_.size() == max_backlog_chunks && recv_armed_ && multishot_) submit_cancel(&recv_op_);
+            return;
+        }
+        consume_chunk(bid, length);
+        flush();
+    }
+
+    void http_session::consume_chunk(uint16_t bid, size_t length) {
+        std::string_view chunk = server_.buffers().view(bid, length);
+
+        if (closing_) {
+            // 閉じる予定の接続に届いた後続データは破棄する
+        } else if (staging_.empty()) {
+            // 通常はリクエスト全体が一つのバッファに収まり、そのまま解析できる (コピーなし)
+            size_t used = process(chunk);
+            if (used < chunk.size()) staging_.assign(chunk.begin() + static_cast<ptrdiff_t>(used), chunk.end());
         } else {
-            if (keep_alive_) {
-                buffer_.assign(buffer_.capacity(), 0);
-                buffer_.resize(0);
-                submit_recv();
+            // 前回の不完全なリクエストの続き: 退避領域に連結して解析を再開する
+            staging_.insert(staging_.end(), chunk.begin(), chunk.end());
+            size_t used = process(std::string_view(staging_.data(), staging_.size()));
+            staging_.erase(staging_.begin(), staging_.begin() + static_cast<ptrdiff_t>(used));
+        }
+
+        // レスポンスは out_ にコピー済みで、未処理分は staging_ に退避済みなのでバッファは不要
+        server_.buffers().recycle(bid);
+    }
+
+    void http_session::flush() {
+        if (!is_open()) return;
+
+        if (!writing_ && has_unsent()) submit_send();
+        if (websocket_) {
+            // 101 を送り終え、受信の取り消しも完了してから引き継ぐ (それまで受信は再開しない)
+            if (writing_ || recv_armed_) {
+                update_timeout();
+            } else if (peer_closed_) {
+                close_socket();
             } else {
-                socket_ = unique_socket();
+                hand_off_websocket();
             }
+            return;
+        }
+        if (writing_ || response_pending()) {
+            // 送信中も後続のリクエストを受信しておく (届いた分は backlog_ に積まれる)
+            arm_recv();
+            update_timeout();
+            return;
+        }
+
+        if (closing_ || peer_closed_) {
+            close_socket();
+        } else {
+            arm_recv();
+            update_timeout();
         }
     }
 
-    void http_session::complete(int result, uint32_t flags) {
-        pending_ops_--;
+    void http_session::update_timeout() noexcept {
+        if (!is_open()) return;
+        const server_options &options = server_.options();
+
+        timeout_phase phase;
+        std::chrono::milliseconds after;
+        if (writing_ || file_busy() || proxy_relaying()) {
+            phase = timeout_phase::write;
+            after = options.write_timeout;
+        } else if (handler_stage_ != handler_stage::none || proxy_busy() || websocket_ ||
+                   stream_stage_ == stream_stage::producing) {
+            // コルーチンハンドラ・非同期の生成器の待ち時間はそれ自身が、上流の応答待ちは proxy_options が制限する
+            // (WebSocket への引き継ぎ待ちは受信の取り消しの完了を待つだけ)
+            phase = timeout_phase::none;
+            after = std::chrono::milliseconds(0);
+        } else if (body_stage_ != body_stage::none) {
+            // 一時ファイルへの書き出しを待つ間はクライアントの送信を待っていない
+            phase = body_stage_ == body_stage::receiving && !body_blocked() ? timeout_phase::body : timeout_phase::none;
+            after = phase == timeout_phase::body ? options.body_timeout : std::chrono::milliseconds(0);
+        } else if (!staging_.empty() || !served_) {
+            // 新しい接続は最初のリクエストのヘッダーを受信し終えるまでを header_timeout で制限する
+            phase = timeout_phase::header;
+            after = options.header_timeout;
+        } else {
+            phase = timeout_phase::idle;
+            after = options.keep_alive_timeout;
+        }
+
+        // ヘッダーの期限は延長しない (少しずつ送り続ける接続 = Slowloris も切断する)
+        if (phase == timeout_phase::header && timeout_phase_ == phase && timer_.armed()) return;
+        timeout_phase_ = phase;
+        if (after.count() > 0) {
+            ctx_.timers().arm(timer_, after);
+        } else {
+            timer_.cancel();
+        }
+    }
+
+    void http_session::handle_timeout(int, uint32_t) {
+        if (!is_open()) return;
+
+        switch (timeout_phase_) {
+        case timeout_phase::header:
+        case timeout_phase::body:
+            // 送信中ではない (受信待ち) ため、408 を返してから閉じる (その送信は write_timeout で制限される)
+            if (server_.options().log_connections) std::cout << "Request timeout." << std::endl;
+            send_error(408);
+            flush();
+            break;
+        default:
+            // 実行中の受信・送信・ファイル操作は close_socket() が取り消す
+            if (server_.options().log_connections) {
+                std::cout << (timeout_phase_ == timeout_phase::idle ? "Keep-alive timeout." : "Write timeout.") << std::endl;
+            }
+            close_socket();
+            break;
+        }
 
-        if (current_state_ == state::reading) {
-            handle_read(result, flags);
-        } else if (current_state_ == state::writing) {
-            handle_write(result);
+        finish_if_done();
+    }
+
+    void http_session::handle_write(int result, uint32_t flags) {
+        if (flags & IORING_CQE_F_NOTIF) {
+            // ゼロコピー送信の通知: カーネルがバッファを参照し終えた
+            pending_ops_--;
+            zero_copy_notifs_--;
+            if (zero_copy_notifs_ == 0 && !send_armed_) complete_write();
+            finish_if_done();
+            return;
+        }
+
+        // ゼロコピー送信は F_MORE が付いていれば後から通知が届く (それまで操作は継続中)
+        if (flags & IORING_CQE_F_MORE) {
+            zero_copy_notifs_++;
+        } else {
+            pending_ops_--;
+        }
+        send_armed_ = false;
+
+        if (result < 0) {
+            // タイムアウトで取り消した場合は既に閉じている
+            if (is_open()) {
+                std::cerr << "Send failed with error: " << -result << std::endl;
+                close_socket();
+            }
+            if (zero_copy_notifs_ == 0) writing_ = false;
+            finish_if_done();
+            return;
+        }
+
+        // 部分送信: 同じバッファの残りを送る (バッファは変更していないため通知を待つ必要はない)
+        size_t &sent = sending_send_buffer_ ? send_buffer_sent_ : out_sent_;
+        size_t total = sending_send_buffer_ ? send_buffer_used_ : out_.size();
+        sent += static_cast<size_t>(result);
+        if (sent < total && is_open()) {
+            submit_send();
+            update_timeout(); // 送信が進んだ
+        } else if (zero_copy_notifs_ == 0) {
+            complete_write();
         }
 
-        if (pending_ops_ == 0 && !socket_) {
-            delete this;
+        finish_if_done();
+    }
+
+    void http_session::complete_write() {
+        writing_ = false;
+
+        if (send_buffer_ != no_send_buffer && send_buffer_sent_ == send_buffer_used_) {
+            server_.send_buffers().release(send_buffer_);
+            send_buffer_ = no_send_buffer;
+            send_buffer_used_ = 0;
+            send_buffer_sent_ = 0;
+        }
+        if (out_sent_ == out_.size()) {
+            out_.clear();
+            out_sent_ = 0;
+            if (out_.capacity() > max_retained_out_capacity) out_.shrink_to_fit();
+
+            if (send_buffer_ == no_send_buffer) {
+                if (handler_stage_ == handler_stage::ready) {
+                    // 送信中に完了したコルーチンハンドラのレスポンス
+                    finish_handler();
+                } else if (file_stage_ == file_stage::ready) {
+                    // 送信中に開き終えたファイルのレスポンス
+                    write_file_response();
+                } else if (file_stage_ == file_stage::headers) {
+                    // ヘッダーを送り終えたのでボディを送る
+                    submit_splice_in();
+                } else if (proxy_stage_ == proxy_stage::ready) {
+                    // 送信中に受信し終えた上流のレスポンス
+                    write_proxy_response();
+                } else if (proxy_stage_ == proxy_stage::headers) {
+                    continue_proxy_body();
+                } else if (stream_busy()) {
+                    // 送信中に生成したボディを送り、次を生成する
+                    advance_stream();
+                } else if (body_stage_ == body_stage::ready) {
+                    // 送信中に一時ファイルへ書き出し終えたリクエスト
+                    complete_body();
+                }
+                resume_requests();
+            }
+        }
+        // 送信バッファの後に out_ が残っていれば flush() が送信する
+        flush();
+    }
+
+    void http_session::close_socket() {
+        // マルチショット受信はソケットを閉じても終了しないため明示的にキャンセルする
+        if (recv_armed_) submit_cancel(&recv_op_);
+        // 相手が受信しないまま止まっている送信も取り消す (タイムアウト時)
+        if (send_armed_) submit_cancel(&send_op_);
+        // 実行中のファイル操作 (ソケットへの SPLICE を含む) も止める
+        if (file_stage_ == file_stage::opening || file_stage_ == file_stage::stat ||
+            file_stage_ == file_stage::splice_in || file_stage_ == file_stage::splice_out) {
+            submit_cancel(&file_op_);
+        }
+        // 上流への転送も止める (上流の接続は再利用せずに閉じる)
+        if (proxy_stage_ == proxy_stage::exchanging) proxy_->cancel();
+        if (proxy_relaying()) submit_cancel(&proxy_op_);
+        // 引き継ぐ前に閉じた WebSocket (on_close を呼んでプールへ返す)
+        if (websocket_) std::exchange(websocket_, nullptr)->abandon();
+
+        socket_ = unique_socket();
+        fixed_socket_ = fixed_socket();
+        timer_.cancel();
+        recv_retry_.cancel();
+
+        for (const auto &chunk : backlog_) server_.buffers().recycle(chunk.bid);
+        backlog_.clear();
+    }
+
+    void http_session::finish_if_done() {
+        if (pending_ops_ == 0 && !is_open()) {
+            if (server_.options().log_connections) std::cout << "Session closed." << std::endl;
+            reset();
+            // 以降このオブジェクトは次の接続に使われる
+            server_.sessions().release(this);
         }
     }
 }
@@ -1,9 +1,14 @@
 #include "ouroboros/http/io_context.hpp"
 #include <sys/mman.h>
+#include <sys/eventfd.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 #include <stdexcept>
 #include <cstring> // for memset
+#include <cerrno>
+#include <vector>
+#include <algorithm>
+#include <utility>
 #include <chrono>
 #include <thread>
 #include <iostream>
@@ -26,20 +31,82 @@ static int io_uring_enter_syscall(int fd, unsigned to_submit, unsigned min_compl
     return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, sig, _NSIG / 8);
 }
 
+// IORING_ENTER_EXT_ARG: シグナルマスクの代わりに io_uring_getevents_arg (待機のタイムアウト) を渡す
+static int io_uring_enter_ext_syscall(int fd, unsigned to_submit, unsigned min_complete,
+    unsigned flags, struct io_uring_getevents_arg *arg) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags | IORING_ENTER_EXT_ARG, arg,
+        sizeof(*arg));
+}
+
+static int io_uring_register_syscall(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
 namespace ouroboros::http
 {
 
-    io_context::io_context(unsigned entries) {
-        std::memset(&params_, 0, sizeof(params_));
+    namespace
+    {
+        thread_local io_context *current_context = nullptr;
+
+        uint32_t requested_setup_flags(const io_context_options &options) noexcept {
+            uint32_t flags = 0;
+            if (options.cq_entries > 0) flags |= IORING_SETUP_CQSIZE;
+            if (options.submit_all) flags |= IORING_SETUP_SUBMIT_ALL;
+            if (options.single_issuer) flags |= IORING_SETUP_SINGLE_ISSUER;
+            if (options.sqpoll) {
+                // SQPOLL ではカーネルスレッドが発行するため、割り込みに関するフラグは指定できない
+                flags |= IORING_SETUP_SQPOLL;
+                if (options.sq_thread_cpu >= 0) flags |= IORING_SETUP_SQ_AFF;
+            } else if (options.defer_taskrun && options.single_issuer) {
+                flags |= IORING_SETUP_DEFER_TASKRUN;
+            } else if (options.coop_taskrun) {
+                flags |= IORING_SETUP_COOP_TASKRUN;
+            }
+            return flags;
+        }
 
-        // 1. io_uring インスタンスの作成
-        int fd = io_uring_setup_syscall(entries, &params_);
-        if (fd < 0) {
-            // エラー詳細を出力するとデバッグしやすいです
-            std::perror("io_uring_setup_syscall failed");
-            throw std::runtime_error("io_uring_setup failed");
+        // io_uring_setup が失敗した時に外すフラグ (新しいカーネルで追加されたものから順に)
+        uint32_t fallback_setup_flags(uint32_t flags, int error) noexcept {
+            if (error == EPERM && (flags & IORING_SETUP_SQPOLL)) {
+                return flags & ~(IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF);
+            }
+            if (error != EINVAL) return flags;
+            for (uint32_t flag : { IORING_SETUP_DEFER_TASKRUN, IORING_SETUP_SINGLE_ISSUER, IORING_SETUP_COOP_TASKRUN,
+                                   IORING_SETUP_SUBMIT_ALL, IORING_SETUP_SQ_AFF }) {
+                if (flags & flag) return flags & ~flag;
+            }
+            return flags;
+        }
+    }
+
+    io_context::io_context(unsigned entries) : io_context(io_context_options{ .entries = entries }) {}
+
+    io_context::io_context(const io_context_options &options) {
+        // 1. io_uring インスタンスの作成 (非対応のフラグを外しながら再試行する)
+        uint32_t flags = requested_setup_flags(options);
+        int fd;
+        while (true) {
+            std::memset(&params_, 0, sizeof(params_));
+            params_.flags = flags;
+            params_.cq_entries = options.cq_entries;
+            if (flags & IORING_SETUP_SQPOLL) {
+                params_.sq_thread_idle = static_cast<uint32_t>(options.sq_thread_idle.count());
+                if (flags & IORING_SETUP_SQ_AFF) params_.sq_thread_cpu = static_cast<uint32_t>(options.sq_thread_cpu);
+            }
+            fd = io_uring_setup_syscall(options.entries, &params_);
+            if (fd >= 0) break;
+
+            uint32_t fallback = fallback_setup_flags(flags, errno);
+            if (fallback == flags) {
+                // エラー詳細を出力するとデバッグしやすいです
+                std::perror("io_uring_setup_syscall failed");
+                throw std::runtime_error("io_uring_setup failed");
+            }
+            flags = fallback;
         }
         ring_fd_ = unique_socket(fd); // RAII管理へ
+        setup_flags_ = flags;
 
         sq_tail_cached_ = 0; // setup_memory_mapping後に実際のtail値で初期化
 
@@ -52,6 +119,29 @@ namespace ouroboros::http
             // mmap したメモリの解放ロジックが必要だが、ここでは簡略化のため省略
             throw;
         }
+
+        // 3. 停止要求の通知用 eventfd
+        int efd = ::eventfd(0, EFD_CLOEXEC);
+        if (efd < 0) {
+            std::perror("eventfd failed");
+            throw std::runtime_error("eventfd failed");
+        }
+        wakeup_fd_ = unique_socket(efd);
+
+        // 4. 対応している操作の取得 (新しい操作を使う前に確認する)
+        probe_opcodes();
+    }
+
+    void io_context::probe_opcodes() noexcept {
+        // io_uring_probe は可変長 (ops[] が末尾に続く)
+        constexpr size_t op_count = 256;
+        alignas(io_uring_probe) unsigned char storage[sizeof(io_uring_probe) + op_count * sizeof(io_uring_probe_op)]{};
+        auto *probe = reinterpret_cast<io_uring_probe *>(storage);
+        auto *ops = reinterpret_cast<io_uring_probe_op *>(storage + sizeof(io_uring_probe));
+        if (register_resource(IORING_REGISTER_PROBE, probe, op_count) < 0) return; // Linux 5.6 未満: 全て非対応とみなす
+        for (size_t i = 0; i < probe->ops_len && i < op_count; ++i) {
+            if (ops[i].flags & IO_URING_OP_SUPPORTED) supported_ops_.set(ops[i].op);
+        }
     }
 
     io_context::~io_context() {
@@ -108,8 +198,10 @@ namespace ouroboros::http
 
         // tailはユーザー空間のキャッシュ値を使う
         if (sq_tail_cached_ - head >= *sq_.ring_entries) {
-            // リングが一杯。送信を試みる。
-            if (submit() < 0) return nullptr;
+            // リングが一杯。イベントループ中でもここでは待たずに送信する
+            // (SQPOLL ではカーネルスレッドが SQE を読み取って空きができるまで待つ)
+            unsigned flags = (setup_flags_ & IORING_SETUP_SQPOLL) ? IORING_ENTER_SQ_WAIT : 0;
+            if (enter(publish(), 0, flags) < 0) return nullptr;
             // 再度チェック
             head = std::atomic_load_explicit(reinterpret_cast<std::atomic<uint32_t>*>(sq_.head), std::memory_order_acquire);
             if (sq_tail_cached_ - head >= *sq_.ring_entries) {
@@ -129,26 +221,105 @@ namespace ouroboros::http
         return sqe;
     }
 
-    int io_context::submit() {
+    unsigned io_context::publish() noexcept {
         uint32_t submitted_tail = *sq_.tail;
-        unsigned to_submit = sq_tail_cached_ - submitted_tail;
-        if (to_submit == 0) {
+        unsigned to_publish = sq_tail_cached_ - submitted_tail;
+        if (to_publish > 0) {
+            // カーネルに見えているtailから、ローカルで進めたtailまでを更新
+            for (unsigned i = 0; i < to_publish; ++i) {
+                sq_.array[(submitted_tail + i) & *sq_.ring_mask] = (submitted_tail + i) & *sq_.ring_mask;
+            }
+            // カーネルにtailの更新を通知
+            std::atomic_store_explicit(reinterpret_cast<std::atomic<uint32_t>*>(sq_.tail), sq_tail_cached_, std::memory_order_release);
+        }
+        // 前回の io_uring_enter で消費されなかった SQE も含める
+        uint32_t head = std::atomic_load_explicit(reinterpret_cast<std::atomic<uint32_t>*>(sq_.head), std::memory_order_acquire);
+        return sq_tail_cached_ - head;
+    }
+
+    int io_context::enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+        const __kernel_timespec *wait) noexcept {
+        if (setup_flags_ & IORING_SETUP_SQPOLL) {
+            // カーネルスレッドが tail を監視している。スリープしている場合だけ起こす
+            // (tail の書き込みと flags の読み込みの順序を保証する)
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            uint32_t sq_flags = std::atomic_load_explicit(reinterpret_cast<std::atomic<uint32_t>*>(sq_.flags), std::memory_order_relaxed);
+            if (sq_flags & IORING_SQ_NEED_WAKEUP) {
+                flags |= IORING_ENTER_SQ_WAKEUP;
+            } else if (!(flags & (IORING_ENTER_GETEVENTS | IORING_ENTER_SQ_WAIT))) {
+                return static_cast<int>(to_submit);
+            }
+        } else if (to_submit == 0 && !(flags & IORING_ENTER_GETEVENTS)) {
             return 0; // 送信対象なし
         }
 
-        // カーネルに見えているtailから、ローカルで進めたtailまでを更新
-        for (unsigned i = 0; i < to_submit; ++i) {
-            sq_.array[(submitted_tail + i) & *sq_.ring_mask] = (submitted_tail + i) & *sq_.ring_mask;
+        syscalls_.store(syscalls_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (wait) {
+            struct io_uring_getevents_arg arg
+            {};
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = reinterpret_cast<uintptr_t>(wait);
+            return io_uring_enter_ext_syscall(ring_fd_.native_handle(), to_submit, min_complete, flags, &arg);
         }
+        // io_uring_enter(fd, to_submit, min_complete, flags, sig)
+        return io_uring_enter_syscall(ring_fd_.native_handle(), to_submit, min_complete, flags, nullptr);
+    }
 
-        // カーネルにtailの更新を通知
-        std::atomic_store_explicit(reinterpret_cast<std::atomic<uint32_t>*>(sq_.tail), sq_tail_cached_, std::memory_order_release);
+    int io_context::submit() {
+        unsigned to_submit = publish();
+        // イベントループ中は、ループが次に待機する時にまとめて送信する
+        if (in_loop_) return 0;
+        return enter(to_submit, 0, 0);
+    }
 
-        // システムコールでカーネルを起こす
-        // io_uring_enter(fd, to_submit, min_complete, flags, sig)
-        return io_uring_enter_syscall(ring_fd_.native_handle(), to_submit, 0, 0, nullptr);
+    int io_context::register_resource(unsigned opcode, void *arg, unsigned nr_args) noexcept {
+        int ret = io_uring_register_syscall(ring_fd_.native_handle(), opcode, arg, nr_args);
+        return ret < 0 ? -errno : ret;
+    }
+
+    int io_context::register_sparse_files(unsigned slots) noexcept {
+        // Linux 5.19+: IORING_RSRC_REGISTER_SPARSE で配列なしに登録する
+        struct io_uring_rsrc_register reg
+        {};
+        reg.nr = slots;
+        reg.flags = IORING_RSRC_REGISTER_SPARSE;
+        int ret = register_resource(IORING_REGISTER_FILES2, &reg, sizeof(reg));
+        if (ret == -EINVAL) {
+            // フォールバック: -1 で埋めた配列を登録する
+            std::vector<int> fds(slots, -1);
+            ret = register_resource(IORING_REGISTER_FILES, fds.data(), slots);
+        }
+        if (ret < 0) return ret;
+        fixed_file_slots_ = slots;
+
+        // Linux 6.0+: カーネルが割り当てるスロットを予約スロットの後ろに限定する (失敗しても動作する)
+        if (slots > reserved_file_slots) {
+            struct io_uring_file_index_range range
+            {};
+            range.off = reserved_file_slots;
+            range.len = slots - reserved_file_slots;
+            register_resource(IORING_REGISTER_FILE_ALLOC_RANGE, &range, 0);
+        }
+        return ret;
     }
 
+    int io_context::install_fixed_file(int fd) noexcept {
+        if (fixed_file_slots_ == 0) return -ENXIO;
+        if (next_reserved_slot_ >= std::min(reserved_file_slots, fixed_file_slots_)) return -ENFILE;
+        unsigned slot = next_reserved_slot_;
+        int ret = update_fixed_file(slot, fd);
+        if (ret < 0) return ret;
+        next_reserved_slot_++;
+        return static_cast<int>(slot);
+    }
+
+    int io_context::update_fixed_file(unsigned slot, int fd) noexcept {
+        struct io_uring_rsrc_update update
+        {};
+        update.offset = slot;
+        update.data = reinterpret_cast<uintptr_t>(&fd);
+        return register_resource(IORING_REGISTER_FILES_UPDATE, &update, 1);
+    }
 
     void io_context::process_completions() {
         unsigned head = std::atomic_load_explicit((std::atomic<uint32_t>*)cq_.head, std::memory_order_acquire);
@@ -169,21 +340,98 @@ namespace ouroboros::http
         std::atomic_store_explicit((std::atomic<uint32_t>*)cq_.head, head, std::memory_order_release);
     }
 
+    void io_context::stop() noexcept {
+        stop_requested_.store(true, std::memory_order_release);
+        // イベントループが io_uring_enter で待機中でも起床させる
+        uint64_t one = 1;
+        [[maybe_unused]] auto n = ::write(wakeup_fd_.native_handle(), &one, sizeof(one));
+    }
+
+    void io_context::arm_wakeup() {
+        auto *sqe = get_sqe();
+        if (!sqe) return;
+
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = wakeup_fd_.native_handle();
+        sqe->addr = reinterpret_cast<uintptr_t>(&wakeup_value_);
+        sqe->len = sizeof(wakeup_value_);
+        sqe->user_data = reinterpret_cast<uintptr_t>(&wakeup_op_);
+        wakeup_armed_ = true;
+        submit();
+    }
+
+    void io_context::handle_wakeup(int result, uint32_t flags) {
+        (void)result;
+        (void)flags;
+        wakeup_armed_ = false;
+        // 停止要求でなければ (あり得ないが) 再度待ち受ける
+        if (!stop_requested_.load(std::memory_order_acquire)) arm_wakeup();
+    }
+
+    bool io_context::prepare_wait(std::chrono::milliseconds timeout) {
+        if (has_feature(IORING_FEAT_EXT_ARG)) {
+            wait_ts_.tv_sec = timeout.count() / 1000;
+            wait_ts_.tv_nsec = (timeout.count() % 1000) * 1000000;
+            return true;
+        }
+
+        // 発行済みのタイムアウトより早い期限が後から登録されても、遅れは最下位の一周分に収まる
+        if (!timeout_armed_) {
+            timeout = std::min(timeout, std::chrono::milliseconds(timer_wheel::tick * timer_wheel::slots));
+            timeout_ts_.tv_sec = timeout.count() / 1000;
+            timeout_ts_.tv_nsec = (timeout.count() % 1000) * 1000000;
+            if (auto *sqe = get_sqe()) {
+                prepare_timeout(sqe, &timeout_ts_, &timeout_op_);
+                timeout_armed_ = true;
+            }
+        }
+        return false;
+    }
+
+    void io_context::handle_timeout(int result, uint32_t flags) {
+        (void)result;
+        (void)flags;
+        // 期限の来たタイマーはイベントループが発火させる
+        timeout_armed_ = false;
+    }
+
+    io_context *io_context::current() noexcept {
+        return current_context;
+    }
+
     void io_context::run() {
         std::cout << "io_context: Event loop running..." << std::endl;
 
-        while (true) {
-            // 1. 新しい完了イベントが到着するまで、カーネルで効率的に待機する。
-            //    現在のシングルスレッド設計では、すべてのサブミットは完了ハンドラ内から
-            //    行われ、その際にシステムコールが発行されるため、ここでは to_submit=0
-            //    で待機するのが適切です。
-            int ret = io_uring_enter_syscall(ring_fd_.native_handle(), 0, 1, IORING_ENTER_GETEVENTS, nullptr);
-            if (ret < 0 && errno != EINTR) {
+        if (!wakeup_armed_) arm_wakeup();
+
+        io_context *previous = std::exchange(current_context, this);
+        in_loop_ = true;
+        while (!stop_requested_.load(std::memory_order_acquire)) {
+            // 1. 前回の完了処理で積まれた SQE の送信と、新しい完了イベントの待機を
+            //    一度のシステムコールで行う (完了ハンドラの submit() はシステムコールを発行しない)。
+            //    DEFER_TASKRUN では完了処理 (task_work) もこの呼び出しの中で行われる。
+            //    タイマーがあれば次の期限までしか待たない (期限が来ていれば待たない)。
+            std::chrono::milliseconds timeout = timers_.next_timeout();
+            unsigned min_complete = timeout.count() == 0 ? 0 : 1;
+            const __kernel_timespec *wait = timeout.count() > 0 && prepare_wait(timeout) ? &wait_ts_ : nullptr;
+            int ret = enter(publish(), min_complete, IORING_ENTER_GETEVENTS, wait);
+            if (ret < 0 && errno != EINTR && errno != EBUSY && errno != ETIME) {
+                // EBUSY: CQ が溢れている。下で完了を処理してから再試行する
+                // ETIME: 待機のタイムアウト (タイマーの期限)
                 perror("io_uring_enter in run loop failed");
             }
 
             // 2. 待機から復帰後、利用可能なすべての完了イベントを処理する。
             process_completions();
+
+            // 3. 期限の来たタイマーを発火させる (コールバックが積んだ SQE は次の待機と同時に送信される)
+            timers_.advance();
         }
+        in_loop_ = false;
+        current_context = previous;
+        // ループの最後に積まれた SQE (切断時の CLOSE 等) を送信しておく
+        submit();
+
+        std::cout << "io_context: Event loop stopped." << std::endl;
     }
 } // namespace ouroboros::http
\ No newline at end of file
@@ -0,0 +1,353 @@
+#include "ouroboros/http/request_parser.hpp"
+#include "ouroboros/http/char_scanner.hpp"
+#include <limits>
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        constexpr bool is_ows(char c) noexcept {
+            return c == ' ' || c == '\t';
+        }
+
+        constexpr bool is_digit(char c) noexcept {
+            return c >= '0' && c <= '9';
+        }
+
+        // pos にある行末 (CRLF または単独の LF) の直後の位置
+        // データ不足なら 0、行末でなければ npos を返す
+        constexpr size_t after_eol(std::string_view data, size_t pos) noexcept {
+            if (pos >= data.size()) return 0;
+            if (data[pos] == '\n') return pos + 1;
+            if (data[pos] != '\r') return std::string_view::npos;
+            if (pos + 1 >= data.size()) return 0;
+            return data[pos + 1] == '\n' ? pos + 2 : std::string_view::npos;
+        }
+    }
+
+    std::optional<method> parse_method(std::string_view name) noexcept {
+        switch (name.size()) {
+        case 3:
+            if (name == "GET") return method::GET;
+            if (name == "PUT") return method::PUT;
+            break;
+        case 4:
+            if (name == "POST") return method::POST;
+            if (name == "HEAD") return method::HEAD;
+            break;
+        case 5:
+            if (name == "PATCH") return method::PATCH;
+            break;
+        case 6:
+            if (name == "DELETE") return method::DELETE;
+            break;
+        case 7:
+            if (name == "OPTIONS") return method::OPTIONS;
+            break;
+        default:
+            break;
+        }
+        return std::nullopt;
+    }
+
+    void request_parser::reset() noexcept {
+        state_ = state::request_line;
+        line_begin_ = 0;
+        head_end_ = 0;
+        content_length_ = 0;
+        error_status_ = 0;
+        target_ = {};
+        status_ = 0;
+        until_close_ = false;
+        version_minor_ = 1;
+        header_count_ = 0;
+        has_content_length_ = false;
+        chunked_ = false;
+        body_pending_ = false;
+        connection_close_ = false;
+        connection_keep_alive_ = false;
+    }
+
+    parse_status request_parser::fail(int status) noexcept {
+        state_ = state::failed;
+        error_status_ = status;
+        return parse_status::error;
+    }
+
+    size_t request_parser::reject(int status) noexcept {
+        fail(status);
+        return 0;
+    }
+
+    parse_status request_parser::parse(std::string_view data, request &req) noexcept {
+        parse_status status = parse_head(data);
+        if (status != parse_status::complete) return status;
+
+        // --- ボディ ---
+        // 揃っている Content-Length のボディは受信データへのビューとして渡す (コピーなし)。
+        // チャンク形式と、まだ揃っていないボディは呼び出し元が受信しながら読む (body_decoder)
+        if (state_ == state::body) {
+            if (chunked_ || data.size() - head_end_ < content_length_) body_pending_ = true;
+            state_ = state::done;
+        }
+
+        materialize(data, req);
+        return parse_status::complete;
+    }
+
+    parse_status request_parser::parse(std::string_view data, client_response &res, bool eof) noexcept {
+        parse_status status = parse_head(data);
+        if (status != parse_status::complete) {
+            // ヘッダーの途中で閉じられた
+            if (status == parse_status::incomplete && eof) return fail(400);
+            return status;
+        }
+
+        if (state_ == state::body) {
+            if (chunked_) {
+                // チャンク形式のボディは呼び出し元が受信しながら復号する (body_decoder)
+                body_pending_ = true;
+            } else if (until_close_) {
+                // 長さの指定が無いボディは接続の終わりまで
+                content_length_ = data.size() - head_end_;
+                if (content_length_ > limits_.max_body_size) return fail(413);
+                if (!eof) return parse_status::incomplete;
+            } else if (data.size() - head_end_ < content_length_) {
+                return eof ? fail(400) : parse_status::incomplete;
+            }
+            state_ = state::done;
+        }
+
+        // 確保 (ヘッダー配列) に失敗した場合はエラーとして扱う
+        try {
+            materialize(data, res);
+        } catch (...) {
+            return fail(500);
+        }
+        return parse_status::complete;
+    }
+
+    parse_status request_parser::parse_head(std::string_view data, header_list &headers) noexcept {
+        parse_status status = parse_head(data);
+        if (status != parse_status::complete) return status;
+
+        headers.clear();
+        for (size_t i = 0; i < header_count_; ++i) {
+            headers.push_back(headers_[i].first.in(data), headers_[i].second.in(data));
+        }
+        return parse_status::complete;
+    }
+
+    parse_status request_parser::parse_head(std::string_view data) noexcept {
+        if (state_ == state::failed) return parse_status::error;
+        if (state_ == state::body || state_ == state::done) return parse_status::complete;
+
+        // --- リクエストライン / ヘッダー ---
+        // 各行は区切り文字の検出と文字種の検証を一度の走査で行う (char_scanner)。
+        // 行の途中でデータが尽きた場合は、次回その行の先頭から解析し直す
+        // (行長は上限値で制限されるため、再走査のコストは限定的)。
+        while (state_ == state::request_line || state_ == state::headers) {
+            bool request_line = state_ == state::request_line;
+            size_t next = 0;
+            if (line_begin_ < data.size() && (data[line_begin_] == '\r' || data[line_begin_] == '\n')) {
+                next = after_eol(data, line_begin_);
+                if (next == std::string_view::npos) return fail(400);
+                if (next != 0 && state_ == state::headers) {
+                    // 空行: ヘッダー終端
+                    head_end_ = next;
+                    state_ = state::body;
+                    if (mode_ == parser_mode::response) {
+                        // RFC 9112 6.3: HEAD への応答・1xx・204・304 はボディを持たない
+                        if (method_ == method::HEAD || status_ < 200 || status_ == 204 || status_ == 304) {
+                            content_length_ = 0;
+                            chunked_ = false;
+                        } else if (!has_content_length_ && !chunked_) {
+                            until_close_ = true;
+                        }
+                    }
+                }
+                // RFC 9112 2.2: リクエストライン前の空行は無視する
+            } else if (line_begin_ < data.size()) {
+                if (!request_line) next = parse_header_line(data, line_begin_);
+                else if (mode_ == parser_mode::request) next = parse_request_line(data, line_begin_);
+                else next = parse_status_line(data, line_begin_);
+                if (state_ == state::failed) return parse_status::error;
+                if (next != 0 && request_line && next - line_begin_ > limits_.max_request_line) return fail(414);
+            }
+
+            if (next == 0) {
+                // データ不足
+                if (request_line && data.size() - line_begin_ > limits_.max_request_line) {
+                    return fail(414);
+                }
+                if (data.size() > limits_.max_header_bytes) return fail(431);
+                return parse_status::incomplete;
+            }
+            if (next > limits_.max_header_bytes) {
+                return fail(request_line ? 414 : 431);
+            }
+            line_begin_ = next;
+        }
+        return parse_status::complete;
+    }
+
+    size_t request_parser::parse_request_line(std::string_view data, size_t begin) noexcept {
+        // METHOD SP request-target SP HTTP-version CRLF
+        size_t method_end = begin + scan_token(data.substr(begin));
+        if (method_end == data.size()) return 0;
+        if (method_end == begin || data[method_end] != ' ') return reject(400);
+        auto m = parse_method(data.substr(begin, method_end - begin));
+        if (!m) return reject(501);
+
+        size_t target_begin = method_end + 1;
+        size_t target_end = target_begin + scan_target(data.substr(target_begin));
+        if (target_end == data.size()) return 0;
+        if (target_end == target_begin || data[target_end] != ' ') return reject(400);
+
+        // "HTTP/x.y" (固定長)
+        size_t version_begin = target_end + 1;
+        if (data.size() - version_begin < 8) return 0;
+        std::string_view version = data.substr(version_begin, 8);
+        if (version.substr(0, 5) != "HTTP/" || version[6] != '.' || !is_digit(version[5]) || !is_digit(version[7])) {
+            return reject(400);
+        }
+        if (version[5] != '1') return reject(505);
+
+        size_t next = after_eol(data, version_begin + 8);
+        if (next == std::string_view::npos) return reject(400);
+        if (next == 0) return 0;
+
+        method_ = *m;
+        target_ = { static_cast<uint32_t>(target_begin), static_cast<uint32_t>(target_end - target_begin) };
+        version_minor_ = version[7] - '0';
+        state_ = state::headers;
+        return next;
+    }
+
+    size_t request_parser::parse_status_line(std::string_view data, size_t begin) noexcept {
+        // HTTP-version SP status-code SP [ reason-phrase ] CRLF
+        // "HTTP/x.y NNN" (固定長)
+        if (data.size() - begin < 12) return 0;
+        std::string_view head = data.substr(begin, 12);
+        if (head.substr(0, 5) != "HTTP/" || head[6] != '.' || !is_digit(head[5]) || !is_digit(head[7]) || head[8] != ' ') {
+            return reject(400);
+        }
+        if (head[5] != '1') return reject(505);
+        if (!is_digit(head[9]) || !is_digit(head[10]) || !is_digit(head[11]) || head[9] == '0') return reject(400);
+
+        // reason-phrase は省略されることがある (空白も省く実装がある)
+        size_t reason_begin = begin + 12;
+        if (reason_begin < data.size() && data[reason_begin] == ' ') reason_begin++;
+        size_t reason_end = reason_begin + scan_field_value(data.substr(reason_begin));
+        size_t next = after_eol(data, reason_end);
+        if (next == std::string_view::npos) return reject(400);
+        if (next == 0) return 0;
+
+        status_ = (head[9] - '0') * 100 + (head[10] - '0') * 10 + (head[11] - '0');
+        target_ = { static_cast<uint32_t>(reason_begin), static_cast<uint32_t>(reason_end - reason_begin) };
+        version_minor_ = head[7] - '0';
+        state_ = state::headers;
+        return next;
+    }
+
+    size_t request_parser::parse_header_line(std::string_view data, size_t begin) noexcept {
+        // obs-fold (継続行) は RFC 9112 5.2 により拒否する
+        if (is_ows(data[begin])) return reject(400);
+        if (header_count_ >= limits_.max_headers || header_count_ >= headers_.size()) return reject(431);
+
+        // field-name ":" OWS field-value OWS CRLF
+        size_t colon = begin + scan_token(data.substr(begin));
+        if (colon == data.size()) return 0;
+        // 名前とコロンの間の空白も不正
+        if (colon == begin || data[colon] != ':') return reject(400);
+
+        size_t value_begin = colon + 1;
+        while (value_begin < data.size() && is_ows(data[value_begin])) value_begin++;
+        size_t value_end = value_begin + scan_field_value(data.substr(value_begin));
+        size_t next = after_eol(data, value_end);
+        if (next == std::string_view::npos) return reject(400); // CR / LF 以外の制御文字
+        if (next == 0) return 0;
+        while (value_end > value_begin && is_ows(data[value_end - 1])) value_end--;
+
+        std::string_view name = data.substr(begin, colon - begin);
+        std::string_view value = data.substr(value_begin, value_end - value_begin);
+
+        // フレーミングと接続管理に関わるヘッダーはここで解釈する
+        if (iequals(name, "content-length")) {
+            if (value.empty()) return reject(400);
+            size_t length = 0;
+            for (char c : value) {
+                if (c < '0' || c > '9') return reject(400);
+                size_t digit = static_cast<size_t>(c - '0');
+                if (length > (std::numeric_limits<size_t>::max() - digit) / 10) return reject(413);
+                length = length * 10 + digit;
+            }
+            if (has_content_length_ && length != content_length_) return reject(400);
+            // リクエストの上限はルートごとに異なるため、呼び出し元が適用する (http_session)
+            if (mode_ == parser_mode::response && length > limits_.max_body_size) return reject(413);
+            // RFC 9112 6.1: Transfer-Encoding と併用されたメッセージはスマグリングを防ぐため拒否する
+            if (chunked_) return reject(400);
+            has_content_length_ = true;
+            content_length_ = length;
+        } else if (iequals(name, "transfer-encoding")) {
+            // "chunked" のみ (他のコーディングは 501。レスポンスでは呼び出し元が不正なレスポンスとして扱う)
+            if (!iequals(value, "chunked")) return reject(501);
+            if (chunked_ || has_content_length_) return reject(400);
+            chunked_ = true;
+        } else if (iequals(name, "connection")) {
+            // カンマ区切りのトークンリスト
+            std::string_view rest = value;
+            while (!rest.empty()) {
+                size_t comma = rest.find(',');
+                std::string_view token = rest.substr(0, comma);
+                while (!token.empty() && is_ows(token.front())) token.remove_prefix(1);
+                while (!token.empty() && is_ows(token.back())) token.remove_suffix(1);
+                if (iequals(token, "close")) connection_close_ = true;
+                else if (iequals(token, "keep-alive")) connection_keep_alive_ = true;
+                if (comma == std::string_view::npos) break;
+                rest.remove_prefix(comma + 1);
+            }
+        }
+
+        headers_[header_count_++] = {
+            range{ static_cast<uint32_t>(begin), static_cast<uint32_t>(name.size()) },
+            range{ static_cast<uint32_t>(value_begin), static_cast<uint32_t>(value.size()) },
+        };
+        return next;
+    }
+
+    void request_parser::materialize(std::string_view data, request &req) const noexcept {
+        req.method = method_;
+        req.target = target_.in(data);
+        size_t question = req.target.find('?');
+        req.path = req.target.substr(0, question);
+        req.query = question == std::string_view::npos ? std::string_view{} : req.target.substr(question + 1);
+        req.version_minor = version_minor_;
+
+        req.headers.clear();
+        for (size_t i = 0; i < header_count_; ++i) {
+            req.headers.push_back(headers_[i].first.in(data), headers_[i].second.in(data));
+        }
+
+        req.body = body_pending_ ? std::string_view{} : data.substr(head_end_, content_length_);
+        req.body_file = -1;
+        // HTTP/1.1 は既定で持続接続、HTTP/1.0 は明示された場合のみ
+        req.keep_alive = version_minor_ >= 1 ? !connection_close_ : (connection_keep_alive_ && !connection_close_);
+    }
+
+    void request_parser::materialize(std::string_view data, client_response &res) const {
+        res.status = status_;
+        res.reason = target_.in(data);
+        res.version_minor = version_minor_;
+
+        res.headers.clear();
+        res.headers.reserve(header_count_);
+        for (size_t i = 0; i < header_count_; ++i) {
+            res.headers.push_back({ headers_[i].first.in(data), headers_[i].second.in(data) });
+        }
+
+        res.body = body_pending_ ? std::string_view{} : data.substr(head_end_, content_length_);
+        // 接続の終わりで区切られたボディの後は再利用できない
+        res.keep_alive = keep_alive();
+    }
+}
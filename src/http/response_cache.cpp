@@ -0,0 +1,92 @@
+#include "ouroboros/http/response_cache.hpp"
+#include "ouroboros/http/response_writer.hpp"
+#include <cstring>
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        constexpr std::string_view connection_close = "Connection: close\r\n";
+        constexpr std::string_view connection_keep_alive = "Connection: keep-alive\r\n";
+
+        char *put(char *p, const char *data, size_t size) noexcept {
+            std::memcpy(p, data, size);
+            return p + size;
+        }
+    }
+
+    response_cache::response_cache(size_t capacity, size_t max_entry_size)
+        : capacity_(capacity), max_entry_size_(max_entry_size) {
+        index_.reserve(capacity);
+    }
+
+    bool response_cache::write(std::string_view target, std::string &out, bool omit_body, bool close) {
+        auto found = index_.find(target);
+        if (found == index_.end()) {
+            misses_++;
+            return false;
+        }
+        auto it = found->second;
+        const entry &e = *it;
+        bool expired = e.expires != std::chrono::steady_clock::time_point::max() &&
+                       std::chrono::steady_clock::now() >= e.expires;
+        if (expired || (e.tag && e.tag->generation() != e.generation)) {
+            erase(it);
+            misses_++;
+            return false;
+        }
+        lru_.splice(lru_.begin(), lru_, it);
+        hits_++;
+
+        // ステータスライン〜Content-Length | Date | Connection | 残りのヘッダー (とボディ)
+        std::string_view date = date_header();
+        std::string_view connection = close ? connection_close : connection_keep_alive;
+        size_t end = omit_body ? e.body_offset : e.wire.size();
+        size_t length = e.date_offset + date.size() + connection.size() + (end - e.connection_end);
+
+        size_t offset = out.size();
+        out.resize_and_overwrite(offset + length, [&](char *data, size_t) noexcept {
+            char *p = put(data + offset, e.wire.data(), e.date_offset);
+            p = put(p, date.data(), date.size());
+            p = put(p, connection.data(), connection.size());
+            p = put(p, e.wire.data() + e.connection_end, end - e.connection_end);
+            return static_cast<size_t>(p - data);
+        });
+        return true;
+    }
+
+    void response_cache::store(std::string_view target, const response &res, const response_cache_policy &policy,
+        uint64_t generation) {
+        if (!policy || capacity_ == 0 || res.status_code() != 200 || res.has_file()) return;
+        if (response_size(res, false, false) > max_entry_size_) return;
+
+        entry e;
+        e.key.assign(target);
+        write_response(e.wire, res, false, false);
+        // Date と Connection は write_response() がステータスライン (と Content-Length) の直後に書く
+        e.date_offset = e.wire.find("\r\nDate: ") + 2;
+        e.date_end = e.wire.find("\r\n", e.date_offset) + 2;
+        e.connection_end = e.date_end + connection_keep_alive.size();
+        e.body_offset = e.wire.find("\r\n\r\n", e.connection_end - 2) + 4;
+        e.expires = policy.ttl.count() > 0 ? std::chrono::steady_clock::now() + policy.ttl
+                                           : std::chrono::steady_clock::time_point::max();
+        e.tag = policy.tag;
+        e.generation = generation;
+
+        if (auto found = index_.find(target); found != index_.end()) erase(found->second);
+        while (lru_.size() >= capacity_) erase(std::prev(lru_.end()));
+
+        lru_.push_front(std::move(e));
+        index_.emplace(lru_.front().key, lru_.begin());
+    }
+
+    void response_cache::clear() noexcept {
+        index_.clear();
+        lru_.clear();
+    }
+
+    void response_cache::erase(std::list<entry>::iterator it) {
+        index_.erase(it->key);
+        lru_.erase(it);
+    }
+}
@@ -0,0 +1,269 @@
+#include "ouroboros/http/response_writer.hpp"
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        struct status_entry
+        {
+            int code;
+            std::string_view line;
+        };
+
+        // RFC 9110 および広く使われている拡張のステータスコード
+        constexpr status_entry standard_statuses[] = {
+            { 100, "HTTP/1.1 100 Continue\r\n" },
+            { 101, "HTTP/1.1 101 Switching Protocols\r\n" },
+            { 102, "HTTP/1.1 102 Processing\r\n" },
+            { 103, "HTTP/1.1 103 Early Hints\r\n" },
+            { 200, "HTTP/1.1 200 OK\r\n" },
+            { 201, "HTTP/1.1 201 Created\r\n" },
+            { 202, "HTTP/1.1 202 Accepted\r\n" },
+            { 203, "HTTP/1.1 203 Non-Authoritative Information\r\n" },
+            { 204, "HTTP/1.1 204 No Content\r\n" },
+            { 205, "HTTP/1.1 205 Reset Content\r\n" },
+            { 206, "HTTP/1.1 206 Partial Content\r\n" },
+            { 207, "HTTP/1.1 207 Multi-Status\r\n" },
+            { 208, "HTTP/1.1 208 Already Reported\r\n" },
+            { 226, "HTTP/1.1 226 IM Used\r\n" },
+            { 300, "HTTP/1.1 300 Multiple Choices\r\n" },
+            { 301, "HTTP/1.1 301 Moved Permanently\r\n" },
+            { 302, "HTTP/1.1 302 Found\r\n" },
+            { 303, "HTTP/1.1 303 See Other\r\n" },
+            { 304, "HTTP/1.1 304 Not Modified\r\n" },
+            { 305, "HTTP/1.1 305 Use Proxy\r\n" },
+            { 307, "HTTP/1.1 307 Temporary Redirect\r\n" },
+            { 308, "HTTP/1.1 308 Permanent Redirect\r\n" },
+            { 400, "HTTP/1.1 400 Bad Request\r\n" },
+            { 401, "HTTP/1.1 401 Unauthorized\r\n" },
+            { 402, "HTTP/1.1 402 Payment Required\r\n" },
+            { 403, "HTTP/1.1 403 Forbidden\r\n" },
+            { 404, "HTTP/1.1 404 Not Found\r\n" },
+            { 405, "HTTP/1.1 405 Method Not Allowed\r\n" },
+            { 406, "HTTP/1.1 406 Not Acceptable\r\n" },
+            { 407, "HTTP/1.1 407 Proxy Authentication Required\r\n" },
+            { 408, "HTTP/1.1 408 Request Timeout\r\n" },
+            { 409, "HTTP/1.1 409 Conflict\r\n" },
+            { 410, "HTTP/1.1 410 Gone\r\n" },
+            { 411, "HTTP/1.1 411 Length Required\r\n" },
+            { 412, "HTTP/1.1 412 Precondition Failed\r\n" },
+            { 413, "HTTP/1.1 413 Content Too Large\r\n" },
+            { 414, "HTTP/1.1 414 URI Too Long\r\n" },
+            { 415, "HTTP/1.1 415 Unsupported Media Type\r\n" },
+            { 416, "HTTP/1.1 416 Range Not Satisfiable\r\n" },
+            { 417, "HTTP/1.1 417 Expectation Failed\r\n" },
+            { 418, "HTTP/1.1 418 I'm a teapot\r\n" },
+            { 421, "HTTP/1.1 421 Misdirected Request\r\n" },
+            { 422, "HTTP/1.1 422 Unprocessable Content\r\n" },
+            { 423, "HTTP/1.1 423 Locked\r\n" },
+            { 424, "HTTP/1.1 424 Failed Dependency\r\n" },
+            { 425, "HTTP/1.1 425 Too Early\r\n" },
+            { 426, "HTTP/1.1 426 Upgrade Required\r\n" },
+            { 428, "HTTP/1.1 428 Precondition Required\r\n" },
+            { 429, "HTTP/1.1 429 Too Many Requests\r\n" },
+            { 431, "HTTP/1.1 431 Request Header Fields Too Large\r\n" },
+            { 451, "HTTP/1.1 451 Unavailable For Legal Reasons\r\n" },
+            { 500, "HTTP/1.1 500 Internal Server Error\r\n" },
+            { 501, "HTTP/1.1 501 Not Implemented\r\n" },
+            { 502, "HTTP/1.1 502 Bad Gateway\r\n" },
+            { 503, "HTTP/1.1 503 Service Unavailable\r\n" },
+            { 504, "HTTP/1.1 504 Gateway Timeout\r\n" },
+            { 505, "HTTP/1.1 505 HTTP Version Not Supported\r\n" },
+            { 506, "HTTP/1.1 506 Variant Also Negotiates\r\n" },
+            { 507, "HTTP/1.1 507 Insufficient Storage\r\n" },
+            { 508, "HTTP/1.1 508 Loop Detected\r\n" },
+            { 510, "HTTP/1.1 510 Not Extended\r\n" },
+            { 511, "HTTP/1.1 511 Network Authentication Required\r\n" },
+        };
+
+        // コード (100-599) で直接引ける表
+        constexpr auto status_lines = [] {
+            std::array<std::string_view, 500> table{};
+            for (const auto &entry : standard_statuses) table[static_cast<size_t>(entry.code - 100)] = entry.line;
+            return table;
+        }();
+
+        constexpr std::string_view content_length_prefix = "Content-Length: ";
+        constexpr std::string_view transfer_encoding_chunked = "Transfer-Encoding: chunked\r\n";
+        constexpr std::string_view connection_close = "Connection: close\r\n";
+        constexpr std::string_view connection_keep_alive = "Connection: keep-alive\r\n";
+        constexpr std::string_view crlf = "\r\n";
+
+        // "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+        constexpr size_t date_header_length = 37;
+
+        struct date_cache
+        {
+            std::time_t second = -1;
+            char text[date_header_length + 1];
+        };
+
+        void put2(char *p, int value) noexcept {
+            p[0] = static_cast<char>('0' + value / 10);
+            p[1] = static_cast<char>('0' + value % 10);
+        }
+
+        void render_date(date_cache &cache, std::time_t now) noexcept {
+            static constexpr char days[7][4] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+            static constexpr char months[12][4] = {
+                "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+            };
+
+            std::tm tm{};
+            gmtime_r(&now, &tm);
+
+            // ロケールに依存しないよう strftime は使わない
+            char *p = cache.text;
+            std::memcpy(p, "Date: ", 6);
+            std::memcpy(p + 6, days[tm.tm_wday], 3);
+            std::memcpy(p + 9, ", ", 2);
+            put2(p + 11, tm.tm_mday);
+            p[13] = ' ';
+            std::memcpy(p + 14, months[tm.tm_mon], 3);
+            p[17] = ' ';
+            int year = tm.tm_year + 1900;
+            put2(p + 18, year / 100);
+            put2(p + 20, year % 100);
+            p[22] = ' ';
+            put2(p + 23, tm.tm_hour);
+            p[25] = ':';
+            put2(p + 26, tm.tm_min);
+            p[28] = ':';
+            put2(p + 29, tm.tm_sec);
+            std::memcpy(p + 31, " GMT\r\n", 6);
+            cache.second = now;
+        }
+
+        // ハンドラからは設定させないヘッダー
+        bool is_managed_header(std::string_view name) noexcept {
+            return iequals(name, "content-length") || iequals(name, "transfer-encoding") || iequals(name, "date") ||
+                   iequals(name, "connection");
+        }
+
+        char *put(char *p, std::string_view s) noexcept {
+            std::memcpy(p, s.data(), s.size());
+            return p + s.size();
+        }
+    }
+
+    std::string_view status_line(int status) noexcept {
+        if (status < 100 || status > 599) return {};
+        return status_lines[static_cast<size_t>(status - 100)];
+    }
+
+    std::string_view date_header() noexcept {
+        thread_local date_cache cache;
+        // CLOCK_REALTIME_COARSE は vDSO で読めるため、毎回呼んでもシステムコールにならない
+        timespec ts{};
+        clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+        if (ts.tv_sec != cache.second) render_date(cache, ts.tv_sec);
+        return { cache.text, date_header_length };
+    }
+
+    namespace
+    {
+        // レスポンスの各部分 (長さを求めてから書き込むため、一度だけ組み立てる)
+        struct response_layout
+        {
+            std::string_view line;
+            char custom_line[16]; // "HTTP/1.1 NNN \r\n"
+            bool bodiless;
+            // 長さの分からないストリーミングのボディ: keep-alive なら chunked、閉じるなら接続の終わりまで
+            bool chunked;
+            bool until_close;
+            char length_digits[20];
+            std::string_view length;
+            std::string_view date;
+            std::string_view connection;
+            std::string_view body;
+            size_t total;
+
+            response_layout(const response &res, bool omit_body, bool close) noexcept {
+                // ステータスライン: 標準外のコードは理由句を空にする (RFC 9112 4)。範囲外は 500 とする
+                int status = res.status_code();
+                if (status < 100 || status > 999) status = 500;
+                line = status_line(status);
+                if (line.empty()) {
+                    std::memcpy(custom_line, "HTTP/1.1 ", 9);
+                    std::to_chars(custom_line + 9, custom_line + 12, status);
+                    std::memcpy(custom_line + 12, " \r\n", 3);
+                    line = { custom_line, 15 };
+                }
+
+                // 1xx / 204 / 304 はボディを持たない (RFC 9110 6.4.1)
+                bodiless = status < 200 || status == 204 || status == 304;
+                bool unknown_length = res.has_stream() && !res.has_content_length();
+                chunked = unknown_length && !close;
+                until_close = unknown_length && close;
+
+                auto length_end = std::to_chars(length_digits, length_digits + sizeof(length_digits), res.content_length()).ptr;
+                length = { length_digits, static_cast<size_t>(length_end - length_digits) };
+
+                date = date_header();
+                connection = close ? connection_close : connection_keep_alive;
+                body = omit_body || bodiless ? std::string_view{} : res.body();
+
+                total = line.size() + date.size() + connection.size() + crlf.size() + body.size();
+                if (!bodiless) {
+                    if (chunked) {
+                        total += transfer_encoding_chunked.size();
+                    } else if (!until_close) {
+                        total += content_length_prefix.size() + length.size() + crlf.size();
+                    }
+                }
+                for (const auto &h : res.headers()) {
+                    if (!is_managed_header(h.name)) total += h.name.size() + 2 + h.value.size() + crlf.size();
+                }
+            }
+
+            // custom_line を指すため、コピー・移動しない
+            response_layout(const response_layout &) = delete;
+            response_layout &operator=(const response_layout &) = delete;
+
+            char *write(char *p, const response &res) const noexcept {
+                p = put(p, line);
+                if (!bodiless) {
+                    if (chunked) {
+                        p = put(p, transfer_encoding_chunked);
+                    } else if (!until_close) {
+                        p = put(p, content_length_prefix);
+                        p = put(p, length);
+                        p = put(p, crlf);
+                    }
+                }
+                p = put(p, date);
+                p = put(p, connection);
+                for (const auto &h : res.headers()) {
+                    if (is_managed_header(h.name)) continue;
+                    p = put(p, h.name);
+                    p = put(p, ": ");
+                    p = put(p, h.value);
+                    p = put(p, crlf);
+                }
+                p = put(p, crlf);
+                return put(p, body);
+            }
+        };
+    }
+
+    void write_response(std::string &out, const response &res, bool omit_body, bool close) {
+        // 必要な長さを先に求め、一度だけ伸長する
+        response_layout layout(res, omit_body, close);
+        size_t offset = out.size();
+        out.resize_and_overwrite(offset + layout.total, [&](char *data, size_t) noexcept {
+            return static_cast<size_t>(layout.write(data + offset, res) - data);
+        });
+    }
+
+    size_t response_size(const response &res, bool omit_body, bool close) noexcept {
+        return response_layout(res, omit_body, close).total;
+    }
+
+    char *write_response(char *dst, const response &res, bool omit_body, bool close) noexcept {
+        return response_layout(res, omit_body, close).write(dst, res);
+    }
+}
@@ -0,0 +1,586 @@
+#include "ouroboros/http/reverse_proxy.hpp"
+#include "ouroboros/http/error.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <system_error>
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        // ヘッダーと共に読み込むボディはユーザー空間を経由するため、受信バッファは小さく始める
+        constexpr size_t initial_buffer_size = 4096;
+
+        // 応答前に接続が閉じられた場合に送り直してよいメソッド (RFC 9110 9.2.2)
+        constexpr bool idempotent(method m) noexcept {
+            return m != method::POST && m != method::PATCH;
+        }
+
+        // 転送しないヘッダー (RFC 9110 7.6.1 のホップバイホップヘッダーと、プロキシが付け直すもの)
+        constexpr std::string_view hop_by_hop_headers[] = {
+            "connection", "keep-alive", "proxy-connection", "te", "trailer", "transfer-encoding", "upgrade",
+            "proxy-authenticate", "proxy-authorization",
+        };
+
+        constexpr bool is_ows(char c) noexcept {
+            return c == ' ' || c == '\t';
+        }
+
+        // Connection ヘッダー (カンマ区切りのトークンリスト) に name が含まれるか
+        bool listed_in(std::string_view connection, std::string_view name) noexcept {
+            while (!connection.empty()) {
+                size_t comma = connection.find(',');
+                std::string_view token = connection.substr(0, comma);
+                while (!token.empty() && is_ows(token.front())) token.remove_prefix(1);
+                while (!token.empty() && is_ows(token.back())) token.remove_suffix(1);
+                if (iequals(token, name)) return true;
+                if (comma == std::string_view::npos) break;
+                connection.remove_prefix(comma + 1);
+            }
+            return false;
+        }
+
+        bool is_hop_by_hop(std::string_view name, std::string_view connection) noexcept {
+            for (auto header : hop_by_hop_headers) {
+                if (iequals(name, header)) return true;
+            }
+            return listed_in(connection, name);
+        }
+
+        // 設定で削除・置き換えるヘッダーか
+        bool is_rewritten(std::string_view name, const std::vector<std::string> &removed,
+            const std::vector<std::pair<std::string, std::string>> &replaced) noexcept {
+            for (const auto &r : removed) {
+                if (iequals(name, r)) return true;
+            }
+            for (const auto &r : replaced) {
+                if (iequals(name, r.first)) return true;
+            }
+            return false;
+        }
+
+        void append_header(std::string &out, std::string_view name, std::string_view value) {
+            out += name;
+            out += ": ";
+            out += value;
+            out += "\r\n";
+        }
+    }
+
+    // --- reverse_proxy ---
+
+    reverse_proxy::reverse_proxy(proxy_options options) {
+        if (options.backends.empty()) throw std::invalid_argument("reverse_proxy: no backends");
+
+        auto route = std::make_shared<proxy_route>();
+        for (const auto &b : options.backends) {
+            proxy_route::backend resolved;
+            if (!resolve_address(b.host, b.port, resolved.address)) {
+                throw std::system_error(make_error_code(error_code::address_resolution_failed), "reverse_proxy: " + b.host);
+            }
+            resolved.host_header = host_header_value(b.host, b.port);
+            resolved.name = b.host + ":" + std::to_string(b.port);
+            route->backends.push_back(std::move(resolved));
+        }
+        route->options = std::move(options);
+        route_ = std::move(route);
+    }
+
+    void reverse_proxy::operator()(const request &req, response &res) const {
+        std::string_view target = req.target;
+        const std::string &prefix = route_->options.strip_prefix;
+        if (!prefix.empty() && target.starts_with(prefix)) {
+            // "/api" は "/apis" には一致させない
+            std::string_view rest = target.substr(prefix.size());
+            if (!rest.empty() && rest.front() == '/') {
+                target = rest;
+            } else if (rest.empty() || rest.front() == '?') {
+                std::pmr::string root(res.arena());
+                root.append("/").append(rest);
+                res.proxy_pass(*route_, root);
+                return;
+            }
+        }
+        res.proxy_pass(*route_, target);
+    }
+
+    void reverse_proxy::mount(std::vector<route_entry> &routes, std::string_view path) const {
+        for (size_t i = 0; i < method_count; ++i) {
+            routes.push_back({ static_cast<method>(i), std::string(path), *this });
+        }
+    }
+
+    // --- upstream_pool ---
+
+    upstream_pool::upstream_pool(const proxy_route &route) : route_(route), backends_(route.backends.size()) {}
+
+    size_t upstream_pool::select(clock::time_point now, size_t exclude) {
+        size_t n = backends_.size();
+        size_t best = npos;
+        for (size_t i = 0; i < n; ++i) {
+            size_t index = (next_ + i) % n;
+            if (index == exclude && n > 1) continue;
+            const backend_state &b = backends_[index];
+            if (b.down_until > now) continue;
+            if (route_.options.balance == balance_policy::round_robin) {
+                best = index;
+                break;
+            }
+            if (best == npos || b.outstanding < backends_[best].outstanding) best = index;
+        }
+        if (best == npos) {
+            // 全て停止中: 最も早く復帰するサーバーを試す (成功すれば停止が解ける)
+            for (size_t index = 0; index < n; ++index) {
+                if (index == exclude && n > 1) continue;
+                if (best == npos || backends_[index].down_until < backends_[best].down_until) best = index;
+            }
+        }
+        // 同数の場合の開始位置も回すため、次は選んだサーバーの次から探す
+        next_ = (best + 1) % n;
+        backends_[best].outstanding++;
+        return best;
+    }
+
+    void upstream_pool::report(size_t index, bool success, clock::time_point now) {
+        backend_state &b = backends_[index];
+        if (success) {
+            b.fails = 0;
+            b.down_until = {};
+            return;
+        }
+        const proxy_options &options = route_.options;
+        if (options.max_fails == 0 || ++b.fails < options.max_fails) return;
+        b.fails = 0;
+        b.down_until = now + options.fail_timeout;
+        // 停止中の接続は使わない
+        b.idle.clear();
+        std::cerr << "Upstream " << route_.backends[index].name << " marked unavailable for "
+                  << options.fail_timeout.count() << " ms." << std::endl;
+    }
+
+    unique_socket upstream_pool::acquire(size_t index, clock::time_point now) {
+        auto &idle = backends_[index].idle;
+        if (idle.empty()) return {};
+        // 最も新しいものから使う。それが期限切れなら残り (より古いもの) も全て期限切れ
+        idle_connection conn = std::move(idle.back());
+        idle.pop_back();
+        if (now - conn.since > route_.options.idle_timeout) {
+            idle.clear();
+            return {};
+        }
+        return std::move(conn.socket);
+    }
+
+    void upstream_pool::release(size_t index, unique_socket socket, clock::time_point now) {
+        auto &idle = backends_[index].idle;
+        if (idle.size() >= route_.options.max_idle_connections) return;
+        idle.push_back({ std::move(socket), now });
+    }
+
+    // --- proxy_transfer ---
+
+    int proxy_transfer::start(upstream_pool &pool, const request &req, std::string_view target, task &done) {
+        const proxy_options &options = pool.route().options;
+        pool_ = &pool;
+        done_ = &done;
+        method_ = req.method;
+        attempts_ = 0;
+        retried_ = false;
+        timed_out_ = false;
+        cancelled_ = false;
+        excess_ = false;
+        body_prefix_ = {};
+        body_remaining_ = 0;
+        body_read_ = 0;
+
+        // ボディはパーサーを通さずに転送するため、長さの上限は設けない
+        parser_ = request_parser(parser_mode::response,
+            { .max_header_bytes = options.max_response_header, .max_body_size = std::numeric_limits<size_t>::max() });
+        parser_.set_request_method(method_);
+        if (in_.empty()) in_.resize(initial_buffer_size);
+
+        backend_ = pool.select(upstream_pool::clock::now());
+        serialize(req, target);
+        if (!open(false)) {
+            socket_ = unique_socket();
+            pool.done(backend_);
+            backend_ = upstream_pool::npos;
+            stage_ = stage::idle;
+            return 502;
+        }
+        return 0;
+    }
+
+    void proxy_transfer::serialize(const request &req, std::string_view target) {
+        const proxy_options &options = pool_->route().options;
+        std::string_view host = req.header("Host");
+        std::string_view connection = req.header("Connection");
+
+        size_t size = target.size() + req.body.size() + 128;
+        for (const auto &h : req.headers) size += h.name.size() + h.value.size() + 4;
+        out_.clear();
+        out_.reserve(size);
+
+        out_ += to_string(req.method);
+        out_ += ' ';
+        out_ += target;
+        out_ += " HTTP/1.1\r\n";
+        host_begin_ = out_.size();
+        host_fixed_ = options.preserve_host && !host.empty();
+        append_header(out_, "Host", host_fixed_ ? host : std::string_view(pool_->route().backends[backend_].host_header));
+        host_end_ = out_.size();
+
+        for (const auto &h : req.headers) {
+            // フレーミングはプロキシが決める。ボディは受信済みのため Expect も送らない
+            if (iequals(h.name, "host") || iequals(h.name, "content-length") || iequals(h.name, "expect")) continue;
+            if (iequals(h.name, "x-forwarded-proto") || (!options.preserve_host && iequals(h.name, "x-forwarded-host"))) {
+                continue;
+            }
+            if (is_hop_by_hop(h.name, connection)) continue;
+            if (is_rewritten(h.name, options.remove_request_headers, options.set_request_headers)) continue;
+            append_header(out_, h.name, h.value);
+        }
+        if (!options.preserve_host && !host.empty()) append_header(out_, "X-Forwarded-Host", host);
+        append_header(out_, "X-Forwarded-Proto", "http");
+        for (const auto &[name, value] : options.set_request_headers) append_header(out_, name, value);
+
+        if (!req.body.empty() || req.method == method::POST || req.method == method::PUT || req.method == method::PATCH) {
+            char length[24];
+            auto end = std::to_chars(length, length + sizeof(length), req.body.size()).ptr;
+            append_header(out_, "Content-Length", std::string_view(length, static_cast<size_t>(end - length)));
+        }
+        out_ += "\r\n";
+        out_ += req.body;
+    }
+
+    void proxy_transfer::set_host() {
+        if (host_fixed_) return;
+        std::string line = "Host: " + pool_->route().backends[backend_].host_header + "\r\n";
+        out_.replace(host_begin_, host_end_ - host_begin_, line);
+        host_end_ = host_begin_ + line.size();
+    }
+
+    bool proxy_transfer::open(bool fresh) {
+        const proxy_options &options = pool_->route().options;
+        auto now = upstream_pool::clock::now();
+        out_sent_ = 0;
+        in_used_ = 0;
+
+        socket_ = fresh ? unique_socket() : pool_->acquire(backend_, now);
+        reused_ = static_cast<bool>(socket_);
+        if (reused_) {
+            stage_ = stage::sending;
+            ctx_.timers().arm(timer_, options.read_timeout);
+            return submit_send();
+        }
+
+        // ボディの SPLICE は io-wq でブロックして待つため、ブロッキングソケットにする
+        // (O_NONBLOCK ではデータが届いていない時に -EAGAIN で完了してしまう)
+        const socket_address &address = pool_->route().backends[backend_].address;
+        int fd = ::socket(address.family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        socket_ = unique_socket(fd);
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        pool_->connection_opened();
+
+        stage_ = stage::connecting;
+        ctx_.timers().arm(timer_, options.connect_timeout);
+        return submit_connect();
+    }
+
+    bool proxy_transfer::submit_connect() {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return false;
+        const socket_address &address = pool_->route().backends[backend_].address;
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->fd = socket_.native_handle();
+        sqe->addr = reinterpret_cast<uintptr_t>(address.get());
+        sqe->off = address.length;
+        sqe->user_data = reinterpret_cast<uintptr_t>(&io_op_);
+        armed_ = true;
+        ctx_.submit();
+        return true;
+    }
+
+    bool proxy_transfer::submit_send() {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = socket_.native_handle();
+        sqe->addr = reinterpret_cast<uintptr_t>(out_.data() + out_sent_);
+        sqe->len = static_cast<uint32_t>(out_.size() - out_sent_);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = reinterpret_cast<uintptr_t>(&io_op_);
+        armed_ = true;
+        ctx_.submit();
+        return true;
+    }
+
+    bool proxy_transfer::submit_recv() {
+        if (in_used_ == in_.size()) {
+            // ヘッダーの上限まで拡張する (それ以上はパーサーが失敗させる)
+            in_.resize(std::min(in_.size() * 2, pool_->route().options.max_response_header + 1));
+        }
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = socket_.native_handle();
+        sqe->addr = reinterpret_cast<uintptr_t>(in_.data() + in_used_);
+        sqe->len = static_cast<uint32_t>(in_.size() - in_used_);
+        sqe->user_data = reinterpret_cast<uintptr_t>(&io_op_);
+        armed_ = true;
+        ctx_.submit();
+        return true;
+    }
+
+    void proxy_transfer::submit_cancel() noexcept {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return;
+        // 対象操作は -ECANCELED で完了する。キャンセル自体の完了通知は不要
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uintptr_t>(&io_op_);
+        sqe->user_data = 0;
+        ctx_.submit();
+    }
+
+    void proxy_transfer::cancel() noexcept {
+        if (!armed_ || cancelled_) return;
+        cancelled_ = true;
+        timer_.cancel();
+        submit_cancel();
+    }
+
+    void proxy_transfer::handle_timeout(int, uint32_t) {
+        if (!armed_ || cancelled_) return;
+        // 実行中の操作を取り消し、その完了で失敗として扱う
+        timed_out_ = true;
+        submit_cancel();
+    }
+
+    void proxy_transfer::handle_io(int result, uint32_t) {
+        armed_ = false;
+        if (cancelled_) {
+            // クライアントの接続が閉じられた: 上流の失敗ではない
+            socket_ = unique_socket();
+            pool_->done(backend_);
+            backend_ = upstream_pool::npos;
+            complete(502);
+            return;
+        }
+        bool timed_out = std::exchange(timed_out_, false);
+
+        switch (stage_) {
+        case stage::connecting:
+            if (result < 0 || timed_out) {
+                connect_failed(timed_out ? 504 : 502);
+                return;
+            }
+            stage_ = stage::sending;
+            ctx_.timers().arm(timer_, pool_->route().options.read_timeout);
+            if (!submit_send()) fail(502);
+            return;
+
+        case stage::sending:
+            if (timed_out) {
+                fail(504);
+                return;
+            }
+            if (result <= 0) {
+                if (!retry_stale()) fail(502);
+                return;
+            }
+            out_sent_ += static_cast<size_t>(result);
+            if (out_sent_ < out_.size()) {
+                if (!submit_send()) fail(502);
+                return;
+            }
+            stage_ = stage::receiving;
+            if (!submit_recv()) fail(502);
+            return;
+
+        case stage::receiving:
+            if (timed_out) {
+                fail(504);
+                return;
+            }
+            if (result <= 0) {
+                // 何も受信せずに閉じられた再利用の接続は、上流の Keep-Alive タイムアウトと行き違った可能性が高い
+                if (in_used_ > 0 || !retry_stale()) fail(502);
+                return;
+            }
+            in_used_ += static_cast<size_t>(result);
+            parse();
+            return;
+
+        default:
+            return;
+        }
+    }
+
+    void proxy_transfer::parse() {
+        while (true) {
+            std::string_view data(in_.data(), in_used_);
+            switch (parser_.parse_head(data, headers_)) {
+            case parse_status::incomplete:
+                if (!submit_recv()) fail(502);
+                return;
+            case parse_status::error:
+                // 不正・上限超過
+                fail(502);
+                return;
+            case parse_status::complete:
+                break;
+            }
+
+            int status = parser_.status();
+            size_t head = parser_.head_size();
+            if (status == 101) {
+                // Upgrade は転送していないため、切り替えられても中継できない
+                fail(502);
+                return;
+            }
+            if (status < 200) {
+                // 1xx (100 Continue / 103 Early Hints) は転送せずに読み捨てる
+                std::memmove(in_.data(), in_.data() + head, in_used_ - head);
+                in_used_ -= head;
+                parser_.reset();
+                parser_.set_request_method(method_);
+                continue;
+            }
+
+            pool_->report(backend_, true, upstream_pool::clock::now());
+            if (parser_.chunked()) {
+                // ヘッダーと共に受信したチャンクは relay_chunked() が区切りを調べながら書く
+                decoder_.reset_chunked();
+                body_read_ = head;
+                complete(0);
+                return;
+            }
+            body_prefix_ = data.substr(head);
+            if (!parser_.body_until_close()) {
+                uint64_t length = parser_.body_length();
+                if (body_prefix_.size() > length) {
+                    // ボディより後ろのデータ (要求していないレスポンス) は捨て、接続も再利用しない
+                    body_prefix_ = body_prefix_.substr(0, length);
+                    excess_ = true;
+                }
+                body_remaining_ = length - body_prefix_.size();
+            }
+            complete(0);
+            return;
+        }
+    }
+
+    void proxy_transfer::connect_failed(int status) {
+        auto now = upstream_pool::clock::now();
+        socket_ = unique_socket();
+        pool_->report(backend_, false, now);
+        pool_->done(backend_);
+        size_t failed = std::exchange(backend_, upstream_pool::npos);
+
+        // まだ何も送っていないため、どのメソッドも他のサーバーで試してよい
+        if (++attempts_ < pool_->size()) {
+            backend_ = pool_->select(now, failed);
+            set_host();
+            if (open(false)) return;
+            socket_ = unique_socket();
+            pool_->done(backend_);
+            backend_ = upstream_pool::npos;
+        }
+        complete(status);
+    }
+
+    bool proxy_transfer::retry_stale() {
+        if (!reused_ || retried_ || !idempotent(method_)) return false;
+        retried_ = true;
+        socket_ = unique_socket();
+        // プールの他の接続も同じ理由で閉じられている可能性が高いため、新しく接続する
+        if (!open(true)) fail(502);
+        return true;
+    }
+
+    void proxy_transfer::fail(int status) {
+        socket_ = unique_socket();
+        pool_->report(backend_, false, upstream_pool::clock::now());
+        pool_->done(backend_);
+        backend_ = upstream_pool::npos;
+        complete(status);
+    }
+
+    void proxy_transfer::complete(int status) {
+        timer_.cancel();
+        stage_ = status == 0 ? stage::done : stage::idle;
+        done_->complete(status, 0);
+    }
+
+    void proxy_transfer::finish(bool reusable) {
+        if (backend_ == upstream_pool::npos) return;
+        if (reusable && !excess_ && parser_.keep_alive() && socket_) {
+            pool_->release(backend_, std::move(socket_), upstream_pool::clock::now());
+        }
+        socket_ = unique_socket();
+        pool_->done(backend_);
+        backend_ = upstream_pool::npos;
+        stage_ = stage::idle;
+    }
+
+    proxy_transfer::chunk_step proxy_transfer::relay_chunked(std::string &out, bool decode) {
+        while (true) {
+            std::string_view data(in_.data() + body_read_, in_used_ - body_read_);
+            size_t consumed = 0;
+            std::string_view piece;
+            auto status = decoder_.decode(data, consumed, piece);
+            // 区切りも含めて受信したまま書く
+            out.append(decode ? piece : data.substr(0, consumed));
+            body_read_ += consumed;
+            switch (status) {
+            case body_decoder::status::data:
+                continue;
+            case body_decoder::status::incomplete:
+                // 受信済みの分を使い切った (受信バッファは先頭から使い直す)
+                body_read_ = in_used_ = 0;
+                return decoder_.data_remaining() > 0 ? chunk_step::splice : chunk_step::receive;
+            case body_decoder::status::done:
+                // ボディより後ろのデータ (要求していないレスポンス) は捨て、接続も再利用しない
+                if (body_read_ < in_used_) excess_ = true;
+                return chunk_step::done;
+            case body_decoder::status::error:
+                return chunk_step::error;
+            }
+        }
+    }
+
+    void proxy_transfer::write_head(std::string &out, bool close, bool chunked) const {
+        const proxy_options &options = pool_->route().options;
+        std::string_view data(in_.data(), in_used_);
+        std::string_view connection = headers_.find("Connection");
+
+        char status[4];
+        std::to_chars(status, status + sizeof(status), parser_.status());
+        out += "HTTP/1.1 ";
+        out.append(status, 3);
+        out += ' ';
+        out += parser_.reason(data);
+        out += "\r\n";
+        for (const auto &h : headers_) {
+            if (is_hop_by_hop(h.name, connection)) continue;
+            if (is_rewritten(h.name, options.remove_response_headers, options.set_response_headers)) continue;
+            append_header(out, h.name, h.value);
+        }
+        for (const auto &[name, value] : options.set_response_headers) append_header(out, name, value);
+        if (chunked) out += "Transfer-Encoding: chunked\r\n";
+        out += close ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
+        out += "\r\n";
+    }
+}
@@ -0,0 +1,208 @@
+#include "ouroboros/http/router.hpp"
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ouroboros::http
+{
+    struct router::node
+    {
+        std::string prefix;  // 静的部分 (パラメータ / ワイルドカードのノードでは空)
+        std::string name;    // パラメータ / ワイルドカードの名前
+
+        // 静的な子は先頭文字がすべて異なる。indices[i] は children[i] の先頭文字
+        std::string indices;
+        std::vector<std::unique_ptr<node>> children;
+        std::unique_ptr<node> param;
+        std::unique_ptr<node> wildcard;
+
+        std::optional<route_handler> handler;
+    };
+
+    namespace
+    {
+        using node_ptr = std::unique_ptr<router::node>;
+
+        enum class piece_kind
+        {
+            text,
+            param,
+            wildcard
+        };
+
+        struct piece
+        {
+            piece_kind kind;
+            std::string_view text; // 静的部分、またはパラメータ名
+        };
+
+        [[noreturn]] void invalid_pattern(std::string_view pattern, const char *reason) {
+            throw std::invalid_argument("invalid route \"" + std::string(pattern) + "\": " + reason);
+        }
+
+        // パターンを静的部分・パラメータ・ワイルドカードに分解する
+        std::vector<piece> split_pattern(std::string_view pattern) {
+            if (pattern.empty() || pattern.front() != '/') invalid_pattern(pattern, "must start with '/'");
+
+            std::vector<piece> pieces;
+            size_t pos = 0;
+            while (pos < pattern.size()) {
+                char c = pattern[pos];
+                bool segment_start = pos > 0 && pattern[pos - 1] == '/';
+                if (segment_start && c == ':') {
+                    size_t end = pattern.find('/', pos);
+                    if (end == std::string_view::npos) end = pattern.size();
+                    if (end == pos + 1) invalid_pattern(pattern, "parameter without a name");
+                    pieces.push_back({ piece_kind::param, pattern.substr(pos + 1, end - pos - 1) });
+                    pos = end;
+                } else if (segment_start && c == '*') {
+                    std::string_view name = pattern.substr(pos + 1);
+                    if (name.find('/') != std::string_view::npos) invalid_pattern(pattern, "wildcard must be last");
+                    pieces.push_back({ piece_kind::wildcard, name.empty() ? std::string_view("*") : name });
+                    pos = pattern.size();
+                } else {
+                    // 次のセグメント先頭の ':' / '*' までが静的部分
+                    size_t end = pos + 1;
+                    while (end < pattern.size() &&
+                           !(pattern[end - 1] == '/' && (pattern[end] == ':' || pattern[end] == '*'))) {
+                        end++;
+                    }
+                    pieces.push_back({ piece_kind::text, pattern.substr(pos, end - pos) });
+                    pos = end;
+                }
+            }
+
+            size_t params = 0;
+            for (const auto &p : pieces) {
+                if (p.kind != piece_kind::text) params++;
+            }
+            if (params > path_params::capacity) invalid_pattern(pattern, "too many parameters");
+            return pieces;
+        }
+
+        // n の静的な子として text を挿入し、text の終端に当たるノードを返す
+        router::node &insert_text(router::node &n, std::string_view text) {
+            size_t idx = n.indices.find(text.front());
+            if (idx == std::string::npos) {
+                auto child = std::make_unique<router::node>();
+                child->prefix = text;
+                n.indices.push_back(text.front());
+                n.children.push_back(std::move(child));
+                return *n.children.back();
+            }
+
+            node_ptr &child = n.children[idx];
+            size_t common = 0;
+            while (common < text.size() && common < child->prefix.size() && text[common] == child->prefix[common]) {
+                common++;
+            }
+
+            if (common < child->prefix.size()) {
+                // 共通部分で分割する: child -> mid (共通部分) -> child (残り)
+                auto mid = std::make_unique<router::node>();
+                mid->prefix = child->prefix.substr(0, common);
+                child->prefix.erase(0, common);
+                mid->indices.push_back(child->prefix.front());
+                mid->children.push_back(std::move(child));
+                child = std::move(mid);
+            }
+
+            if (common == text.size()) return *child;
+            return insert_text(*child, text.substr(common));
+        }
+
+        router::node &insert_named(node_ptr &slot, std::string_view name, std::string_view pattern) {
+            if (!slot) {
+                slot = std::make_unique<router::node>();
+                slot->name = name;
+            } else if (slot->name != name) {
+                invalid_pattern(pattern, "conflicts with an existing parameter name at the same position");
+            }
+            return *slot;
+        }
+
+        // n 自身の部分は一致済み。path[pos..] を子と一致させる
+        const route_handler *match(const router::node &n, std::string_view path, size_t pos,
+            path_params &params) noexcept {
+            if (pos == path.size()) {
+                if (n.handler) return &*n.handler;
+            } else {
+                // 1. 静的 (子の数は少ないため線形に探す)
+                const char first = path[pos];
+                for (size_t idx = 0; idx < n.indices.size(); ++idx) {
+                    if (n.indices[idx] != first) continue;
+                    const router::node &child = *n.children[idx];
+                    std::string_view rest = path.substr(pos);
+                    if (rest.starts_with(child.prefix)) {
+                        if (auto *h = match(child, path, pos + child.prefix.size(), params)) return h;
+                    }
+                    break;
+                }
+                // 2. パラメータ (一つのセグメント)
+                if (n.param) {
+                    size_t end = path.find('/', pos);
+                    if (end == std::string_view::npos) end = path.size();
+                    if (end > pos) {
+                        size_t mark = params.size();
+                        if (params.push_back(n.param->name, path.substr(pos, end - pos))) {
+                            if (auto *h = match(*n.param, path, end, params)) return h;
+                        }
+                        params.truncate(mark);
+                    }
+                }
+            }
+            // 3. ワイルドカード (残り全体)
+            if (n.wildcard && n.wildcard->handler) {
+                if (params.push_back(n.wildcard->name, path.substr(pos))) return &*n.wildcard->handler;
+            }
+            return nullptr;
+        }
+    }
+
+    router::router() = default;
+    router::~router() = default;
+    router::router(router &&) noexcept = default;
+    router &router::operator=(router &&) noexcept = default;
+
+    void router::add(method m, std::string_view pattern, any_handler handler, response_cache_policy cache,
+        body_options body) {
+        auto pieces = split_pattern(pattern);
+
+        node_ptr &root = roots_[static_cast<size_t>(m)];
+        if (!root) root = std::make_unique<node>();
+
+        node *n = root.get();
+        for (const auto &p : pieces) {
+            switch (p.kind) {
+            case piece_kind::text:
+                n = &insert_text(*n, p.text);
+                break;
+            case piece_kind::param:
+                n = &insert_named(n->param, p.text, pattern);
+                break;
+            case piece_kind::wildcard:
+                n = &insert_named(n->wildcard, p.text, pattern);
+                break;
+            }
+        }
+        n->handler = route_handler{ std::move(handler.sync), std::move(handler.async), std::move(cache), std::move(body) };
+    }
+
+    const route_handler *router::find(method m, std::string_view path, path_params &params) const noexcept {
+        params.clear();
+        const node *root = roots_[static_cast<size_t>(m)].get();
+        if (!root) return nullptr;
+        return match(*root, path, 0, params);
+    }
+
+    unsigned router::allowed_methods(std::string_view path) const noexcept {
+        unsigned methods = 0;
+        path_params scratch;
+        for (size_t i = 0; i < method_count; ++i) {
+            if (roots_[i] && match(*roots_[i], path, 0, scratch)) methods |= method_bit(static_cast<method>(i));
+            scratch.clear();
+        }
+        return methods;
+    }
+}
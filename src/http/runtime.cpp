@@ -0,0 +1,142 @@
+#include "ouroboros/http/runtime.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <iostream>
+#include <algorithm>
+#include <optional>
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        // std::atomic::wait による簡易バリア
+        void wait_until(std::atomic<size_t> &counter, size_t expected) {
+            size_t current;
+            while ((current = counter.load(std::memory_order_acquire)) != expected) {
+                counter.wait(current, std::memory_order_acquire);
+            }
+        }
+
+        void advance(std::atomic<size_t> &counter) {
+            counter.fetch_add(1, std::memory_order_acq_rel);
+            counter.notify_all();
+        }
+    }
+
+    runtime::runtime(runtime_options options) : options_(std::move(options)) {
+        unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+        unsigned threads = options_.threads;
+        if (threads == 0) {
+            threads = options_.cpus.empty() ? hardware : static_cast<unsigned>(options_.cpus.size());
+        }
+        if (options_.cpus.empty()) {
+            for (unsigned i = 0; i < threads; ++i) options_.cpus.push_back(i % hardware);
+        }
+
+        workers_.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i) {
+            auto w = std::make_unique<worker>();
+            w->cpu = options_.cpus[i % options_.cpus.size()];
+            workers_.push_back(std::move(w));
+        }
+    }
+
+    runtime::~runtime() {
+        stop();
+        wait();
+    }
+
+    std::expected<void, std::error_code> runtime::start(uint16_t port, const std::vector<route_entry> &routes) {
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i]->thread = std::thread([this, i, port, &routes] { worker_main(i, port, routes); });
+        }
+
+        // 全ワーカーの準備完了 (成功・失敗とも) を待つ。routes はここまで有効であればよい
+        wait_until(ready_, workers_.size());
+
+        for (const auto &w : workers_) {
+            if (w->error) {
+                stop();
+                wait();
+                return std::unexpected(w->error);
+            }
+        }
+        return {};
+    }
+
+    void runtime::stop() noexcept {
+        stopping_.store(true, std::memory_order_release);
+        for (const auto &w : workers_) {
+            std::lock_guard lock(w->mutex);
+            if (w->ctx) w->ctx->stop();
+        }
+    }
+
+    void runtime::wait() {
+        for (const auto &w : workers_) {
+            if (w->thread.joinable()) w->thread.join();
+        }
+    }
+
+    void runtime::worker_main(size_t index, uint16_t port, const std::vector<route_entry> &routes) {
+        worker &self = *workers_[index];
+
+        // 1. CPU への固定 (io_context のメモリもこのCPUのNUMAノードに確保される)
+        if (options_.pin_threads) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(self.cpu, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+                std::cerr << "runtime: failed to pin worker " << index << " to CPU " << self.cpu << std::endl;
+            }
+        }
+
+        // 2. ワーカー専用の io_context / server / ルーティングテーブル
+        std::optional<io_context> ctx;
+        std::optional<server> svr;
+        try {
+            ctx.emplace(options_.io);
+            auto created = server::create(*ctx, port, options_.server);
+            if (created) {
+                svr.emplace(std::move(*created));
+                svr->load_routes(routes);
+            } else {
+                self.error = created.error();
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "runtime: worker " << index << " failed: " << e.what() << std::endl;
+            self.error = std::make_error_code(std::errc::resource_unavailable_try_again);
+        }
+
+        // 3. listen は index 順に行う (SO_REUSEPORT グループ内の順序を CBPF の戻り値と一致させる)
+        wait_until(listen_turn_, index);
+        if (!self.error) {
+            if (auto started = svr->start(); !started) self.error = started.error();
+        }
+        advance(listen_turn_);
+
+        // 4. 全リスナーが揃ってから CBPF を取り付ける (グループ内のどのソケットに付けてもよい)
+        advance(listening_);
+        wait_until(listening_, workers_.size());
+        if (index == 0 && options_.reuseport_cbpf && !self.error) {
+            std::vector<unsigned> cpus;
+            for (const auto &w : workers_) cpus.push_back(w->cpu);
+            if (auto attached = svr->attach_reuseport_cbpf(cpus); !attached) self.error = attached.error();
+        }
+
+        if (!self.error) {
+            std::lock_guard lock(self.mutex);
+            self.ctx = &*ctx;
+            // start() 完了前に stop() が呼ばれていた場合
+            if (stopping_.load(std::memory_order_acquire)) ctx->stop();
+        }
+        advance(ready_);
+        if (self.error) return;
+
+        // 5. イベントループ (stop() まで戻らない)
+        ctx->run();
+
+        std::lock_guard lock(self.mutex);
+        self.ctx = nullptr;
+    }
+}
@@ -0,0 +1,89 @@
+#include "ouroboros/http/send_buffer_pool.hpp"
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <utility>
+
+namespace ouroboros::http
+{
+    std::expected<send_buffer_pool, std::error_code> send_buffer_pool::create(io_context &ctx,
+        uint16_t buffer_count, uint32_t buffer_size) {
+        if (buffer_count == 0 || buffer_size == 0) {
+            return std::unexpected(error_code::buffer_registration_failed);
+        }
+
+        send_buffer_pool pool(buffer_count, buffer_size);
+
+        pool.storage_sz_ = static_cast<size_t>(buffer_count) * buffer_size;
+        void *storage = mmap(nullptr, pool.storage_sz_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (storage == MAP_FAILED) {
+            return std::unexpected(error_code::buffer_registration_failed);
+        }
+        pool.storage_ = static_cast<char *>(storage);
+
+        // バッファごとに一つの iovec として登録する (ピン留めは RLIMIT_MEMLOCK の対象)
+        std::vector<iovec> iovs(buffer_count);
+        for (uint16_t i = 0; i < buffer_count; ++i) {
+            iovs[i].iov_base = pool.data(i);
+            iovs[i].iov_len = buffer_size;
+        }
+        if (ctx.register_resource(IORING_REGISTER_BUFFERS, iovs.data(), buffer_count) < 0) {
+            return std::unexpected(error_code::buffer_registration_failed);
+        }
+        pool.ctx_ = &ctx; // 登録に成功した場合のみ (破棄時に登録を解除する)
+
+        // 先頭のバッファから使われるよう逆順に積む
+        pool.free_.reserve(buffer_count);
+        for (uint16_t i = buffer_count; i > 0; --i) pool.free_.push_back(static_cast<uint16_t>(i - 1));
+        return pool;
+    }
+
+    send_buffer_pool::send_buffer_pool(uint16_t buffer_count, uint32_t buffer_size)
+        : buffer_count_(buffer_count), buffer_size_(buffer_size) {}
+
+    send_buffer_pool::send_buffer_pool(send_buffer_pool &&other) noexcept
+        : ctx_(std::exchange(other.ctx_, nullptr)), buffer_count_(std::exchange(other.buffer_count_, 0)),
+        buffer_size_(std::exchange(other.buffer_size_, 0)),
+        storage_(std::exchange(other.storage_, nullptr)), storage_sz_(std::exchange(other.storage_sz_, 0)),
+        free_(std::move(other.free_)) {}
+
+    send_buffer_pool &send_buffer_pool::operator=(send_buffer_pool &&other) noexcept {
+        if (this != &other) {
+            release_storage();
+            ctx_ = std::exchange(other.ctx_, nullptr);
+            buffer_count_ = std::exchange(other.buffer_count_, 0);
+            buffer_size_ = std::exchange(other.buffer_size_, 0);
+            storage_ = std::exchange(other.storage_, nullptr);
+            storage_sz_ = std::exchange(other.storage_sz_, 0);
+            free_ = std::move(other.free_);
+        }
+        return *this;
+    }
+
+    send_buffer_pool::~send_buffer_pool() {
+        release_storage();
+    }
+
+    void send_buffer_pool::release_storage() noexcept {
+        if (ctx_) {
+            ctx_->register_resource(IORING_UNREGISTER_BUFFERS, nullptr, 0);
+            ctx_ = nullptr;
+        }
+        if (storage_) {
+            munmap(storage_, storage_sz_);
+            storage_ = nullptr;
+        }
+        free_.clear();
+    }
+
+    std::optional<uint16_t> send_buffer_pool::acquire() noexcept {
+        if (free_.empty()) return std::nullopt;
+        uint16_t index = free_.back();
+        free_.pop_back();
+        return index;
+    }
+
+    void send_buffer_pool::release(uint16_t index) noexcept {
+        // create() で容量を確保済みのため再確保は起きない
+        free_.push_back(index);
+    }
+}
@@ -1,6 +1,8 @@
 #include "ouroboros/http/server.hpp"
 #include "ouroboros/http/http_session.hpp"
 #include <sys/socket.h>
+#include <sys/resource.h>
+#include <linux/filter.h>
 #include <arpa/inet.h>
 #include <iostream>
 #include <cstring>
@@ -8,7 +10,25 @@
 
 namespace ouroboros::http
 {
-    std::expected<server, std::error_code> server::create(io_context &ctx, uint16_t port) {
+    namespace
+    {
+        // 資源不足で Accept に失敗した後、再発行するまでの間隔 (その間に接続が閉じて fd・スロットが空くのを待つ)
+        constexpr std::chrono::milliseconds accept_retry_delay{ 100 };
+    }
+
+    struct server::accept_retry final : task
+    {
+        explicit accept_retry(server &s) noexcept : owner(s) {}
+
+        // 再発行の時刻になった
+        void complete(int, uint32_t) override { owner.submit_accept(); }
+
+        server &owner;
+        timer delay{ *this };
+    };
+
+    std::expected<server, std::error_code> server::create(io_context &ctx, uint16_t port,
+        const server_options &options) {
         // 1. ソケット作成
         int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0); // ノンブロッキング重要
         if (fd < 0) {
@@ -35,12 +55,61 @@ namespace ouroboros::http
         if (::bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
             return std::unexpected(error_code::bind_failed);
         }
+        // ポート 0 ならカーネルが選んだポートを読み戻す
+        if (port == 0) {
+            socklen_t len = sizeof(addr);
+            if (::getsockname(fd, (struct sockaddr *)&addr, &len) < 0) {
+                return std::unexpected(error_code::bind_failed);
+            }
+            port = ntohs(addr.sin_port);
+        }
+
+        // 受信バッファプールの登録 (要件 3.2)
+        auto pool = buffer_pool::create(ctx);
+        if (!pool) {
+            return std::unexpected(pool.error());
+        }
 
-        return server(ctx, port, std::move(server_sock));
+        // ダイレクトディスクリプタの割り当て先となる固定ファイルテーブルの登録
+        if (options.direct_descriptors && ctx.fixed_file_slots() == 0) {
+            // テーブルサイズは RLIMIT_NOFILE を超えられない
+            unsigned slots = options.fixed_file_slots;
+            struct rlimit limit
+            {};
+            if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < slots) {
+                slots = static_cast<unsigned>(limit.rlim_cur);
+            }
+            if (ctx.register_sparse_files(slots) < 0) {
+                std::cerr << "Fixed file registration failed, sockets use regular file descriptors." << std::endl;
+            }
+        }
+
+        // ゼロコピー送信用の登録済みバッファ (失敗してもコピーによる送信で動作する)
+        send_buffer_pool send_buffers;
+        if (options.zero_copy_threshold > 0 && options.send_buffer_count > 0 && ctx.supports(IORING_OP_SEND_ZC)) {
+            auto registered = send_buffer_pool::create(ctx, options.send_buffer_count, options.send_buffer_size);
+            if (registered) {
+                send_buffers = std::move(*registered);
+            } else {
+                std::cerr << "Send buffer registration failed (RLIMIT_MEMLOCK?), zero-copy sends use unregistered buffers." << std::endl;
+            }
+        }
+
+        return server(ctx, port, std::move(server_sock), std::move(*pool), std::move(send_buffers), options);
     }
 
-    server::server(io_context &ctx, uint16_t port, unique_socket socket)
-        : ctx_(ctx), server_socket_(std::move(socket)), port_(port) {}
+    server::server(io_context &ctx, uint16_t port, unique_socket socket, buffer_pool buffers,
+        send_buffer_pool send_buffers, const server_options &options)
+        : ctx_(ctx), server_socket_(std::move(socket)),
+        direct_(options.direct_descriptors && ctx.fixed_file_slots() > 0), port_(port), options_(options),
+        buffers_(std::move(buffers)), send_buffers_(std::move(send_buffers)),
+        zero_copy_(options.zero_copy_threshold > 0 && ctx.supports(IORING_OP_SEND_ZC)),
+        arena_blocks_(options.arena_size), files_(options.file_cache_size, options.file_revalidate_after),
+        responses_(options.response_cache_size, options.response_cache_max_entry_size),
+        websockets_(options.max_websockets), sessions_(options.max_sessions) {}
+
+    server::~server() = default;
+    server::server(server &&) noexcept = default;
 
     std::expected<void, std::error_code> server::start() {
         // 4. Listen
@@ -49,11 +118,41 @@ namespace ouroboros::http
         }
         std::cout << "Server listening on port " << port_ << std::endl;
 
+        // リスナーも固定ファイルにして Accept ごとの fget/fput を省く (登録できなければ fd のまま)
+        if (direct_) {
+            if (int slot = ctx_.install_fixed_file(server_socket_.native_handle()); slot >= 0) {
+                listen_slot_ = fixed_socket(ctx_, slot);
+            }
+        }
+
         // 最初の Accept リクエストを発行
+        accept_retry_ = std::make_unique<accept_retry>(*this);
         submit_accept();
         return {}; // Success
     }
 
+    std::expected<void, std::error_code> server::attach_reuseport_cbpf(std::span<const unsigned> cpus) {
+        // 受信CPU番号 -> グループ内インデックスの対応表を classic BPF で表現する
+        //   A = cpu; if (A == cpus[i]) return i; ... ; return A % n;
+        std::vector<sock_filter> code;
+        code.reserve(cpus.size() * 2 + 3);
+        code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, cpus[i], 0, 1));
+            code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<uint32_t>(i)));
+        }
+        code.push_back(BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32_t>(cpus.size())));
+        code.push_back(BPF_STMT(BPF_RET | BPF_A, 0));
+
+        sock_fprog prog{};
+        prog.len = static_cast<unsigned short>(code.size());
+        prog.filter = code.data();
+        if (setsockopt(server_socket_.native_handle(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+            return std::unexpected(error_code::socket_option_failed);
+        }
+        return {};
+    }
+
     void server::submit_accept() {
         // SQEを取得
         auto *sqe = ctx_.get_sqe();
@@ -66,10 +165,24 @@ namespace ouroboros::http
 
         // IORING_OP_ACCEPT を手動設定 (liburing_prep_accept 相当)
         sqe->opcode = IORING_OP_ACCEPT;
-        sqe->fd = server_socket_.native_handle();
-        sqe->addr = (uint64_t)&client_addr_;
-        sqe->addr2 = (uint64_t)&client_len_;
-        sqe->flags = 0; // SOCK_NONBLOCKなどを指定可能
+        if (listen_slot_) {
+            sqe->fd = listen_slot_.native_handle();
+            sqe->flags = IOSQE_FIXED_FILE;
+        } else {
+            sqe->fd = server_socket_.native_handle();
+            sqe->flags = 0;
+        }
+        if (options_.multishot_accept) {
+            // 複数の完了が同じ領域へ書き込まれるため、接続元アドレスは受け取らない
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        } else {
+            sqe->addr = (uint64_t)&client_addr_;
+            sqe->addr2 = (uint64_t)&client_len_;
+        }
+        if (direct_) {
+            // 空きスロットをカーネルに選ばせる (CQE の res がスロット番号になる)
+            sqe->file_index = IORING_FILE_INDEX_ALLOC;
+        }
 
         // 完了時のコールバックとして自分自身(server)を登録
         sqe->user_data = (uint64_t)this;
@@ -78,41 +191,83 @@ namespace ouroboros::http
         ctx_.submit();
     }
 
+    void server::retry_accept_later() {
+        ctx_.timers().arm(accept_retry_->delay, accept_retry_delay);
+    }
+
     // Accept完了時に呼ばれる (イベントループから)
     void server::complete(int result, uint32_t flags) {
-        (void)flags; // このコンテキストではフラグは未使用
-        if (result < 0) {
+        bool retry_later = false;
+        if (result == -EINVAL && direct_) {
+            // IORING_FILE_INDEX_ALLOC 非対応 (Linux 5.19 未満): 通常の fd で受け付け直す
+            std::cerr << "Direct descriptors are not supported, accepting regular file descriptors." << std::endl;
+            direct_ = false;
+        } else if (result == -EINVAL && options_.multishot_accept) {
+            // IORING_ACCEPT_MULTISHOT 非対応 (Linux 5.19 未満): 単発の Accept を繰り返す
+            std::cerr << "Multishot accept is not supported, falling back to single-shot accept." << std::endl;
+            options_.multishot_accept = false;
+        } else if (result == -ECONNABORTED || result == -EINTR || result == -EAGAIN) {
+            // この接続だけの失敗: すぐに次を受け付ける
+        } else if (result < 0) {
+            // fd・固定ファイルテーブルの枯渇 (EMFILE / ENFILE)・メモリ不足等: すぐに発行し直しても同じ結果になる
             std::cerr << "Accept failed: " << -result << std::endl;
+            retry_later = true;
+        } else if (direct_) {
+            fixed_socket client_sock(ctx_, result);
+
+            if (options_.log_connections) std::cout << "New Connection! Slot: " << result << std::endl;
+
+            if (auto *session = sessions_.acquire(*this, ctx_)) {
+                session->start(std::move(client_sock));
+            } else {
+                // 上限に達している: client_sock の破棄で閉じる
+                std::cerr << "Session limit reached, closing connection." << std::endl;
+            }
         } else {
             int client_fd = result;
             unique_socket client_sock(client_fd);
 
-            std::cout << "New Connection! FD: " << client_fd << std::endl;
+            if (options_.log_connections) std::cout << "New Connection! FD: " << client_fd << std::endl;
 
-            // Sessionを作成し、start() を呼ぶ
-            // Sessionは通信終了時に delete this するので、ここではポインタを渡して放置する (Fire & Forget)
-            auto *session = new http_session(*this, ctx_, std::move(client_sock));
-            session->start();
+            // プールから取り出したセッションで処理を開始する
+            // セッションは通信終了時に自身をプールへ返却する (Fire & Forget)
+            if (auto *session = sessions_.acquire(*this, ctx_)) {
+                session->start(std::move(client_sock));
+            } else {
+                // 上限に達している: client_sock の破棄で閉じる
+                std::cerr << "Session limit reached, closing connection." << std::endl;
+            }
         }
 
-        submit_accept();
+        // マルチショットの場合、カーネルが Accept を継続している間 (F_MORE) は再発行不要
+        if (!options_.multishot_accept || !(flags & IORING_CQE_F_MORE)) {
+            if (!retry_later) {
+                submit_accept();
+            } else if (!accept_retry_->delay.armed()) {
+                retry_accept_later();
+            }
+        }
     }
 
     void server::load_routes(const std::vector<route_entry> &routes) {
         for (const auto &entry : routes) {
-            routes_[entry.method][entry.path] = entry.handler;
+            router_.add(entry.method, entry.path, entry.handler, entry.cache, entry.body);
         }
     }
 
-    std::optional<handler_function> server::find_handler(method method, const std::string &path) const {
-        if (auto it_method = routes_.find(method); it_method != routes_.end()) {
-            const auto &path_map = it_method->second;
-            if (auto it_path = path_map.find(path); it_path != path_map.end()) {
-                return it_path->second;
-            }
-        }
-        return std::nullopt;
+    std::string server::allowed_methods(std::string_view path) const {
+        unsigned methods = router_.allowed_methods(path);
+        if (const auto &table = options_.static_routes) methods |= table.allowed_methods(table.router, path);
+        // HEAD は GET のハンドラで処理される
+        if (methods & method_bit(method::GET)) methods |= method_bit(method::HEAD);
+        return format_allow(methods);
     }
 
-
+    upstream_pool &server::proxy_pool(const proxy_route &route) {
+        for (auto &pool : proxy_pools_) {
+            if (&pool->route() == &route) return *pool;
+        }
+        proxy_pools_.push_back(std::make_unique<upstream_pool>(route));
+        return *proxy_pools_.back();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "ouroboros/http/session_pool.hpp"
+#include <new>
+
+namespace ouroboros::http
+{
+    http_session *session_pool::acquire(server &svr, io_context &ctx) {
+        if (in_use_ >= capacity_) return nullptr;
+
+        if (!free_list_) {
+            // スラブを一つ確保し、全セッションを構築して空きリストへつなぐ
+            void *memory = ::operator new(sizeof(http_session) * slab_size, std::align_val_t{ alignof(http_session) });
+            auto *slab = static_cast<http_session *>(memory);
+            size_t constructed = 0;
+            try {
+                for (; constructed < slab_size; ++constructed) new (slab + constructed) http_session(svr, ctx);
+            } catch (...) {
+                while (constructed > 0) slab[--constructed].~http_session();
+                ::operator delete(memory, std::align_val_t{ alignof(http_session) });
+                throw;
+            }
+            slabs_.emplace_back(slab);
+
+            // 先頭から順に使われるよう逆順につなぐ
+            for (size_t i = slab_size; i > 0; --i) {
+                slab[i - 1].next_free_ = free_list_;
+                free_list_ = &slab[i - 1];
+            }
+        }
+
+        http_session *session = free_list_;
+        free_list_ = session->next_free_;
+        session->next_free_ = nullptr;
+        in_use_++;
+        return session;
+    }
+
+    void session_pool::release(http_session *session) noexcept {
+        session->next_free_ = free_list_;
+        free_list_ = session;
+        in_use_--;
+    }
+
+    void session_pool::slab_deleter::operator()(http_session *slab) const noexcept {
+        for (size_t i = 0; i < slab_size; ++i) slab[i].~http_session();
+        ::operator delete(static_cast<void *>(slab), std::align_val_t{ alignof(http_session) });
+    }
+}
@@ -0,0 +1,44 @@
+#include "ouroboros/http/socket_address.hpp"
+#include <arpa/inet.h>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+
+namespace ouroboros::http
+{
+    bool resolve_address(const std::string &host, uint16_t port, socket_address &address) {
+        address = {};
+        auto *v4 = reinterpret_cast<sockaddr_in *>(&address.storage);
+        if (inet_pton(AF_INET, host.c_str(), &v4->sin_addr) == 1) {
+            v4->sin_family = AF_INET;
+            v4->sin_port = htons(port);
+            address.length = sizeof(sockaddr_in);
+            return true;
+        }
+        auto *v6 = reinterpret_cast<sockaddr_in6 *>(&address.storage);
+        if (inet_pton(AF_INET6, host.c_str(), &v6->sin6_addr) == 1) {
+            v6->sin6_family = AF_INET6;
+            v6->sin6_port = htons(port);
+            address.length = sizeof(sockaddr_in6);
+            return true;
+        }
+
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *result = nullptr;
+        if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) return false;
+        std::memcpy(&address.storage, result->ai_addr, result->ai_addrlen);
+        address.length = result->ai_addrlen;
+        freeaddrinfo(result);
+        if (address.storage.ss_family == AF_INET) v4->sin_port = htons(port);
+        else v6->sin6_port = htons(port);
+        return true;
+    }
+
+    std::string host_header_value(const std::string &host, uint16_t port) {
+        std::string value = host.find(':') == std::string::npos ? host : "[" + host + "]";
+        if (port != 80) value += ":" + std::to_string(port);
+        return value;
+    }
+}
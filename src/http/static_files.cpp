@@ -0,0 +1,178 @@
+#include "ouroboros/http/static_files.hpp"
+#include <fcntl.h>
+#include <cerrno>
+#include <charconv>
+#include <system_error>
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        struct mime_entry
+        {
+            std::string_view extension;
+            std::string_view type;
+        };
+
+        constexpr mime_entry mime_types[] = {
+            { "html", "text/html; charset=utf-8" },
+            { "htm", "text/html; charset=utf-8" },
+            { "css", "text/css; charset=utf-8" },
+            { "js", "text/javascript; charset=utf-8" },
+            { "mjs", "text/javascript; charset=utf-8" },
+            { "json", "application/json" },
+            { "txt", "text/plain; charset=utf-8" },
+            { "xml", "application/xml" },
+            { "svg", "image/svg+xml" },
+            { "png", "image/png" },
+            { "jpg", "image/jpeg" },
+            { "jpeg", "image/jpeg" },
+            { "gif", "image/gif" },
+            { "webp", "image/webp" },
+            { "avif", "image/avif" },
+            { "ico", "image/x-icon" },
+            { "woff", "font/woff" },
+            { "woff2", "font/woff2" },
+            { "ttf", "font/ttf" },
+            { "wasm", "application/wasm" },
+            { "pdf", "application/pdf" },
+            { "mp4", "video/mp4" },
+            { "webm", "video/webm" },
+            { "mp3", "audio/mpeg" },
+            { "zip", "application/zip" },
+            { "gz", "application/gzip" },
+        };
+
+        int hex_value(char c) noexcept {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        constexpr bool is_ows(char c) noexcept {
+            return c == ' ' || c == '\t';
+        }
+
+        std::string_view trim(std::string_view s) noexcept {
+            while (!s.empty() && is_ows(s.front())) s.remove_prefix(1);
+            while (!s.empty() && is_ows(s.back())) s.remove_suffix(1);
+            return s;
+        }
+
+        // 10進数の全体を解釈する (空・数字以外・桁あふれは false)
+        bool parse_u64(std::string_view s, uint64_t &value) noexcept {
+            if (s.empty()) return false;
+            auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+            return ec == std::errc{} && end == s.data() + s.size();
+        }
+    }
+
+    static_files::static_files(const std::string &root) {
+        int fd = ::open(root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "static_files: cannot open " + root);
+        root_ = std::make_shared<const unique_socket>(fd);
+    }
+
+    void static_files::operator()(const request &req, response &res) const {
+        std::string_view encoded = req.params.empty() ? std::string_view{} : req.params.end()[-1].value;
+
+        // パーセントデコード (作業領域はリクエストアリーナ)
+        std::pmr::string path(res.arena());
+        path.reserve(encoded.size() + 10);
+        for (size_t i = 0; i < encoded.size(); ++i) {
+            char c = encoded[i];
+            if (c == '%') {
+                int high = i + 2 < encoded.size() ? hex_value(encoded[i + 1]) : -1;
+                int low = high >= 0 ? hex_value(encoded[i + 2]) : -1;
+                if (low < 0) {
+                    res.set_status_code(400);
+                    res.set_body("Bad Request");
+                    return;
+                }
+                c = static_cast<char>(high * 16 + low);
+                i += 2;
+            }
+            // NUL はパスを途中で切ってしまうため拒否する
+            if (c == '\0') {
+                res.set_status_code(400);
+                res.set_body("Bad Request");
+                return;
+            }
+            path.push_back(c);
+        }
+
+        // ルートからの相対パスにする (絶対パスは RESOLVE_BENEATH で拒否される)
+        size_t first = path.find_first_not_of('/');
+        path.erase(0, first == std::pmr::string::npos ? path.size() : first);
+        if (path.empty() || path.back() == '/') path.append("index.html");
+
+        res.set_header("Content-Type", mime_type(path));
+        res.send_file(root_fd(), path);
+    }
+
+    std::string_view mime_type(std::string_view path) noexcept {
+        size_t dot = path.rfind('.');
+        size_t slash = path.rfind('/');
+        if (dot == std::string_view::npos || (slash != std::string_view::npos && dot < slash)) {
+            return "application/octet-stream";
+        }
+        std::string_view extension = path.substr(dot + 1);
+        for (const auto &entry : mime_types) {
+            if (iequals(entry.extension, extension)) return entry.type;
+        }
+        return "application/octet-stream";
+    }
+
+    bool etag_matches(std::string_view if_none_match, std::string_view etag) noexcept {
+        // 弱い比較: W/ を除いた opaque-tag が一致すれば良い (RFC 9110 13.1.2)
+        if (etag.starts_with("W/")) etag.remove_prefix(2);
+        std::string_view rest = if_none_match;
+        while (!rest.empty()) {
+            size_t comma = rest.find(',');
+            std::string_view tag = trim(rest.substr(0, comma));
+            if (tag == "*") return true;
+            if (tag.starts_with("W/")) tag.remove_prefix(2);
+            if (tag == etag) return true;
+            if (comma == std::string_view::npos) break;
+            rest.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    range_status parse_range(std::string_view value, uint64_t size, uint64_t &begin, uint64_t &length) noexcept {
+        value = trim(value);
+        if (value.size() < 6 || !iequals(value.substr(0, 6), "bytes=")) return range_status::none;
+        value = trim(value.substr(6));
+        // 複数範囲 (multipart/byteranges) は未対応: Range を無視して全体を返す
+        if (value.find(',') != std::string_view::npos) return range_status::none;
+
+        size_t dash = value.find('-');
+        if (dash == std::string_view::npos) return range_status::none;
+        std::string_view first = trim(value.substr(0, dash));
+        std::string_view last = trim(value.substr(dash + 1));
+
+        uint64_t a = 0;
+        uint64_t b = 0;
+        if (first.empty()) {
+            // 末尾の n バイト
+            if (!parse_u64(last, b)) return range_status::none;
+            if (b == 0 || size == 0) return range_status::unsatisfiable;
+            if (b > size) b = size;
+            begin = size - b;
+            length = b;
+            return range_status::satisfiable;
+        }
+        if (!parse_u64(first, a)) return range_status::none;
+        if (last.empty()) {
+            b = size == 0 ? 0 : size - 1;
+        } else {
+            if (!parse_u64(last, b) || b < a) return range_status::none;
+            if (b >= size) b = size - 1;
+        }
+        if (a >= size) return range_status::unsatisfiable;
+        begin = a;
+        length = b - a + 1;
+        return range_status::satisfiable;
+    }
+}
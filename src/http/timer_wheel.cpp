@@ -0,0 +1,174 @@
+#include "ouroboros/http/timer_wheel.hpp"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+
+namespace ouroboros::http
+{
+    timer::~timer() { cancel(); }
+
+    void timer::cancel() noexcept {
+        if (wheel_) wheel_->cancel(*this);
+    }
+
+    timer_wheel::~timer_wheel() {
+        for (auto &level : wheel_) {
+            for (auto &head : level) {
+                while (head.next != &head) {
+                    timer &t = owner(head.next);
+                    head.next = t.link_.next;
+                    t.link_.reset();
+                    t.wheel_ = nullptr;
+                }
+                head.prev = &head;
+            }
+        }
+    }
+
+    timer &timer_wheel::owner(link *l) noexcept {
+        // link_ は timer の先頭メンバ
+        return *reinterpret_cast<timer *>(l);
+    }
+
+    uint64_t timer_wheel::ticks(clock::time_point now) const noexcept {
+        if (now <= origin_) return 0;
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - origin_) / tick);
+    }
+
+    void timer_wheel::arm(timer &t, std::chrono::milliseconds after, clock::time_point now) noexcept {
+        if (t.wheel_) t.wheel_->cancel(t);
+
+        uint64_t delay = after <= tick ? 1 : static_cast<uint64_t>((after + tick - std::chrono::milliseconds(1)) / tick);
+        t.expires_ = std::max(ticks(now), now_) + delay;
+        t.wheel_ = this;
+        insert(t);
+        size_++;
+    }
+
+    void timer_wheel::cancel(timer &t) noexcept {
+        if (t.wheel_ != this) return;
+        unlink(t);
+        t.wheel_ = nullptr;
+        size_--;
+    }
+
+    void timer_wheel::insert(timer &t) noexcept {
+        constexpr uint64_t span = uint64_t{ 1 } << (slot_bits * levels);
+        if (t.expires_ < now_) t.expires_ = now_;
+        if (t.expires_ - now_ >= span) t.expires_ = now_ + span - 1;
+
+        // 残り時間が収まる最も下の階層に置く
+        uint64_t delta = t.expires_ - now_;
+        unsigned level = 0;
+        while (level + 1 < levels && delta >= (uint64_t{ 1 } << (slot_bits * (level + 1)))) level++;
+        unsigned slot = static_cast<unsigned>(t.expires_ >> (slot_bits * level)) & (slots - 1);
+
+        link &head = wheel_[level][slot];
+        t.link_.prev = head.prev;
+        t.link_.next = &head;
+        head.prev->next = &t.link_;
+        head.prev = &t.link_;
+        t.level_ = static_cast<uint8_t>(level);
+        t.slot_ = static_cast<uint8_t>(slot);
+        occupied_[level] |= uint64_t{ 1 } << slot;
+    }
+
+    void timer_wheel::unlink(timer &t) noexcept {
+        t.link_.prev->next = t.link_.next;
+        t.link_.next->prev = t.link_.prev;
+        t.link_.reset();
+        // 発火・振り分け中のタイマーは既にスロットから外れているが、空判定はスロットの実際の状態で行う
+        link &head = wheel_[t.level_][t.slot_];
+        if (head.next == &head) occupied_[t.level_] &= ~(uint64_t{ 1 } << t.slot_);
+    }
+
+    uint64_t timer_wheel::ticks_until_next() const noexcept {
+        uint64_t next = UINT64_MAX;
+        for (unsigned level = 0; level < levels; ++level) {
+            if (occupied_[level] == 0) continue;
+            // 現在のスロットは処理済み。その次から順に、最初の空でないスロットを探す (同じ番号は一周後)
+            unsigned shift = slot_bits * level;
+            unsigned current = static_cast<unsigned>(now_ >> shift) & (slots - 1);
+            uint64_t rotated = std::rotr(occupied_[level], static_cast<int>((current + 1) & (slots - 1)));
+            uint64_t distance = static_cast<uint64_t>(std::countr_zero(rotated)) + 1;
+            next = std::min(next, (((now_ >> shift) + distance) << shift) - now_);
+        }
+        return next;
+    }
+
+    std::chrono::milliseconds timer_wheel::next_timeout(clock::time_point now) const noexcept {
+        if (size_ == 0) return std::chrono::milliseconds(-1);
+
+        uint64_t due = now_ + ticks_until_next();
+        uint64_t current = ticks(now);
+        return due > current ? static_cast<std::chrono::milliseconds::rep>(due - current) * tick : std::chrono::milliseconds(0);
+    }
+
+    size_t timer_wheel::advance(clock::time_point now) {
+        uint64_t target = ticks(now);
+        size_t fired = 0;
+        while (now_ < target) {
+            if (size_ == 0) {
+                now_ = target;
+                break;
+            }
+            // 空のスロットしかないティックは飛ばす
+            uint64_t next = ticks_until_next();
+            if (next > target - now_) {
+                now_ = target;
+                break;
+            }
+            now_ += next;
+            fired += process_tick();
+        }
+        return fired;
+    }
+
+    size_t timer_wheel::process_tick() {
+        // 上位の階層から振り分ける (振り分け先が同じティックで処理されるスロットでもよい)
+        for (unsigned level = levels - 1; level > 0; --level) {
+            uint64_t mask = (uint64_t{ 1 } << (slot_bits * level)) - 1;
+            if ((now_ & mask) == 0) cascade(level, static_cast<unsigned>(now_ >> (slot_bits * level)) & (slots - 1));
+        }
+
+        // 期限が来たタイマーを一時リストへ移してから発火させる
+        // (コールバックが他のタイマーを解除・登録してもよい)
+        unsigned slot = static_cast<unsigned>(now_) & (slots - 1);
+        link &head = wheel_[0][slot];
+        if (head.next == &head) return 0;
+        link expired;
+        expired.next = head.next;
+        expired.prev = head.prev;
+        expired.next->prev = &expired;
+        expired.prev->next = &expired;
+        head.next = head.prev = &head;
+        occupied_[0] &= ~(uint64_t{ 1 } << slot);
+
+        size_t fired = 0;
+        while (expired.next != &expired) {
+            timer &t = owner(expired.next);
+            cancel(t);
+            t.target_->complete(-ETIME, 0);
+            fired++;
+        }
+        return fired;
+    }
+
+    void timer_wheel::cascade(unsigned level, unsigned slot) noexcept {
+        link &head = wheel_[level][slot];
+        if (head.next == &head) return;
+        link moving;
+        moving.next = head.next;
+        moving.prev = head.prev;
+        moving.next->prev = &moving;
+        moving.prev->next = &moving;
+        head.next = head.prev = &head;
+        occupied_[level] &= ~(uint64_t{ 1 } << slot);
+
+        while (moving.next != &moving) {
+            timer &t = owner(moving.next);
+            unlink(t);
+            insert(t);
+        }
+    }
+}
@@ -0,0 +1,195 @@
+#include "ouroboros/http/websocket.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        constexpr bool is_ows(char c) noexcept {
+            return c == ' ' || c == '\t';
+        }
+
+        std::string_view trim(std::string_view s) noexcept {
+            while (!s.empty() && is_ows(s.front())) s.remove_prefix(1);
+            while (!s.empty() && is_ows(s.back())) s.remove_suffix(1);
+            return s;
+        }
+
+        // カンマ区切りのトークンリスト (Connection / Upgrade) に token が含まれるか
+        bool has_token(std::string_view list, std::string_view token) noexcept {
+            while (!list.empty()) {
+                size_t comma = list.find(',');
+                if (iequals(trim(list.substr(0, comma)), token)) return true;
+                if (comma == std::string_view::npos) break;
+                list.remove_prefix(comma + 1);
+            }
+            return false;
+        }
+
+        // クライアントが提示したサブプロトコルのうち、最初にサーバーが対応しているもの (無ければ空)
+        std::string_view select_protocol(std::string_view offered, const std::vector<std::string> &supported) noexcept {
+            while (!offered.empty()) {
+                size_t comma = offered.find(',');
+                std::string_view name = trim(offered.substr(0, comma));
+                for (const auto &p : supported) {
+                    if (p == name) return name;
+                }
+                if (comma == std::string_view::npos) break;
+                offered.remove_prefix(comma + 1);
+            }
+            return {};
+        }
+    }
+
+    // --- websocket_endpoint ---
+
+    websocket_endpoint::websocket_endpoint(websocket_options options)
+        : route_(std::make_shared<const websocket_route>(websocket_route{ std::move(options) })) {}
+
+    void websocket_endpoint::operator()(const request &req, response &res) const {
+        const websocket_options &options = route_->options;
+
+        // GET のルートは HEAD にも呼ばれるため、メソッドも確認する
+        if (req.method != method::GET || req.version_minor < 1) {
+            res.set_status_code(400);
+            return;
+        }
+        if (!has_token(req.header("Upgrade"), "websocket") || !has_token(req.header("Connection"), "upgrade")) {
+            // アップグレードを要求していない通常のリクエスト
+            res.set_status_code(426);
+            res.set_header("Upgrade", "websocket");
+            res.set_body("WebSocket upgrade required");
+            return;
+        }
+        if (trim(req.header("Sec-WebSocket-Version")) != "13") {
+            // 対応しているバージョンを返す (RFC 6455 4.4)
+            res.set_status_code(426);
+            res.set_header("Sec-WebSocket-Version", "13");
+            return;
+        }
+        std::string_view key = trim(req.header("Sec-WebSocket-Key"));
+        if (!valid_websocket_key(key)) {
+            res.set_status_code(400);
+            return;
+        }
+        if (!options.allowed_origins.empty()) {
+            // ブラウザからの別オリジンの接続を拒否する (Origin を送らないクライアントも拒否する)
+            std::string_view origin = req.header("Origin");
+            bool allowed = std::any_of(options.allowed_origins.begin(), options.allowed_origins.end(),
+                [origin](const std::string &o) { return iequals(o, origin); });
+            if (!allowed) {
+                res.set_status_code(403);
+                return;
+            }
+        }
+
+        auto accept = websocket_accept_key(key);
+        res.set_header("Sec-WebSocket-Accept", std::string_view(accept.data(), accept.size()));
+        std::string_view protocol = select_protocol(req.header("Sec-WebSocket-Protocol"), options.protocols);
+        if (!protocol.empty()) res.set_header("Sec-WebSocket-Protocol", protocol);
+        res.accept_websocket(*route_);
+    }
+
+    // --- websocket_hub ---
+
+    websocket_hub::~websocket_hub() {
+        for (auto *session : members_) {
+            if (!session) continue;
+            std::erase_if(session->hubs_, [this](const websocket_session::hub_link &link) { return link.hub == this; });
+        }
+    }
+
+    websocket_hub &websocket_hub::current(std::string_view name) {
+        // コアごとの名前付きハブ (数は少ないため線形探索)
+        thread_local std::vector<std::pair<std::string, std::unique_ptr<websocket_hub>>> hubs;
+        for (auto &[n, hub] : hubs) {
+            if (n == name) return *hub;
+        }
+        hubs.emplace_back(std::string(name), std::make_unique<websocket_hub>());
+        return *hubs.back().second;
+    }
+
+    void websocket_hub::subscribe(websocket_session &session) {
+        if (!session.is_open()) return;
+        for (const auto &link : session.hubs_) {
+            if (link.hub == this) return;
+        }
+        members_.push_back(&session);
+        session.hubs_.push_back({ this, members_.size() - 1 });
+    }
+
+    void websocket_hub::unsubscribe(websocket_session &session) {
+        auto &links = session.hubs_;
+        for (size_t i = 0; i < links.size(); ++i) {
+            if (links[i].hub != this) continue;
+            size_t index = links[i].index;
+            links[i] = links.back();
+            links.pop_back();
+            remove_at(index);
+            return;
+        }
+    }
+
+    void websocket_hub::remove_at(size_t index) noexcept {
+        if (publishing_) {
+            // 走査中の配列は動かさない (publish() の最後に詰める)
+            members_[index] = nullptr;
+            holes_++;
+            return;
+        }
+        // 末尾の購読者を空いた位置へ移す
+        websocket_session *last = members_.back();
+        members_.pop_back();
+        if (index < members_.size()) {
+            members_[index] = last;
+            relink(*last, index);
+        }
+    }
+
+    void websocket_hub::relink(websocket_session &session, size_t index) noexcept {
+        for (auto &link : session.hubs_) {
+            if (link.hub == this) {
+                link.index = index;
+                return;
+            }
+        }
+    }
+
+    void websocket_hub::compact() noexcept {
+        size_t out = 0;
+        for (size_t i = 0; i < members_.size(); ++i) {
+            websocket_session *session = members_[i];
+            if (!session) continue;
+            if (out != i) {
+                members_[out] = session;
+                relink(*session, out);
+            }
+            out++;
+        }
+        members_.resize(out);
+        holes_ = 0;
+    }
+
+    size_t websocket_hub::publish(websocket_opcode opcode, std::string_view payload) {
+        if (size() == 0) return 0;
+        return publish(websocket_frame::make(opcode, payload));
+    }
+
+    size_t websocket_hub::publish(const websocket_frame &frame) {
+        if (!frame) return 0;
+
+        // 送信キューの上限で閉じた購読者は on_close の中で外れる (穴として残し、最後に詰める)
+        bool nested = std::exchange(publishing_, true);
+        size_t sent = 0;
+        for (size_t i = 0; i < members_.size(); ++i) {
+            websocket_session *session = members_[i];
+            if (session && session->send(frame)) sent++;
+        }
+        if (!nested) {
+            publishing_ = false;
+            if (holes_ > 0) compact();
+        }
+        return sent;
+    }
+}
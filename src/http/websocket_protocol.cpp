@@ -0,0 +1,427 @@
+#include "ouroboros/http/websocket_protocol.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define OUROBOROS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        // --- マスク解除 ---
+        //
+        // 各実装はブロック単位で処理した後、4の倍数の位置から残りを1バイトずつ処理する
+
+        inline void unmask_tail(char *p, size_t i, size_t n, uint32_t key) noexcept {
+            unsigned char k[4];
+            std::memcpy(k, &key, 4);
+            for (; i < n; ++i) p[i] = static_cast<char>(p[i] ^ static_cast<char>(k[i & 3]));
+        }
+
+        void apply_scalar(char *p, size_t n, uint32_t key) noexcept {
+            uint64_t key64;
+            std::memcpy(&key64, &key, 4);
+            std::memcpy(reinterpret_cast<char *>(&key64) + 4, &key, 4);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                uint64_t word;
+                std::memcpy(&word, p + i, 8);
+                word ^= key64;
+                std::memcpy(p + i, &word, 8);
+            }
+            unmask_tail(p, i, n, key);
+        }
+
+#ifdef OUROBOROS_X86
+        // key はメモリ上のバイト順で読み込んだ値なので、各 32bit レーンへ複製すればバイト順が揃う
+
+        __attribute__((target("sse2")))
+        void apply_sse2(char *p, size_t n, uint32_t key) noexcept {
+            const __m128i k = _mm_set1_epi32(static_cast<int>(key));
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                auto *block = reinterpret_cast<__m128i *>(p + i);
+                _mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), k));
+            }
+            unmask_tail(p, i, n, key);
+        }
+
+        // 大きなフレームは64バイトずつ (2本のロード・ストアを並行させる)、端数は 32 / 16 バイトで処理する
+        __attribute__((target("avx2")))
+        void apply_avx2(char *p, size_t n, uint32_t key) noexcept {
+            const __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+            size_t i = 0;
+            for (; i + 64 <= n; i += 64) {
+                auto *a = reinterpret_cast<__m256i *>(p + i);
+                auto *b = reinterpret_cast<__m256i *>(p + i + 32);
+                __m256i x = _mm256_loadu_si256(a);
+                __m256i y = _mm256_loadu_si256(b);
+                _mm256_storeu_si256(a, _mm256_xor_si256(x, k));
+                _mm256_storeu_si256(b, _mm256_xor_si256(y, k));
+            }
+            if (i + 32 <= n) {
+                auto *a = reinterpret_cast<__m256i *>(p + i);
+                _mm256_storeu_si256(a, _mm256_xor_si256(_mm256_loadu_si256(a), k));
+                i += 32;
+            }
+            if (i + 16 <= n) {
+                auto *a = reinterpret_cast<__m128i *>(p + i);
+                _mm_storeu_si128(a, _mm_xor_si128(_mm_loadu_si128(a), _mm256_castsi256_si128(k)));
+                i += 16;
+            }
+            unmask_tail(p, i, n, key);
+        }
+#endif // OUROBOROS_X86
+
+        constexpr websocket_masker scalar_masker{ websocket_masker::isa::scalar, "scalar", apply_scalar };
+#ifdef OUROBOROS_X86
+        constexpr websocket_masker sse2_masker{ websocket_masker::isa::sse2, "sse2", apply_sse2 };
+        constexpr websocket_masker avx2_masker{ websocket_masker::isa::avx2, "avx2", apply_avx2 };
+#endif
+
+        const websocket_masker *detect() noexcept {
+#ifdef OUROBOROS_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return &avx2_masker;
+            if (__builtin_cpu_supports("sse2")) return &sse2_masker;
+#endif
+            return &scalar_masker;
+        }
+
+        // 起動時に一度だけ判定する
+        const websocket_masker *const active_masker = detect();
+
+        // --- SHA-1 (RFC 3174。Sec-WebSocket-Accept の計算にのみ使用) ---
+
+        constexpr uint32_t rotl(uint32_t x, int n) noexcept {
+            return (x << n) | (x >> (32 - n));
+        }
+
+        void sha1_block(uint32_t (&h)[5], const unsigned char *block) noexcept {
+            uint32_t w[80];
+            for (int i = 0; i < 16; ++i) {
+                w[i] = static_cast<uint32_t>(block[i * 4]) << 24 | static_cast<uint32_t>(block[i * 4 + 1]) << 16 |
+                       static_cast<uint32_t>(block[i * 4 + 2]) << 8 | static_cast<uint32_t>(block[i * 4 + 3]);
+            }
+            for (int i = 16; i < 80; ++i) w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i) {
+                uint32_t f, k;
+                if (i < 20) {
+                    f = (b & c) | (~b & d);
+                    k = 0x5a827999;
+                } else if (i < 40) {
+                    f = b ^ c ^ d;
+                    k = 0x6ed9eba1;
+                } else if (i < 60) {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8f1bbcdc;
+                } else {
+                    f = b ^ c ^ d;
+                    k = 0xca62c1d6;
+                }
+                uint32_t t = rotl(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = rotl(b, 30);
+                b = a;
+                a = t;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        }
+
+        // a と b を連結したデータの SHA-1
+        std::array<unsigned char, 20> sha1(std::string_view a, std::string_view b) noexcept {
+            uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+            unsigned char block[64];
+            size_t filled = 0;
+            uint64_t total = 0;
+            auto feed = [&](std::string_view data) {
+                for (char c : data) {
+                    block[filled++] = static_cast<unsigned char>(c);
+                    if (filled == 64) {
+                        sha1_block(h, block);
+                        filled = 0;
+                    }
+                }
+                total += data.size();
+            };
+            feed(a);
+            feed(b);
+
+            // パディング: 0x80、0 埋め、ビット長 (ビッグエンディアン 64bit)
+            block[filled++] = 0x80;
+            if (filled > 56) {
+                std::fill(block + filled, block + 64, 0);
+                sha1_block(h, block);
+                filled = 0;
+            }
+            std::fill(block + filled, block + 56, 0);
+            uint64_t bits = total * 8;
+            for (int i = 0; i < 8; ++i) block[56 + i] = static_cast<unsigned char>(bits >> (56 - i * 8));
+            sha1_block(h, block);
+
+            std::array<unsigned char, 20> digest;
+            for (int i = 0; i < 5; ++i) {
+                digest[static_cast<size_t>(i * 4)] = static_cast<unsigned char>(h[i] >> 24);
+                digest[static_cast<size_t>(i * 4 + 1)] = static_cast<unsigned char>(h[i] >> 16);
+                digest[static_cast<size_t>(i * 4 + 2)] = static_cast<unsigned char>(h[i] >> 8);
+                digest[static_cast<size_t>(i * 4 + 3)] = static_cast<unsigned char>(h[i]);
+            }
+            return digest;
+        }
+
+        constexpr char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        constexpr bool is_base64(char c) noexcept {
+            return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '/';
+        }
+
+        // RFC 6455 1.3
+        constexpr std::string_view websocket_guid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    }
+
+    const websocket_masker &websocket_masker::active() noexcept {
+        return *active_masker;
+    }
+
+    const websocket_masker *websocket_masker::get(isa kind) noexcept {
+        switch (kind) {
+        case isa::scalar:
+            return &scalar_masker;
+#ifdef OUROBOROS_X86
+        case isa::sse2:
+            return __builtin_cpu_supports("sse2") ? &sse2_masker : nullptr;
+        case isa::avx2:
+            return __builtin_cpu_supports("avx2") ? &avx2_masker : nullptr;
+#endif
+        default:
+            return nullptr;
+        }
+    }
+
+    void websocket_unmask(char *p, size_t n, uint32_t key, uint64_t offset) noexcept {
+        if (unsigned shift = static_cast<unsigned>(offset & 3)) {
+            // 途中から始まる場合は、p[0] に対応するキーのバイトが先頭になるよう回転する
+            unsigned char k[4], rotated[4];
+            std::memcpy(k, &key, 4);
+            for (unsigned i = 0; i < 4; ++i) rotated[i] = k[(i + shift) & 3];
+            std::memcpy(&key, rotated, 4);
+        }
+        active_masker->apply(p, n, key);
+    }
+
+    // --- websocket_parser ---
+
+    void websocket_parser::reset() noexcept {
+        frame_ = {};
+        mask_ = 0;
+        remaining_ = 0;
+        in_payload_ = false;
+        error_ = 0;
+        header_size_ = 0;
+    }
+
+    size_t websocket_parser::decode_header(const unsigned char *p, size_t n) noexcept {
+        if (n < 2) return 0;
+        unsigned char b0 = p[0], b1 = p[1];
+
+        // 拡張 (permessage-deflate 等) は合意しないため RSV ビットは常に 0
+        if (b0 & 0x70) {
+            error_ = websocket_close::protocol_error;
+            return 0;
+        }
+        auto opcode = static_cast<websocket_opcode>(b0 & 0x0f);
+        switch (opcode) {
+        case websocket_opcode::continuation:
+        case websocket_opcode::text:
+        case websocket_opcode::binary:
+        case websocket_opcode::close:
+        case websocket_opcode::ping:
+        case websocket_opcode::pong:
+            break;
+        default:
+            error_ = websocket_close::protocol_error;
+            return 0;
+        }
+        // クライアントのフレームは必ずマスクされている (RFC 6455 5.1)
+        if (!(b1 & 0x80)) {
+            error_ = websocket_close::protocol_error;
+            return 0;
+        }
+
+        unsigned len7 = b1 & 0x7f;
+        size_t extended = len7 == 126 ? 2 : len7 == 127 ? 8 : 0;
+        size_t size = 2 + extended + 4;
+        if (n < size) return 0;
+
+        uint64_t length = len7;
+        if (extended) {
+            length = 0;
+            for (size_t i = 0; i < extended; ++i) length = (length << 8) | p[2 + i];
+            if (length >> 63) {
+                error_ = websocket_close::protocol_error;
+                return 0;
+            }
+        }
+        bool fin = (b0 & 0x80) != 0;
+        // 制御フレームは分割できず、ペイロードは 125 バイトまで (RFC 6455 5.5)
+        if (is_control(opcode) && (!fin || length > 125)) {
+            error_ = websocket_close::protocol_error;
+            return 0;
+        }
+        if (length > max_frame_size_) {
+            error_ = websocket_close::message_too_big;
+            return 0;
+        }
+
+        frame_ = { opcode, fin, length };
+        std::memcpy(&mask_, p + 2 + extended, 4);
+        return size;
+    }
+
+    websocket_parser::status websocket_parser::parse(char *data, size_t n, size_t &consumed, std::string_view &piece) noexcept {
+        consumed = 0;
+        piece = {};
+        if (error_) return status::error;
+
+        if (!in_payload_ || remaining_ == 0) {
+            // 次のフレームのヘッダー
+            in_payload_ = false;
+            auto *bytes = reinterpret_cast<const unsigned char *>(data);
+            if (header_size_ == 0) {
+                // 通常はヘッダー全体が受信データの中にある (コピーなし)
+                size_t size = decode_header(bytes, n);
+                if (error_) return status::error;
+                if (size == 0) {
+                    // ヘッダーの途中で切れている (最大 13 バイト)
+                    std::memcpy(header_.data(), data, n);
+                    header_size_ = n;
+                    consumed = n;
+                    return status::incomplete;
+                }
+                consumed = size;
+            } else {
+                // 前回の断片に続きを足して読み直す
+                size_t take = std::min(header_.size() - header_size_, n);
+                std::memcpy(header_.data() + header_size_, data, take);
+                size_t size = decode_header(header_.data(), header_size_ + take);
+                if (error_) return status::error;
+                if (size == 0) {
+                    header_size_ += take;
+                    consumed = n;
+                    return status::incomplete;
+                }
+                consumed = size - header_size_;
+                header_size_ = 0;
+            }
+            in_payload_ = true;
+            remaining_ = frame_.length;
+        }
+
+        size_t take = static_cast<size_t>(std::min<uint64_t>(remaining_, n - consumed));
+        if (take == 0 && remaining_ > 0) return status::incomplete;
+        char *p = data + consumed;
+        websocket_unmask(p, take, mask_, frame_.length - remaining_);
+        remaining_ -= take;
+        consumed += take;
+        piece = { p, take };
+        return status::payload;
+    }
+
+    size_t write_frame_header(char *out, websocket_opcode opcode, bool fin, uint64_t length) noexcept {
+        out[0] = static_cast<char>((fin ? 0x80 : 0x00) | static_cast<uint8_t>(opcode));
+        if (length < 126) {
+            out[1] = static_cast<char>(length);
+            return 2;
+        }
+        if (length <= 0xffff) {
+            out[1] = 126;
+            out[2] = static_cast<char>(length >> 8);
+            out[3] = static_cast<char>(length);
+            return 4;
+        }
+        out[1] = 127;
+        for (int i = 0; i < 8; ++i) out[2 + i] = static_cast<char>(length >> (56 - i * 8));
+        return 10;
+    }
+
+    std::array<char, 28> websocket_accept_key(std::string_view key) noexcept {
+        auto digest = sha1(key, websocket_guid);
+        std::array<char, 28> out;
+        size_t o = 0;
+        // 20 バイト = 3 バイト * 6 + 2 バイト (末尾は '=' 1つ)
+        for (size_t i = 0; i < 18; i += 3) {
+            uint32_t v = static_cast<uint32_t>(digest[i]) << 16 | static_cast<uint32_t>(digest[i + 1]) << 8 | digest[i + 2];
+            out[o++] = base64_chars[(v >> 18) & 0x3f];
+            out[o++] = base64_chars[(v >> 12) & 0x3f];
+            out[o++] = base64_chars[(v >> 6) & 0x3f];
+            out[o++] = base64_chars[v & 0x3f];
+        }
+        uint32_t v = static_cast<uint32_t>(digest[18]) << 16 | static_cast<uint32_t>(digest[19]) << 8;
+        out[o++] = base64_chars[(v >> 18) & 0x3f];
+        out[o++] = base64_chars[(v >> 12) & 0x3f];
+        out[o++] = base64_chars[(v >> 6) & 0x3f];
+        out[o] = '=';
+        return out;
+    }
+
+    bool valid_websocket_key(std::string_view key) noexcept {
+        if (key.size() != 24 || key.substr(22) != "==") return false;
+        return std::all_of(key.begin(), key.begin() + 22, is_base64);
+    }
+
+    bool valid_utf8(std::string_view s) noexcept {
+        auto *p = reinterpret_cast<const unsigned char *>(s.data());
+        size_t n = s.size();
+        size_t i = 0;
+        while (i < n) {
+            if (i + 8 <= n) {
+                uint64_t word;
+                std::memcpy(&word, p + i, 8);
+                if (!(word & 0x8080808080808080ull)) {
+                    i += 8;
+                    continue;
+                }
+            }
+            unsigned char c = p[i];
+            if (c < 0x80) {
+                ++i;
+                continue;
+            }
+            size_t length;
+            uint32_t cp;
+            if ((c & 0xe0) == 0xc0 && c >= 0xc2) {
+                length = 2;
+                cp = c & 0x1f;
+            } else if ((c & 0xf0) == 0xe0) {
+                length = 3;
+                cp = c & 0x0f;
+            } else if ((c & 0xf8) == 0xf0 && c <= 0xf4) {
+                length = 4;
+                cp = c & 0x07;
+            } else {
+                return false;
+            }
+            if (i + length > n) return false;
+            for (size_t j = 1; j < length; ++j) {
+                unsigned char cc = p[i + j];
+                if ((cc & 0xc0) != 0x80) return false;
+                cp = (cp << 6) | (cc & 0x3f);
+            }
+            // 冗長な表現・サロゲート・範囲外
+            if (length == 3 && (cp < 0x800 || (cp >= 0xd800 && cp <= 0xdfff))) return false;
+            if (length == 4 && (cp < 0x10000 || cp > 0x10ffff)) return false;
+            i += length;
+        }
+        return true;
+    }
+}
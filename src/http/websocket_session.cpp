@@ -0,0 +1,619 @@
+#include "ouroboros/http/websocket_session.hpp"
+#include "ouroboros/http/websocket.hpp"
+#include "ouroboros/http/server.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <utility>
+#include <linux/io_uring.h>
+
+namespace ouroboros::http
+{
+    namespace
+    {
+        // これを超えて伸びた組み立て・送信用の領域は接続の再利用時 (メッセージの組み立て後) に解放する
+        constexpr size_t max_retained_capacity = 64 * 1024;
+
+        // 受信したクローズフレームのステータスとして正しいか (RFC 6455 7.4)
+        bool valid_close_code(uint16_t code) noexcept {
+            if (code >= 1000 && code <= 1003) return true;
+            if (code >= 1007 && code <= 1014) return true;
+            return code >= 3000 && code <= 4999;
+        }
+    }
+
+    // --- websocket_frame ---
+
+    websocket_frame websocket_frame::make(websocket_opcode opcode, std::string_view payload) {
+        char header[max_frame_header];
+        size_t header_size = write_frame_header(header, opcode, true, payload.size());
+        size_t size = header_size + payload.size();
+
+        void *memory = ::operator new(sizeof(block) + size);
+        auto *b = new (memory) block{ 1, size };
+        char *bytes = reinterpret_cast<char *>(b + 1);
+        std::memcpy(bytes, header, header_size);
+        if (!payload.empty()) std::memcpy(bytes + header_size, payload.data(), payload.size());
+
+        websocket_frame frame;
+        frame.block_ = b;
+        return frame;
+    }
+
+    void websocket_frame::reset() noexcept {
+        if (block_ && --block_->refs == 0) ::operator delete(block_);
+        block_ = nullptr;
+    }
+
+    // --- websocket_session ---
+
+    websocket_session::websocket_session(server &svr, io_context &ctx) : server_(svr), ctx_(ctx) {}
+
+    websocket_session::~websocket_session() { leave_hubs(); }
+
+    void websocket_session::reset() noexcept {
+        leave_hubs();
+        route_ = nullptr;
+        state_ = state::idle;
+        user_data_ = nullptr;
+        timer_.cancel();
+        recv_retry_.cancel();
+        timeout_phase_ = timeout_phase::none;
+        recv_armed_ = false;
+        send_armed_ = false;
+        close_after_send_ = false;
+
+        parser_.reset();
+        frame_open_ = false;
+        in_message_ = false;
+        message_.clear();
+        if (message_.capacity() > max_retained_capacity) message_.shrink_to_fit();
+        control_size_ = 0;
+
+        queue_.clear();
+        sending_.clear();
+        sending_index_ = 0;
+        local_.clear();
+        local_sending_.clear();
+        if (local_.capacity() > max_retained_capacity) local_.shrink_to_fit();
+        if (local_sending_.capacity() > max_retained_capacity) local_sending_.shrink_to_fit();
+        queued_bytes_ = 0;
+    }
+
+    void websocket_session::open(const websocket_route &route, const request &req) {
+        route_ = &route;
+        state_ = state::handshake;
+        multishot_ = server_.options().multishot_recv;
+        parser_.set_max_frame_size(route.options.max_message_size);
+
+        if (!route.options.on_open) return;
+        try {
+            route.options.on_open(*this, req);
+        } catch (const std::exception &e) {
+            std::cerr << "WebSocket handler exception: " << e.what() << std::endl;
+            close(websocket_close::internal_error);
+        }
+    }
+
+    void websocket_session::start(unique_socket socket, std::string_view received) {
+        socket_ = std::move(socket);
+        start_io(received);
+    }
+
+    void websocket_session::start(fixed_socket socket, std::string_view received) {
+        fixed_socket_ = std::move(socket);
+        start_io(received);
+    }
+
+    void websocket_session::start_io(std::string_view received) {
+        // on_open の中で close() された場合は closing のまま相手のクローズを待つ
+        if (state_ == state::handshake) state_ = state::open;
+        arm_timeout(state_ == state::open ? timeout_phase::ping : timeout_phase::closing);
+        submit_recv();
+
+        if (!received.empty() && has_socket()) {
+            // 101 の送信中に届いたフレーム (http_session の退避領域は引き継ぎ後に再利用されるためコピーする)
+            std::string data(received);
+            receive(data.data(), data.size());
+        }
+        flush();
+        finish_if_done();
+    }
+
+    void websocket_session::abandon() {
+        notify_close(websocket_close::abnormal);
+        state_ = state::closed;
+        finish_if_done();
+    }
+
+    // --- 受信 ---
+
+    void websocket_session::receive(char *data, size_t length) {
+        // 何か届いていれば Ping は不要 (Pong 待ちも解除する)
+        if (timeout_phase_ == timeout_phase::ping || timeout_phase_ == timeout_phase::pong) {
+            arm_timeout(timeout_phase::ping);
+        }
+
+        size_t offset = 0;
+        // クローズの応答を積んだ後 (close_after_send_) に届いたデータは読まない
+        while (offset < length && has_socket() && !close_after_send_) {
+            size_t consumed = 0;
+            std::string_view piece;
+            auto status = parser_.parse(data + offset, length - offset, consumed, piece);
+            offset += consumed;
+
+            if (status == websocket_parser::status::incomplete) break;
+            if (status == websocket_parser::status::error) {
+                fail(parser_.error_code());
+                return;
+            }
+            handle_piece(piece);
+        }
+    }
+
+    void websocket_session::handle_piece(std::string_view piece) {
+        const auto &frame = parser_.frame();
+
+        if (is_control(frame.opcode)) {
+            // 制御フレームはメッセージの断片の間にも届く (ペイロードは 125 バイト以下)
+            std::memcpy(control_ + control_size_, piece.data(), piece.size());
+            control_size_ += piece.size();
+            if (parser_.frame_complete()) {
+                size_t size = std::exchange(control_size_, 0);
+                handle_control(frame.opcode, std::string_view(control_, size));
+            }
+            return;
+        }
+
+        if (!frame_open_) {
+            // データフレームの先頭
+            frame_open_ = true;
+            if (frame.opcode == websocket_opcode::continuation) {
+                if (!in_message_) return fail(websocket_close::protocol_error);
+            } else {
+                if (in_message_) return fail(websocket_close::protocol_error);
+                in_message_ = true;
+                message_opcode_ = frame.opcode;
+
+                if (frame.fin && piece.size() == frame.length) {
+                    // 断片化されず一つの受信に収まったメッセージ: 受信バッファの中のまま渡す
+                    frame_open_ = false;
+                    in_message_ = false;
+                    deliver(message_opcode_, piece);
+                    return;
+                }
+            }
+        }
+
+        // フレームの長さは parser_ が制限するが、断片化されたメッセージは合計で制限する
+        if (message_.size() + piece.size() > route_->options.max_message_size) {
+            return fail(websocket_close::message_too_big);
+        }
+        message_.append(piece);
+        if (!parser_.frame_complete()) return;
+
+        frame_open_ = false;
+        if (!frame.fin) return;
+        in_message_ = false;
+        deliver(message_opcode_, message_);
+        message_.clear();
+        if (message_.capacity() > max_retained_capacity) message_.shrink_to_fit();
+    }
+
+    void websocket_session::handle_control(websocket_opcode opcode, std::string_view payload) {
+        switch (opcode) {
+        case websocket_opcode::ping:
+            if (state_ == state::open) enqueue(websocket_opcode::pong, payload);
+            break;
+        case websocket_opcode::pong:
+            // 受信したことで receive() が Ping のタイマーを戻している
+            break;
+        case websocket_opcode::close: {
+            uint16_t code = websocket_close::no_status;
+            if (payload.size() == 1) return fail(websocket_close::protocol_error);
+            if (payload.size() >= 2) {
+                code = static_cast<uint16_t>(static_cast<unsigned char>(payload[0]) << 8 | static_cast<unsigned char>(payload[1]));
+                if (!valid_close_code(code)) return fail(websocket_close::protocol_error);
+                if (!valid_utf8(payload.substr(2))) return fail(websocket_close::invalid_payload);
+            }
+            if (state_ == state::open) {
+                // 相手から始めたクローズ: 同じコードを返す
+                if (code == websocket_close::no_status) {
+                    enqueue(websocket_opcode::close, {});
+                } else {
+                    enqueue_close(code, {});
+                }
+                notify_close(code);
+            }
+            // こちらのクローズへの応答、または応答を積んだ: 送り終えたら閉じる
+            close_after_send_ = true;
+            arm_timeout(timeout_phase::closing);
+            flush();
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void websocket_session::deliver(websocket_opcode opcode, std::string_view message) {
+        // クローズハンドシェイク中のメッセージは捨てる
+        if (state_ != state::open) return;
+
+        const websocket_options &options = route_->options;
+        if (opcode == websocket_opcode::text && options.validate_utf8 && !valid_utf8(message)) {
+            return fail(websocket_close::invalid_payload);
+        }
+        if (!options.on_message) return;
+        try {
+            options.on_message(*this, message, opcode);
+        } catch (const std::exception &e) {
+            std::cerr << "WebSocket handler exception: " << e.what() << std::endl;
+            close(websocket_close::internal_error);
+        }
+    }
+
+    void websocket_session::fail(uint16_t code) {
+        if (state_ == state::open) {
+            enqueue_close(code, {});
+            notify_close(code);
+        }
+        close_after_send_ = true;
+        arm_timeout(timeout_phase::closing);
+        flush();
+    }
+
+    void websocket_session::notify_close(uint16_t code) {
+        if (!is_open()) return;
+        state_ = state::closing;
+        leave_hubs();
+
+        if (!route_->options.on_close) return;
+        try {
+            route_->options.on_close(*this, code);
+        } catch (const std::exception &e) {
+            std::cerr << "WebSocket handler exception: " << e.what() << std::endl;
+        }
+    }
+
+    void websocket_session::leave_hubs() noexcept {
+        while (!hubs_.empty()) {
+            hub_link link = hubs_.back();
+            hubs_.pop_back();
+            link.hub->remove_at(link.index);
+        }
+    }
+
+    // --- 送信 ---
+
+    void websocket_session::send(websocket_opcode opcode, std::string_view message) {
+        if (!is_open()) return;
+        enqueue(opcode, message);
+    }
+
+    bool websocket_session::send(const websocket_frame &frame) {
+        if (!is_open() || !frame) return false;
+        size_t length = frame.bytes().size();
+        queue_.push_back({ frame, 0, length });
+        queued_bytes_ += length;
+        if (!check_queue_limit()) return false;
+        flush();
+        return true;
+    }
+
+    void websocket_session::close(uint16_t code, std::string_view reason) {
+        if (!is_open()) return;
+        enqueue_close(code, reason);
+        notify_close(code);
+        // ソケットを引き継ぐ前 (on_open の中) なら start_io() がタイマーを設定する
+        if (has_socket()) arm_timeout(timeout_phase::closing);
+    }
+
+    void websocket_session::enqueue(websocket_opcode opcode, std::string_view payload) {
+        char header[max_frame_header];
+        size_t header_size = write_frame_header(header, opcode, true, payload.size());
+        size_t offset = local_.size();
+        local_.append(header, header_size);
+        local_.append(payload);
+
+        // 直前の要素も local_ なら一つの範囲にまとめる (iovec を増やさない)
+        size_t length = header_size + payload.size();
+        if (!queue_.empty() && !queue_.back().frame && queue_.back().offset + queue_.back().length == offset) {
+            queue_.back().length += length;
+        } else {
+            queue_.push_back({ {}, offset, length });
+        }
+        queued_bytes_ += length;
+        if (check_queue_limit()) flush();
+    }
+
+    void websocket_session::enqueue_close(uint16_t code, std::string_view reason) {
+        char payload[125];
+        payload[0] = static_cast<char>(code >> 8);
+        payload[1] = static_cast<char>(code & 0xff);
+        size_t reason_size = std::min<size_t>(reason.size(), sizeof(payload) - 2);
+        std::memcpy(payload + 2, reason.data(), reason_size);
+        enqueue(websocket_opcode::close, std::string_view(payload, 2 + reason_size));
+    }
+
+    bool websocket_session::check_queue_limit() {
+        // ハンドシェイク中 (on_open) に積んだ分は制限しない
+        if (state_ != state::open || queued_bytes_ <= route_->options.max_send_queue) return true;
+        std::cerr << "WebSocket send queue limit exceeded, closing connection." << std::endl;
+        close_socket();
+        return false;
+    }
+
+    void websocket_session::flush() {
+        if (!has_socket() || send_armed_) return;
+
+        if (sending_index_ == sending_.size()) {
+            // 送信中のフレームを送り終えた: 次に送るフレームと入れ替える
+            sending_.clear();
+            sending_index_ = 0;
+            local_sending_.clear();
+            if (!queue_.empty()) {
+                std::swap(queue_, sending_);
+                std::swap(local_, local_sending_);
+            }
+        }
+        if (sending_index_ < sending_.size()) {
+            submit_send();
+            return;
+        }
+        if (close_after_send_) close_socket();
+    }
+
+    void websocket_session::submit_recv() {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) {
+            close_socket();
+            return;
+        }
+        pending_ops_++;
+        recv_armed_ = true;
+
+        sqe->opcode = IORING_OP_RECV;
+        sqe->addr = 0;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = server_.buffers().group_id();
+        if (multishot_) {
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->len = 0;
+        } else {
+            sqe->len = server_.buffers().buffer_size();
+        }
+        prepare_socket_io(sqe);
+        sqe->user_data = (uint64_t)&recv_op_;
+
+        ctx_.submit();
+    }
+
+    void websocket_session::submit_send() {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) {
+            close_socket();
+            return;
+        }
+        pending_ops_++;
+        send_armed_ = true;
+
+        auto data_of = [this](const queued_frame &f) {
+            return f.frame ? f.frame.bytes().data() + f.offset : local_sending_.data() + f.offset;
+        };
+
+        size_t count = std::min(sending_.size() - sending_index_, max_iovecs);
+        if (count == 1) {
+            const queued_frame &f = sending_[sending_index_];
+            sqe->opcode = IORING_OP_SEND;
+            sqe->addr = (uint64_t)data_of(f);
+            sqe->len = static_cast<uint32_t>(f.length);
+        } else {
+            // 複数のフレーム (共有フレームと local_sending_ の範囲) を一回で送る
+            iov_.resize(count);
+            for (size_t i = 0; i < count; ++i) {
+                const queued_frame &f = sending_[sending_index_ + i];
+                iov_[i] = { const_cast<char *>(data_of(f)), f.length };
+            }
+            msg_ = {};
+            msg_.msg_iov = iov_.data();
+            msg_.msg_iovlen = count;
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->addr = (uint64_t)&msg_;
+            sqe->len = 1;
+        }
+        // 相手が切断していても SIGPIPE ではなく -EPIPE で完了させる
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->flags = 0;
+        prepare_socket_io(sqe);
+        sqe->user_data = (uint64_t)&send_op_;
+
+        ctx_.submit();
+    }
+
+    void websocket_session::submit_cancel(task *target) {
+        auto *sqe = ctx_.get_sqe();
+        if (!sqe) return;
+
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = (uint64_t)target;
+        sqe->user_data = 0;
+
+        ctx_.submit();
+    }
+
+    void websocket_session::prepare_socket_io(io_uring_sqe *sqe) const noexcept {
+        if (fixed_socket_) {
+            sqe->fd = fixed_socket_.native_handle();
+            sqe->flags |= IOSQE_FIXED_FILE;
+        } else {
+            sqe->fd = socket_.native_handle();
+        }
+    }
+
+    void websocket_session::handle_read(int result, uint32_t flags) {
+        bool more = multishot_ && (flags & IORING_CQE_F_MORE);
+        if (!more) {
+            pending_ops_--;
+            recv_armed_ = false;
+        }
+
+        auto bid = buffer_pool::buffer_id(flags);
+        if (result > 0 && bid && has_socket()) {
+            // マスクはバッファの中でそのまま解除する (返却するまで他に使われない)
+            receive(server_.buffers().data(*bid), static_cast<size_t>(result));
+            server_.buffers().recycle(*bid);
+        } else {
+            if (bid) server_.buffers().recycle(*bid);
+
+            if (result == -ENOBUFS) {
+                // プールが枯渇している。すぐに発行し直しても同じ結果になるため、少し待ってから再発行する
+                if (has_socket()) ctx_.timers().arm(recv_retry_, recv_retry_delay);
+            } else if (result == -EINVAL && multishot_) {
+                multishot_ = false;
+            } else if (has_socket()) {
+                // EOF またはエラー (クローズフレームの無い切断は 1006)
+                close_socket();
+            }
+        }
+
+        if (!recv_armed_ && has_socket() && !recv_retry_.armed()) submit_recv();
+        finish_if_done();
+    }
+
+    void websocket_session::handle_recv_retry(int, uint32_t) {
+        if (!recv_armed_ && has_socket()) submit_recv();
+    }
+
+    void websocket_session::handle_write(int result, uint32_t) {
+        pending_ops_--;
+        send_armed_ = false;
+
+        if (result < 0) {
+            // 閉じる時に取り消した場合は既に閉じている
+            if (has_socket()) close_socket();
+            finish_if_done();
+            return;
+        }
+
+        // 送れた分だけ先頭から進める (部分送信なら途中から続ける)
+        size_t sent = static_cast<size_t>(result);
+        queued_bytes_ -= sent;
+        while (sent > 0 && sending_index_ < sending_.size()) {
+            queued_frame &f = sending_[sending_index_];
+            if (sent < f.length) {
+                f.offset += sent;
+                f.length -= sent;
+                break;
+            }
+            sent -= f.length;
+            f.frame.reset();
+            sending_index_++;
+        }
+
+        flush();
+        finish_if_done();
+    }
+
+    void websocket_session::arm_timeout(timeout_phase phase) {
+        timeout_phase_ = phase;
+        const websocket_options &options = route_->options;
+        std::chrono::milliseconds after = phase == timeout_phase::closing ? options.close_timeout : options.ping_interval;
+        if (phase != timeout_phase::none && after.count() > 0) {
+            ctx_.timers().arm(timer_, after);
+        } else {
+            timer_.cancel();
+        }
+    }
+
+    void websocket_session::handle_timeout(int, uint32_t) {
+        if (!has_socket()) return;
+
+        switch (timeout_phase_) {
+        case timeout_phase::ping:
+            enqueue(websocket_opcode::ping, {});
+            if (has_socket()) arm_timeout(timeout_phase::pong);
+            break;
+        case timeout_phase::pong:
+            if (server_.options().log_connections) std::cout << "WebSocket ping timeout." << std::endl;
+            close_socket();
+            break;
+        case timeout_phase::closing:
+            if (server_.options().log_connections) std::cout << "WebSocket close timeout." << std::endl;
+            close_socket();
+            break;
+        default:
+            break;
+        }
+
+        finish_if_done();
+    }
+
+    void websocket_session::close_socket() {
+        if (recv_armed_) submit_cancel(&recv_op_);
+        if (send_armed_) submit_cancel(&send_op_);
+
+        socket_ = unique_socket();
+        fixed_socket_ = fixed_socket();
+        timer_.cancel();
+        recv_retry_.cancel();
+        timeout_phase_ = timeout_phase::none;
+
+        // クローズハンドシェイクを経ずに切断した
+        notify_close(websocket_close::abnormal);
+        state_ = state::closed;
+    }
+
+    void websocket_session::finish_if_done() {
+        if (pending_ops_ == 0 && state_ == state::closed) {
+            if (server_.options().log_connections) std::cout << "WebSocket closed." << std::endl;
+            reset();
+            server_.websockets().release(this);
+        }
+    }
+
+    // --- websocket_pool ---
+
+    websocket_session *websocket_pool::acquire(server &svr, io_context &ctx) {
+        if (in_use_ >= capacity_) return nullptr;
+
+        if (!free_list_) {
+            void *memory = ::operator new(sizeof(websocket_session) * slab_size, std::align_val_t{ alignof(websocket_session) });
+            auto *slab = static_cast<websocket_session *>(memory);
+            size_t constructed = 0;
+            try {
+                for (; constructed < slab_size; ++constructed) new (slab + constructed) websocket_session(svr, ctx);
+            } catch (...) {
+                while (constructed > 0) slab[--constructed].~websocket_session();
+                ::operator delete(memory, std::align_val_t{ alignof(websocket_session) });
+                throw;
+            }
+            slabs_.emplace_back(slab);
+
+            for (size_t i = slab_size; i > 0; --i) {
+                slab[i - 1].next_free_ = free_list_;
+                free_list_ = &slab[i - 1];
+            }
+        }
+
+        websocket_session *session = free_list_;
+        free_list_ = session->next_free_;
+        session->next_free_ = nullptr;
+        in_use_++;
+        return session;
+    }
+
+    void websocket_pool::release(websocket_session *session) noexcept {
+        session->next_free_ = free_list_;
+        free_list_ = session;
+        in_use_--;
+    }
+
+    void websocket_pool::slab_deleter::operator()(websocket_session *slab) const noexcept {
+        for (size_t i = 0; i < slab_size; ++i) slab[i].~websocket_session();
+        ::operator delete(static_cast<void *>(slab), std::align_val_t{ alignof(websocket_session) });
+    }
+}
@@ -1,59 +1,129 @@
 #include "ouroboros/http.hpp"
+#include <csignal>
 #include <iostream>
 #include <vector>
 #include <stdexcept>
+#include <memory_resource>
+#include <filesystem>
 
 // A simple, standalone handler function for the root path.
-void HomeHandler(const ouroboros::http::request& req, ouroboros::http::response& res) {
+void HomeHandler(const ouroboros::http::request&, ouroboros::http::response& res) {
     res.set_body("Welcome to the Ouroboros HTTP server!");
     res.set_header("Content-Type", "text/plain");
 }
 
+// A coroutine handler: it suspends without blocking the event loop of its core.
+// Later requests on the same connection wait until it completes.
+ouroboros::http::coro::task<void> DelayHandler(const ouroboros::http::request& req, ouroboros::http::response& res) {
+    co_await ouroboros::http::coro::sleep_for(*ouroboros::http::io_context::current(), std::chrono::milliseconds(100));
+    res.set_body(req.query.empty() ? std::string_view("delayed") : req.query);
+    res.set_header("Content-Type", "text/plain");
+}
+
+// A streaming handler: the body is produced piece by piece as the client reads it,
+// so a large export never has to be held in memory (sent with chunked encoding).
+void ExportHandler(const ouroboros::http::request&, ouroboros::http::response& res) {
+    res.set_header("Content-Type", "text/csv");
+    res.stream([row = 0](std::string& out) mutable {
+        if (row == 0) out.append("id,name\n");
+        for (int end = row + 1000; row < end && row < 100000; ++row) {
+            out.append(std::to_string(row)).append(",user").append(std::to_string(row)).append("\n");
+        }
+        return row < 100000; // false: this was the last piece
+    });
+}
+
+// An upload handler: bodies over 1 MiB are written to an unnamed temporary file while they arrive
+// (req.body_file), smaller ones are passed in memory (req.body). Content-Length and chunked bodies are accepted.
+void UploadHandler(const ouroboros::http::request& req, ouroboros::http::response& res) {
+    uint64_t size = req.body_file >= 0 ? req.body_file_size : req.body.size();
+    res.set_body("{\"received\": " + std::to_string(size) + "}");
+    res.set_header("Content-Type", "application/json");
+}
+
 // A controller-style class to group related handlers.
 class ApiController {
 public:
-    void Login(const ouroboros::http::request& req, ouroboros::http::response& res) {
+    void Login(const ouroboros::http::request&, ouroboros::http::response& res) {
         // In a real application, you would validate credentials here.
         res.set_status_code(200);
         res.set_body("{\"status\": \"ok\", \"message\": \"Logged in successfully\"}");
         res.set_header("Content-Type", "application/json");
     }
+
+    // Path parameters are views into the request (no copies).
+    // The body is built in the per-request arena, so no heap allocation takes place.
+    void GetUser(const ouroboros::http::request& req, ouroboros::http::response& res) {
+        std::pmr::string body(res.arena());
+        body.append("{\"id\": \"").append(req.params["id"]).append("\"}");
+        res.set_body(std::move(body));
+        res.set_header("Content-Type", "application/json");
+    }
 };
 
 int main() {
     using namespace ouroboros::http;
 
     try {
-        io_context context;
-        auto server_or_error = server::create(context, 8080);
-        if (!server_or_error) {
-            std::cerr << "Server creation failed: " << server_or_error.error().message() << std::endl;
-            return 1;
-        }
-
-        auto& svr = server_or_error.value();
-
         // --- New Framework Usage ---
         ApiController api;
 
         // Define the routing table using the route_entry struct.
         std::vector<route_entry> routes = {
-            { method::GET,  "/",       HomeHandler },
-            { method::POST, "/login",  bind_member(&ApiController::Login, &api) }
+            // The serialized response is cached per core and served without calling the handler for 1s.
+            { method::GET,  "/",       HomeHandler, cache_for(std::chrono::seconds(1)) },
+            { method::POST, "/login",  bind_member(&ApiController::Login, &api) },
+            { method::GET,  "/delay",  DelayHandler },
+            { method::GET,  "/export", ExportHandler },
+            // Up to 256 MiB per upload; only the part not yet written to disk is held in memory.
+            { method::POST, "/upload", UploadHandler, {}, { .max_size = 256 << 20, .spill_threshold = 1 << 20 } }
         };
 
-        // Load the routes into the server instance.
-        svr.load_routes(routes);
-        std::cout << "Routing table loaded." << std::endl;
-        // -------------------------
+        // WebSocket: each message is broadcast to the clients connected to the same core.
+        websocket_endpoint chat({
+            .on_open = [](websocket_session& ws, const request&) { websocket_hub::current("chat").subscribe(ws); },
+            .on_message = [](websocket_session&, std::string_view message, websocket_opcode opcode) {
+                websocket_hub::current("chat").publish(opcode, message);
+            },
+        });
+        routes.push_back({ method::GET, "/chat", chat });
+
+        // Serve files under ./public at /static/ (opened and sent asynchronously with splice).
+        if (std::filesystem::is_directory("public")) {
+            routes.push_back({ method::GET, "/static/*path", static_files("public") });
+        }
 
-        auto start_or_error = svr.start();
+        // Routes known at compile time: matched by generated code, handlers are called directly.
+        static_router<
+            route<"GET", "/users/:id", &ApiController::GetUser>
+        > static_routes{ api };
+
+        // SIGINT / SIGTERM はワーカースレッドではなく、このスレッドの sigwait で受け取る
+        // (マスクはワーカースレッドに継承されるため、起動前に設定する)
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        // Thread-per-core: CPUコア数分のワーカーがそれぞれ io_context / server / ルーティングテーブルを持つ
+        runtime_options options;
+        options.server.static_routes = static_routes.table();
+        runtime rt(options);
+        auto start_or_error = rt.start(8080, routes);
         if(!start_or_error) {
              std::cerr << "Server start failed: " << start_or_error.error().message() << std::endl;
             return 1;
         }
+        std::cout << "Routing table loaded. Workers: " << rt.size() << std::endl;
+        // -------------------------
 
-        context.run();
+        int signal_number = 0;
+        sigwait(&signals, &signal_number);
+        std::cout << "Shutting down..." << std::endl;
+
+        rt.stop();
+        rt.wait();
 
     } catch (const std::exception& e) {
         std::cerr << "Exception: " << e.what() << std::endl;
@@ -61,4 +131,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
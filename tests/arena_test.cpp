@@ -0,0 +1,84 @@
+#include "ouroboros/http/arena.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace ouroboros::http;
+
+TEST(ArenaBlockPoolTest, ReusesReleasedBlocks) {
+    arena_block_pool pool(1024);
+
+    std::byte *a = pool.acquire();
+    std::byte *b = pool.acquire();
+    EXPECT_NE(a, b);
+    EXPECT_EQ(pool.blocks(), 2u);
+    EXPECT_EQ(pool.available(), 0u);
+
+    pool.release(a);
+    EXPECT_EQ(pool.available(), 1u);
+    EXPECT_EQ(pool.acquire(), a);
+    EXPECT_EQ(pool.blocks(), 2u);
+
+    pool.release(a);
+    pool.release(b);
+    EXPECT_EQ(pool.available(), 2u);
+}
+
+TEST(RequestArenaTest, TakesBlockOnFirstAllocation) {
+    arena_block_pool pool(1024);
+    counting_resource upstream;
+    request_arena arena(pool, &upstream);
+
+    // 割り当てのないリクエスト (待機中の接続) はブロックを持たない
+    EXPECT_FALSE(arena.holds_block());
+    EXPECT_EQ(pool.blocks(), 0u);
+
+    {
+        std::pmr::string s("a string longer than the small string buffer", arena.resource());
+        EXPECT_TRUE(arena.holds_block());
+        EXPECT_EQ(pool.blocks(), 1u);
+    }
+    arena.reset();
+    EXPECT_FALSE(arena.holds_block());
+    EXPECT_EQ(pool.available(), 1u);
+    EXPECT_EQ(upstream.allocations(), 0u);
+}
+
+TEST(RequestArenaTest, SharesBlocksBetweenArenas) {
+    arena_block_pool pool(1024);
+    counting_resource upstream;
+    request_arena first(pool, &upstream);
+    request_arena second(pool, &upstream);
+
+    // 順に処理されるリクエストは同じブロックを使い回す
+    for (int i = 0; i < 8; ++i) {
+        request_arena &arena = i % 2 ? second : first;
+        EXPECT_NE(arena.resource()->allocate(512, 8), nullptr);
+        arena.reset();
+    }
+    EXPECT_EQ(pool.blocks(), 1u);
+    EXPECT_EQ(pool.available(), 1u);
+}
+
+TEST(RequestArenaTest, ReturnsOverflowOnReset) {
+    arena_block_pool pool(256);
+    counting_resource upstream;
+    request_arena arena(pool, &upstream);
+
+    EXPECT_NE(arena.resource()->allocate(4096, 8), nullptr);
+    EXPECT_GT(upstream.allocations(), 0u);
+    EXPECT_GT(upstream.bytes_in_use(), 0u);
+
+    arena.reset();
+    EXPECT_EQ(upstream.bytes_in_use(), 0u);
+    EXPECT_EQ(pool.available(), 1u);
+}
+
+TEST(RequestArenaTest, ReturnsBlockOnDestruction) {
+    arena_block_pool pool(1024);
+    counting_resource upstream;
+    {
+        request_arena arena(pool, &upstream);
+        EXPECT_NE(arena.resource()->allocate(64, 8), nullptr);
+    }
+    EXPECT_EQ(pool.available(), 1u);
+}
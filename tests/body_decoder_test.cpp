@@ -0,0 +1,124 @@
+#include "ouroboros/http/body_decoder.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+
+using namespace ouroboros::http;
+
+namespace
+{
+    struct decode_result
+    {
+        body_decoder::status status;
+        std::string body;
+        size_t consumed; // 入力全体のうち消費したバイト数
+    };
+
+    // input を step バイトずつ受信したものとして復号する (受信データは未消費の分を先頭に残して連結する)
+    decode_result decode_split(body_decoder &decoder, std::string_view input, size_t step) {
+        decode_result result{ body_decoder::status::incomplete, {}, 0 };
+        std::string received;
+        size_t fed = 0;
+        while (true) {
+            size_t consumed = 0;
+            std::string_view piece;
+            auto status = decoder.decode(received, consumed, piece);
+            result.body.append(piece);
+            received.erase(0, consumed);
+            result.consumed += consumed;
+            if (status == body_decoder::status::done || status == body_decoder::status::error) {
+                result.status = status;
+                return result;
+            }
+            if (status == body_decoder::status::incomplete) {
+                if (fed == input.size()) return result;
+                size_t n = std::min(step, input.size() - fed);
+                received.append(input.substr(fed, n));
+                fed += n;
+            }
+        }
+    }
+}
+
+TEST(BodyDecoderTest, ReadsContentLengthBody) {
+    body_decoder decoder;
+    decoder.reset(5);
+
+    auto result = decode_split(decoder, "helloGET / HTTP/1.1\r\n", 64);
+    EXPECT_EQ(result.status, body_decoder::status::done);
+    EXPECT_EQ(result.body, "hello");
+    EXPECT_EQ(result.consumed, 5u);
+}
+
+TEST(BodyDecoderTest, ReadsChunkedBody) {
+    constexpr std::string_view input = "5\r\nhello\r\n6;name=value\r\n world\r\n0\r\n\r\n";
+    body_decoder decoder;
+    decoder.reset_chunked();
+
+    auto result = decode_split(decoder, input, input.size());
+    EXPECT_EQ(result.status, body_decoder::status::done);
+    EXPECT_EQ(result.body, "hello world");
+    EXPECT_EQ(result.consumed, input.size());
+}
+
+TEST(BodyDecoderTest, ResumesChunkedBodySplitAtEveryByte) {
+    constexpr std::string_view input = "a\r\n0123456789\r\n1F;ext\r\nabcdefghijklmnopqrstuvwxyzABCDE\r\n0\r\nX-Trailer: 1\r\n\r\n";
+    body_decoder decoder;
+    decoder.reset_chunked();
+
+    auto result = decode_split(decoder, input, 1);
+    EXPECT_EQ(result.status, body_decoder::status::done);
+    EXPECT_EQ(result.body, "0123456789abcdefghijklmnopqrstuvwxyzABCDE");
+    EXPECT_EQ(result.consumed, input.size());
+}
+
+TEST(BodyDecoderTest, StopsAtEndOfChunkedBody) {
+    constexpr std::string_view body = "3\r\nabc\r\n0\r\n\r\n";
+    body_decoder decoder;
+    decoder.reset_chunked();
+
+    auto result = decode_split(decoder, std::string(body) + "GET / HTTP/1.1\r\n", 64);
+    EXPECT_EQ(result.status, body_decoder::status::done);
+    EXPECT_EQ(result.body, "abc");
+    EXPECT_EQ(result.consumed, body.size());
+}
+
+TEST(BodyDecoderTest, AcceptsSixteenDigitChunkSize) {
+    body_decoder decoder;
+    decoder.reset_chunked();
+
+    // uint64_t に収まる長さ (データが届くまで incomplete)
+    auto result = decode_split(decoder, "000000000000000A\r\n0123456789\r\n0\r\n\r\n", 64);
+    EXPECT_EQ(result.status, body_decoder::status::done);
+    EXPECT_EQ(result.body, "0123456789");
+}
+
+TEST(BodyDecoderTest, RejectsChunkSizeOverflow) {
+    body_decoder decoder;
+    decoder.reset_chunked();
+
+    // 17桁の長さは uint64_t に収まらない (分割されていても検出する)
+    auto result = decode_split(decoder, "10000000000000000\r\n", 1);
+    EXPECT_EQ(result.status, body_decoder::status::error);
+}
+
+TEST(BodyDecoderTest, RejectsMissingChunkSize) {
+    body_decoder decoder;
+    decoder.reset_chunked();
+
+    EXPECT_EQ(decode_split(decoder, "\r\nhello\r\n", 64).status, body_decoder::status::error);
+}
+
+TEST(BodyDecoderTest, RejectsInvalidChunkSizeCharacter) {
+    body_decoder decoder;
+    decoder.reset_chunked();
+
+    EXPECT_EQ(decode_split(decoder, "5x\r\nhello\r\n", 64).status, body_decoder::status::error);
+}
+
+TEST(BodyDecoderTest, RejectsMissingCrlfAfterChunkData) {
+    body_decoder decoder;
+    decoder.reset_chunked();
+
+    EXPECT_EQ(decode_split(decoder, "3\r\nabcd\r\n0\r\n\r\n", 64).status, body_decoder::status::error);
+}
@@ -0,0 +1,146 @@
+#include "ouroboros/http/char_scanner.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ouroboros::http;
+
+namespace
+{
+    using scan_fn = size_t (*)(const char *, size_t) noexcept;
+
+    struct scan_kind
+    {
+        const char *name;
+        scan_fn char_scanner::*fn;
+        // 走査を止めない文字 (この中から埋める)
+        std::string valid;
+    };
+
+    std::string valid_chars(scan_fn scalar) {
+        std::string valid;
+        for (int c = 0; c < 256; ++c) {
+            char ch = static_cast<char>(c);
+            if (scalar(&ch, 1) == 1) valid.push_back(ch);
+        }
+        return valid;
+    }
+
+    std::vector<scan_kind> scan_kinds() {
+        const char_scanner &scalar = *char_scanner::get(char_scanner::isa::scalar);
+        return {
+            { "token", &char_scanner::token, valid_chars(scalar.token) },
+            { "target", &char_scanner::target, valid_chars(scalar.target) },
+            { "field_value", &char_scanner::field_value, valid_chars(scalar.field_value) },
+        };
+    }
+
+    // CPU が対応するスカラー以外の実装
+    std::vector<const char_scanner *> vector_scanners() {
+        std::vector<const char_scanner *> scanners;
+        for (auto kind : { char_scanner::isa::sse42, char_scanner::isa::avx2 }) {
+            if (const char_scanner *s = char_scanner::get(kind)) scanners.push_back(s);
+        }
+        return scanners;
+    }
+
+    // p[0..n) を全ての実装で走査し、スカラー実装と同じ位置を返すことを確かめる
+    void expect_same(const scan_kind &kind, const char *p, size_t n) {
+        const char_scanner &scalar = *char_scanner::get(char_scanner::isa::scalar);
+        size_t expected = (scalar.*kind.fn)(p, n);
+        for (const char_scanner *s : vector_scanners()) {
+            ASSERT_EQ((s->*kind.fn)(p, n), expected) << s->name << " " << kind.name << " n=" << n;
+        }
+    }
+}
+
+TEST(CharScannerTest, ScalarScannerIsAlwaysAvailable) {
+    ASSERT_NE(char_scanner::get(char_scanner::isa::scalar), nullptr);
+    EXPECT_NE(char_scanner::get(char_scanner::active().kind), nullptr);
+}
+
+TEST(CharScannerTest, AgreesOnEveryByteAtEveryPosition) {
+    // 有効な文字の列のどこか一か所に各バイト値を置く (ベクトル境界の前後と 32 バイトを超える端数を含む)
+    constexpr size_t lengths[] = { 15, 16, 17, 31, 32, 33, 47, 63, 64, 65, 95 };
+    for (const auto &kind : scan_kinds()) {
+        for (size_t n : lengths) {
+            std::string s(n, '\0');
+            for (size_t i = 0; i < n; ++i) s[i] = kind.valid[i % kind.valid.size()];
+            for (size_t pos = 0; pos < n; ++pos) {
+                char saved = s[pos];
+                for (int c = 0; c < 256; ++c) {
+                    s[pos] = static_cast<char>(c);
+                    expect_same(kind, s.data(), n);
+                    if (HasFatalFailure()) return;
+                }
+                s[pos] = saved;
+            }
+        }
+    }
+}
+
+TEST(CharScannerTest, AgreesOnTailsPastVectorBoundary) {
+    // 全て有効な文字 (走査は最後まで進む): 0〜31 バイトの端数を、ずらした開始位置からも確かめる
+    for (const auto &kind : scan_kinds()) {
+        std::string buffer(256, '\0');
+        for (size_t i = 0; i < buffer.size(); ++i) buffer[i] = kind.valid[(i * 7) % kind.valid.size()];
+        for (size_t offset = 0; offset < 16; ++offset) {
+            for (size_t blocks = 0; blocks <= 3; ++blocks) {
+                for (size_t tail = 0; tail < 32; ++tail) {
+                    expect_same(kind, buffer.data() + offset, blocks * 32 + tail);
+                    if (HasFatalFailure()) return;
+                }
+            }
+        }
+    }
+}
+
+TEST(CharScannerTest, AgreesOnTildeRuns) {
+    // '~' は SSE4.2 の token の範囲から外してあり、スカラーで確認して走査を続ける
+    const scan_kind kind = scan_kinds()[0];
+    for (size_t n = 0; n <= 80; ++n) {
+        std::string all(n, '~');
+        expect_same(kind, all.data(), n);
+        std::string mixed(n, 'a');
+        for (size_t i = 0; i < n; i += 3) mixed[i] = '~';
+        expect_same(kind, mixed.data(), n);
+        if (n > 0) {
+            mixed[n - 1] = ' ';
+            expect_same(kind, mixed.data(), n);
+        }
+        if (HasFatalFailure()) return;
+    }
+}
+
+TEST(CharScannerTest, AgreesOnHighBytes) {
+    // 0x80 以上は token では止まり、target と field_value では止まらない (符号付き比較の誤りを検出する)
+    for (const auto &kind : scan_kinds()) {
+        for (size_t n = 0; n <= 96; ++n) {
+            std::string s(n, '\0');
+            for (size_t i = 0; i < n; ++i) s[i] = static_cast<char>(0x80 + (i * 13) % 128);
+            expect_same(kind, s.data(), n);
+            if (HasFatalFailure()) return;
+        }
+    }
+}
+
+TEST(CharScannerTest, AgreesOnRandomInput) {
+    std::mt19937 rng(12345);
+    for (const auto &kind : scan_kinds()) {
+        std::string s(160, '\0');
+        for (int round = 0; round < 20000; ++round) {
+            // 大半を有効な文字にして、停止位置が長い入力の途中に来るようにする
+            size_t n = rng() % s.size();
+            size_t invalid_per_mille = rng() % 50;
+            for (size_t i = 0; i < n; ++i) {
+                s[i] = rng() % 1000 < invalid_per_mille ? static_cast<char>(rng() & 0xff)
+                                                        : kind.valid[rng() % kind.valid.size()];
+            }
+            size_t offset = rng() % 16;
+            expect_same(kind, s.data() + offset, n - std::min(n, offset));
+            if (HasFatalFailure()) return;
+        }
+    }
+}
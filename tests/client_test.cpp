@@ -0,0 +1,191 @@
+#include "ouroboros/http/client.hpp"
+#include "ouroboros/http/coro.hpp"
+#include "ouroboros/http/error.hpp"
+#include "loopback_backend.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <expected>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ouroboros::http;
+
+namespace
+{
+    using client_result = std::expected<client_response, std::error_code>;
+
+    constexpr std::string_view chunked_head = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+
+    // body をチャンク形式で組み立てる (chunk_size バイトずつ)
+    std::string encode_chunked(std::string_view body, size_t chunk_size) {
+        std::string out;
+        char size[32];
+        for (size_t offset = 0; offset < body.size(); offset += chunk_size) {
+            size_t n = std::min(chunk_size, body.size() - offset);
+            std::snprintf(size, sizeof(size), "%zx\r\n", n);
+            out += size;
+            out += body.substr(offset, n);
+            out += "\r\n";
+        }
+        out += "0\r\n\r\n";
+        return out;
+    }
+
+    // 全てのリクエストが終わったらイベントループを止める
+    struct join_counter : task
+    {
+        io_context &ctx;
+        size_t remaining;
+
+        join_counter(io_context &c, size_t n) : ctx(c), remaining(n) {}
+        void complete(int, uint32_t) override {
+            if (--remaining == 0) ctx.stop();
+        }
+    };
+
+    coro::task<void> fetch_one(client &cl, uint16_t port, std::string_view target, client_result &result) {
+        result = co_await cl.request("127.0.0.1", port, { .target = target });
+    }
+
+    // targets を同時に送り、全ての結果を返す (イベントループはこのスレッドで回す)
+    std::vector<client_result> fetch_all(uint16_t port, const std::vector<std::string> &targets,
+        const client_options &options = {}, uint64_t *connections = nullptr) {
+        io_context ctx;
+        client cl(ctx, options);
+        std::vector<client_result> results;
+        for (size_t i = 0; i < targets.size(); ++i) results.emplace_back(std::unexpected(std::error_code()));
+        join_counter joined(ctx, targets.size());
+        std::vector<coro::task<void>> tasks;
+        for (size_t i = 0; i < targets.size(); ++i) {
+            tasks.push_back(fetch_one(cl, port, targets[i], results[i]));
+            tasks.back().start(joined);
+        }
+        ctx.run();
+        if (connections) *connections = cl.connections_opened();
+        return results;
+    }
+
+    // 順に送る (前のレスポンスを受け取ってから次を送る)
+    coro::task<void> fetch_sequence(client &cl, uint16_t port, size_t count, std::vector<client_result> &results) {
+        for (size_t i = 0; i < count; ++i) results.push_back(co_await cl.request("127.0.0.1", port, { .target = "/" }));
+    }
+}
+
+TEST(ClientTest, DecodesChunkedResponseAcrossReceives) {
+    // 長さの行・データ・トレーラーを別々に送り、それぞれ別の受信で届くようにする
+    loopback_backend backend([](int fd) {
+        std::string buffer;
+        if (read_request(fd, buffer).empty()) return;
+        for (std::string_view piece : { chunked_head, std::string_view("5\r\nhel"), std::string_view("lo\r\n6;ext=1\r\n"),
+                 std::string_view(" world\r\n0\r\nX-Trailer: t\r\n"), std::string_view("\r\n") }) {
+            write_all(fd, piece);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        read_request(fd, buffer);
+    });
+
+    auto results = fetch_all(backend.port(), { "/" });
+    ASSERT_TRUE(results[0].has_value()) << results[0].error().message();
+    EXPECT_EQ(results[0]->status, 200);
+    EXPECT_EQ(results[0]->body, "hello world");
+    EXPECT_EQ(results[0]->header("Transfer-Encoding"), "chunked");
+}
+
+TEST(ClientTest, ReusesConnectionAfterChunkedResponse) {
+    loopback_backend backend([](int fd) {
+        std::string buffer;
+        for (int i = 0; !read_request(fd, buffer).empty(); ++i) {
+            write_all(fd, std::string(chunked_head) + encode_chunked("response " + std::to_string(i), 4));
+        }
+    });
+
+    io_context ctx;
+    client cl(ctx);
+    std::vector<client_result> results;
+    join_counter joined(ctx, 1);
+    auto sequence = fetch_sequence(cl, backend.port(), 3, results);
+    sequence.start(joined);
+    ctx.run();
+
+    ASSERT_EQ(results.size(), 3u);
+    for (size_t i = 0; i < results.size(); ++i) {
+        ASSERT_TRUE(results[i].has_value()) << results[i].error().message();
+        EXPECT_EQ(results[i]->body, "response " + std::to_string(i));
+    }
+    EXPECT_EQ(cl.connections_opened(), 1u);
+    EXPECT_EQ(backend.connections(), 1u);
+}
+
+TEST(ClientTest, SplitsPipelinedChunkedResponses) {
+    // 4つのリクエストを受け取ってから、レスポンスをまとめて一度に送る
+    loopback_backend backend([](int fd) {
+        std::string buffer;
+        std::string responses;
+        for (int i = 0; i < 4; ++i) {
+            std::string req = read_request(fd, buffer);
+            if (req.empty()) return;
+            std::string target = req.substr(4, req.find(' ', 4) - 4);
+            responses += std::string(chunked_head) + encode_chunked("body of " + target, 3);
+        }
+        write_all(fd, responses);
+        read_request(fd, buffer);
+    });
+
+    uint64_t connections = 0;
+    auto results = fetch_all(backend.port(), { "/a", "/b", "/c", "/d" }, { .max_connections = 1, .max_pipeline = 4 },
+        &connections);
+    const char *targets[] = { "/a", "/b", "/c", "/d" };
+    for (size_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(results[i].has_value()) << results[i].error().message();
+        EXPECT_EQ(results[i]->body, std::string("body of ") + targets[i]);
+    }
+    EXPECT_EQ(connections, 1u);
+}
+
+TEST(ClientTest, DecodesLargeChunkedResponse) {
+    // 受信バッファ (初期 16KiB) より大きいボディを小さなチャンクで送る
+    std::string body(1 << 20, '\0');
+    for (size_t i = 0; i < body.size(); ++i) body[i] = static_cast<char>('a' + i % 26);
+    loopback_backend backend([&body](int fd) {
+        std::string buffer;
+        if (read_request(fd, buffer).empty()) return;
+        write_all(fd, std::string(chunked_head) + encode_chunked(body, 1000));
+        read_request(fd, buffer);
+    });
+
+    auto results = fetch_all(backend.port(), { "/" });
+    ASSERT_TRUE(results[0].has_value()) << results[0].error().message();
+    EXPECT_EQ(results[0]->body.size(), body.size());
+    EXPECT_TRUE(results[0]->body == body);
+}
+
+TEST(ClientTest, RejectsChunkedBodyOverLimit) {
+    loopback_backend backend([](int fd) {
+        std::string buffer;
+        if (read_request(fd, buffer).empty()) return;
+        write_all(fd, std::string(chunked_head) + encode_chunked(std::string(64, 'x'), 16));
+        read_request(fd, buffer);
+    });
+
+    client_options options;
+    options.limits.max_body_size = 32;
+    auto results = fetch_all(backend.port(), { "/" }, options);
+    ASSERT_FALSE(results[0].has_value());
+    EXPECT_EQ(results[0].error(), make_error_code(error_code::invalid_response));
+}
+
+TEST(ClientTest, RejectsTruncatedChunkedBody) {
+    // ボディの途中で閉じられたレスポンス
+    loopback_backend backend([](int fd) {
+        std::string buffer;
+        if (read_request(fd, buffer).empty()) return;
+        write_all(fd, std::string(chunked_head) + "a\r\nhello");
+    });
+
+    auto results = fetch_all(backend.port(), { "/" });
+    ASSERT_FALSE(results[0].has_value());
+    EXPECT_EQ(results[0].error(), make_error_code(error_code::invalid_response));
+}
@@ -0,0 +1,124 @@
+#ifndef LOOPBACK_BACKEND_HPP
+#define LOOPBACK_BACKEND_HPP
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// テスト用の上流サーバー (ループバックの 127.0.0.1 で待ち受け、ポートはカーネルが選ぶ)
+//
+// 接続ごとにスレッドを起こして handler(fd) を呼ぶ (handler が戻ったら閉じる)。
+// 破棄時は待ち受けと残っている接続を shutdown() して、全てのスレッドを待つ。
+class loopback_backend
+{
+public:
+    using handler = std::function<void(int fd)>;
+
+    explicit loopback_backend(handler h) : handler_(std::move(h)) {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd_, 64) < 0 ||
+            ::getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&addr), &length) < 0) {
+            std::abort();
+        }
+        port_ = ntohs(addr.sin_port);
+        accept_thread_ = std::thread([this] { accept_loop(); });
+    }
+
+    ~loopback_backend() {
+        ::shutdown(listen_fd_, SHUT_RDWR);
+        accept_thread_.join();
+        ::close(listen_fd_);
+        {
+            std::lock_guard lock(mutex_);
+            for (int fd : open_) ::shutdown(fd, SHUT_RDWR);
+        }
+        for (auto &t : threads_) t.join();
+    }
+
+    loopback_backend(const loopback_backend &) = delete;
+    loopback_backend &operator=(const loopback_backend &) = delete;
+
+    [[nodiscard]] uint16_t port() const noexcept { return port_; }
+    // これまでに受け付けた接続の数
+    [[nodiscard]] size_t connections() const noexcept { return accepted_.load(); }
+
+private:
+    void accept_loop() {
+        while (true) {
+            // 待ち受けを shutdown() すると失敗する
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) return;
+            accepted_++;
+            std::lock_guard lock(mutex_);
+            open_.push_back(fd);
+            threads_.emplace_back([this, fd] {
+                handler_(fd);
+                std::lock_guard lock(mutex_);
+                open_.erase(std::find(open_.begin(), open_.end(), fd));
+                ::close(fd);
+            });
+        }
+    }
+
+    handler handler_;
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<size_t> accepted_{ 0 };
+    std::thread accept_thread_;
+    std::mutex mutex_;
+    std::vector<int> open_;
+    std::vector<std::thread> threads_;
+};
+
+// data を全て送る (相手が閉じていれば false)
+inline bool write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+// 一つのリクエスト (ヘッダーと Content-Length のボディ) を読む。接続が閉じられたら空
+// buffer には次のリクエストの先頭が残る (同じ接続では同じ buffer を渡す)
+inline std::string read_request(int fd, std::string &buffer) {
+    char chunk[4096];
+    size_t head_end;
+    while ((head_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return {};
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+    head_end += 4;
+    size_t length = 0;
+    if (size_t field = buffer.find("Content-Length: "); field != std::string::npos && field < head_end) {
+        length = std::strtoul(buffer.c_str() + field + 16, nullptr, 10);
+    }
+    while (buffer.size() < head_end + length) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return {};
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+    std::string request = buffer.substr(0, head_end + length);
+    buffer.erase(0, head_end + length);
+    return request;
+}
+
+#endif // LOOPBACK_BACKEND_HPP
@@ -0,0 +1,163 @@
+#include "ouroboros/http/request_parser.hpp"
+#include <gtest/gtest.h>
+#include <string_view>
+
+using namespace ouroboros::http;
+
+namespace
+{
+    // data を先頭から1バイトずつ増やしながら解析する (受信が任意の位置で分割された場合)
+    parse_status parse_split(request_parser &parser, std::string_view data, request &req) {
+        parse_status status = parse_status::incomplete;
+        for (size_t n = 1; n <= data.size() && status == parse_status::incomplete; ++n) {
+            status = parser.parse(data.substr(0, n), req);
+        }
+        return status;
+    }
+}
+
+TEST(RequestParserTest, ParsesCompleteRequest) {
+    constexpr std::string_view data = "GET /users?id=1 HTTP/1.1\r\nHost: example.com\r\n\r\n";
+    request_parser parser;
+    request req;
+
+    ASSERT_EQ(parser.parse(data, req), parse_status::complete);
+    EXPECT_EQ(req.method, method::GET);
+    EXPECT_EQ(req.path, "/users");
+    EXPECT_EQ(req.query, "id=1");
+    EXPECT_EQ(req.header("host"), "example.com");
+    EXPECT_EQ(parser.consumed(), data.size());
+}
+
+TEST(RequestParserTest, ResumesAcrossSplitInput) {
+    constexpr std::string_view head =
+        "POST /login HTTP/1.1\r\nHost: example.com\r\nContent-Length: 5\r\nX-Long-Header: abcdefghij\r\n\r\n";
+    request_parser parser;
+    request req;
+
+    // ヘッダーが揃った時点で完了し、まだ届いていないボディは呼び出し元が読む
+    ASSERT_EQ(parse_split(parser, head, req), parse_status::complete);
+    EXPECT_EQ(req.method, method::POST);
+    EXPECT_EQ(req.path, "/login");
+    EXPECT_EQ(req.header("x-long-header"), "abcdefghij");
+    EXPECT_TRUE(parser.body_pending());
+    EXPECT_EQ(parser.body_length(), 5u);
+    EXPECT_EQ(parser.consumed(), head.size());
+}
+
+TEST(RequestParserTest, ReturnsBodyReceivedWithHeaders) {
+    constexpr std::string_view data = "POST /login HTTP/1.1\r\nHost: example.com\r\nContent-Length: 5\r\n\r\nhello";
+    request_parser parser;
+    request req;
+
+    ASSERT_EQ(parser.parse(data, req), parse_status::complete);
+    EXPECT_FALSE(parser.body_pending());
+    EXPECT_EQ(req.body, "hello");
+    EXPECT_EQ(parser.consumed(), data.size());
+}
+
+TEST(RequestParserTest, StopsAtPipelinedRequest) {
+    constexpr std::string_view first = "GET /a HTTP/1.1\r\nHost: x\r\n\r\n";
+    constexpr std::string_view data = "GET /a HTTP/1.1\r\nHost: x\r\n\r\nGET /b HTTP/1.1\r\nHost: x\r\n\r\n";
+    request_parser parser;
+    request req;
+
+    ASSERT_EQ(parser.parse(data, req), parse_status::complete);
+    EXPECT_EQ(req.path, "/a");
+    ASSERT_EQ(parser.consumed(), first.size());
+
+    parser.reset();
+    ASSERT_EQ(parser.parse(data.substr(first.size()), req), parse_status::complete);
+    EXPECT_EQ(req.path, "/b");
+}
+
+TEST(RequestParserTest, AcceptsChunkedRequest) {
+    constexpr std::string_view head = "POST /upload HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: chunked\r\n\r\n";
+    request_parser parser;
+    request req;
+
+    ASSERT_EQ(parser.parse(head, req), parse_status::complete);
+    EXPECT_TRUE(parser.chunked());
+    EXPECT_TRUE(parser.body_pending());
+    EXPECT_EQ(parser.consumed(), head.size());
+}
+
+TEST(RequestParserTest, RejectsContentLengthWithTransferEncoding) {
+    request_parser parser;
+    request req;
+
+    ASSERT_EQ(parser.parse("POST / HTTP/1.1\r\nHost: x\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n", req),
+        parse_status::error);
+    EXPECT_EQ(parser.error_status(), 400);
+}
+
+TEST(RequestParserTest, RejectsTransferEncodingWithContentLength) {
+    request_parser parser;
+    request req;
+
+    ASSERT_EQ(parser.parse("POST / HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: chunked\r\nContent-Length: 5\r\n\r\n", req),
+        parse_status::error);
+    EXPECT_EQ(parser.error_status(), 400);
+}
+
+TEST(RequestParserTest, RejectsConflictingContentLengths) {
+    request_parser parser;
+    request req;
+
+    ASSERT_EQ(parser.parse("POST / HTTP/1.1\r\nHost: x\r\nContent-Length: 5\r\nContent-Length: 6\r\n\r\n", req),
+        parse_status::error);
+    EXPECT_EQ(parser.error_status(), 400);
+}
+
+TEST(RequestParserTest, RejectsUnsupportedTransferCoding) {
+    request_parser parser;
+    request req;
+
+    ASSERT_EQ(parser.parse("POST / HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: gzip\r\n\r\n", req), parse_status::error);
+    EXPECT_EQ(parser.error_status(), 501);
+}
+
+TEST(RequestParserTest, RejectsOversizedRequestLine) {
+    parser_limits limits;
+    limits.max_request_line = 32;
+    request_parser parser(limits);
+    request req;
+
+    ASSERT_EQ(parser.parse("GET /aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa HTTP/1.1\r\n\r\n", req), parse_status::error);
+    EXPECT_EQ(parser.error_status(), 414);
+}
+
+TEST(ResponseParserTest, LeavesChunkedBodyToCaller) {
+    constexpr std::string_view head = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+    request_parser parser(parser_mode::response, {});
+    client_response res;
+
+    // ヘッダーまでで完了し、ボディ (続くチャンク) は呼び出し元が読む
+    ASSERT_EQ(parser.parse(std::string(head) + "5\r\nhel", res), parse_status::complete);
+    EXPECT_TRUE(parser.chunked());
+    EXPECT_TRUE(parser.body_pending());
+    EXPECT_FALSE(parser.body_until_close());
+    EXPECT_TRUE(parser.keep_alive());
+    EXPECT_EQ(parser.consumed(), head.size());
+    EXPECT_TRUE(res.body.empty());
+}
+
+TEST(ResponseParserTest, IgnoresChunkedCodingOfHeadResponse) {
+    constexpr std::string_view data = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+    request_parser parser(parser_mode::response, {});
+    parser.set_request_method(method::HEAD);
+    client_response res;
+
+    ASSERT_EQ(parser.parse(data, res), parse_status::complete);
+    EXPECT_FALSE(parser.body_pending());
+    EXPECT_EQ(parser.consumed(), data.size());
+}
+
+TEST(ResponseParserTest, RejectsChunkedResponseWithContentLength) {
+    request_parser parser(parser_mode::response, {});
+    client_response res;
+
+    ASSERT_EQ(parser.parse("HTTP/1.1 200 OK\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n", res),
+        parse_status::error);
+    EXPECT_EQ(parser.error_status(), 400);
+}
@@ -0,0 +1,417 @@
+#include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/reverse_proxy.hpp"
+#include "ouroboros/http/server.hpp"
+#include "loopback_backend.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ouroboros::http;
+
+namespace
+{
+    using std::chrono::milliseconds;
+
+    constexpr std::string_view chunked_head = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+
+    std::string ok_response(std::string_view body) {
+        return "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + std::string(body);
+    }
+
+    // body をチャンク形式で組み立てる (chunk_size バイトずつ)
+    std::string encode_chunked(std::string_view body, size_t chunk_size) {
+        std::string out;
+        char size[32];
+        for (size_t offset = 0; offset < body.size(); offset += chunk_size) {
+            size_t n = std::min(chunk_size, body.size() - offset);
+            std::snprintf(size, sizeof(size), "%zx\r\n", n);
+            out += size;
+            out += body.substr(offset, n);
+            out += "\r\n";
+        }
+        out += "0\r\n\r\n";
+        return out;
+    }
+
+    std::string pattern_body(size_t size) {
+        std::string body(size, '\0');
+        for (size_t i = 0; i < body.size(); ++i) body[i] = static_cast<char>('a' + i % 26);
+        return body;
+    }
+
+    // 全てのリクエストに同じボディを Content-Length で返す上流 (Keep-Alive)
+    loopback_backend::handler serve(std::string body) {
+        return [body = std::move(body)](int fd) {
+            std::string buffer;
+            while (!read_request(fd, buffer).empty()) {
+                if (!write_all(fd, ok_response(body))) return;
+            }
+        };
+    }
+
+    // 閉じられたポート (接続は拒否される)
+    uint16_t closed_port() {
+        uint16_t port;
+        {
+            loopback_backend backend([](int) {});
+            port = backend.port();
+        }
+        return port;
+    }
+
+    struct raw_response
+    {
+        int status = 0;
+        std::string head;
+        std::string body; // 受信したままのボディ (チャンク形式なら区切りも含む)
+    };
+
+    // request を送り、サーバーが閉じるまで読む (失敗したら status は 0)
+    raw_response send_request(uint16_t port, std::string_view request) {
+        raw_response res;
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return res;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        std::string received;
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0 && write_all(fd, request)) {
+            char chunk[16384];
+            ssize_t n;
+            while ((n = ::recv(fd, chunk, sizeof(chunk), 0)) > 0) received.append(chunk, static_cast<size_t>(n));
+        }
+        ::close(fd);
+
+        size_t head_end = received.find("\r\n\r\n");
+        if (head_end == std::string::npos || received.size() < 12) return res;
+        res.status = std::stoi(received.substr(9, 3));
+        res.head = received.substr(0, head_end + 4);
+        res.body = received.substr(head_end + 4);
+        return res;
+    }
+
+    raw_response get(uint16_t port, std::string_view target) {
+        return send_request(port, "GET " + std::string(target) + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+    }
+
+    // 全てのパスを上流へ転送するサーバー (イベントループは run() を呼んだスレッドで回す)
+    struct proxy_server
+    {
+        io_context ctx;
+        reverse_proxy proxy;
+        std::expected<server, std::error_code> svr;
+
+        explicit proxy_server(proxy_options options, server_options server_options = {})
+            : proxy(std::move(options)), svr(server::create(ctx, 0, server_options)) {
+            EXPECT_TRUE(svr.has_value());
+            if (!svr) return;
+            std::vector<route_entry> routes;
+            proxy.mount(routes, "/*path");
+            svr->load_routes(routes);
+            EXPECT_TRUE(svr->start().has_value());
+        }
+
+        // 別のスレッドで client(port) を実行し、戻ったらイベントループを止める
+        template <typename Client>
+        void run(Client client) {
+            if (!svr) return;
+            std::thread t([&, port = svr->port()] {
+                client(port);
+                ctx.stop();
+            });
+            ctx.run();
+            t.join();
+        }
+
+        upstream_pool &pool() { return svr->proxy_pool(proxy.route()); }
+    };
+
+    proxy_options options_for(std::initializer_list<uint16_t> ports) {
+        proxy_options options;
+        for (uint16_t port : ports) options.backends.push_back({ "127.0.0.1", port });
+        return options;
+    }
+}
+
+TEST(ReverseProxyTest, RoundRobinAlternatesBackends) {
+    loopback_backend a(serve("a"));
+    loopback_backend b(serve("b"));
+    proxy_server proxy(options_for({ a.port(), b.port() }));
+
+    std::vector<std::string> bodies;
+    proxy.run([&](uint16_t port) {
+        for (int i = 0; i < 4; ++i) bodies.push_back(get(port, "/x").body);
+    });
+    EXPECT_EQ(bodies, (std::vector<std::string>{ "a", "b", "a", "b" }));
+}
+
+TEST(ReverseProxyTest, LeastOutstandingAvoidsBusyBackend) {
+    // a は最初のリクエストへの応答を release まで保留する
+    std::atomic<int> a_received{ 0 };
+    std::atomic<bool> release{ false };
+    loopback_backend a([&](int fd) {
+        std::string buffer;
+        while (!read_request(fd, buffer).empty()) {
+            if (a_received++ == 0) {
+                for (int i = 0; i < 5000 && !release; ++i) std::this_thread::sleep_for(milliseconds(1));
+            }
+            if (!write_all(fd, ok_response("a"))) return;
+        }
+    });
+    loopback_backend b(serve("b"));
+    proxy_options options = options_for({ a.port(), b.port() });
+    options.balance = balance_policy::least_outstanding;
+    proxy_server proxy(options);
+
+    std::string first;
+    std::vector<std::string> bodies;
+    proxy.run([&](uint16_t port) {
+        std::thread slow([&] { first = get(port, "/slow").body; });
+        while (a_received == 0) std::this_thread::sleep_for(milliseconds(1));
+        // a は処理中のため、順番が a に回っても b を選ぶ
+        for (int i = 0; i < 3; ++i) bodies.push_back(get(port, "/x").body);
+        release = true;
+        slow.join();
+    });
+    EXPECT_EQ(first, "a");
+    EXPECT_EQ(bodies, (std::vector<std::string>{ "b", "b", "b" }));
+    EXPECT_EQ(a_received, 1);
+}
+
+TEST(ReverseProxyTest, SkipsFailingBackendUntilFailTimeout) {
+    // a は healthy になるまで不正なレスポンスを返す
+    std::atomic<bool> healthy{ false };
+    loopback_backend a([&](int fd) {
+        std::string buffer;
+        while (!read_request(fd, buffer).empty()) {
+            if (!write_all(fd, healthy ? ok_response("a") : "HTTP/1.1 abc\r\n\r\n")) return;
+        }
+    });
+    loopback_backend b(serve("b"));
+    proxy_options options = options_for({ a.port(), b.port() });
+    options.max_fails = 2;
+    options.fail_timeout = milliseconds(300);
+    proxy_server proxy(options);
+
+    std::vector<raw_response> before, after;
+    proxy.run([&](uint16_t port) {
+        for (int i = 0; i < 6; ++i) before.push_back(get(port, "/x"));
+        healthy = true;
+        std::this_thread::sleep_for(milliseconds(400));
+        for (int i = 0; i < 2; ++i) after.push_back(get(port, "/x"));
+    });
+
+    ASSERT_EQ(before.size(), 6u);
+    // 2回目の失敗で a は停止中になり、以降は b だけに割り当てる
+    EXPECT_EQ(before[0].status, 502);
+    EXPECT_EQ(before[1].body, "b");
+    EXPECT_EQ(before[2].status, 502);
+    for (size_t i = 3; i < before.size(); ++i) EXPECT_EQ(before[i].body, "b") << i;
+    // fail_timeout を過ぎたら再び割り当てる
+    ASSERT_EQ(after.size(), 2u);
+    EXPECT_EQ(after[0].body, "a");
+    EXPECT_EQ(after[1].body, "b");
+}
+
+TEST(ReverseProxyTest, PoolRecoversBackendAfterFailTimeout) {
+    proxy_route route;
+    route.options.max_fails = 2;
+    route.options.fail_timeout = milliseconds(1000);
+    route.backends.resize(2);
+    route.backends[0].name = "a";
+    route.backends[1].name = "b";
+    upstream_pool pool(route);
+    auto t0 = upstream_pool::clock::now();
+
+    // 連続しない失敗は数えない
+    pool.report(0, false, t0);
+    pool.report(0, true, t0);
+    pool.report(0, false, t0);
+    for (int i = 0; i < 4; ++i) {
+        size_t index = pool.select(t0);
+        pool.done(index);
+        EXPECT_EQ(index, static_cast<size_t>(i % 2)) << i;
+    }
+
+    pool.report(0, false, t0);
+    for (int i = 0; i < 4; ++i) {
+        size_t index = pool.select(t0 + milliseconds(999));
+        pool.done(index);
+        EXPECT_EQ(index, 1u) << i;
+    }
+    size_t index = pool.select(t0 + milliseconds(1001));
+    pool.done(index);
+    EXPECT_EQ(index, 0u);
+}
+
+TEST(ReverseProxyTest, RetriesStaleConnectionForIdempotentMethod) {
+    // 上流は1つのレスポンスごとに接続を閉じる (プールの接続は次のリクエストの時点で閉じられている)
+    loopback_backend backend([](int fd) {
+        std::string buffer;
+        if (!read_request(fd, buffer).empty()) write_all(fd, ok_response("fresh"));
+    });
+    proxy_server proxy(options_for({ backend.port() }));
+
+    std::vector<raw_response> responses;
+    proxy.run([&](uint16_t port) {
+        responses.push_back(get(port, "/a"));
+        std::this_thread::sleep_for(milliseconds(20));
+        responses.push_back(get(port, "/b"));
+        std::this_thread::sleep_for(milliseconds(20));
+        responses.push_back(send_request(port, "POST /c HTTP/1.1\r\nHost: localhost\r\nContent-Length: 1\r\n"
+                                           "Connection: close\r\n\r\nx"));
+    });
+
+    ASSERT_EQ(responses.size(), 3u);
+    EXPECT_EQ(responses[0].body, "fresh");
+    // GET は新しい接続で送り直す
+    EXPECT_EQ(responses[1].status, 200);
+    EXPECT_EQ(responses[1].body, "fresh");
+    // POST は上流が処理した可能性があるため送り直さない
+    EXPECT_EQ(responses[2].status, 502);
+    EXPECT_EQ(backend.connections(), 2u);
+    EXPECT_EQ(proxy.pool().connections_opened(), 2u);
+}
+
+TEST(ReverseProxyTest, ReturnsBadGatewayWhenConnectionRefused) {
+    proxy_server proxy(options_for({ closed_port() }));
+    raw_response res;
+    proxy.run([&](uint16_t port) { res = get(port, "/x"); });
+    EXPECT_EQ(res.status, 502);
+}
+
+TEST(ReverseProxyTest, ReturnsBadGatewayForInvalidResponse) {
+    loopback_backend backend([](int fd) {
+        std::string buffer;
+        if (!read_request(fd, buffer).empty()) write_all(fd, "HTTP/1.1 abc\r\n\r\n");
+    });
+    proxy_server proxy(options_for({ backend.port() }));
+    raw_response res;
+    proxy.run([&](uint16_t port) { res = get(port, "/x"); });
+    EXPECT_EQ(res.status, 502);
+}
+
+TEST(ReverseProxyTest, ReturnsGatewayTimeoutWhenBackendIsSlow) {
+    // リクエストを受け取ったまま応答しない (プロキシが閉じるまで待つ)
+    loopback_backend backend([](int fd) {
+        std::string buffer;
+        if (!read_request(fd, buffer).empty()) read_request(fd, buffer);
+    });
+    proxy_options options = options_for({ backend.port() });
+    options.read_timeout = milliseconds(100);
+    proxy_server proxy(options);
+
+    raw_response res;
+    proxy.run([&](uint16_t port) { res = get(port, "/x"); });
+    EXPECT_EQ(res.status, 504);
+}
+
+TEST(ReverseProxyTest, SplicesBodyLargerThanPipe) {
+    std::string body = pattern_body(1 << 20);
+    loopback_backend backend(serve(body));
+    server_options server_options;
+    server_options.file_pipe_size = 4096;
+    proxy_server proxy(options_for({ backend.port() }), server_options);
+
+    std::vector<raw_response> responses;
+    proxy.run([&](uint16_t port) {
+        for (int i = 0; i < 2; ++i) responses.push_back(get(port, "/large"));
+    });
+    ASSERT_EQ(responses.size(), 2u);
+    for (const auto &res : responses) {
+        EXPECT_EQ(res.status, 200);
+        EXPECT_EQ(res.body.size(), body.size());
+        EXPECT_TRUE(res.body == body);
+    }
+    // ボディを最後まで転送した接続は再利用される
+    EXPECT_EQ(proxy.pool().connections_opened(), 1u);
+}
+
+TEST(ReverseProxyTest, ForwardsChunkedBodyVerbatim) {
+    std::string encoded = encode_chunked(pattern_body(300000), 1000);
+    // 拡張とトレーラーもそのまま届く
+    encoded.insert(0, "0a;ext=1\r\n0123456789\r\n");
+    encoded.insert(encoded.size() - 2, "X-Trailer: t\r\n");
+    loopback_backend backend([&encoded](int fd) {
+        std::string buffer;
+        while (!read_request(fd, buffer).empty()) {
+            if (!write_all(fd, std::string(chunked_head) + encoded)) return;
+        }
+    });
+    server_options server_options;
+    server_options.file_pipe_size = 4096;
+    proxy_server proxy(options_for({ backend.port() }), server_options);
+
+    std::vector<raw_response> responses;
+    proxy.run([&](uint16_t port) {
+        for (int i = 0; i < 2; ++i) responses.push_back(get(port, "/chunked"));
+    });
+    ASSERT_EQ(responses.size(), 2u);
+    for (const auto &res : responses) {
+        EXPECT_EQ(res.status, 200);
+        EXPECT_NE(res.head.find("Transfer-Encoding: chunked\r\n"), std::string::npos);
+        EXPECT_EQ(res.body.size(), encoded.size());
+        EXPECT_TRUE(res.body == encoded);
+    }
+    // 最後のチャンクまで転送した接続は再利用される
+    EXPECT_EQ(proxy.pool().connections_opened(), 1u);
+}
+
+TEST(ReverseProxyTest, ForwardsChunkedBodySplitAcrossReceives) {
+    // 長さの行・データ・トレーラーを別々に送る
+    const std::vector<std::string_view> pieces = { chunked_head, "5\r\nhel", "lo\r\n6;ext=1", "\r\n world\r\n0\r\n",
+        "X-Trailer: t\r\n", "\r\n" };
+    loopback_backend backend([&pieces](int fd) {
+        std::string buffer;
+        if (read_request(fd, buffer).empty()) return;
+        for (std::string_view piece : pieces) {
+            write_all(fd, piece);
+            std::this_thread::sleep_for(milliseconds(5));
+        }
+        read_request(fd, buffer);
+    });
+    proxy_server proxy(options_for({ backend.port() }));
+
+    raw_response res;
+    proxy.run([&](uint16_t port) { res = get(port, "/x"); });
+    EXPECT_EQ(res.status, 200);
+    EXPECT_EQ(res.body, "5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\nX-Trailer: t\r\n\r\n");
+}
+
+TEST(ReverseProxyTest, DecodesChunkedBodyForHttp10Client) {
+    // HTTP/1.0 のクライアントにはデータだけを送り、接続を閉じてボディの終わりを伝える
+    loopback_backend backend([](int fd) {
+        std::string buffer;
+        while (!read_request(fd, buffer).empty()) {
+            if (!write_all(fd, std::string(chunked_head) + encode_chunked("hello chunked world", 4))) return;
+        }
+    });
+    proxy_server proxy(options_for({ backend.port() }));
+
+    raw_response res;
+    proxy.run([&](uint16_t port) { res = send_request(port, "GET /x HTTP/1.0\r\nHost: localhost\r\n\r\n"); });
+    EXPECT_EQ(res.status, 200);
+    EXPECT_EQ(res.head.find("Transfer-Encoding"), std::string::npos);
+    EXPECT_EQ(res.body, "hello chunked world");
+}
+
+TEST(ReverseProxyTest, ClosesClientOnTruncatedChunkedBody) {
+    // ボディの途中で上流が閉じた: 最後のチャンクを送らずにクライアントの接続を閉じる
+    loopback_backend backend([](int fd) {
+        std::string buffer;
+        if (!read_request(fd, buffer).empty()) write_all(fd, std::string(chunked_head) + "a\r\nhello");
+    });
+    proxy_server proxy(options_for({ backend.port() }));
+
+    raw_response res;
+    proxy.run([&](uint16_t port) { res = get(port, "/x"); });
+    EXPECT_EQ(res.status, 200);
+    EXPECT_EQ(res.body, "a\r\nhello");
+    EXPECT_EQ(proxy.pool().idle_connections(0), 0u);
+}
@@ -0,0 +1,187 @@
+#include "ouroboros/http/io_context.hpp"
+#include "ouroboros/http/server.hpp"
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace ouroboros::http;
+
+namespace
+{
+    // このスレッドのヒープ割り当て回数 (counting が true の間だけ数える)
+    // イベントループのスレッドだけで有効にし、クライアントのスレッドの割り当ては数えない
+    thread_local bool counting = false;
+    thread_local size_t heap_allocations = 0;
+
+    void *counted_allocate(size_t size, size_t alignment) {
+        if (counting) ++heap_allocations;
+        if (size == 0) size = 1;
+        void *p = alignment > alignof(std::max_align_t)
+            ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+            : std::malloc(size);
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+}
+
+// 全てのヒープ割り当てを数える (アリーナを経由しない割り当ても検出する)
+void *operator new(size_t size) { return counted_allocate(size, alignof(std::max_align_t)); }
+void *operator new[](size_t size) { return counted_allocate(size, alignof(std::max_align_t)); }
+void *operator new(size_t size, std::align_val_t alignment) { return counted_allocate(size, static_cast<size_t>(alignment)); }
+void *operator new[](size_t size, std::align_val_t alignment) { return counted_allocate(size, static_cast<size_t>(alignment)); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace
+{
+    // 一つの Keep-Alive 接続でリクエストを順に送り、レスポンスのボディを返す (失敗したら空)
+    std::vector<std::string> keep_alive_client(uint16_t port, size_t requests) {
+        std::vector<std::string> bodies;
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return bodies;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            ::close(fd);
+            return bodies;
+        }
+
+        constexpr std::string_view request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        std::string received;
+        char buf[4096];
+        for (size_t i = 0; i < requests; ++i) {
+            if (::send(fd, request.data(), request.size(), 0) != static_cast<ssize_t>(request.size())) break;
+            // ヘッダーの終わりと Content-Length の分のボディが揃うまで読む
+            size_t head_end = std::string::npos;
+            size_t length = 0;
+            while (head_end == std::string::npos || received.size() < head_end + length) {
+                ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0) {
+                    ::close(fd);
+                    return bodies;
+                }
+                received.append(buf, static_cast<size_t>(n));
+                if (head_end == std::string::npos && (head_end = received.find("\r\n\r\n")) != std::string::npos) {
+                    head_end += 4;
+                    size_t field = received.find("Content-Length: ");
+                    if (field == std::string::npos || field > head_end) break;
+                    length = std::strtoul(received.c_str() + field + 16, nullptr, 10);
+                }
+            }
+            bodies.push_back(received.substr(head_end, length));
+            received.erase(0, head_end + length);
+        }
+        ::close(fd);
+        return bodies;
+    }
+
+    // ハンドラが呼ばれた時点の状態
+    struct arena_sample
+    {
+        size_t heap_allocations;  // イベントループのスレッドのヒープ割り当て回数 (累計)
+        size_t upstream_allocations;
+        size_t upstream_bytes_in_use;
+        size_t blocks_in_use;     // 貸し出し中のアリーナのブロック数
+    };
+
+    // body を返すサーバーに Keep-Alive で requests 回リクエストし、各ハンドラ呼び出し時点の状態を返す
+    // (ハンドラと状態の読み出しはイベントループのスレッドで行う)
+    std::vector<arena_sample> serve_keep_alive(size_t arena_size, const std::string &body, size_t requests,
+        arena_sample &after) {
+        io_context ctx;
+        server_options options;
+        options.arena_size = arena_size;
+        // ポートはカーネルに選ばせる (並列に実行されるテストと衝突しない)
+        auto svr = server::create(ctx, 0, options);
+        EXPECT_TRUE(svr.has_value());
+        if (!svr) return {};
+
+        std::vector<arena_sample> samples;
+        samples.reserve(requests);
+        server *s = &*svr;
+        auto sample = [s] {
+            const arena_block_pool &blocks = s->arena_blocks();
+            return arena_sample{ heap_allocations, s->arena_upstream().allocations(), s->arena_upstream().bytes_in_use(),
+                blocks.blocks() - blocks.available() };
+        };
+        svr->load_routes({
+            { method::GET, "/", [&samples, &body, sample](const request &, response &res) {
+                samples.push_back(sample());
+                res.set_header("Content-Type", "text/plain");
+                res.set_header("Cache-Control", "no-store");
+                res.set_header("X-Request", "keep-alive");
+                res.set_body(body);
+            } },
+        });
+        EXPECT_TRUE(svr->start().has_value());
+
+        std::vector<std::string> bodies;
+        std::thread client([&, port = svr->port()] {
+            bodies = keep_alive_client(port, requests);
+            ctx.stop();
+        });
+        counting = true;
+        ctx.run();
+        counting = false;
+        client.join();
+
+        EXPECT_EQ(bodies.size(), requests);
+        for (const auto &received : bodies) EXPECT_EQ(received, body);
+        after = sample();
+        return samples;
+    }
+}
+
+TEST(SessionArenaTest, KeepAliveRequestsDoNotAllocate) {
+    // レスポンス (ヘッダー3つと 1KiB のボディ) はアリーナのブロックに収まる
+    std::string body(1024, 'a');
+    arena_sample after{};
+    auto samples = serve_keep_alive(8 * 1024, body, 16, after);
+    ASSERT_EQ(samples.size(), 16u);
+
+    // 最初のリクエスト (セッション・出力バッファ・ブロックの確保) の後は、
+    // write_response と recycle_response を経てもヒープ割り当ては起きない
+    for (size_t i = 1; i < samples.size(); ++i) {
+        EXPECT_EQ(samples[i].heap_allocations, samples[1].heap_allocations) << "request " << i;
+        EXPECT_EQ(samples[i].upstream_allocations, samples.front().upstream_allocations) << "request " << i;
+    }
+    EXPECT_EQ(after.upstream_allocations, samples.front().upstream_allocations);
+    EXPECT_EQ(after.upstream_bytes_in_use, 0u);
+}
+
+TEST(SessionArenaTest, IdleConnectionHoldsNoBlock) {
+    arena_sample after{};
+    auto samples = serve_keep_alive(8 * 1024, std::string(64, 'c'), 4, after);
+    ASSERT_EQ(samples.size(), 4u);
+
+    // 前のレスポンスを書き終えて待機している間、接続はブロックを返している
+    for (const auto &sample : samples) EXPECT_EQ(sample.blocks_in_use, 0u);
+    EXPECT_EQ(after.blocks_in_use, 0u);
+}
+
+TEST(SessionArenaTest, OverflowIsReturnedOnRecycle) {
+    // ブロックに収まらないボディは上位リソースから割り当てられ、次のリクエストまでに返却される
+    arena_sample after{};
+    auto samples = serve_keep_alive(256, std::string(4096, 'b'), 8, after);
+    ASSERT_EQ(samples.size(), 8u);
+
+    for (const auto &sample : samples) EXPECT_EQ(sample.upstream_bytes_in_use, 0u);
+    EXPECT_GT(after.upstream_allocations, samples.front().upstream_allocations);
+    EXPECT_EQ(after.upstream_bytes_in_use, 0u);
+}
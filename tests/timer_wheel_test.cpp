@@ -0,0 +1,233 @@
+#include "ouroboros/http/timer_wheel.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+
+using namespace ouroboros::http;
+
+namespace
+{
+    using std::chrono::milliseconds;
+
+    // 発火の回数と結果を記録するタスク (on_fire はコールバック内の処理)
+    struct recorder : task
+    {
+        size_t fired = 0;
+        int result = 0;
+        std::function<void()> on_fire;
+
+        void complete(int res, uint32_t) override {
+            fired++;
+            result = res;
+            if (on_fire) on_fire();
+        }
+    };
+
+    // 固定した時刻をティック 0 とするホイール (時間は advance(at(ms)) で進める)
+    struct fixed_wheel
+    {
+        timer_wheel::clock::time_point origin = timer_wheel::clock::now();
+        timer_wheel wheel{ origin };
+
+        timer_wheel::clock::time_point at(int64_t ms) const { return origin + milliseconds(ms); }
+        void arm(timer &t, int64_t after, int64_t now = 0) { wheel.arm(t, milliseconds(after), at(now)); }
+    };
+}
+
+TEST(TimerWheelTest, FiresOnExpiryTickAtEveryLevel) {
+    // 100ms は階層1、5000ms は階層2、300000ms は階層3 に置かれ、振り分けを経て期限のティックで発火する
+    for (int64_t after : { 10, 63, 64, 100, 4095, 4096, 5000, 262143, 262144, 300000 }) {
+        fixed_wheel w;
+        recorder r;
+        timer t(r);
+        w.arm(t, after);
+
+        EXPECT_EQ(w.wheel.advance(w.at(after - 1)), 0u) << after;
+        EXPECT_TRUE(t.armed()) << after;
+        EXPECT_EQ(w.wheel.advance(w.at(after)), 1u) << after;
+        EXPECT_FALSE(t.armed()) << after;
+        EXPECT_EQ(r.fired, 1u) << after;
+        EXPECT_EQ(r.result, -ETIME) << after;
+        EXPECT_TRUE(w.wheel.empty()) << after;
+    }
+}
+
+TEST(TimerWheelTest, CascadesStepByStep) {
+    // 各階層の振り分けの時刻 (64 / 4096 / 262144 の倍数) ちょうどに止まりながら進める
+    fixed_wheel w;
+    recorder level1, level2, level3;
+    timer t1(level1), t2(level2), t3(level3);
+    w.arm(t1, 100);
+    w.arm(t2, 5000);
+    w.arm(t3, 300000);
+
+    size_t fired = 0;
+    int64_t now = 0;
+    while (now < 300000) {
+        now = std::min<int64_t>((now / 64 + 1) * 64, 300000);
+        fired += w.wheel.advance(w.at(now));
+        EXPECT_EQ(level1.fired, now >= 100 ? 1u : 0u) << now;
+        EXPECT_EQ(level2.fired, now >= 5000 ? 1u : 0u) << now;
+        EXPECT_EQ(level3.fired, now >= 300000 ? 1u : 0u) << now;
+        if (HasFailure()) return;
+    }
+    EXPECT_EQ(fired, 3u);
+    EXPECT_TRUE(w.wheel.empty());
+}
+
+TEST(TimerWheelTest, FiresTimersInSameSlotTogether) {
+    fixed_wheel w;
+    recorder a, b, later;
+    timer ta(a), tb(b), tl(later);
+    w.arm(ta, 5000);
+    w.arm(tb, 5000);
+    // 同じ上位スロット (4096〜8191) に入るが、振り分け後は別のスロット
+    w.arm(tl, 5001);
+
+    EXPECT_EQ(w.wheel.advance(w.at(5000)), 2u);
+    EXPECT_EQ(later.fired, 0u);
+    EXPECT_EQ(w.wheel.size(), 1u);
+    EXPECT_EQ(w.wheel.advance(w.at(5001)), 1u);
+}
+
+TEST(TimerWheelTest, ReportsNoTimeoutWhenEmpty) {
+    fixed_wheel w;
+    EXPECT_LT(w.wheel.next_timeout(w.at(0)), milliseconds(0));
+
+    recorder r;
+    timer t(r);
+    w.arm(t, 10);
+    t.cancel();
+    EXPECT_LT(w.wheel.next_timeout(w.at(0)), milliseconds(0));
+}
+
+TEST(TimerWheelTest, NextTimeoutSkipsEmptySlots) {
+    fixed_wheel w;
+    recorder first, second;
+    timer t1(first), t2(second);
+    w.arm(t1, 10);
+    w.arm(t2, 50);
+
+    EXPECT_EQ(w.wheel.next_timeout(w.at(0)), milliseconds(10));
+    EXPECT_EQ(w.wheel.next_timeout(w.at(4)), milliseconds(6));
+    EXPECT_EQ(w.wheel.advance(w.at(10)), 1u);
+    // 11〜49 の空のスロットを飛ばす
+    EXPECT_EQ(w.wheel.next_timeout(w.at(10)), milliseconds(40));
+    // 時刻が期限を過ぎていれば 0
+    EXPECT_EQ(w.wheel.next_timeout(w.at(60)), milliseconds(0));
+}
+
+TEST(TimerWheelTest, NextTimeoutWrapsAroundLowestLevel) {
+    fixed_wheel w;
+    w.wheel.advance(w.at(60));
+
+    // 60 + 10 = 70 はスロット 6 (現在のスロット 60 より前の番号) に置かれる
+    recorder r;
+    timer t(r);
+    w.arm(t, 10, 60);
+    EXPECT_EQ(w.wheel.next_timeout(w.at(60)), milliseconds(10));
+    EXPECT_EQ(w.wheel.advance(w.at(69)), 0u);
+    EXPECT_EQ(w.wheel.advance(w.at(70)), 1u);
+}
+
+TEST(TimerWheelTest, NextTimeoutStopsAtCascade) {
+    fixed_wheel w;
+    recorder r;
+    timer t(r);
+    w.arm(t, 5000);
+
+    // 期限より前に、上位の階層から振り分ける時刻 (4096、次に 4992) で起きる必要がある
+    EXPECT_EQ(w.wheel.next_timeout(w.at(0)), milliseconds(4096));
+    EXPECT_EQ(w.wheel.advance(w.at(4096)), 0u);
+    EXPECT_EQ(w.wheel.next_timeout(w.at(4096)), milliseconds(4992 - 4096));
+    EXPECT_EQ(w.wheel.advance(w.at(4992)), 0u);
+    EXPECT_EQ(w.wheel.next_timeout(w.at(4992)), milliseconds(8));
+    EXPECT_EQ(w.wheel.advance(w.at(5000)), 1u);
+    EXPECT_LT(w.wheel.next_timeout(w.at(5000)), milliseconds(0));
+}
+
+TEST(TimerWheelTest, CancelsAfterCascade) {
+    // 階層3 -> 2 -> 1 -> 0 と振り分けられた後のどの時点でも解除できる
+    // 300000 は 262144 で階層2、299008 で階層1、299968 で階層0 へ振り分けられる
+    for (int64_t cancel_at : { 262144, 299008, 299968, 299999 }) {
+        fixed_wheel w;
+        recorder r, other;
+        timer t(r), neighbour(other);
+        w.arm(t, 300000);
+        w.arm(neighbour, 300000);
+
+        EXPECT_EQ(w.wheel.advance(w.at(cancel_at)), 0u) << cancel_at;
+        t.cancel();
+        EXPECT_FALSE(t.armed()) << cancel_at;
+        EXPECT_EQ(w.wheel.size(), 1u) << cancel_at;
+
+        // 同じスロットに残ったタイマーは予定どおり発火する
+        EXPECT_EQ(w.wheel.advance(w.at(300000)), 1u) << cancel_at;
+        EXPECT_EQ(r.fired, 0u) << cancel_at;
+        EXPECT_EQ(other.fired, 1u) << cancel_at;
+        EXPECT_LT(w.wheel.next_timeout(w.at(300000)), milliseconds(0)) << cancel_at;
+    }
+}
+
+TEST(TimerWheelTest, RearmReplacesEarlierRegistration) {
+    fixed_wheel w;
+    recorder r;
+    timer t(r);
+    w.arm(t, 5000);
+    w.wheel.advance(w.at(4096));
+    // 振り分け後に付け替える
+    w.arm(t, 20, 4096);
+    EXPECT_EQ(w.wheel.size(), 1u);
+
+    EXPECT_EQ(w.wheel.advance(w.at(4116)), 1u);
+    EXPECT_EQ(w.wheel.advance(w.at(6000)), 0u);
+    EXPECT_EQ(r.fired, 1u);
+}
+
+TEST(TimerWheelTest, RearmsFromCallback) {
+    fixed_wheel w;
+    recorder r;
+    timer t(r);
+    // 発火中のティック (advance の途中) を基準に 10ms ごとに登録し直す
+    r.on_fire = [&] {
+        if (r.fired < 10) w.wheel.arm(t, milliseconds(10), w.origin);
+    };
+    w.arm(t, 10);
+
+    EXPECT_EQ(w.wheel.advance(w.at(95)), 9u);
+    EXPECT_TRUE(t.armed());
+    EXPECT_EQ(w.wheel.advance(w.at(1000)), 1u);
+    EXPECT_EQ(r.fired, 10u);
+    EXPECT_FALSE(t.armed());
+}
+
+TEST(TimerWheelTest, RearmWithZeroDelayFiresOnNextTick) {
+    fixed_wheel w;
+    recorder r;
+    timer t(r);
+    // 1 ティック未満は切り上げるため、同じティックの中で発火し続けることはない
+    r.on_fire = [&] {
+        if (r.fired < 3) w.wheel.arm(t, milliseconds(0), w.origin);
+    };
+    w.arm(t, 0);
+
+    EXPECT_EQ(w.wheel.advance(w.at(1)), 1u);
+    EXPECT_EQ(w.wheel.advance(w.at(2)), 1u);
+    EXPECT_EQ(w.wheel.advance(w.at(100)), 1u);
+    EXPECT_EQ(r.fired, 3u);
+}
+
+TEST(TimerWheelTest, CallbackMayCancelTimerDueInSameTick) {
+    fixed_wheel w;
+    recorder first, second;
+    timer t1(first), t2(second);
+    first.on_fire = [&] { t2.cancel(); };
+    w.arm(t1, 100);
+    w.arm(t2, 100);
+
+    EXPECT_EQ(w.wheel.advance(w.at(100)), 1u);
+    EXPECT_EQ(first.fired, 1u);
+    EXPECT_EQ(second.fired, 0u);
+    EXPECT_TRUE(w.wheel.empty());
+}
@@ -0,0 +1,195 @@
+#include "ouroboros/http/websocket_protocol.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+
+using namespace ouroboros::http;
+
+namespace
+{
+    constexpr unsigned char mask_key[4] = { 0x12, 0x34, 0x56, 0x78 };
+
+    // クライアントのフレーム (マスク付き) を組み立てる
+    // length_code: 126 / 127 なら拡張長で、それ以外は7ビットの長さで payload.size() を表す
+    std::string client_frame(uint8_t first_byte, std::string_view payload, unsigned length_code = 0) {
+        std::string frame;
+        frame.push_back(static_cast<char>(first_byte));
+        uint64_t length = payload.size();
+        if (length_code == 0) length_code = length < 126 ? static_cast<unsigned>(length) : length <= 0xffff ? 126 : 127;
+        frame.push_back(static_cast<char>(0x80 | length_code));
+        size_t extended = length_code == 126 ? 2 : length_code == 127 ? 8 : 0;
+        for (size_t i = extended; i > 0; --i) frame.push_back(static_cast<char>((length >> ((i - 1) * 8)) & 0xff));
+        frame.append(reinterpret_cast<const char *>(mask_key), 4);
+        for (size_t i = 0; i < payload.size(); ++i) frame.push_back(static_cast<char>(payload[i] ^ mask_key[i % 4]));
+        return frame;
+    }
+
+    // フレームのヘッダーだけを組み立てる (拡張長の値を直接指定する)
+    std::string client_header(uint8_t first_byte, unsigned length_code, uint64_t extended_length) {
+        std::string frame;
+        frame.push_back(static_cast<char>(first_byte));
+        frame.push_back(static_cast<char>(0x80 | length_code));
+        size_t extended = length_code == 126 ? 2 : length_code == 127 ? 8 : 0;
+        for (size_t i = extended; i > 0; --i) frame.push_back(static_cast<char>((extended_length >> ((i - 1) * 8)) & 0xff));
+        frame.append(reinterpret_cast<const char *>(mask_key), 4);
+        return frame;
+    }
+
+    struct parse_result
+    {
+        websocket_parser::status status;
+        std::string payload;
+    };
+
+    // frame を step バイトずつ渡して一つのフレームのペイロードを集める
+    parse_result parse_frame(websocket_parser &parser, std::string frame, size_t step) {
+        parse_result result{ websocket_parser::status::incomplete, {} };
+        for (size_t offset = 0; offset < frame.size();) {
+            size_t n = std::min(step, frame.size() - offset);
+            size_t used = 0;
+            while (used < n) {
+                size_t consumed = 0;
+                std::string_view piece;
+                result.status = parser.parse(frame.data() + offset + used, n - used, consumed, piece);
+                if (result.status == websocket_parser::status::error) return result;
+                result.payload.append(piece);
+                used += consumed;
+                if (result.status == websocket_parser::status::payload && parser.frame_complete()) return result;
+                if (result.status == websocket_parser::status::incomplete) break;
+            }
+            offset += n;
+        }
+        return result;
+    }
+}
+
+TEST(WebSocketParserTest, ParsesMaskedTextFrame) {
+    websocket_parser parser(1 << 20);
+
+    auto result = parse_frame(parser, client_frame(0x81, "hello"), 64);
+    ASSERT_EQ(result.status, websocket_parser::status::payload);
+    EXPECT_EQ(parser.frame().opcode, websocket_opcode::text);
+    EXPECT_TRUE(parser.frame().fin);
+    EXPECT_EQ(result.payload, "hello");
+}
+
+TEST(WebSocketParserTest, ParsesSixteenBitExtendedLength) {
+    websocket_parser parser(1 << 20);
+    std::string payload(300, 'x');
+
+    auto result = parse_frame(parser, client_frame(0x82, payload), 1 << 20);
+    ASSERT_EQ(result.status, websocket_parser::status::payload);
+    EXPECT_EQ(parser.frame().length, 300u);
+    EXPECT_EQ(result.payload, payload);
+}
+
+TEST(WebSocketParserTest, ParsesSixtyFourBitExtendedLength) {
+    websocket_parser parser(1 << 20);
+    std::string payload(70000, 'y');
+
+    auto result = parse_frame(parser, client_frame(0x82, payload), 1 << 20);
+    ASSERT_EQ(result.status, websocket_parser::status::payload);
+    EXPECT_EQ(parser.frame().length, 70000u);
+    EXPECT_EQ(result.payload, payload);
+}
+
+TEST(WebSocketParserTest, ResumesHeaderSplitAtEveryByte) {
+    websocket_parser parser(1 << 20);
+    std::string payload(1000, 'z');
+
+    // 127 の拡張長 (ヘッダー 14 バイト) を1バイトずつ受信する
+    auto result = parse_frame(parser, client_frame(0x82, payload, 127), 1);
+    ASSERT_EQ(result.status, websocket_parser::status::payload);
+    EXPECT_EQ(parser.frame().length, 1000u);
+    EXPECT_EQ(result.payload, payload);
+}
+
+TEST(WebSocketParserTest, RejectsSixtyFourBitLengthWithHighBitSet) {
+    websocket_parser parser(~uint64_t{ 0 });
+
+    auto result = parse_frame(parser, client_header(0x82, 127, uint64_t{ 1 } << 63), 64);
+    EXPECT_EQ(result.status, websocket_parser::status::error);
+    EXPECT_EQ(parser.error_code(), websocket_close::protocol_error);
+}
+
+TEST(WebSocketParserTest, RejectsFrameLargerThanLimit) {
+    websocket_parser parser(1000);
+
+    auto result = parse_frame(parser, client_header(0x82, 126, 1001), 64);
+    EXPECT_EQ(result.status, websocket_parser::status::error);
+    EXPECT_EQ(parser.error_code(), websocket_close::message_too_big);
+}
+
+TEST(WebSocketParserTest, RejectsReservedBits) {
+    for (int rsv : { 0x40, 0x20, 0x10 }) {
+        websocket_parser parser(1 << 20);
+
+        auto result = parse_frame(parser, client_frame(static_cast<uint8_t>(0x81 | rsv), "hi"), 64);
+        EXPECT_EQ(result.status, websocket_parser::status::error);
+        EXPECT_EQ(parser.error_code(), websocket_close::protocol_error);
+    }
+}
+
+TEST(WebSocketParserTest, RejectsReservedOpcode) {
+    websocket_parser parser(1 << 20);
+
+    auto result = parse_frame(parser, client_frame(0x83, "hi"), 64);
+    EXPECT_EQ(result.status, websocket_parser::status::error);
+    EXPECT_EQ(parser.error_code(), websocket_close::protocol_error);
+}
+
+TEST(WebSocketParserTest, RejectsUnmaskedFrame) {
+    websocket_parser parser(1 << 20);
+    std::string frame = "\x81\x02hi";
+
+    auto result = parse_frame(parser, frame, 64);
+    EXPECT_EQ(result.status, websocket_parser::status::error);
+    EXPECT_EQ(parser.error_code(), websocket_close::protocol_error);
+}
+
+TEST(WebSocketParserTest, AcceptsControlFrameAtLimit) {
+    websocket_parser parser(1 << 20);
+    std::string payload(125, 'p');
+
+    auto result = parse_frame(parser, client_frame(0x89, payload), 64);
+    ASSERT_EQ(result.status, websocket_parser::status::payload);
+    EXPECT_EQ(parser.frame().opcode, websocket_opcode::ping);
+    EXPECT_EQ(result.payload, payload);
+}
+
+TEST(WebSocketParserTest, RejectsOversizedControlFrame) {
+    websocket_parser parser(1 << 20);
+
+    // 125 バイトを超える制御フレーム (拡張長を使う)
+    auto result = parse_frame(parser, client_frame(0x89, std::string(126, 'p')), 64);
+    EXPECT_EQ(result.status, websocket_parser::status::error);
+    EXPECT_EQ(parser.error_code(), websocket_close::protocol_error);
+}
+
+TEST(WebSocketParserTest, RejectsFragmentedControlFrame) {
+    websocket_parser parser(1 << 20);
+
+    // FIN の無いクローズフレーム
+    auto result = parse_frame(parser, client_frame(0x08, "\x03\xe8"), 64);
+    EXPECT_EQ(result.status, websocket_parser::status::error);
+    EXPECT_EQ(parser.error_code(), websocket_close::protocol_error);
+}
+
+TEST(WebSocketFrameHeaderTest, UsesShortestLengthEncoding) {
+    char header[max_frame_header];
+
+    EXPECT_EQ(write_frame_header(header, websocket_opcode::text, true, 125), 2u);
+    EXPECT_EQ(static_cast<unsigned char>(header[0]), 0x81);
+    EXPECT_EQ(static_cast<unsigned char>(header[1]), 125);
+
+    ASSERT_EQ(write_frame_header(header, websocket_opcode::binary, true, 126), 4u);
+    EXPECT_EQ(static_cast<unsigned char>(header[1]), 126);
+    EXPECT_EQ(static_cast<unsigned char>(header[2]), 0x00);
+    EXPECT_EQ(static_cast<unsigned char>(header[3]), 126);
+
+    ASSERT_EQ(write_frame_header(header, websocket_opcode::binary, false, 0x10000), 10u);
+    EXPECT_EQ(static_cast<unsigned char>(header[0]), 0x02);
+    EXPECT_EQ(static_cast<unsigned char>(header[1]), 127);
+    EXPECT_EQ(static_cast<unsigned char>(header[7]), 0x01);
+    EXPECT_EQ(static_cast<unsigned char>(header[9]), 0x00);
+}